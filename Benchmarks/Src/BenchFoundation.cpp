@@ -0,0 +1,435 @@
+// BenchFoundation.cpp
+//
+// Foundation module benchmarks. Each container or algorithm is measured at every size returned by GetSizes. Work is
+// repeated per call (see GetRepeats) so small sizes are not lost in timer noise, and the reported ns/op lets sizes be
+// compared directly. All data is generated deterministically with Hash so runs on different machines see the same
+// inputs.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <Foundation/tArray.h>
+#include <Foundation/tList.h>
+#include <Foundation/tMap.h>
+#include <Foundation/tString.h>
+#include <Foundation/tHash.h>
+#include <Foundation/tSort.h>
+#include <Foundation/tPriorityQueue.h>
+#include "BenchFoundation.h"
+
+
+namespace tBenchmark
+{
+	struct IntItem : public tLink<IntItem>
+	{
+		IntItem(int value = 0)																							: Value(value) { }
+		int Value;
+	};
+
+	// Returns a new array of size deterministic pseudo-random ints. Caller deletes.
+	int* NewRandomInts(int size, uint32 seed = 0);
+}
+
+
+int* tBenchmark::NewRandomInts(int size, uint32 seed)
+{
+	int* values = new int[size];
+	for (int i = 0; i < size; i++)
+		values[i] = int(Hash(uint32(i) + seed) & 0x7FFFFFFF);
+	return values;
+}
+
+
+namespace tBenchmark
+{
+
+
+tBenchUnit(FoundationArray)
+{
+	const int* sizes = nullptr;
+	int numSizes = GetSizes(sizes);
+	for (int s = 0; s < numSizes; s++)
+	{
+		int size = sizes[s];
+		int repeats = GetRepeats(size);
+		tString name;
+
+		tsPrintf(name, "tArray Append %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			for (int r = 0; r < repeats; r++)
+			{
+				tArray<int> array(0, 256);
+				for (int i = 0; i < size; i++)
+					array.Append(i);
+				tDoNotOptimize(array.GetNumElements());
+			}
+		});
+
+		// Random reads defeat the prefetcher once the array no longer fits in cache.
+		tArray<int> array(size, 256);
+		for (int i = 0; i < size; i++)
+			array.Append(i);
+		int* indices = NewRandomInts(size);
+		for (int i = 0; i < size; i++)
+			indices[i] %= size;
+
+		tsPrintf(name, "tArray RandomRead %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			int64 sum = 0;
+			for (int r = 0; r < repeats; r++)
+				for (int i = 0; i < size; i++)
+					sum += array[indices[i]];
+			tDoNotOptimize(sum);
+		});
+		delete[] indices;
+	}
+}
+
+
+tBenchUnit(FoundationList)
+{
+	const int* sizes = nullptr;
+	int numSizes = GetSizes(sizes);
+	for (int s = 0; s < numSizes; s++)
+	{
+		int size = sizes[s];
+		int repeats = GetRepeats(size);
+		int* values = NewRandomInts(size);
+		tString name;
+
+		// Includes the allocation of the items as that is how intrusive lists are used in practice.
+		tsPrintf(name, "tList Append %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			for (int r = 0; r < repeats; r++)
+			{
+				tList<IntItem> list;
+				for (int i = 0; i < size; i++)
+					list.Append(new IntItem(values[i]));
+				tDoNotOptimize(list.GetNumItems());
+			}
+		});
+
+		tList<IntItem> list;
+		for (int i = 0; i < size; i++)
+			list.Append(new IntItem(values[i]));
+
+		tsPrintf(name, "tList Iterate %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			int64 sum = 0;
+			for (int r = 0; r < repeats; r++)
+				for (IntItem* item = list.First(); item; item = item->Next())
+					sum += item->Value;
+			tDoNotOptimize(sum);
+		});
+
+		// Sorting a sorted list is a different (and much faster) test, so each call re-randomizes the values first.
+		// The re-randomize is a single pass and is small compared to the n log n sort.
+		tsPrintf(name, "tList MergeSort %d", size);
+		int sortRepeats = GetRepeats(size, 100000);
+		tMeasureOps(name.Chr(), size, int64(size)*sortRepeats, [&]()
+		{
+			for (int r = 0; r < sortRepeats; r++)
+			{
+				int i = 0;
+				for (IntItem* item = list.First(); item; item = item->Next(), i++)
+					item->Value = values[i];
+				list.Sort([](const IntItem& a, const IntItem& b) { return a.Value < b.Value; });
+			}
+		});
+
+		delete[] values;
+	}
+}
+
+
+tBenchUnit(FoundationMap)
+{
+	const int* sizes = nullptr;
+	int numSizes = GetSizes(sizes);
+	for (int s = 0; s < numSizes; s++)
+	{
+		int size = sizes[s];
+		int repeats = GetRepeats(size);
+		int* keys = NewRandomInts(size);
+		tString name;
+
+		tsPrintf(name, "tMap<int> Insert %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			for (int r = 0; r < repeats; r++)
+			{
+				tMap<int, int> map;
+				for (int i = 0; i < size; i++)
+					map[keys[i]] = i;
+				tDoNotOptimize(map.GetNumItems());
+			}
+		});
+
+		tMap<int, int> map;
+		for (int i = 0; i < size; i++)
+			map[keys[i]] = i;
+
+		tsPrintf(name, "tMap<int> LookupHit %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			int64 sum = 0;
+			for (int r = 0; r < repeats; r++)
+				for (int i = 0; i < size; i++)
+					sum += *map.GetValue(keys[i]);
+			tDoNotOptimize(sum);
+		});
+
+		// Keys are all <= 0x7FFFFFFF so setting the top bit guarantees a miss.
+		tsPrintf(name, "tMap<int> LookupMiss %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			int numFound = 0;
+			for (int r = 0; r < repeats; r++)
+				for (int i = 0; i < size; i++)
+					numFound += map.GetValue(int(uint32(keys[i]) | 0x80000000u)) ? 1 : 0;
+			tDoNotOptimize(numFound);
+		});
+
+		// String keys exercise the tString hash and compare.
+		tString* strKeys = new tString[size];
+		for (int i = 0; i < size; i++)
+			tsPrintf(strKeys[i], "Key_%08X", keys[i]);
+		int strRepeats = GetRepeats(size, 200000);
+
+		tsPrintf(name, "tMap<tString> Insert %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*strRepeats, [&]()
+		{
+			for (int r = 0; r < strRepeats; r++)
+			{
+				tMap<tString, int> strMap;
+				for (int i = 0; i < size; i++)
+					strMap[strKeys[i]] = i;
+				tDoNotOptimize(strMap.GetNumItems());
+			}
+		});
+
+		tMap<tString, int> strMap;
+		for (int i = 0; i < size; i++)
+			strMap[strKeys[i]] = i;
+
+		tsPrintf(name, "tMap<tString> LookupHit %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*strRepeats, [&]()
+		{
+			int64 sum = 0;
+			for (int r = 0; r < strRepeats; r++)
+				for (int i = 0; i < size; i++)
+					sum += *strMap.GetValue(strKeys[i]);
+			tDoNotOptimize(sum);
+		});
+
+		delete[] strKeys;
+		delete[] keys;
+	}
+}
+
+
+tBenchUnit(FoundationString)
+{
+	const int* sizes = nullptr;
+	int numSizes = GetSizes(sizes);
+	for (int s = 0; s < numSizes; s++)
+	{
+		int size = sizes[s];
+		int repeats = GetRepeats(size);
+		tString name;
+
+		// Appending one short piece at a time is the common pattern when building paths and messages.
+		tString piece("abcd");
+		tsPrintf(name, "tString Append %d", size);
+		int appendRepeats = GetRepeats(size, 100000);
+		tMeasureOps(name.Chr(), size, int64(size)*appendRepeats, [&]()
+		{
+			for (int r = 0; r < appendRepeats; r++)
+			{
+				tString str;
+				for (int i = 0; i < size; i++)
+					str += piece;
+				tDoNotOptimize(str.Length());
+			}
+		});
+
+		// A haystack of size characters with the needle only at the very end.
+		tString haystack;
+		haystack.Set(size);
+		for (int i = 0; i < size; i++)
+			haystack[i] = char('a' + (Hash(i) % 8));
+		const char* needle = "xyz";
+		if (size >= 3)
+		{
+			haystack[size-3] = 'x';
+			haystack[size-2] = 'y';
+			haystack[size-1] = 'z';
+		}
+
+		tsPrintf(name, "tString FindString %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			int64 sum = 0;
+			for (int r = 0; r < repeats; r++)
+			{
+				// The clobber stops the compiler hoisting the search out of the loop.
+				sum += haystack.FindString(needle);
+				tDoNotOptimize(sum);
+			}
+		});
+
+		tsPrintf(name, "tString Replace %d", size);
+		int replaceRepeats = GetRepeats(size, 200000);
+		tMeasureOps(name.Chr(), size, int64(size)*replaceRepeats, [&]()
+		{
+			for (int r = 0; r < replaceRepeats; r++)
+			{
+				tString copy(haystack);
+				tDoNotOptimize(copy.Replace("ab", "xyz"));
+			}
+		});
+	}
+}
+
+
+tBenchUnit(FoundationHash)
+{
+	// Hashes are measured in MB/s over buffers of every size. For small buffers the per-call overhead dominates.
+	const int* sizes = nullptr;
+	int numSizes = GetSizes(sizes);
+	for (int s = 0; s < numSizes; s++)
+	{
+		int size = sizes[s];
+		int repeats = GetRepeats(size, 10000000);
+		uint8* data = new uint8[size];
+		for (int i = 0; i < size; i++)
+			data[i] = uint8(Hash(i));
+
+		int64 numBytes = int64(size)*repeats;
+		tString name;
+
+		tsPrintf(name, "tHashDataFast32 %d", size);
+		tMeasure(name.Chr(), numBytes, 0, [&]() { uint32 h = 0; for (int r = 0; r < repeats; r++) h ^= tHash::tHashDataFast32(data, size); tDoNotOptimize(h); });
+
+		tsPrintf(name, "tHashData32 %d", size);
+		tMeasure(name.Chr(), numBytes, 0, [&]() { uint32 h = 0; for (int r = 0; r < repeats; r++) h ^= tHash::tHashData32(data, size); tDoNotOptimize(h); });
+
+		tsPrintf(name, "tHashData64 %d", size);
+		tMeasure(name.Chr(), numBytes, 0, [&]() { uint64 h = 0; for (int r = 0; r < repeats; r++) h ^= tHash::tHashData64(data, size); tDoNotOptimize(h); });
+
+		// The cryptographic hashes are an order of magnitude slower so they get fewer repeats.
+		int cryptoRepeats = GetRepeats(size, 1000000);
+		int64 cryptoBytes = int64(size)*cryptoRepeats;
+
+		tsPrintf(name, "tHashDataMD5 %d", size);
+		tMeasure(name.Chr(), cryptoBytes, 0, [&]() { for (int r = 0; r < cryptoRepeats; r++) { tuint128 h = tHash::tHashDataMD5(data, size); tDoNotOptimize(h); } });
+
+		tsPrintf(name, "tHashDataSHA256 %d", size);
+		tMeasure(name.Chr(), cryptoBytes, 0, [&]() { for (int r = 0; r < cryptoRepeats; r++) { tuint256 h = tHash::tHashDataSHA256(data, size); tDoNotOptimize(h); } });
+
+		delete[] data;
+	}
+}
+
+
+tBenchUnit(FoundationSort)
+{
+	const int* sizes = nullptr;
+	int numSizes = GetSizes(sizes);
+	for (int s = 0; s < numSizes; s++)
+	{
+		int size = sizes[s];
+		int repeats = GetRepeats(size, 100000);
+		int* values = NewRandomInts(size);
+		int* work = new int[size];
+		tString name;
+
+		// Every repeat sorts a fresh copy of the same unsorted data. The copy is a memcpy and is cheap next to the sort.
+		tsPrintf(name, "tSort::tQuick %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			for (int r = 0; r < repeats; r++)
+			{
+				tStd::tMemcpy(work, values, size*sizeof(int));
+				tSort::tQuick(work, size);
+			}
+			tDoNotOptimize(work[0]);
+		});
+
+		tsPrintf(name, "tSort::tShell %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			for (int r = 0; r < repeats; r++)
+			{
+				tStd::tMemcpy(work, values, size*sizeof(int));
+				tSort::tShell(work, size);
+			}
+			tDoNotOptimize(work[0]);
+		});
+
+		// Insertion sort is O(n^2) so it is only run for small sizes. That is also the only place it should be used.
+		if (size <= 10000)
+		{
+			tsPrintf(name, "tSort::tInsertion %d", size);
+			int insertionRepeats = GetRepeats(size*size, 10000000);
+			tMeasureOps(name.Chr(), size, int64(size)*insertionRepeats, [&]()
+			{
+				for (int r = 0; r < insertionRepeats; r++)
+				{
+					tStd::tMemcpy(work, values, size*sizeof(int));
+					tSort::tInsertion(work, size);
+				}
+				tDoNotOptimize(work[0]);
+			});
+		}
+
+		delete[] work;
+		delete[] values;
+	}
+}
+
+
+tBenchUnit(FoundationPriorityQueue)
+{
+	const int* sizes = nullptr;
+	int numSizes = GetSizes(sizes);
+	for (int s = 0; s < numSizes; s++)
+	{
+		int size = sizes[s];
+		int repeats = GetRepeats(size, 100000);
+		int* keys = NewRandomInts(size);
+		tString name;
+
+		// One op is an insert plus the matching remove.
+		tsPrintf(name, "tPriorityQueue InsertRemove %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*repeats, [&]()
+		{
+			int64 sum = 0;
+			for (int r = 0; r < repeats; r++)
+			{
+				tPriorityQueue<int> queue(size, 256);
+				for (int i = 0; i < size; i++)
+					queue.Insert(tPriorityQueue<int>::tItem(i, keys[i]));
+				while (!queue.IsEmpty())
+					sum += queue.GetRemoveMin().Data;
+			}
+			tDoNotOptimize(sum);
+		});
+
+		delete[] keys;
+	}
+}
+
+
+}
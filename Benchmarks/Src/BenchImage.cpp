@@ -0,0 +1,776 @@
+// BenchImage.cpp
+//
+// Image module benchmarks. The corpus is generated rather than loaded so the benchmarks run anywhere and every run
+// sees exactly the same pixels. There are two images: a 'photo' with smooth gradients and fine noise, which is hard
+// for lossless codecs, and a 'graphic' with flat colours, hard edges and transparency, which is what icons and UI
+// textures look like. Codec benchmarks save each image to every writable format and load it back. MB/s is always
+// measured against the uncompressed RGBA size so numbers are comparable between formats.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <Foundation/tFundamentals.h>
+#include <System/tFile.h>
+#include <Image/tPicture.h>
+#include <Image/tTexture.h>
+#include <Image/tAtlas.h>
+#include <Image/tConvert.h>
+#include <Image/tEnvMap.h>
+#include <Image/tPixelUtil.h>
+#include <Image/tQuantize.h>
+#include <Image/tImageAPNG.h>
+#include <Image/tImageASTC.h>
+#include <Image/tImageBMP.h>
+#include <Image/tImageGIF.h>
+#include <Image/tImageHDR.h>
+#include <Image/tImageJPG.h>
+#include <Image/tImagePNG.h>
+#include <Image/tImageQOI.h>
+#include <Image/tImageTGA.h>
+#include <Image/tImageTIFF.h>
+#include <Image/tImageWEBP.h>
+#include "BenchImage.h"
+using namespace tImage;
+
+
+namespace tBenchmark
+{
+	const char* CorpusDir		= "BenchData/";
+	const int CorpusWidth		= 1024;
+	const int CorpusHeight		= 1024;
+
+	void GeneratePhoto(tPicture&, int width, int height);
+	void GenerateGraphic(tPicture&, int width, int height);
+	void GenerateCorpus(tPicture& photo, tPicture& graphic);
+
+	// Saves the picture with saveFn and times it, then times loading it back as a T.
+	template<typename T, typename SaveFn> void BenchCodec(const char* corpusName, const tPicture&, const char* ext, SaveFn);
+}
+
+
+void tBenchmark::GeneratePhoto(tPicture& pic, int width, int height)
+{
+	pic.Set(width, height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			float u = float(x) / float(width);
+			float v = float(y) / float(height);
+			float r = 0.5f + 0.5f*tMath::tSin(u*9.0f + v*3.0f);
+			float g = 0.5f + 0.5f*tMath::tCos(v*7.0f - u*2.0f);
+			float b = 0.5f + 0.25f*tMath::tSin((u-0.5f)*(v-0.5f)*60.0f) + 0.25f*u;
+			int noise = int(Hash(uint32(y*width + x)) & 0x0F) - 8;
+			tPixel4b& pixel = pic.Pixel(x, y);
+			pixel.R = uint8(tMath::tClamp(int(r*235.0f) + noise, 0, 255));
+			pixel.G = uint8(tMath::tClamp(int(g*235.0f) + noise, 0, 255));
+			pixel.B = uint8(tMath::tClamp(int(b*235.0f) + noise, 0, 255));
+			pixel.A = 255;
+		}
+	}
+}
+
+
+void tBenchmark::GenerateGraphic(tPicture& pic, int width, int height)
+{
+	pic.Set(width, height, tPixel4b::transparent);
+	const tPixel4b palette[] =
+	{
+		tPixel4b(230, 57, 70, 255), tPixel4b(241, 250, 238, 255), tPixel4b(168, 218, 220, 255),
+		tPixel4b(69, 123, 157, 255), tPixel4b(29, 53, 87, 255), tPixel4b(255, 183, 3, 200)
+	};
+	const int numColours = int(tNumElements(palette));
+
+	// A grid of rounded tiles, each with a ring in a second colour. Everything off the tiles stays transparent.
+	int tileSize = 64;
+	for (int y = 0; y < height; y++)
+	{
+		int ty = y / tileSize;
+		int ly = y % tileSize - tileSize/2;
+		for (int x = 0; x < width; x++)
+		{
+			int tx = x / tileSize;
+			int lx = x % tileSize - tileSize/2;
+			int distSq = lx*lx + ly*ly;
+			uint32 tileHash = Hash(uint32(ty*1024 + tx));
+			if ((tMath::tAbs(lx) > 28) || (tMath::tAbs(ly) > 28))
+				continue;
+
+			if ((distSq > 14*14) && (distSq < 22*22))
+				pic.Pixel(x, y) = palette[(tileHash >> 8) % numColours];
+			else
+				pic.Pixel(x, y) = palette[tileHash % numColours];
+		}
+	}
+}
+
+
+void tBenchmark::GenerateCorpus(tPicture& photo, tPicture& graphic)
+{
+	GeneratePhoto(photo, CorpusWidth, CorpusHeight);
+	GenerateGraphic(graphic, CorpusWidth, CorpusHeight);
+	if (!tSystem::tDirExists(CorpusDir))
+		tSystem::tCreateDir(CorpusDir);
+}
+
+
+template<typename T, typename SaveFn> void tBenchmark::BenchCodec(const char* corpusName, const tPicture& pic, const char* ext, SaveFn saveFn)
+{
+	int width = pic.GetWidth();
+	int height = pic.GetHeight();
+	int64 numPixels = int64(width) * int64(height);
+	int64 numBytes = numPixels * sizeof(tPixel4b);
+
+	tString file;
+	tsPrintf(file, "%s%s.%s", CorpusDir, corpusName, ext);
+
+	// The image object copies the pixels so the corpus picture is untouched.
+	T image(pic.GetPixels(), width, height, false);
+	tString name;
+	tsPrintf(name, "%s %s Save", ext, corpusName);
+	bool saved = true;
+	tMeasure(name.Chr(), numBytes, numPixels, [&]() { saved = saveFn(image, file); });
+	if (!saved)
+	{
+		tPrintf("%s save failed. Skipping load.\n", ext);
+		return;
+	}
+
+	tsPrintf(name, "%s %s Load", ext, corpusName);
+	bool loaded = true;
+	tMeasure(name.Chr(), numBytes, numPixels, [&]() { T loadedImage(file); loaded = loadedImage.IsValid(); });
+	if (!loaded)
+		tPrintf("%s load failed.\n", ext);
+
+	tPrintf("%s %s file size %d bytes. Ratio %.2f.\n", ext, corpusName, tSystem::tGetFileSize(file), double(numBytes) / double(tMath::tMax(tSystem::tGetFileSize(file), 1)));
+	tSystem::tDeleteFile(file);
+}
+
+
+namespace tBenchmark
+{
+
+
+tBenchUnit(ImageCodecs)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+
+	struct Corpus { const char* Name; tPicture* Picture; };
+	Corpus corpus[] = { { "Photo", &photo }, { "Graphic", &graphic } };
+	for (int c = 0; c < int(tNumElements(corpus)); c++)
+	{
+		const char* name = corpus[c].Name;
+		const tPicture& pic = *corpus[c].Picture;
+
+		BenchCodec<tImagePNG> (name, pic, "png",  [](const tImagePNG& img, const tString& f)  { return img.Save(f) != tImagePNG::tFormat::Invalid; });
+		BenchCodec<tImageAPNG>(name, pic, "apng", [](const tImageAPNG& img, const tString& f) { return img.Save(f) != tImageAPNG::tFormat::Invalid; });
+		BenchCodec<tImageQOI> (name, pic, "qoi",  [](const tImageQOI& img, const tString& f)  { return img.Save(f) != tImageQOI::tFormat::Invalid; });
+		BenchCodec<tImageBMP> (name, pic, "bmp",  [](const tImageBMP& img, const tString& f)  { return img.Save(f) != tImageBMP::tFormat::Invalid; });
+		BenchCodec<tImageTGA> (name, pic, "tga",  [](const tImageTGA& img, const tString& f)  { return img.Save(f) != tImageTGA::tFormat::Invalid; });
+		BenchCodec<tImageJPG> (name, pic, "jpg",  [](const tImageJPG& img, const tString& f)  { return img.Save(f); });
+		BenchCodec<tImageTIFF>(name, pic, "tiff", [](const tImageTIFF& img, const tString& f) { return img.Save(f); });
+		BenchCodec<tImageGIF> (name, pic, "gif",  [](const tImageGIF& img, const tString& f)  { return img.Save(f); });
+
+		BenchCodec<tImageWEBP>(name, pic, "webp", [](const tImageWEBP& img, const tString& f)
+		{
+			tImageWEBP::SaveParams params;
+			params.Lossy = true;
+			return img.Save(f, params);
+		});
+
+		BenchCodec<tImageASTC>(name, pic, "astc", [](const tImageASTC& img, const tString& f)
+		{
+			tImageASTC::SaveParams params;
+			params.Quality = tASTCEncoder::Quality_Fast;
+			return img.Save(f, params);
+		});
+	}
+}
+
+
+tBenchUnit(ImageBMPLoad)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+	int64 numPixels = photo.GetNumPixels();
+	int64 numBytes = numPixels*sizeof(tPixel4b);
+
+	// Loading from a file that is already in memory skips all file I/O, so the difference from the file load is the
+	// cost of reading the file.
+	tImageBMP bmp(photo.GetPixels(), photo.GetWidth(), photo.GetHeight(), false);
+	tString file;
+	tsPrintf(file, "%sPhoto.bmp", CorpusDir);
+	tImageBMP::tFormat formats[] = { tImageBMP::tFormat::BPP24, tImageBMP::tFormat::BPP32 };
+	int bitDepths[] = { 24, 32 };
+	for (int f = 0; f < int(tNumElements(formats)); f++)
+	{
+		if (bmp.Save(file, formats[f]) != formats[f])
+		{
+			tPrintf("bmp %d-bit save failed.\n", bitDepths[f]);
+			continue;
+		}
+		int fileSize = 0;
+		uint8* fileData = tSystem::tLoadFile(file, nullptr, &fileSize);
+
+		tImageBMP loaded;
+		tString name;
+		tsPrintf(name, "bmp %d-bit Load Memory", bitDepths[f]);
+		tMeasure(name.Chr(), numBytes, numPixels, [&]() { loaded.Load(fileData, fileSize); });
+		tsPrintf(name, "bmp %d-bit Load File", bitDepths[f]);
+		tMeasure(name.Chr(), numBytes, numPixels, [&]() { loaded.Load(file); });
+
+		delete[] fileData;
+	}
+	tSystem::tDeleteFile(file);
+}
+
+
+tBenchUnit(ImageQOIStripes)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+	int64 numPixels = photo.GetNumPixels();
+	int64 numBytes = numPixels*sizeof(tPixel4b);
+
+	// Stripe counts of 0 and 1 write a standard single-threaded QOI file. Larger counts encode and decode the stripes
+	// in parallel.
+	tImageQOI qoi(photo.GetPixels(), photo.GetWidth(), photo.GetHeight(), false);
+	const int stripeCounts[] = { 1, 4, 16, 64 };
+	for (int stripes : stripeCounts)
+	{
+		tImageQOI::SaveParams params;
+		params.Format = tImageQOI::tFormat::BPP32;
+		params.NumStripes = stripes;
+		uint8* qoiInMemory = nullptr;
+		int qoiNumBytes = 0;
+
+		tString name;
+		tsPrintf(name, "qoi Stripes %d Save Memory", stripes);
+		tMeasure(name.Chr(), numBytes, numPixels, [&]() { delete[] qoiInMemory; qoiInMemory = nullptr; qoi.Save(qoiInMemory, qoiNumBytes, params); });
+		if (!qoiInMemory)
+		{
+			tPrintf("qoi save failed. Skipping load.\n");
+			continue;
+		}
+
+		tImageQOI loaded;
+		tsPrintf(name, "qoi Stripes %d Load Memory", stripes);
+		tMeasure(name.Chr(), numBytes, numPixels, [&]() { loaded.Load(qoiInMemory, qoiNumBytes); });
+		delete[] qoiInMemory;
+	}
+}
+
+
+tBenchUnit(ImageHDRLoad)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+	int width = photo.GetWidth();
+	int height = photo.GetHeight();
+	int64 numPixels = photo.GetNumPixels();
+	int64 numBytes = numPixels*sizeof(tPixel4b);
+
+	// There is no hdr writer so an hdr file is built in memory. The photo bytes are the mantissas and the exponent
+	// varies across the image. Scanlines use the run-length format with literal dumps only, so nothing is compressed.
+	tString header;
+	tsPrintf(header, "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", height, width);
+	int hdrNumBytes = header.Length() + height*(4 + 4*(width + (width+127)/128));
+	uint8* hdrFile = new uint8[hdrNumBytes];
+	uint8* write = hdrFile;
+	tStd::tMemcpy(write, header.Chr(), header.Length());
+	write += header.Length();
+	for (int y = height-1; y >= 0; y--)
+	{
+		*write++ = 2; *write++ = 2; *write++ = uint8(width >> 8); *write++ = uint8(width & 0xFF);
+		for (int c = 0; c < 4; c++)
+		{
+			for (int x = 0; x < width; x += 128)
+			{
+				int count = tMath::tMin(128, width - x);
+				*write++ = uint8(count);
+				for (int i = 0; i < count; i++)
+					*write++ = (c < 3) ? photo.GetPixel(x+i, y).E[c] : uint8(124 + ((x+i+y) >> 8));
+			}
+		}
+	}
+
+	// The loader modifies the header in place so every trial gets a fresh copy. The copy is tiny compared to the decode.
+	uint8* hdrCopy = new uint8[hdrNumBytes];
+	for (int outputFloat = 0; outputFloat < 2; outputFloat++)
+	{
+		for (int numThreads = 1; numThreads >= 0; numThreads--)
+		{
+			tImageHDR::LoadParams params;
+			params.OutputFloat = outputFloat ? true : false;
+			params.NumThreads = numThreads;
+			tString name;
+			tsPrintf(name, "hdr Load %s %s", outputFloat ? "Float" : "8-bit", numThreads ? "Single-threaded" : "Multi-threaded");
+			tImageHDR hdr;
+			tMeasure(name.Chr(), numBytes, numPixels, [&]() { tStd::tMemcpy(hdrCopy, hdrFile, hdrNumBytes); hdr.Load(hdrCopy, hdrNumBytes, params); });
+		}
+	}
+	delete[] hdrCopy;
+	delete[] hdrFile;
+}
+
+
+tBenchUnit(ImageResample)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+
+	tResampleFilter filters[] = { tResampleFilter::Nearest, tResampleFilter::Bilinear, tResampleFilter::Bicubic, tResampleFilter::Lanczos };
+	int sizes[][2] = { { CorpusWidth/2, CorpusHeight/2 }, { CorpusWidth*3/2, CorpusHeight*3/2 } };
+	for (int f = 0; f < int(tNumElements(filters)); f++)
+	{
+		for (int s = 0; s < int(tNumElements(sizes)); s++)
+		{
+			int dstW = sizes[s][0];
+			int dstH = sizes[s][1];
+			int64 numPixels = int64(dstW) * int64(dstH);
+			tString name;
+			tsPrintf(name, "Resample %s %dx%d", tResampleFilterNamesSimple[int(filters[f])], dstW, dstH);
+
+			// The copy is part of every trial. It is cheap compared to the resample.
+			tMeasure(name.Chr(), numPixels*sizeof(tPixel4b), numPixels, [&]() { tPicture pic(photo); pic.Resample(dstW, dstH, filters[f]); });
+		}
+	}
+}
+
+
+tBenchUnit(ImageRotateFlip)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+	int64 numPixels = photo.GetNumPixels();
+
+	// The same picture is reused by every trial. Rotates are measured as a clockwise and anti-clockwise pair so the
+	// dimensions are unchanged after each trial.
+	tPicture pic(photo);
+	tMeasure("Rotate90 CW+ACW", 2*numPixels*sizeof(tPixel4b), 2*numPixels, [&]() { pic.Rotate90(false); pic.Rotate90(true); });
+	tMeasure("Flip Horizontal", numPixels*sizeof(tPixel4b), numPixels, [&]() { pic.Flip(true); });
+	tMeasure("Flip Vertical", numPixels*sizeof(tPixel4b), numPixels, [&]() { pic.Flip(false); });
+}
+
+
+tBenchUnit(ImageChannels)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+	int64 numPixels = graphic.GetNumPixels();
+	int64 numBytes = numPixels*sizeof(tPixel4b);
+
+	// Each trial modifies the previous result. The work done does not depend on the pixel values.
+	tPicture pic(graphic);
+	tMeasure("Swizzle BGRA", numBytes, numPixels, [&]() { pic.Swizzle(tComp::B, tComp::G, tComp::R, tComp::A); });
+	tMeasure("Spread R", numBytes, numPixels, [&]() { pic.Spread(tComp::R); });
+	tMeasure("Intensity RGB", numBytes, numPixels, [&]() { pic.Intensity(tCompBit_RGB); });
+	tMeasure("SetAll A", numBytes, numPixels, [&]() { pic.SetAll(tColour4b(0, 0, 0, 128), tCompBit_A); });
+	tMeasure("AlphaBlendColour RGB", numBytes, numPixels, [&]() { pic.AlphaBlendColour(tColour4b::white, tCompBit_RGB, -1); });
+}
+
+
+tBenchUnit(ImageQuantize)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+
+	// Quantizers are much slower than codecs, so a quarter of the photo is used.
+	int width = CorpusWidth/2;
+	int height = CorpusHeight/2;
+	photo.Crop(width, height, tPicture::Anchor::MiddleMiddle);
+	const tPixel4b* pixels = photo.GetPixels();
+	int64 numPixels = int64(width) * int64(height);
+
+	const int numColours = 256;
+	tColour3b* palette = new tColour3b[numColours];
+	uint8* indices = new uint8[numPixels];
+
+	tMeasure("Quantize Fixed 256", numPixels*sizeof(tPixel4b), numPixels, [&]() { tQuantizeFixed::QuantizeImage(numColours, width, height, pixels, palette, indices, false); });
+	tMeasure("Quantize Wu 256", numPixels*sizeof(tPixel4b), numPixels, [&]() { tQuantizeWu::QuantizeImage(numColours, width, height, pixels, palette, indices, false); });
+	tMeasure("Quantize Neu 256 Sample10", numPixels*sizeof(tPixel4b), numPixels, [&]() { tQuantizeNeu::QuantizeImage(numColours, width, height, pixels, palette, indices, false, 10); });
+
+	// Spatial (scolorq) is orders of magnitude slower than the others so it gets a tiny image and a smaller palette.
+	int spatialW = 64;
+	int spatialH = 64;
+	const int spatialColours = 64;
+	tPicture spatialPic(photo);
+	spatialPic.Crop(spatialW, spatialH, tPicture::Anchor::MiddleMiddle);
+	const tPixel4b* spatialPixels = spatialPic.GetPixels();
+	int64 spatialPixelCount = int64(spatialW) * int64(spatialH);
+	tMeasure("Quantize Spatial 64 Small", spatialPixelCount*sizeof(tPixel4b), spatialPixelCount, [&]() { tQuantizeSpatial::QuantizeImage(spatialColours, spatialW, spatialH, spatialPixels, palette, indices, false); });
+
+	delete[] palette;
+	delete[] indices;
+}
+
+
+tBenchUnit(ImageTexture)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+
+	// Every encode generates the full mipmap chain, so pixel counts include all levels.
+	int64 numPixels = 0;
+	for (int w = CorpusWidth, h = CorpusHeight; ; w = tMath::tMax(w/2, 1), h = tMath::tMax(h/2, 1))
+	{
+		numPixels += int64(w) * int64(h);
+		if ((w == 1) && (h == 1))
+			break;
+	}
+
+	tPixelFormat formats[] =
+	{
+		tPixelFormat::R8G8B8A8, tPixelFormat::BC1DXT1, tPixelFormat::BC3DXT4DXT5, tPixelFormat::BC4ATI1U,
+		tPixelFormat::BC5ATI2U, tPixelFormat::BC6U, tPixelFormat::BC7, tPixelFormat::ASTC4X4, tPixelFormat::ASTC8X8
+	};
+	for (int f = 0; f < int(tNumElements(formats)); f++)
+	{
+		tString name;
+		tsPrintf(name, "Texture %s Fast", tGetPixelFormatName(formats[f]));
+
+		// The texture consumes the picture so each trial encodes a fresh copy.
+		tMeasure(name.Chr(), numPixels*sizeof(tPixel4b), numPixels, [&]() { tPicture pic(photo); tTexture texture(pic, true, formats[f], tTexture::tQuality::Fast); });
+	}
+}
+
+
+tBenchUnit(ImageBC)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+
+	// Only the main layer is encoded so blocks/s counts exactly the 4x4 blocks of the picture. The higher presets are
+	// slow so a quarter of the photo is used. After timing, the last encode is decoded and its PSNR is printed. PSNR is
+	// measured only over the channels each format encodes.
+	int width = CorpusWidth/2;
+	int height = CorpusHeight/2;
+	photo.Crop(width, height, tPicture::Anchor::MiddleMiddle);
+	int64 numPixels = int64(width) * int64(height);
+	int64 numBlocks = numPixels / 16;
+
+	tPixelFormat formats[] =
+	{
+		tPixelFormat::BC1DXT1, tPixelFormat::BC3DXT4DXT5, tPixelFormat::BC4ATI1U,
+		tPixelFormat::BC5ATI2U, tPixelFormat::BC6U, tPixelFormat::BC7
+	};
+	int numChannels[] = { 3, 3, 1, 2, 3, 3 };
+	tTexture::tQuality qualities[] = { tTexture::tQuality::Fast, tTexture::tQuality::Development, tTexture::tQuality::Production };
+	const char* qualityNames[] = { "Fast", "Development", "Production" };
+	for (int q = 0; q < int(tNumElements(qualities)); q++)
+	{
+		for (int f = 0; f < int(tNumElements(formats)); f++)
+		{
+			tString name;
+			tsPrintf(name, "Encode %s %s", tGetPixelFormatName(formats[f]), qualityNames[q]);
+			tTexture texture;
+			const tResult& result = tMeasure(name.Chr(), numPixels*sizeof(tPixel4b), numPixels, [&]() { tPicture pic(photo); texture.Set(pic, false, formats[f], qualities[q]); });
+			if (!texture.IsValid())
+			{
+				tPrintf("%s encode failed.\n", name.Chr());
+				continue;
+			}
+
+			tLayer* layer = texture.GetMainLayer();
+			tColour4b* decodedLDR = nullptr;
+			tColour4f* decodedHDR = nullptr;
+			if (DecodePixelData(formats[f], layer->Data, layer->GetDataSize(), width, height, decodedLDR, decodedHDR) != DecodeResult::Success)
+			{
+				tPrintf("%s decode failed.\n", name.Chr());
+				continue;
+			}
+
+			double sumSqErr = 0.0;
+			const tPixel4b* srcPixels = photo.GetPixels();
+			for (int p = 0; p < numPixels; p++)
+			{
+				for (int c = 0; c < numChannels[f]; c++)
+				{
+					double decoded = decodedLDR ? double(decodedLDR[p].E[c]) : 255.0*tMath::tLinearToSRGB(decodedHDR[p].E[c]);
+					double err = decoded - double(srcPixels[p].E[c]);
+					sumSqErr += err*err;
+				}
+			}
+			delete[] decodedLDR;
+			delete[] decodedHDR;
+
+			double mse = tMath::tMax(sumSqErr / double(numPixels*numChannels[f]), 0.0001);
+			double blocksPerSec = (result.MedianSeconds > 0.0) ? double(numBlocks) / result.MedianSeconds : 0.0;
+			tPrintf("%s %.0f blocks/s PSNR %.2f dB.\n", name.Chr(), blocksPerSec, 10.0*log10(255.0*255.0 / mse));
+		}
+	}
+}
+
+
+tBenchUnit(ImageASTC)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+
+	// ASTC encode cost depends mostly on the quality preset, so the block size is fixed and every preset is measured.
+	// Pixel counts include all mipmap levels.
+	int64 numPixels = 0;
+	for (int w = CorpusWidth, h = CorpusHeight; ; w = tMath::tMax(w/2, 1), h = tMath::tMax(h/2, 1))
+	{
+		numPixels += int64(w) * int64(h);
+		if ((w == 1) && (h == 1))
+			break;
+	}
+
+	tTexture::tQuality qualities[] = { tTexture::tQuality::Fast, tTexture::tQuality::Development, tTexture::tQuality::Production };
+	const char* qualityNames[] = { "Fast", "Development", "Production" };
+	for (int q = 0; q < int(tNumElements(qualities)); q++)
+	{
+		tString name;
+		tsPrintf(name, "Texture ASTC6X6 %s", qualityNames[q]);
+		tMeasure(name.Chr(), numPixels*sizeof(tPixel4b), numPixels, [&]() { tPicture pic(photo); tTexture texture(pic, true, tPixelFormat::ASTC6X6, qualities[q]); });
+	}
+}
+
+
+tBenchUnit(ImageConvert)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+
+	// Sources alternate between the photo and the graphic and between tga and qoi so more than one decoder runs.
+	// Destinations cycle through qoi, tga and bmp. The whole batch is one measurement and the per-stage busy time of
+	// the last run is printed so the slowest stage can be seen.
+	const int numFiles = 16;
+	int64 numPixels = int64(numFiles) * CorpusWidth * CorpusHeight;
+	tString srcFiles[numFiles];
+	tString dstFiles[numFiles];
+	for (int f = 0; f < numFiles; f++)
+	{
+		const tPicture& pic = (f & 2) ? graphic : photo;
+		tsPrintf(srcFiles[f], "%sConvertSource%02d.%s", CorpusDir, f, (f & 1) ? "tga" : "qoi");
+		tsPrintf(dstFiles[f], "%sConverted%02d.%s", CorpusDir, f, ((f % 3) == 0) ? "qoi" : (((f % 3) == 1) ? "tga" : "bmp"));
+		if (f & 1)
+			tImageTGA(pic.GetPixels(), CorpusWidth, CorpusHeight, false).Save(srcFiles[f]);
+		else
+			tImageQOI(pic.GetPixels(), CorpusWidth, CorpusHeight, false).Save(srcFiles[f]);
+	}
+
+	for (int resample = 0; resample < 2; resample++)
+	{
+		tConvertParams params;
+		params.ResampleWidth = resample ? CorpusWidth/2 : 0;
+		tConvertStats stats;
+		tString name;
+		tsPrintf(name, "Convert %d Files %s", numFiles, resample ? "Resample" : "Direct");
+		tMeasure(name.Chr(), numPixels*sizeof(tPixel4b), numPixels, [&]()
+		{
+			tList<tConvertJob> jobs;
+			for (int f = 0; f < numFiles; f++)
+				jobs.Append(new tConvertJob(srcFiles[f], dstFiles[f]));
+			stats = tConvertStats();
+			tDoNotOptimize(tConvertBatch(jobs, params, &stats));
+		});
+
+		for (int st = 0; st < int(tConvertStage::NumStages); st++)
+		{
+			const tConvertStageStats& stage = stats.Stages[st];
+			tPrintf
+			(
+				"Convert %s %-9s Busy:%7.3f s %8.1f items/s %8.1f MB/s\n",
+				resample ? "Resample" : "Direct", tGetConvertStageName(tConvertStage(st)),
+				stage.BusySeconds, stage.GetItemsPerSecond(), stage.GetMBPerSecond()
+			);
+		}
+	}
+
+	for (int f = 0; f < numFiles; f++)
+	{
+		tSystem::tDeleteFile(srcFiles[f]);
+		tSystem::tDeleteFile(dstFiles[f]);
+	}
+}
+
+
+tBenchUnit(ImageAtlas)
+{
+	// 50k small sprites of varied size, as found in UI and particle sheets. Sprites share a few pictures so the
+	// corpus itself stays small. Each has a transparent border so trimming does real work.
+	const int numSprites = 50000;
+	const int numUnique = 64;
+	tPicture* unique = new tPicture[numUnique];
+	for (int u = 0; u < numUnique; u++)
+	{
+		int w = 8 + int(Hash(u) % 57);
+		int h = 8 + int(Hash(u + numUnique) % 57);
+		unique[u].Set(w, h, tPixel4b::transparent);
+		for (int y = 1; y < h-1; y++)
+			for (int x = 1; x < w-1; x++)
+				unique[u].SetPixel(x, y, uint8(Hash(x*y + u)), uint8(x*4), uint8(y*4), 255);
+	}
+
+	const tPicture** sprites = new const tPicture*[numSprites];
+	for (int s = 0; s < numSprites; s++)
+		sprites[s] = &unique[Hash(s) % numUnique];
+
+	for (int method = 0; method < 2; method++)
+	{
+		tAtlas::Params params;
+		params.Method = method ? tAtlas::tMethod::Skyline : tAtlas::tMethod::MaxRects;
+		params.PageWidth = 2048;
+		params.PageHeight = 2048;
+		params.Padding = 1;
+		params.Extrude = 1;
+		params.AllowRotation = true;
+		params.Trim = true;
+
+		const char* methodName = method ? "Skyline" : "MaxRects";
+		tString name;
+		tsPrintf(name, "Atlas Pack %s 50k", methodName);
+		tAtlas atlas;
+		tMeasureOps(name.Chr(), numSprites, numSprites, [&]() { tDoNotOptimize(atlas.Pack(sprites, numSprites, params)); });
+
+		int64 numPixels = int64(atlas.GetNumPages()) * params.PageWidth * params.PageHeight;
+		tsPrintf(name, "Atlas Build %s 50k", methodName);
+		tMeasure(name.Chr(), numPixels*sizeof(tPixel4b), numPixels, [&]() { tDoNotOptimize(atlas.Build(sprites, numSprites, params)); });
+		tPrintf("Atlas %s Pages:%d Occupancy:%.3f\n", methodName, atlas.GetNumPages(), atlas.GetOccupancy());
+	}
+
+	delete[] sprites;
+	delete[] unique;
+}
+
+
+tBenchUnit(ImagePVRTC)
+{
+	// PVRTC decodes any bit pattern, so hashed bytes make a valid (if noisy) texture. Dimensions must be powers of 2.
+	const int width = 2048;
+	const int height = 2048;
+	int64 numPixels = int64(width) * int64(height);
+
+	tPixelFormat formats[] = { tPixelFormat::PVRBPP2, tPixelFormat::PVRBPP4 };
+	for (int f = 0; f < int(tNumElements(formats)); f++)
+	{
+		int dataSize = (formats[f] == tPixelFormat::PVRBPP2) ? width*height/4 : width*height/2;
+		uint8* data = new uint8[dataSize];
+		for (int b = 0; b < dataSize; b++)
+			data[b] = uint8(Hash(b + f));
+
+		for (int multi = 0; multi < 2; multi++)
+		{
+			tString name;
+			tsPrintf(name, "Decode %s %s", tGetPixelFormatName(formats[f]), multi ? "Multi" : "Single");
+			tMeasure(name.Chr(), numPixels*sizeof(tPixel4b), numPixels, [&]()
+			{
+				tColour4b* decoded4b = nullptr;
+				tColour4f* decoded4f = nullptr;
+				DecodePixelData_PVR(formats[f], data, dataSize, width, height, decoded4b, decoded4f, multi ? 0 : 1);
+				delete[] decoded4b;
+			});
+		}
+		delete[] data;
+	}
+}
+
+
+tBenchUnit(ImageJPGSave)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+	int64 numPixels = int64(photo.GetWidth()) * int64(photo.GetHeight());
+	int64 numBytes = numPixels * sizeof(tPixel4b);
+	tImageJPG jpg(photo.GetPixels(), photo.GetWidth(), photo.GetHeight(), false);
+	tString file;
+	tsPrintf(file, "%sPhotoOptions.jpg", CorpusDir);
+
+	struct Option { const char* Name; tImageJPG::Subsampling Subsampling; bool FastDCT; bool OptimizeHuffman; bool Progressive; int NumThreads; };
+	Option options[] =
+	{
+		{ "444",			tImageJPG::Subsampling::S444, false,	false,	false,	1 },
+		{ "420",			tImageJPG::Subsampling::S420, false,	false,	false,	1 },
+		{ "420 FastDCT",	tImageJPG::Subsampling::S420, true,		false,	false,	1 },
+		{ "420 Optimized",	tImageJPG::Subsampling::S420, false,	true,	false,	1 },
+		{ "420 Progressive",tImageJPG::Subsampling::S420, false,	false,	true,	1 },
+		{ "420 Banded",		tImageJPG::Subsampling::S420, false,	false,	false,	0 },
+		{ "444 Banded",		tImageJPG::Subsampling::S444, false,	false,	false,	0 }
+	};
+	for (int o = 0; o < int(tNumElements(options)); o++)
+	{
+		tImageJPG::SaveParams params;
+		params.Subsampling		= options[o].Subsampling;
+		params.FastDCT			= options[o].FastDCT;
+		params.OptimizeHuffman	= options[o].OptimizeHuffman;
+		params.Progressive		= options[o].Progressive;
+		params.NumThreads		= options[o].NumThreads;
+
+		tString name;
+		tsPrintf(name, "jpg Save %s", options[o].Name);
+		tMeasure(name.Chr(), numBytes, numPixels, [&]() { jpg.Save(file, params); });
+		tPrintf("jpg %s file size %d bytes.\n", options[o].Name, tSystem::tGetFileSize(file));
+	}
+	tSystem::tDeleteFile(file);
+}
+
+
+tBenchUnit(ImageEnvMap)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+
+	// The top half of the photo stretched to a 2:1 float panorama stands in for an HDR environment.
+	int panW = CorpusWidth;
+	int panH = CorpusHeight/2;
+	tPicture4f panorama(panW, panH);
+	for (int y = 0; y < panH; y++)
+		for (int x = 0; x < panW; x++)
+			panorama.Pixel(x, y).Set(photo.GetPixel(x, y + panH));
+
+	const int faceSize = 256;
+	tPicture4f faces[tFaceIndex_NumFaces];
+	int64 numFacePixels = int64(tFaceIndex_NumFaces)*faceSize*faceSize;
+	tMeasure("EnvMap EquirectToCubemap 256", numFacePixels*sizeof(tPixel4f), numFacePixels, [&]() { EquirectToCubemap(faces, panorama, faceSize); });
+
+	// Default params. A full specular chain with 256 samples per texel and 32x32 irradiance with 512.
+	tList<tLayer> specular[tFaceIndex_NumFaces];
+	tList<tLayer> irradiance[tFaceIndex_NumFaces];
+	tMeasure("EnvMap PrefilterSpecular 256", numFacePixels*sizeof(tPixel4f), numFacePixels, [&]() { PrefilterSpecular(specular, faces); });
+	tMeasure("EnvMap ComputeIrradiance 32", numFacePixels*sizeof(tPixel4f), numFacePixels, [&]() { ComputeIrradiance(irradiance, faces); });
+}
+
+
+tBenchUnit(ImageWEBPFrames)
+{
+	tPicture photo, graphic;
+	GenerateCorpus(photo, graphic);
+
+	// An animation of full-width strips of the photo, each starting a little lower than the last. Frames are encoded
+	// independently, so the parallel save produces the same file as the sequential one.
+	const int numFrames = 16;
+	const int frameW = CorpusWidth;
+	const int frameH = CorpusHeight/4;
+	tList<tFrame> frames;
+	for (int f = 0; f < numFrames; f++)
+		frames.Append(new tFrame(photo.GetPixels() + f*16*frameW, frameW, frameH, 0.1f));
+	tImageWEBP webp(frames, true);
+
+	tString file;
+	tsPrintf(file, "%sFrames.webp", CorpusDir);
+	int64 numPixels = int64(numFrames) * frameW * frameH;
+	tImageWEBP::SaveParams params;
+	params.Method = 2;
+	for (int numThreads = 1; numThreads >= 0; numThreads--)
+	{
+		params.NumThreads = numThreads;
+		tString name;
+		tsPrintf(name, "webp Save %d Frames %s", numFrames, numThreads ? "Sequential" : "Parallel");
+		const tResult& result = tMeasure(name.Chr(), numPixels*sizeof(tPixel4b), numPixels, [&]() { webp.Save(file, params); });
+		tPrintf("webp %s %.1f frames/s.\n", numThreads ? "Sequential" : "Parallel", (result.MedianSeconds > 0.0) ? double(numFrames) / result.MedianSeconds : 0.0);
+	}
+	tSystem::tDeleteFile(file);
+}
+
+
+}
@@ -0,0 +1,38 @@
+// BenchImage.h
+//
+// Image module benchmarks.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include "Benchmarks.h"
+
+
+namespace tBenchmark
+{
+	tBenchUnit(ImageCodecs);
+	tBenchUnit(ImageBMPLoad);
+	tBenchUnit(ImageQOIStripes);
+	tBenchUnit(ImageHDRLoad);
+	tBenchUnit(ImageResample);
+	tBenchUnit(ImageRotateFlip);
+	tBenchUnit(ImageChannels);
+	tBenchUnit(ImageQuantize);
+	tBenchUnit(ImageTexture);
+	tBenchUnit(ImageBC);
+	tBenchUnit(ImageASTC);
+	tBenchUnit(ImageConvert);
+	tBenchUnit(ImageAtlas);
+	tBenchUnit(ImagePVRTC);
+	tBenchUnit(ImageJPGSave);
+	tBenchUnit(ImageEnvMap);
+	tBenchUnit(ImageWEBPFrames);
+}
@@ -0,0 +1,96 @@
+// BenchSystem.cpp
+//
+// System module benchmarks.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <System/tRegex.h>
+#include "BenchSystem.h"
+
+
+namespace tBenchmark
+{
+
+
+tBenchUnit(SystemRegex)
+{
+	const char* pattern = "Image_\\d+\\.(png|jpg)";
+
+	tMeasureOps("tRegex Compile", 0, 100000, [&]()
+	{
+		for (int r = 0; r < 100000; r++)
+		{
+			tSystem::tRegex regex(pattern);
+			tDoNotOptimize(regex.IsValid());
+		}
+	});
+
+	// Filename matching is the main use. Half the names match.
+	const int numNames = 1000;
+	tString* names = new tString[numNames];
+	for (int n = 0; n < numNames; n++)
+		tsPrintf(names[n], (n & 1) ? "Image_%05d.png" : "Image_%05d.tga", n);
+
+	tSystem::tRegex regex(pattern);
+	int matchRepeats = GetRepeats(numNames);
+	tMeasureOps("tRegex IsMatch Filenames", numNames, int64(numNames)*matchRepeats, [&]()
+	{
+		int numMatches = 0;
+		for (int r = 0; r < matchRepeats; r++)
+			for (int n = 0; n < numNames; n++)
+				numMatches += regex.IsMatch(names[n]) ? 1 : 0;
+		tDoNotOptimize(numMatches);
+	});
+	delete[] names;
+
+	// Scanning text for every occurrence. One op is one character of text scanned.
+	const int* sizes = nullptr;
+	int numSizes = GetSizes(sizes);
+	tSystem::tRegex wordRegex("\\d\\d\\d-\\d\\d\\d\\d");
+	for (int s = 0; s < numSizes; s++)
+	{
+		int size = sizes[s];
+		tString text(size);
+		for (int i = 0; i < size; i++)
+			text[i] = char('a' + (Hash(i) % 26));
+
+		// Plant a phone-number-like token roughly every 100 characters.
+		for (int i = 0; i + 8 <= size; i += 100)
+			tStd::tMemcpy(text.Text() + i, "555-0123", 8);
+
+		int scanRepeats = GetRepeats(size, 100000);
+		tString name;
+		tsPrintf(name, "tRegex SearchAll %d", size);
+		tMeasureOps(name.Chr(), size, int64(size)*scanRepeats, [&]()
+		{
+			int numFound = 0;
+			for (int r = 0; r < scanRepeats; r++)
+			{
+				const char* begin = text.Chr();
+				const char* end = begin + size;
+				while (begin < end)
+				{
+					tList<tSystem::tRegex::Match> matches;
+					wordRegex.Search(begin, end, matches);
+					tSystem::tRegex::Match* match = matches.First();
+					if (!match || !match->IsValid())
+						break;
+					numFound++;
+					begin += match->IndexStart + match->Length;
+				}
+			}
+			tDoNotOptimize(numFound);
+		});
+	}
+}
+
+
+}
@@ -0,0 +1,308 @@
+// Benchmarks.cpp
+//
+// Tacent benchmarks. Unlike the unit tests these do not check correctness. They time the operations we care about so
+// that speed regressions show up. Try calling with a command line like:
+// Benchmarks.exe --trials 9 --json Results.json
+// Benchmarks.exe --filter Image
+// Benchmarks.exe --filter Foundation --maxsize 100000 --pin 2
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifdef PLATFORM_WINDOWS
+#include <locale.h>
+#include <windows.h>
+#include <psapi.h>
+#elif defined(PLATFORM_LINUX)
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+#include <Foundation/tVersion.cmake.h>
+#include <System/tCmdLine.h>
+#include <System/tFile.h>
+#include <System/tMachine.h>
+#include "Benchmarks.h"
+#include "BenchFoundation.h"
+#include "BenchSystem.h"
+#if !defined(ARCHITECTURE_ARM32) && !defined(ARCHITECTURE_ARM64)
+#include "BenchImage.h"
+#endif
+
+
+tCmdLine::tOption OptionHelp("Display help.", "help", 'h');
+tCmdLine::tOption OptionTrials("Number of timed trials per measurement. Default 5.", "trials", 't', 1);
+tCmdLine::tOption OptionWarmup("Number of untimed warmup runs per measurement. Default 1.", "warmup", 'w', 1);
+tCmdLine::tOption OptionFilter("Only run units whose name contains the supplied string.", "filter", 'f', 1);
+tCmdLine::tOption OptionMaxSize("Largest container size for parameterized benchmarks. Default 1000000.", "maxsize", 'm', 1);
+tCmdLine::tOption OptionPin("Pin the benchmark thread to the supplied logical core.", "pin", 'p', 1);
+tCmdLine::tOption OptionJSON("Write all results to the supplied JSON file.", "json", 'j', 1);
+
+
+namespace tBenchmark
+{
+	int NumWarmup				= 1;
+	int NumTrials				= 5;
+	int MaxSize					= 1000000;
+	tString Filter;
+	const char* CurrentUnit		= "";
+	tList<tResult> Results;
+}
+
+
+bool tBenchmark::IsUnitSelected(const char* unitName)
+{
+	if (Filter.IsEmpty())
+		return true;
+
+	tString name(unitName);
+	return name.FindString(Filter.Chr()) != -1;
+}
+
+
+int tBenchmark::GetSizes(const int*& sizes)
+{
+	static const int allSizes[] = { 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+	sizes = allSizes;
+	int count = 0;
+	while ((count < int(tNumElements(allSizes))) && (allSizes[count] <= MaxSize))
+		count++;
+
+	return count;
+}
+
+
+int tBenchmark::GetRepeats(int size, int minOps)
+{
+	if (size <= 0)
+		return 1;
+
+	return tMath::tMax(minOps / size, 1);
+}
+
+
+bool tBenchmark::PinToCore(int core)
+{
+	if ((core < 0) || (core >= tSystem::tGetNumCores()))
+		return false;
+
+	#if defined(PLATFORM_WINDOWS)
+	return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core) != 0;
+
+	#elif defined(PLATFORM_LINUX)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(core, &cpuSet);
+	return sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0;
+
+	#else
+	return false;
+	#endif
+}
+
+
+void tBenchmark::ResetPeakMemory()
+{
+	#ifdef PLATFORM_LINUX
+	// Writing 5 to clear_refs resets the VmHWM high-water mark (Linux 4.0+). If it fails we just get the process peak.
+	tFileHandle file = tSystem::tOpenFile("/proc/self/clear_refs", "wb");
+	if (file)
+	{
+		tSystem::tWriteFile(file, "5", 1);
+		tSystem::tCloseFile(file);
+	}
+	#endif
+}
+
+
+int64 tBenchmark::GetPeakMemory()
+{
+	#if defined(PLATFORM_WINDOWS)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return int64(counters.PeakWorkingSetSize);
+	return -1;
+
+	#elif defined(PLATFORM_LINUX)
+	// VmHWM honours the reset above. ru_maxrss does not, so it is only the fallback. Procfs files report a size of 0
+	// so tLoadFile cannot be used. The file is read until EOF instead.
+	char statusText[8192];
+	int statusLength = 0;
+	tFileHandle file = tSystem::tOpenFile("/proc/self/status", "rb");
+	if (file)
+	{
+		int numRead = 0;
+		while ((statusLength < int(sizeof(statusText)) - 1) && ((numRead = tSystem::tReadFile(file, statusText + statusLength, int(sizeof(statusText)) - 1 - statusLength)) > 0))
+			statusLength += numRead;
+		tSystem::tCloseFile(file);
+	}
+	statusText[statusLength] = '\0';
+	tString status(statusText);
+	if (!status.IsEmpty())
+	{
+		int idx = status.FindString("VmHWM:");
+		if (idx != -1)
+		{
+			int64 kb = 0;
+			for (int c = idx + 6; c < status.Length(); c++)
+			{
+				char ch = status[c];
+				if ((ch >= '0') && (ch <= '9'))
+					kb = kb*10 + (ch - '0');
+				else if (kb > 0)
+					break;
+			}
+			if (kb > 0)
+				return kb * 1024;
+		}
+	}
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return int64(usage.ru_maxrss) * 1024;
+	return -1;
+
+	#else
+	return -1;
+	#endif
+}
+
+
+void tBenchmark::PrintResult(const tResult& result)
+{
+	double relStdDev = (result.MeanSeconds > 0.0) ? 100.0 * result.StdDevSeconds / result.MeanSeconds : 0.0;
+	tPrintf("%-40s min %9.3f ms  median %9.3f ms  sd %5.1f%%", result.Name.Chr(), result.MinSeconds*1000.0, result.MedianSeconds*1000.0, relStdDev);
+	if (result.NumOps > 0)
+		tPrintf("  %9.2f MOps/s  %8.2f ns/op", result.GetMOpsPerSec(), result.GetNanosecondsPerOp());
+	if (result.NumBytes > 0)
+		tPrintf("  %9.2f MB/s", result.GetMBPerSec());
+	if (result.NumPixels > 0)
+		tPrintf("  %8.2f MPix/s", result.GetMPixPerSec());
+	if (result.PeakMemory >= 0)
+		tPrintf("  peak %7.1f MB", double(result.PeakMemory) / (1024.0*1024.0));
+	tPrintf("\n");
+}
+
+
+bool tBenchmark::WriteJSON(const tString& jsonFile)
+{
+	tFileHandle file = tSystem::tOpenFile(jsonFile.Chr(), "wt");
+	if (!file)
+		return false;
+
+	tfPrintf(file, "{\n");
+	tfPrintf(file, "  \"version\": \"%d.%d.%d\",\n", tVersion::Major, tVersion::Minor, tVersion::Revision);
+	tfPrintf(file, "  \"cores\": %d,\n", tSystem::tGetNumCores());
+	tfPrintf(file, "  \"warmup\": %d,\n", NumWarmup);
+	tfPrintf(file, "  \"trials\": %d,\n", NumTrials);
+	tfPrintf(file, "  \"results\":\n  [\n");
+	for (tResult* result = Results.First(); result; result = result->Next())
+	{
+		tfPrintf(file, "    { ");
+		tfPrintf(file, "\"unit\": \"%s\", \"name\": \"%s\", \"trials\": %d, ", result->Unit.Chr(), result->Name.Chr(), result->NumTrials);
+		tfPrintf(file, "\"min_ms\": %.6f, \"max_ms\": %.6f, ", result->MinSeconds*1000.0, result->MaxSeconds*1000.0);
+		tfPrintf(file, "\"median_ms\": %.6f, \"mean_ms\": %.6f, \"stddev_ms\": %.6f, ", result->MedianSeconds*1000.0, result->MeanSeconds*1000.0, result->StdDevSeconds*1000.0);
+		tfPrintf(file, "\"size\": %|64d, \"bytes\": %|64d, \"pixels\": %|64d, \"ops\": %|64d, ", result->Size, result->NumBytes, result->NumPixels, result->NumOps);
+		tfPrintf(file, "\"mb_per_sec\": %.3f, \"mpix_per_sec\": %.3f, \"mops_per_sec\": %.3f, ", result->GetMBPerSec(), result->GetMPixPerSec(), result->GetMOpsPerSec());
+		tfPrintf(file, "\"peak_memory\": %|64d }%s\n", result->PeakMemory, result->Next() ? "," : "");
+	}
+	tfPrintf(file, "  ]\n}\n");
+
+	tSystem::tCloseFile(file);
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	#ifdef PLATFORM_WINDOWS
+	setlocale(LC_ALL, ".UTF8");
+	#endif
+
+	tCmdLine::tParse(argc, argv);
+	if (OptionHelp)
+	{
+		tCmdLine::tPrintUsage
+		(
+			u8"Tristan Grimmer",
+			u8"Times Tacent operations over a generated corpus and reports throughput and peak\n"
+			"memory. Results may be saved as JSON to compare between runs.",
+			1, 0
+		);
+		tCmdLine::tPrintSyntax();
+		return 0;
+	}
+
+	if (OptionTrials)
+		tBenchmark::NumTrials = tMath::tMax(OptionTrials.Arg1().AsInt32(), 1);
+	if (OptionWarmup)
+		tBenchmark::NumWarmup = tMath::tMax(OptionWarmup.Arg1().AsInt32(), 0);
+	if (OptionFilter)
+		tBenchmark::Filter = OptionFilter.Arg1();
+	if (OptionMaxSize)
+		tBenchmark::MaxSize = tMath::tMax(OptionMaxSize.Arg1().AsInt32(), 10);
+	if (OptionPin)
+	{
+		int core = OptionPin.Arg1().AsInt32();
+		if (tBenchmark::PinToCore(core))
+			tPrintf("Pinned to core %d.\n", core);
+		else
+			tPrintf("Unable to pin to core %d.\n", core);
+	}
+
+	tPrintf
+	(
+		"Benchmarking Tacent Version %d.%d.%d. Cores %d. Warmup %d. Trials %d.\n",
+		tVersion::Major, tVersion::Minor, tVersion::Revision,
+		tSystem::tGetNumCores(), tBenchmark::NumWarmup, tBenchmark::NumTrials
+	);
+
+	// Foundation benchmarks.
+	tBench(FoundationArray);
+	tBench(FoundationList);
+	tBench(FoundationMap);
+	tBench(FoundationString);
+	tBench(FoundationHash);
+	tBench(FoundationSort);
+	tBench(FoundationPriorityQueue);
+
+	// System benchmarks.
+	tBench(SystemRegex);
+
+	// Image benchmarks.
+	#if !defined(ARCHITECTURE_ARM32) && !defined(ARCHITECTURE_ARM64)
+	tBench(ImageCodecs);
+	tBench(ImageBMPLoad);
+	tBench(ImageQOIStripes);
+	tBench(ImageHDRLoad);
+	tBench(ImageResample);
+	tBench(ImageRotateFlip);
+	tBench(ImageChannels);
+	tBench(ImageQuantize);
+	tBench(ImageTexture);
+	tBench(ImageBC);
+	tBench(ImageASTC);
+	tBench(ImageConvert);
+	tBench(ImageAtlas);
+	tBench(ImagePVRTC);
+	tBench(ImageJPGSave);
+	tBench(ImageEnvMap);
+	tBench(ImageWEBPFrames);
+	#endif
+
+	if (OptionJSON)
+	{
+		if (tBenchmark::WriteJSON(OptionJSON.Arg1()))
+			tPrintf("\nResults written to %s\n", OptionJSON.Arg1().Chr());
+		else
+			tPrintf("\nUnable to write results to %s\n", OptionJSON.Arg1().Chr());
+	}
+
+	return 0;
+}
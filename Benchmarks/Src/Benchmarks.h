@@ -0,0 +1,195 @@
+// Benchmarks.h
+//
+// Tacent benchmark framework. A benchmark unit is a function that calls tMeasure or tMeasureOps one or more times.
+// Each measurement runs the supplied function a number of untimed warmup iterations followed by a number of timed
+// trials. The minimum, maximum, median, mean and standard deviation of the trial times are recorded along with the peak
+// memory use of the process. When a measurement is given the number of bytes, pixels or operations processed per call,
+// throughput is reported in MB/s, MPix/s or MOps/s. All results may be written to a JSON file so that separate runs
+// can be compared. Container and algorithm benchmarks are usually run over a range of sizes (see GetSizes) so that
+// results can be plotted against size.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <cmath>
+#include <Foundation/tList.h>
+#include <Foundation/tString.h>
+#include <System/tPrint.h>
+#include <System/tTime.h>
+
+
+namespace tBenchmark
+{
+
+
+#define tBenchUnit(name) void name()
+#define tBench(name) { if (tBenchmark::IsUnitSelected(#name)) { tPrintf("\nBenchmarking " #name "\n"); tBenchmark::CurrentUnit = #name; tBenchmark::name(); } }
+
+
+struct tResult : public tLink<tResult>
+{
+	tString Unit;
+	tString Name;
+	int NumTrials				= 0;
+	double MinSeconds			= 0.0;
+	double MaxSeconds			= 0.0;
+	double MedianSeconds		= 0.0;
+	double MeanSeconds			= 0.0;
+	double StdDevSeconds		= 0.0;
+	int64 Size					= 0;				// The size parameter (eg. number of container elements). 0 if none.
+	int64 NumBytes				= 0;				// Bytes processed by a single call. 0 if not meaningful.
+	int64 NumPixels				= 0;				// Pixels processed by a single call. 0 if not meaningful.
+	int64 NumOps				= 0;				// Operations performed by a single call. 0 if not meaningful.
+	int64 PeakMemory			= -1;				// Peak resident bytes during the measurement. -1 if unknown.
+
+	// Throughput is based on the median time as it is less sensitive to outliers than the mean.
+	double GetMBPerSec() const																							{ return (NumBytes > 0) && (MedianSeconds > 0.0) ? double(NumBytes) / (MedianSeconds*1024.0*1024.0) : 0.0; }
+	double GetMPixPerSec() const																						{ return (NumPixels > 0) && (MedianSeconds > 0.0) ? double(NumPixels) / (MedianSeconds*1000000.0) : 0.0; }
+	double GetMOpsPerSec() const																						{ return (NumOps > 0) && (MedianSeconds > 0.0) ? double(NumOps) / (MedianSeconds*1000000.0) : 0.0; }
+	double GetNanosecondsPerOp() const																					{ return (NumOps > 0) ? MedianSeconds*1000000000.0 / double(NumOps) : 0.0; }
+};
+
+
+// Runs fn NumWarmup times untimed, then NumTrials times timed, and records the result. numBytes and numPixels are the
+// amount of data processed by a single call of fn and may be 0. The returned result remains valid until exit.
+template<typename Fn> const tResult& tMeasure(const char* name, int64 numBytes, int64 numPixels, Fn fn);
+
+// Same as tMeasure but for containers and algorithms. size is recorded as the parameter the benchmark was run with and
+// numOps is the number of operations (inserts, lookups, compares etc) performed by a single call of fn.
+template<typename Fn> const tResult& tMeasureOps(const char* name, int64 size, int64 numOps, Fn fn);
+
+// Prevents the compiler from optimizing away a computation whose result is otherwise unused.
+template<typename T> void tDoNotOptimize(const T& value);
+
+// A cheap integer hash for generating deterministic pseudo-random benchmark data. The same input always gives the
+// same output on every platform so runs are comparable.
+uint32 Hash(uint32 x);
+
+// Returns the number of sizes and sets sizes to point to them. These are the powers of 10 from 10 to MaxSize.
+int GetSizes(const int*& sizes);
+
+// Small sizes finish in a few microseconds which is too close to timer resolution. Benchmarks repeat their work this
+// many times per call so that every call performs at least minOps operations.
+int GetRepeats(int size, int minOps = 1000000);
+
+// Pins the calling thread to the supplied logical core to reduce timing noise from migrations. Returns success.
+bool PinToCore(int core);
+
+// A unit is selected if no filter was specified or if the filter string is a substring of the unit name.
+bool IsUnitSelected(const char* unitName);
+
+// Peak memory is the high-water mark of the process resident set in bytes, or -1 if unsupported. On Linux the
+// high-water mark can be reset so each measurement reports its own peak. On other platforms it is the process peak.
+void ResetPeakMemory();
+int64 GetPeakMemory();
+
+void PrintResult(const tResult&);
+bool WriteJSON(const tString& jsonFile);
+
+extern int NumWarmup;
+extern int NumTrials;
+extern int MaxSize;
+extern tString Filter;
+extern const char* CurrentUnit;
+extern tList<tResult> Results;
+
+
+// Implementation below this line.
+
+
+inline uint32 Hash(uint32 x)
+{
+	x ^= x >> 16;	x *= 0x7FEB352Du;
+	x ^= x >> 15;	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return x;
+}
+
+
+template<typename Fn> inline void tRunTrials(tResult& result, Fn& fn)
+{
+	for (int w = 0; w < NumWarmup; w++)
+		fn();
+
+	ResetPeakMemory();
+	int numTrials = tMath::tMax(NumTrials, 1);
+	double* seconds = new double[numTrials];
+	double freq = double(tSystem::tGetHardwareTimerFrequency());
+	for (int t = 0; t < numTrials; t++)
+	{
+		int64 start = tSystem::tGetHardwareTimerCount();
+		fn();
+		seconds[t] = double(tSystem::tGetHardwareTimerCount() - start) / freq;
+	}
+
+	// There are only ever a handful of trials so an insertion sort is fine.
+	double total = 0.0;
+	for (int i = 0; i < numTrials; i++)
+	{
+		total += seconds[i];
+		for (int j = i; (j > 0) && (seconds[j] < seconds[j-1]); j--)
+			tStd::tSwap(seconds[j], seconds[j-1]);
+	}
+	double mean = total / double(numTrials);
+	double sumSqDiff = 0.0;
+	for (int i = 0; i < numTrials; i++)
+		sumSqDiff += (seconds[i] - mean) * (seconds[i] - mean);
+
+	result.Unit				= CurrentUnit;
+	result.NumTrials		= numTrials;
+	result.MinSeconds		= seconds[0];
+	result.MaxSeconds		= seconds[numTrials-1];
+	result.MedianSeconds	= (numTrials & 1) ? seconds[numTrials/2] : (seconds[numTrials/2 - 1] + seconds[numTrials/2]) / 2.0;
+	result.MeanSeconds		= mean;
+	result.StdDevSeconds	= (numTrials > 1) ? sqrt(sumSqDiff / double(numTrials - 1)) : 0.0;
+	result.PeakMemory		= GetPeakMemory();
+	delete[] seconds;
+
+	Results.Append(&result);
+	PrintResult(result);
+}
+
+
+template<typename Fn> inline const tResult& tMeasure(const char* name, int64 numBytes, int64 numPixels, Fn fn)
+{
+	tResult* result		= new tResult;
+	result->Name		= name;
+	result->NumBytes	= numBytes;
+	result->NumPixels	= numPixels;
+	tRunTrials(*result, fn);
+	return *result;
+}
+
+
+template<typename Fn> inline const tResult& tMeasureOps(const char* name, int64 size, int64 numOps, Fn fn)
+{
+	tResult* result		= new tResult;
+	result->Name		= name;
+	result->Size		= size;
+	result->NumOps		= numOps;
+	tRunTrials(*result, fn);
+	return *result;
+}
+
+
+template<typename T> inline void tDoNotOptimize(const T& value)
+{
+	#if defined(_MSC_VER)
+	// MSVC has no inline asm on x64. A volatile read of the address is enough to keep the value alive.
+	static const void* volatile sink;
+	sink = &value;
+	#else
+	asm volatile("" : : "r,m"(value) : "memory");
+	#endif
+}
+
+
+}
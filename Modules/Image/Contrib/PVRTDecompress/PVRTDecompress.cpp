@@ -490,7 +490,7 @@ static void mapDecompressedData(Pixel32* pOutput, uint32_t width, const Pixel32*
 		}
 	}
 }
-static uint32_t pvrtcDecompress(uint8_t* pCompressedData, Pixel32* pDecompressedData, uint32_t width, uint32_t height, uint8_t bpp)
+static uint32_t pvrtcDecompress(uint8_t* pCompressedData, Pixel32* pDecompressedData, uint32_t width, uint32_t height, uint8_t bpp, int32_t firstBand, int32_t endBand)
 {
 	uint32_t wordWidth = 4;
 	uint32_t wordHeight = 4;
@@ -507,8 +507,9 @@ static uint32_t pvrtcDecompress(uint8_t* pCompressedData, Pixel32* pDecompressed
 	PVRTCWordIndices indices;
 	std::vector<Pixel32> pPixels(wordWidth * wordHeight * sizeof(Pixel32));
 
-	// For each row of words
-	for (int32_t wordY = -1; wordY < i32NumYWords - 1; wordY++)
+	// For each row of words. Band b decodes the pixels between the centres of word rows b-1 and b. Different bands
+	// write different pixels so they may be decoded concurrently into the same output.
+	for (int32_t wordY = firstBand - 1; wordY < endBand - 1; wordY++)
 	{
 		// for each column of words
 		for (int32_t wordX = -1; wordX < i32NumXWords - 1; wordX++)
@@ -565,7 +566,7 @@ uint32_t PVRTDecompressPVRTC(const void* pCompressedData, uint32_t Do2bitMode, u
 	if (XTrueDim != XDim || YTrueDim != YDim) { pDecompressedData = new Pixel32[XTrueDim * YTrueDim]; }
 
 	// Decompress the surface.
-	uint32_t retval = pvrtcDecompress((uint8_t*)pCompressedData, pDecompressedData, XTrueDim, YTrueDim, uint8_t(Do2bitMode == 1 ? 2 : 4));
+	uint32_t retval = pvrtcDecompress((uint8_t*)pCompressedData, pDecompressedData, XTrueDim, YTrueDim, uint8_t(Do2bitMode == 1 ? 2 : 4), 0, int32_t(YTrueDim / 4));
 
 	// If the dimensions were too small, then copy the new buffer back into the output buffer.
 	if (XTrueDim != XDim || YTrueDim != YDim)
@@ -582,5 +583,17 @@ uint32_t PVRTDecompressPVRTC(const void* pCompressedData, uint32_t Do2bitMode, u
 	return retval;
 }
 
+uint32_t PVRTDecompressPVRTCBand(const void* pCompressedData, uint32_t Do2bitMode, uint32_t XDim, uint32_t YDim, uint8_t* pResultImage, uint32_t FirstWordRow, uint32_t NumWordRows)
+{
+	// No padding here. The caller must use PVRTDecompressPVRTC for images below the minimum size.
+	if ((XDim < ((Do2bitMode == 1u) ? 16u : 8u)) || (YDim < 8u)) { return 0; }
+	uint32_t numYWords = YDim / 4;
+	if ((FirstWordRow >= numYWords) || (NumWordRows == 0)) { return 0; }
+	uint32_t endWordRow = std::min(FirstWordRow + NumWordRows, numYWords);
+
+	pvrtcDecompress((uint8_t*)pCompressedData, (Pixel32*)pResultImage, XDim, YDim, uint8_t(Do2bitMode == 1 ? 2 : 4), int32_t(FirstWordRow), int32_t(endWordRow));
+	return XDim * (endWordRow - FirstWordRow) * 4 / ((Do2bitMode == 1u) ? 4u : 2u);
+}
+
 } // namespace pvr
 //!\endcond
@@ -19,4 +19,17 @@ namespace pvr {
 /// <returns>Return the amount of data that was decompressed.</returns>
 uint32_t PVRTDecompressPVRTC(const void* compressedData, uint32_t do2bitMode, uint32_t xDim, uint32_t yDim, uint8_t* outResultImage);
 
+/// <summary>Decompresses a horizontal band of a PVRTC texture to RGBA 8888. Band b covers the pixel rows from the
+/// centre of word row b-1 to the centre of word row b (wrapping), so bands never write the same pixels and may be
+/// decoded concurrently into the same output image. Each band reads the word rows on either side of it.</summary>
+/// <param name="compressedData">The PVRTC texture data to decompress</param>
+/// <param name="do2bitMode">Signifies whether the data is PVRTC2 or PVRTC4</param>
+/// <param name="xDim">X dimension of the texture. Must be at least 16 (2bpp) or 8 (4bpp)</param>
+/// <param name="yDim">Y dimension of the texture. Must be at least 8</param>
+/// <param name="outResultImage">The full xDim*yDim decompressed texture. Only the band's pixels are written</param>
+/// <param name="firstWordRow">First band to decode. Word rows are 4 pixels high</param>
+/// <param name="numWordRows">Number of bands to decode</param>
+/// <returns>Return the amount of data that was decompressed or 0 if the dimensions or band are invalid.</returns>
+uint32_t PVRTDecompressPVRTCBand(const void* compressedData, uint32_t do2bitMode, uint32_t xDim, uint32_t yDim, uint8_t* outResultImage, uint32_t firstWordRow, uint32_t numWordRows);
+
 } // namespace pvr
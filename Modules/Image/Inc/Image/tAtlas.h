@@ -0,0 +1,121 @@
+// tAtlas.h
+//
+// Texture atlas (sprite-sheet) packing. A set of tPicture sprites is packed into one or more fixed-size pages using
+// either MaxRects or Skyline bin packing. Sprites may optionally be trimmed of uniform borders and rotated by 90
+// degrees to pack tighter. Edge pixels may be extruded outwards so bilinear filtering at sprite edges does not pick up
+// neighbouring sprites. Pages are composited in parallel, one page per thread.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Math/tColour.h>
+#include "Image/tPicture.h"
+namespace tImage
+{
+
+
+// Where a single sprite ended up. Coordinates follow tPicture conventions: the origin is the lower-left of the page
+// and y increases upwards. The UVs use the same convention so they may be used directly with OpenGL.
+struct tAtlasEntry
+{
+	int Page						= -1;		// The page index or -1 if the sprite could not be packed.
+	int X							= 0;		// Lower-left of the sprite pixels in the page. Does not include extrusion.
+	int Y							= 0;
+	int Width						= 0;		// Size of the sprite pixels in the page. If rotated these are the
+	int Height						= 0;		// trimmed height and width respectively.
+	bool Rotated					= false;	// The sprite was rotated 90 degrees clockwise when placed.
+
+	// Trimming. The trimmed pixels start at TrimX, TrimY in the original sprite of size SrcWidth x SrcHeight. With
+	// trimming off TrimX and TrimY are 0 and the trimmed size is the source size.
+	int TrimX						= 0;
+	int TrimY						= 0;
+	int SrcWidth					= 0;
+	int SrcHeight					= 0;
+
+	// Normalized page coordinates of the sprite pixels.
+	float U0 = 0.0f, V0 = 0.0f;
+	float U1 = 0.0f, V1 = 0.0f;
+};
+
+
+class tAtlas
+{
+public:
+	enum class tMethod
+	{
+		MaxRects,			// Best short-side fit. Tightest packing. Slower, especially for many small sprites.
+		Skyline				// Bottom-left skyline. Roughly an order of magnitude faster with slightly more waste.
+	};
+
+	struct Params
+	{
+		Params()																										{ Reset(); }
+		void Reset();
+
+		tMethod Method;
+		int PageWidth;
+		int PageHeight;
+
+		// Number of empty pixels between sprites. Extruded pixels are in addition to this.
+		int Padding;
+
+		// Number of times the edge pixels of each sprite are repeated outwards.
+		int Extrude;
+
+		// Allow sprites to be rotated 90 degrees clockwise if it gives a better fit.
+		bool AllowRotation;
+
+		// Trim sides of each sprite that match TrimColour in TrimChannels. This is the same test Deborder uses.
+		bool Trim;
+		tColour4b TrimColour;
+		comp_t TrimChannels;
+
+		// Colour of the page pixels not covered by sprites.
+		tColour4b Background;
+
+		// Threads used for trimming and compositing. All cores if <= 0.
+		int NumThreads;
+	};
+
+	tAtlas()																											{ }
+	~tAtlas()																											{ Clear(); }
+
+	// Packs the sprites and composites the pages. The sprite pictures are only read during this call. Entry i
+	// corresponds to sprites[i]. A sprite that cannot fit on an empty page, or is invalid, gets an entry with Page -1.
+	// Returns the number of sprites packed.
+	int Build(const tPicture* const* sprites, int numSprites, const Params& = Params());
+
+	// Same as Build but only computes the entries. No pages are allocated.
+	int Pack(const tPicture* const* sprites, int numSprites, const Params& = Params());
+
+	void Clear();
+	int GetNumPages() const																								{ return NumPages; }
+	int GetNumEntries() const																							{ return NumEntries; }
+	const tAtlasEntry& GetEntry(int index) const																		{ tAssert((index >= 0) && (index < NumEntries)); return Entries[index]; }
+	tPicture& GetPage(int page)																							{ tAssert((page >= 0) && (page < NumPages) && Pages); return Pages[page]; }
+
+	// The fraction of the used page area covered by sprite pixels (excluding extrusion and padding). The last page is
+	// counted in full, so fewer, fuller pages give a higher number.
+	float GetOccupancy() const;
+
+private:
+	void Composite(const tPicture* const* sprites, const Params&);
+
+	int NumEntries							= 0;
+	tAtlasEntry* Entries					= nullptr;
+	int NumPages							= 0;
+	int PageWidth							= 0;
+	int PageHeight							= 0;
+	tPicture* Pages							= nullptr;
+};
+
+
+}
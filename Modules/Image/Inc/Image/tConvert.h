@@ -0,0 +1,119 @@
+// tConvert.h
+//
+// Batch image conversion. Converting a large set of files with Load, transform and Save in a loop on one thread
+// leaves most cores idle and the CPU waiting on the disk. tConvertBatch splits each conversion into stages: Read file
+// bytes, Decode, Transform, Encode, and Write. The Read and Write stages each get a dedicated I/O thread. Decode,
+// Transform and Encode are serviced by a shared pool of compute threads. Stages are connected by bounded queues so a
+// fast reader cannot get arbitrarily far ahead of the encoders and memory use stays proportional to the queue
+// capacity, not the number of files. Per-stage counters are returned so it is easy to see which stage is the
+// bottleneck.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <functional>
+#include <Foundation/tList.h>
+#include <Foundation/tString.h>
+#include "Image/tPicture.h"
+#include "Image/tQuantize.h"
+#include "Image/tResample.h"
+namespace tImage
+{
+
+
+enum class tConvertStage
+{
+	Read,
+	Decode,
+	Transform,
+	Encode,
+	Write,
+	NumStages
+};
+const char* tGetConvertStageName(tConvertStage);
+
+
+// A single conversion. The destination type is determined by the DstFile extension. Supported destination types are
+// tga, bmp, qoi, png, jpg, webp and tiff. Any type tPicture can be made from may be used as the source.
+struct tConvertJob : public tLink<tConvertJob>
+{
+	tConvertJob()																										{ }
+	tConvertJob(const tString& srcFile, const tString& dstFile)															: SrcFile(srcFile), DstFile(dstFile) { }
+
+	tString SrcFile;
+	tString DstFile;
+
+	// Results. Success is true only if the file was written. On failure FailedStage is the stage that failed.
+	bool Success																	= false;
+	tConvertStage FailedStage														= tConvertStage::NumStages;
+};
+
+
+struct tConvertParams
+{
+	tConvertParams()																									{ Reset(); }
+	void Reset();
+
+	// The number of compute threads shared by the Decode, Transform and Encode stages. If <= 0 all cores are used.
+	int NumThreads;
+
+	// The maximum number of jobs that may wait between any two adjacent stages. Larger values smooth out uneven file
+	// sizes at the cost of memory. Clamped to at least 1.
+	int QueueCapacity;
+
+	// Transform stage. The operations are applied in the order they are listed here. A ResampleWidth or
+	// ResampleHeight of 0 keeps the aspect ratio based on the other. If both are 0 no resample is performed.
+	int ResampleWidth;
+	int ResampleHeight;
+	tResampleFilter ResampleFilter;
+	tResampleEdgeMode ResampleEdgeMode;
+
+	// Brightness and Contrast are in [0.0, 1.0]. Negative values (the default) leave the image unadjusted.
+	float Brightness;
+	float Contrast;
+
+	// If QuantizeColours is in [2, 256] the image is quantized to that many colours.
+	int QuantizeColours;
+	tQuantize::Method QuantizeMethod;
+
+	// Optional. Called last in the Transform stage. It is called concurrently from multiple threads, each with a
+	// different picture, so it must be thread-safe. Return false to fail the job.
+	std::function<bool(tPicture&)> Transform;
+};
+
+
+struct tConvertStageStats
+{
+	int64 NumItems																	= 0;		// Jobs that completed the stage.
+	int64 NumFailed																	= 0;		// Jobs that failed in the stage.
+	int64 NumBytes																	= 0;		// File bytes for Read, Encode and Write. Pixel bytes for Decode and Transform.
+	double BusySeconds																= 0.0;		// Summed over all threads that worked on the stage.
+
+	// Throughput of a single busy thread. Compare against the pipeline wall time to see where time goes.
+	double GetItemsPerSecond() const																					{ return (BusySeconds > 0.0) ? double(NumItems) / BusySeconds : 0.0; }
+	double GetMBPerSecond() const																						{ return (BusySeconds > 0.0) ? double(NumBytes) / (BusySeconds*1024.0*1024.0) : 0.0; }
+};
+
+
+struct tConvertStats
+{
+	tConvertStageStats Stages[int(tConvertStage::NumStages)];
+	double WallSeconds																= 0.0;
+	int NumComputeThreads															= 0;
+};
+
+
+// Converts all jobs and fills in their Success and FailedStage members. Blocks until every job is complete. Returns
+// the number of jobs that succeeded. If stats is non-null it is filled in.
+int tConvertBatch(tList<tConvertJob>& jobs, const tConvertParams& = tConvertParams(), tConvertStats* stats = nullptr);
+
+
+}
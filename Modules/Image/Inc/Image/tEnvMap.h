@@ -0,0 +1,74 @@
+// tEnvMap.h
+//
+// Environment maps for image-based lighting. An equirectangular (latitude-longitude) HDR panorama may be converted to
+// the six faces of a cubemap. From those faces a diffuse irradiance cubemap and a GGX prefiltered specular cubemap,
+// with roughness increasing down the mipmap chain, may be computed. Everything is done in linear float. Filtering uses
+// importance sampling with the sample count reduced by reading from box-filtered mipmaps of the source faces, so
+// results are smooth with a few hundred samples per texel. Work is split across faces, texels and mipmaps on all
+// cores and the RGBA maths uses SSE2 on x86/x64.
+//
+// Faces are in tFaceIndex order and use the usual DDS/KTX cubemap orientation. The output layers are float
+// (R32G32B32A32f or R16G16B16A16f) and, like tPicture, their rows go from bottom to top. They can be handed straight
+// to tImageDDS::Writer or tImageKTX::Writer with the default save params to produce a standard cubemap file.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Foundation/tList.h>
+#include "Image/tBaseImage.h"
+#include "Image/tLayer.h"
+#include "Image/tPictureT.h"
+namespace tImage
+{
+
+
+struct tEnvMapParams
+{
+	tEnvMapParams()																										{ Reset(); }
+	tEnvMapParams(const tEnvMapParams& src)																				: NumSpecularMipmaps(src.NumSpecularMipmaps), NumSpecularSamples(src.NumSpecularSamples), IrradianceSize(src.IrradianceSize), NumIrradianceSamples(src.NumIrradianceSamples), PixelFormat(src.PixelFormat), NumThreads(src.NumThreads) { }
+	void Reset()																										{ NumSpecularMipmaps = 0; NumSpecularSamples = 256; IrradianceSize = 32; NumIrradianceSamples = 512; PixelFormat = tPixelFormat::R16G16B16A16f; NumThreads = 0; }
+	tEnvMapParams& operator=(const tEnvMapParams& src)																	{ NumSpecularMipmaps = src.NumSpecularMipmaps; NumSpecularSamples = src.NumSpecularSamples; IrradianceSize = src.IrradianceSize; NumIrradianceSamples = src.NumIrradianceSamples; PixelFormat = src.PixelFormat; NumThreads = src.NumThreads; return *this; }
+
+	// Roughness goes linearly from 0 at mipmap 0 to 1 at the last mipmap. If <= 0, or more than the full chain, the
+	// full chain down to 1x1 is generated.
+	int NumSpecularMipmaps;
+	int NumSpecularSamples;
+
+	// Face width and height of the irradiance cubemap. Irradiance is very smooth so it can be small.
+	int IrradianceSize;
+	int NumIrradianceSamples;
+
+	// Must be R16G16B16A16f or R32G32B32A32f. Alpha is always 1.
+	tPixelFormat PixelFormat;
+
+	// All cores if <= 0.
+	int NumThreads;
+};
+
+
+// Converts an equirectangular panorama to six square faces of faceSize with bilinear filtering. The panorama wraps
+// horizontally. Its centre faces +Z, +X is a quarter of the way to the right of that, and the top row is +Y. Returns
+// false if the panorama is invalid or faceSize < 1.
+bool EquirectToCubemap(tPicture4f faces[tFaceIndex_NumFaces], const tPicture4f& panorama, int faceSize, int numThreads = 0);
+
+// Computes a GGX prefiltered specular cubemap from six square faces of the same size. Each layer list gets one layer
+// per mipmap. Mipmap 0 is the source face itself since it has zero roughness. Mipmap m of n has roughness m/(n-1) and
+// is prefiltered assuming the view and normal are the reflection direction, as in the split-sum approximation. Any
+// layers already in the lists are deleted. Returns false if the faces or params are not valid.
+bool PrefilterSpecular(tList<tLayer> layers[tFaceIndex_NumFaces], const tPicture4f faces[tFaceIndex_NumFaces], const tEnvMapParams& = tEnvMapParams());
+
+// Computes a diffuse irradiance cubemap from six square faces of the same size. Each texel is the cosine-weighted
+// average of the incoming radiance over the hemisphere around its direction, so multiplying by a diffuse albedo gives
+// the outgoing radiance. Each layer list gets a single layer. Returns false if the faces or params are not valid.
+bool ComputeIrradiance(tList<tLayer> layers[tFaceIndex_NumFaces], const tPicture4f faces[tFaceIndex_NumFaces], const tEnvMapParams& = tEnvMapParams());
+
+
+}
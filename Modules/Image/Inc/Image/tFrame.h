@@ -16,6 +16,7 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #pragma once
+#include <functional>
 #include <Foundation/tStandard.h>
 #include <Foundation/tList.h>
 #include <Image/tPixelFormat.h>
@@ -65,6 +66,13 @@ private:
 };
 
 
+// Loaders that support progressive decoding (interlaced png, progressive jpg) call a function of this type after each
+// pass that is not the last. The preview is full-size, bottom-row-first, and lower quality than the final image. pass
+// is zero-based and numPasses is the number of passes in the file. The preview belongs to the caller of the function
+// so it may be stolen from. Loading continues when the function returns.
+typedef std::function<void(tFrame& preview, int pass, int numPasses)> tProgressiveCallback;
+
+
 // Implementation below this line.
 
 
@@ -26,9 +26,25 @@ namespace tImage
 class tImageAPNG : public tBaseImage
 {
 public:
+	enum LoadFlags
+	{
+		// Skips the tacent decoder and always loads with apngdis. Mostly useful for cross-checking the two decoders.
+		LoadFlag_ForceApngDis		= 1 << 0,
+		LoadFlags_Default			= 0
+	};
+
+	struct LoadParams
+	{
+		LoadParams()																									{ Reset(); }
+		LoadParams(const LoadParams& src)																				: Flags(src.Flags) { }
+		void Reset()																									{ Flags = LoadFlags_Default; }
+		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; return *this; }
+		uint32 Flags;
+	};
+
 	// Creates an invalid tImageAPNG. You must call Load manually.
 	tImageAPNG()																										{ }
-	tImageAPNG(const tString& apngFile)																					{ Load(apngFile); }
+	tImageAPNG(const tString& apngFile, const LoadParams& params = LoadParams())										{ Load(apngFile, params); }
 
 	// Creates a tImageAPNG from a bunch of frames. If steal is true, the srcFrames will be empty after.
 	tImageAPNG(tList<tFrame>& srcFrames, bool stealFrames)																{ Set(srcFrames, stealFrames); }
@@ -45,8 +61,13 @@ public:
 
 	virtual ~tImageAPNG()																								{ Clear(); }
 
-	// Clears the current tImageAPNG before loading. If false returned object is invalid.
-	bool Load(const tString& apngFile);
+	// Clears the current tImageAPNG before loading. If false returned object is invalid. 8-bit RGB and RGBA files
+	// that are not interlaced (this includes everything tImageAPNG saves) are decoded by tacent directly: the frame
+	// rectangles are decompressed concurrently and then composited in order, touching only each frame's rectangle on
+	// the running canvas. Other files are loaded with apngdis. Compositing is done eagerly at load time because every
+	// frame depends on all the ones before it and Frames hands out complete tFrames that callers walk or steal
+	// directly. Memory is kept down by decoding in bounded batches onto a single canvas.
+	bool Load(const tString& apngFile, const LoadParams& = LoadParams());
 
 	// @todo No current in-memory loader.
 	// bool Load(const uint8* apngFileInMemory, int numBytes);
@@ -74,12 +95,20 @@ public:
 	struct SaveParams
 	{
 		SaveParams()																									{ Reset(); }
-		SaveParams(const SaveParams& src)																				: Format(src.Format), OverrideFrameDuration(src.OverrideFrameDuration) { }
-		void Reset()																									{ Format = tFormat::Auto; OverrideFrameDuration = -1; }
-		SaveParams& operator=(const SaveParams& src)																	{ Format = src.Format; OverrideFrameDuration = src.OverrideFrameDuration; return *this; }
+		SaveParams(const SaveParams& src)																				: Format(src.Format), OverrideFrameDuration(src.OverrideFrameDuration), DirtyRects(src.DirtyRects), NumThreads(src.NumThreads) { }
+		void Reset()																									{ Format = tFormat::Auto; OverrideFrameDuration = -1; DirtyRects = false; NumThreads = 0; }
+		SaveParams& operator=(const SaveParams& src)																	{ Format = src.Format; OverrideFrameDuration = src.OverrideFrameDuration; DirtyRects = src.DirtyRects; NumThreads = src.NumThreads; return *this; }
 
 		tFormat Format;
 		int OverrideFrameDuration;
+
+		// If DirtyRects is true tacent writes the file itself instead of using apngasm. Every frame after the first
+		// stores only the rectangle that changed since the previous frame (dispose none, blend source) and the
+		// rectangles are compressed concurrently on NumThreads threads (all cores if <= 0). This is much faster for
+		// long or screen-capture style animations. apngasm also stores changed rectangles, but it tries every dispose
+		// and blend combination per frame on a single thread, so its files are sometimes a little smaller.
+		bool DirtyRects;
+		int NumThreads;
 	};
 
 	// Saves the tImageAPNG to the APNG file specified. The type of filename must be PNG or APNG. PNG is allowed because
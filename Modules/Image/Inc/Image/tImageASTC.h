@@ -20,10 +20,46 @@
 #include <Image/tPixelFormat.h>
 #include <Image/tLayer.h>
 #include <Image/tBaseImage.h>
+#include <Image/tToneMap.h>
+struct astcenc_context;
 namespace tImage
 {
 
 
+// Encodes 8-bit RGBA pixels to ASTC blocks using astcenc. Creating the astcenc context is expensive compared to
+// encoding a small image, so an encoder may be reused for any number of images (mipmaps, atlas pages, etc.) that share
+// the same block size, quality, and profile. Every worker thread takes part in compressing each image. A single
+// encoder may only compress one image at a time.
+class tASTCEncoder
+{
+public:
+	// Quality presets. These are the effort levels of the astcenc named presets. Any value in [0, 100] may be used.
+	static constexpr float Quality_Fastest		= 0.0f;
+	static constexpr float Quality_Fast			= 10.0f;
+	static constexpr float Quality_Medium		= 60.0f;
+	static constexpr float Quality_Thorough		= 98.0f;
+	static constexpr float Quality_Exhaustive	= 100.0f;
+
+	// The format must be one of the ASTC pixel formats. Pixels are treated as linear if the profile is LDRlRGBA and as
+	// sRGB otherwise. If numThreads is <= 0 all cores are used. Check IsValid after construction.
+	tASTCEncoder(tPixelFormat astcFormat, float quality = Quality_Medium, tColourProfile = tColourProfile::sRGB, int numThreads = 0);
+	~tASTCEncoder();
+
+	bool IsValid() const																								{ return Context ? true : false; }
+	tPixelFormat GetFormat() const																						{ return Format; }
+
+	// Returns a new[] allocated buffer holding the encoded blocks and sets numBytes to its size. Returns nullptr on
+	// failure. Blocks are written in the same row order as the supplied pixels unless reverseRows is true, in which case
+	// the pixel rows are read last to first. Use it to go from bottom-up tacent pixels to a top-down .astc file.
+	uint8* Encode(int& numBytes, const tPixel4b* pixels, int width, int height, bool reverseRows = false);
+
+private:
+	tPixelFormat Format			= tPixelFormat::Invalid;
+	int NumThreads				= 1;
+	astcenc_context* Context	= nullptr;
+};
+
+
 class tImageASTC : public tBaseImage
 {
 public:
@@ -37,22 +73,36 @@ public:
 		LoadFlag_GammaCompression	= 1 << 2,	// Gamma-correct. Gamma compression using an encoding gamma of 1/2.2. You may override the 2.2 default.
 		LoadFlag_SRGBCompression	= 1 << 3,	// Same as above but uses the official sRGB transformation. Linear -> sRGB. Approx encoding gamma of 1/2.4 for part of curve.
 		LoadFlag_AutoGamma			= 1 << 4,	// Determines whether to apply sRGB compression based on colour profile. Call GetColourProfile to see if it applied.
-		LoadFlag_ToneMapExposure	= 1 << 5,	// Apply exposure value when loading the astc.
+		LoadFlag_ToneMapExposure	= 1 << 5,	// Apply exposure and the ToneMap operator when loading the astc.
 		LoadFlags_Default			= LoadFlag_Decode | LoadFlag_ReverseRowOrder | LoadFlag_AutoGamma
 	};
 
 	struct LoadParams
 	{
 		LoadParams()																									{ Reset(); }
-		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Profile(src.Profile), Gamma(src.Gamma), Exposure(src.Exposure) { }
+		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Profile(src.Profile), Gamma(src.Gamma), Exposure(src.Exposure), ToneMap(src.ToneMap) { }
 
-		void Reset()																									{ Flags = LoadFlags_Default; Profile = tColourProfile::LDRsRGB_LDRlA; Gamma = tMath::DefaultGamma; Exposure = 1.0f; }
-		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Profile = src.Profile; Gamma = src.Gamma; Exposure = src.Exposure; return *this; }
+		void Reset()																									{ Flags = LoadFlags_Default; Profile = tColourProfile::LDRsRGB_LDRlA; Gamma = tMath::DefaultGamma; Exposure = 1.0f; ToneMap = tToneMapOperator::Exposure; }
+		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Profile = src.Profile; Gamma = src.Gamma; Exposure = src.Exposure; ToneMap = src.ToneMap; return *this; }
 
 		uint32 Flags;
 		tColourProfile Profile;		// Used if decoding and LoadFlag_AutoGamma is set.
 		float Gamma;				// Used if decoding and LoadFlag_GammaCompression is set.
 		float Exposure;				// Used if decoding and LoadFlag_ToneMapExposure is set.
+		tToneMapOperator ToneMap;	// Used if decoding and LoadFlag_ToneMapExposure is set.
+	};
+
+	struct SaveParams
+	{
+		SaveParams()																									{ Reset(); }
+		SaveParams(const SaveParams& src)																				: Format(src.Format), Quality(src.Quality), NumThreads(src.NumThreads) { }
+
+		void Reset()																									{ Format = tPixelFormat::ASTC4X4; Quality = tASTCEncoder::Quality_Medium; NumThreads = 0; }
+		SaveParams& operator=(const SaveParams& src)																	{ Format = src.Format; Quality = src.Quality; NumThreads = src.NumThreads; return *this; }
+
+		tPixelFormat Format;		// The block size. Must be one of the ASTC pixel formats.
+		float Quality;				// Encoder effort in [0, 100]. See the tASTCEncoder presets.
+		int NumThreads;				// Threads taking part in the encode. All cores if <= 0.
 	};
 
 	// Creates an invalid tImageASTC. You must call Load manually.
@@ -88,6 +138,12 @@ public:
 	// Sets from a tPicture.
 	bool Set(tPicture& picture, bool steal = true) override;
 
+	// Saves to an .astc file. If the layer was not decoded its ASTC blocks are written as-is and the params are
+	// ignored. Otherwise the R8G8B8A8 pixels are encoded, as linear if the colour profile is LDRlRGBA and as sRGB if not.
+	// Decoded rows are assumed to be bottom-up, which is what LoadFlag_ReverseRowOrder and the Set calls give. Returns
+	// success.
+	bool Save(const tString& astcFile, const SaveParams& = SaveParams()) const;
+
 	// After this call no memory will be consumed by the object and it will be invalid.
 	void Clear() override;
 	bool IsValid() const override																						{ return (Layer && Layer->IsValid()); }
@@ -41,6 +41,7 @@
 #include <Image/tBaseImage.h>
 namespace tImage
 {
+class tBlockWriter;
 
 
 class tImageBMP : public tBaseImage
@@ -62,11 +63,12 @@ public:
 	virtual ~tImageBMP()																								{ Clear(); }
 
 	// Clears the current tImageBMP before loading. Supports RGBA, RGB, R5G5B5A1, 8-bit indexed, 4-bit indexed, 1-bit
-	// indexed, and run-length encoded RLE4 and RLE8. Returns success. If false returned, object is invalid.
+	// indexed, and run-length encoded RLE4 and RLE8. Returns success. If false returned, object is invalid. The file is
+	// read into memory in one go and decoded from there.
 	bool Load(const tString& bmpFile);
 
-	// @todo No current in-memory loader.
-	// bool Load(const uint8* bmpFileInMemory, int numBytes);
+	// Same as above but loads from a bmp file already in memory. Truncated pixel data results in a failed load.
+	bool Load(const uint8* bmpFileInMemory, int numBytes);
 
 	// This one sets from a supplied pixel array. If steal is true it takes ownership of the pixels pointer. Otherwise
 	// it just copies the data out.
@@ -101,6 +103,10 @@ public:
 	tFormat Save(const tString& bmpFile, tFormat) const;
 	tFormat Save(const tString& bmpFile, const SaveParams& = SaveParams()) const;
 
+	// Same as above but the bmp file is written to memory instead of disk. On success bmpFileInMemory is set to a new
+	// buffer of numBytes that you are responsible for delete[]ing. On failure it is set to nullptr.
+	tFormat Save(uint8*& bmpFileInMemory, int& numBytes, const SaveParams& = SaveParams()) const;
+
 	// After this call no memory will be consumed by the object and it will be invalid.
 	void Clear() override;
 	bool IsValid() const override																						{ return Pixels ? true : false; }
@@ -153,14 +159,18 @@ private:
 	};
 	#pragma pack(pop, r1)
 
-	void ReadRow_Pixels32	(tFileHandle, uint8* dest);
-	void ReadRow_Pixels24	(tFileHandle, uint8* dest);
-	void ReadRow_Pixels16	(tFileHandle, uint8* dest);
-	void ReadRow_Indexed8	(tFileHandle, uint8* dest, PaletteColour* palette);
-	void ReadRow_Indexed4	(tFileHandle, uint8* dest, PaletteColour* palette);
-	void ReadRow_Indexed1	(tFileHandle, uint8* dest, PaletteColour* palette);
-	void ReadRow_IndexedRLE8(tFileHandle, uint8* dest, PaletteColour* palette);
-	void ReadRow_IndexedRLE4(tFileHandle, uint8* dest, PaletteColour* palette);
+	// Writes the headers and rows. Format must be BPP24 or BPP32.
+	bool Save(tBlockWriter&, tFormat) const;
+
+	// These decode the pixel data starting at src (with end one past the last valid byte) into the RGBA dest buffer.
+	// The non-RLE readers decode a whole row at a time and write it straight to its final (possibly flipped) location.
+	// They return false if the source data is truncated. The RLE readers stop early if the data runs out.
+	bool ReadRow_Pixels32	(const uint8* src, const uint8* end, uint8* dest, bool flip);
+	bool ReadRow_Pixels24	(const uint8* src, const uint8* end, uint8* dest, bool flip);
+	bool ReadRow_Pixels16	(const uint8* src, const uint8* end, uint8* dest, bool flip);
+	bool ReadRow_Indexed	(const uint8* src, const uint8* end, uint8* dest, bool flip, int bpp, const tPixel4b* palette);
+	void ReadRow_IndexedRLE8(const uint8* src, const uint8* end, uint8* dest, const PaletteColour* palette);
+	void ReadRow_IndexedRLE4(const uint8* src, const uint8* end, uint8* dest, const PaletteColour* palette);
 
 	// So this is a neat C++11 feature. Allows simplified constructors.
 	int Width = 0;
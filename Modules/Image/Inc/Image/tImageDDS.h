@@ -1,8 +1,9 @@
 // tImageDDS.h
 //
-// This class knows how to load Direct Draw Surface (.dds) files. It knows the details of the dds file format and loads
-// the data into tLayers, optionally decompressing them. Saving is not implemented yet. The layers may be 'stolen' from
-// a tImageDDS so that excessive memcpys are avoided. After they are stolen the tImageDDS is invalid.
+// This class knows how to load and save Direct Draw Surface (.dds) files. It knows the details of the dds file format
+// and loads the data into tLayers, optionally decompressing them. Saving writes tLayer data as-is, without any decode,
+// and may be streamed one layer at a time. The layers may be 'stolen' from a tImageDDS so that excessive memcpys are
+// avoided. After they are stolen the tImageDDS is invalid.
 //
 // Copyright (c) 2006, 2017, 2019, 2020, 2022-2024 Tristan Grimmer.
 // Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
@@ -18,8 +19,10 @@
 #include "Image/tLayer.h"
 #include "Image/tPixelFormat.h"
 #include <Image/tBaseImage.h>
+#include <Image/tToneMap.h>
 namespace tImage
 {
+class tTexture;
 
 
 // A tImageDDS object represents and knows how to load a dds file. In general a DirectDrawSurface is composed of
@@ -41,7 +44,7 @@ public:
 		LoadFlag_GammaCompression	= 1 << 2,
 		LoadFlag_SRGBCompression	= 1 << 3,	// Same as above but uses the official sRGB transformation. Linear -> sRGB. Approx encoding gamma of 1/2.4 for part of curve.
 		LoadFlag_AutoGamma			= 1 << 4,	// Tries to determine whether to apply sRGB compression based on pixel format. Call GetColourSpace to see if it applied.
-		LoadFlag_ToneMapExposure	= 1 << 5,	// Apply exposure value when loading the dds. Only affects HDR (linear-colour) formats.
+		LoadFlag_ToneMapExposure	= 1 << 5,	// Apply exposure and the ToneMap operator when loading the dds. Only affects HDR (linear-colour) formats.
 		LoadFlag_SpreadLuminance	= 1 << 6,	// For DDS files with a single Red or Luminance component, spread it to all the RGB channels (otherwise red only). Does not spread single-channel Alpha formats. Applies only if decoding a dds is an R-only or L-only format.
 		LoadFlag_CondMultFourDim	= 1 << 7,	// Produce conditional success if image dimension not a multiple of 4. Only checks BC formats,
 		LoadFlag_CondPowerTwoDim	= 1 << 8,	// Produce conditional success if image dimension not a power of 2. Only checks BC formats.
@@ -66,17 +69,18 @@ public:
 	// see if row-reversal was performed. The conditional is only set if reversal was requested.
 	//
 	// Additional parameters may be processed during dds-loading. Gamma is only used if GammaCompression flag is set.
-	// Exposure >= 0 (black) and only used if ToneMapExposure flag set.
+	// Exposure >= 0 (black) and ToneMap are only used if ToneMapExposure flag set.
 	struct LoadParams
 	{
 		LoadParams()																									{ Reset(); }
-		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Gamma(src.Gamma), Exposure(src.Exposure) { }
-		void Reset()																									{ Flags = LoadFlags_Default; Gamma = tMath::DefaultGamma; Exposure = 1.0f; }
-		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Gamma = src.Gamma; Exposure = src.Exposure; return *this; }
+		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Gamma(src.Gamma), Exposure(src.Exposure), ToneMap(src.ToneMap) { }
+		void Reset()																									{ Flags = LoadFlags_Default; Gamma = tMath::DefaultGamma; Exposure = 1.0f; ToneMap = tToneMapOperator::Exposure; }
+		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Gamma = src.Gamma; Exposure = src.Exposure; ToneMap = src.ToneMap; return *this; }
 
 		uint32 Flags;
 		float Gamma;
 		float Exposure;
+		tToneMapOperator ToneMap;
 	};
 
 	// Creates an invalid tImageDDS. You must call Load manually.
@@ -148,6 +152,76 @@ public:
 	bool Load(const tString& ddsFile, const LoadParams& = LoadParams());
 	bool Load(const uint8* ddsFileInMemory, int numBytes, const LoadParams& = LoadParams());
 
+	// Saving never decodes. The layer data is written exactly as it is in the tLayers so block-compressed data is
+	// written bit-for-bit. A DX10 extension header is written for every pixel format that has a DXGI equivalent. The
+	// few that do not (R8G8B8, B8G8R8, and L8) are written with a legacy component-mask header. Volume textures are not
+	// supported. Texture arrays require the DX10 header.
+	struct SaveParams
+	{
+		SaveParams()																									{ Reset(); }
+		SaveParams(const SaveParams& src)																				: ReverseRowOrder(src.ReverseRowOrder), ColourProfile(src.ColourProfile) { }
+		void Reset()																									{ ReverseRowOrder = true; ColourProfile = tColourProfile::sRGB; }
+		SaveParams& operator=(const SaveParams& src)																	{ ReverseRowOrder = src.ReverseRowOrder; ColourProfile = src.ColourProfile; return *this; }
+
+		// Tacent layers have their origin at the lower-left while dds files store the top row first. Leave this set for
+		// layers from a tTexture or a tImageDDS loaded with LoadFlag_ReverseRowOrder. The same restrictions as loading
+		// apply: BC6, BC7, and ASTC rows cannot be reversed without a decode, so they are written in the order given.
+		// The member Save only reverses if the rows of this object are in tacent order (RowsReversed returns true).
+		bool ReverseRowOrder;
+
+		// Chooses between the UNORM_SRGB and UNORM DXGI formats where both exist. Any profile other than sRGB writes
+		// the UNORM variant.
+		tColourProfile ColourProfile;
+	};
+
+	// Streams a dds to disk one layer at a time so only the layer currently being written needs to be in memory. Open
+	// writes the headers. Write may then be called once for every image and mipmap level in any order as each layer
+	// is written to its final location in the file. Close returns false if any layer was not written. The number of
+	// images is 6 for a cubemap, a multiple of 6 for a cubemap array, or the array size for a texture array.
+	class Writer
+	{
+	public:
+		Writer()																										{ }
+		~Writer()																										{ Close(); }
+
+		bool Open
+		(
+			const tString& ddsFile, tPixelFormat, int width, int height,
+			int numMipmaps = 1, int numImages = 1, bool cubemap = false, const SaveParams& = SaveParams()
+		);
+		bool Write(int image, int mipmap, const tLayer&);
+		bool Close();
+
+		bool IsOpen() const																								{ return File ? true : false; }
+
+		// Returns true if the rows are being reversed as they are written. May be false even if it was requested.
+		bool RowsReversed() const																						{ return ReverseRows; }
+
+	private:
+		int GetLayerOffset(int image, int mipmap) const;
+		int GetLayerSize(int mipmap) const;
+
+		tFileHandle File						= nullptr;
+		tPixelFormat PixelFormat				= tPixelFormat::Invalid;
+		int Width								= 0;
+		int Height								= 0;
+		int NumMipmaps							= 0;
+		int NumImages							= 0;
+		int DataOffset							= 0;
+		bool ReverseRows						= false;
+		bool* Written							= nullptr;		// NumImages * NumMipmaps entries.
+	};
+
+	// Saves all the images and mipmap layers of this object. Decoded (R8G8B8A8) layers are saved as R8G8B8A8. Layers
+	// that were not reversed on load are already in file order and are written unchanged.
+	bool Save(const tString& ddsFile, const SaveParams& = SaveParams()) const;
+
+	// Saves the layers of a tTexture without decoding them. The second version saves a cubemap from six textures in
+	// tFaceIndex order. All six must be valid and have the same pixel format, dimensions, and number of mipmaps. To
+	// avoid holding all the layers in memory at once, use a Writer with tTexture::Encode.
+	static bool Save(const tString& ddsFile, const tTexture&, const SaveParams& = SaveParams());
+	static bool Save(const tString& ddsFile, const tTexture* const faces[tFaceIndex_NumFaces], const SaveParams& = SaveParams());
+
 	// This one sets from a supplied pixel array. If steal is true it takes ownership of the pixels pointer. Otherwise
 	// it just copies the data out.
 	bool Set(tPixel4b* pixels, int width, int height, bool steal = false) override;
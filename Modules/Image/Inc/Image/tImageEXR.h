@@ -20,6 +20,8 @@
 #include <Image/tPixelFormat.h>
 #include <Image/tFrame.h>
 #include <Image/tBaseImage.h>
+#include <Image/tToneMap.h>
+#include <Image/tPictureT.h>
 namespace tImage
 {
 
@@ -36,6 +38,13 @@ public:
 		float Defog;		// [   0.0, 0.1  ] Try to keep below 0.01.
 		float KneeLow;		// [  -3.0, 3.0  ]
 		float KneeHigh;		// [   3.5, 7.5  ]
+
+		// None (the default) uses the knee and gamma pipeline above. Any other operator is applied to the defogged
+		// linear colours scaled by 2^Exposure, followed by gamma compression with Gamma. The knees are then unused.
+		tToneMapOperator ToneMap;
+
+		// Rows are converted concurrently on up to this many threads. If <= 0 all cores are used.
+		int NumThreads;
 	};
 
 	// Creates an invalid tImageEXR. You must call Load manually.
@@ -75,6 +84,25 @@ public:
 	// Sets from a tPicture.
 	bool Set(tPicture& picture, bool steal = true) override;
 
+	struct SaveParams
+	{
+		SaveParams()																									{ Reset(); }
+		SaveParams(const SaveParams& src)																				: UseZLibCompression(src.UseZLibCompression), NumThreads(src.NumThreads) { }
+		void Reset()																									{ UseZLibCompression = true; NumThreads = 0; }
+		SaveParams& operator=(const SaveParams& src)																	{ UseZLibCompression = src.UseZLibCompression; NumThreads = src.NumThreads; return *this; }
+
+		bool UseZLibCompression;		// Uses ZIP compression if true. No compression otherwise.
+		int NumThreads;					// Threads OpenEXR may use for compression. All cores if <= 0.
+	};
+
+	// Saves a float picture as a single-part half-float RGBA EXR. The values are written linear and unclamped, so this
+	// is the lossless(ish) path for HDR data. The alpha channel is omitted if all alphas are 1.0. Returns success.
+	static bool Save(const tString& exrFile, const tPicture4f&, const SaveParams& = SaveParams());
+
+	// Loads the first part of an EXR as linear float RGBA with no tone mapping, gamma or clamping. Half-float files such
+	// as the ones written above come back exactly. A missing alpha channel reads as 1.0. Returns success.
+	static bool Load(const tString& exrFile, tPicture4f&);
+
 	// After this call no memory will be consumed by the object and it will be invalid.
 	void Clear() override;
 	bool IsValid() const override																						{ return (GetNumFrames() >= 1); }
@@ -110,6 +138,8 @@ inline void tImageEXR::LoadParams::Reset()
 	Defog			= 0.0f;
 	KneeLow			= 0.0f;
 	KneeHigh		= 3.5f;
+	ToneMap			= tToneMapOperator::None;
+	NumThreads		= 0;
 }
 
 
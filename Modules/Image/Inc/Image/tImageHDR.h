@@ -42,6 +42,7 @@
 #include <Math/tColour.h>
 #include <Image/tPixelFormat.h>
 #include <Image/tBaseImage.h>
+#include <Image/tToneMap.h>
 namespace tImage
 {
 
@@ -55,6 +56,17 @@ public:
 		void Reset();
 		float Gamma;
 		int Exposure;
+
+		// If true the pixels are decoded to linear R32G32B32A32f and are available with GetPixels4f. Gamma is ignored
+		// but Exposure still applies. If false (the default) they are gamma-corrected to R8G8B8A8.
+		bool OutputFloat;
+
+		// Only used when not outputting float. None (the default) uses the Radiance gamma tables. Any other operator
+		// is applied to the linear colours after the Exposure adjustment and before gamma compression with Gamma.
+		tToneMapOperator ToneMap;
+
+		// Scanlines are decoded concurrently on up to this many threads. If <= 0 all cores are used.
+		int NumThreads;
 	};
 
 	// Creates an invalid tImageHDR. You must call Load manually.
@@ -73,9 +85,10 @@ public:
 	// Constructs from a tPicture.
 	tImageHDR(tPicture& picture, bool steal = true)																		{ Set(picture, steal); }
 
-	virtual ~tImageHDR()																								{ Clear(); }
+	virtual ~tImageHDR()																								{ Clear(); CleanupGammaTables(); }
 
-	// Clears the current tImageHDR before loading. If false returned object is invalid.
+	// Clears the current tImageHDR before loading. If false returned object is invalid. The file is scanned once to find
+	// where each scanline starts and the scanlines are then decoded in parallel.
 	bool Load(const tString& hdrFile, const LoadParams& = LoadParams());
 	bool Load(uint8* hdrFileInMemory, int numBytes, const LoadParams& = LoadParams());
 
@@ -90,39 +103,45 @@ public:
 
 	// After this call no memory will be consumed by the object and it will be invalid.
 	void Clear() override;
-	bool IsValid() const override																						{ return Pixels ? true : false; }
+	bool IsValid() const override																						{ return (Pixels || Pixels4f) ? true : false; }
 
 	int GetWidth() const																								{ return Width; }
 	int GetHeight() const																								{ return Height; }
 
 	// After this call you are the owner of the pixels and must eventually delete[] them. This tImageHDR object is
-	// invalid afterwards.
+	// invalid afterwards. GetFrame and StealPixels return nullptr if the image was loaded with OutputFloat set.
 	tPixel4b* StealPixels();
 	tFrame* GetFrame(bool steal = true) override;
 	tPixel4b* GetPixels() const																							{ return Pixels; }
 
+	// Only valid if loaded with OutputFloat set. Otherwise these return nullptr.
+	tPixel4f* StealPixels4f();
+	tPixel4f* GetPixels4f() const																						{ return Pixels4f; }
+
 private:
-	bool LegacyReadRadianceColours(tPixel4b* scanline, int length);		// Older hdr files use this scanline format.
-	bool ReadRadianceColours(tPixel4b* scanline, int length);			// Most hdr files use the new scanline format. This will call the old as necessary.
-	bool ConvertRadianceToGammaCorrected(tPixel4b* scan, int len);
+	// The readers advance readP as they consume bytes and never read at or past endP. The scanline may be read from
+	// scanline[-1] by legacy run-length records so it must be preceded by one valid pixel. The skip versions parse
+	// the same data without decoding it so the start of every scanline can be found up-front.
+	static bool LegacyReadRadianceColours(tPixel4b* scanline, int length, const uint8*& readP, const uint8* endP);	// Older hdr files use this scanline format.
+	static bool ReadRadianceColours(tPixel4b* scanline, int length, const uint8*& readP, const uint8* endP);		// Most hdr files use the new scanline format. This will call the old as necessary.
+	static bool LegacySkipRadianceColours(int length, const uint8*& readP, const uint8* endP);
+	static bool SkipRadianceColours(int length, const uint8*& readP, const uint8* endP);
+	void ConvertRadianceToGammaCorrected(tPixel4b* dest, const tPixel4b* scan, int len) const;
 	static void AdjustExposure(tPixel4b* scan, int len, int adjust);
-
-	void PutB(int v)																									{ *WriteP++ = uint8(v); }
-	uint8 GetB()																										{ return *ReadP++; }
-	void UngetB(int v)																									{ *(--ReadP) = v; }
+	static int GetB(const uint8*& readP, const uint8* endP)																{ return (readP < endP) ? *readP++ : EOF; }
 
 	int Width							= 0;
 	int Height							= 0;
 	tPixel4b* Pixels					= nullptr;
+	tPixel4f* Pixels4f					= nullptr;
 
-	// Read and write pointers used during processing.
-	uint8* ReadP						= nullptr;
-	uint8* WriteP						= nullptr;
-
-	// While it would be more efficient to share these tables between instances, we need thread safety.
+	// The tables are per-instance so separate tImageHDRs may load concurrently. They are built before any scanlines are
+	// decoded and are only read after that, so the decode threads of a single load can share them. They are kept
+	// between loads and only rebuilt when the gamma changes.
 	void SetupGammaTables(float gamma);
 	void CleanupGammaTables();
 
+	float TableGamma					= 0.0f;
 	uint8* MantissaTable				= nullptr;
 	uint8* ExponentTable				= nullptr;
 	uint8 (*GammaTable)[256]			= nullptr;
@@ -143,6 +162,9 @@ inline void tImageHDR::LoadParams::Reset()
 {
 	Gamma			= tMath::DefaultGamma;
 	Exposure		= 0;
+	OutputFloat		= false;
+	ToneMap			= tToneMapOperator::None;
+	NumThreads		= 0;
 }
 
 
@@ -152,6 +174,8 @@ inline void tImageHDR::Clear()
 	Height = 0;
 	delete[] Pixels;
 	Pixels = nullptr;
+	delete[] Pixels4f;
+	Pixels4f = nullptr;
 	tBaseImage::Clear();
 }
 
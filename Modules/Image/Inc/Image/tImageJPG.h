@@ -40,10 +40,28 @@ public:
 	struct LoadParams
 	{
 		LoadParams()																									{ Reset(); }
-		LoadParams(const LoadParams& src)																				: Flags(src.Flags) { }
-		void Reset()																									{ Flags = LoadFlags_Default; }
-		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; return *this; }
+		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Progressive(src.Progressive), RegionX(src.RegionX), RegionY(src.RegionY), RegionWidth(src.RegionWidth), RegionHeight(src.RegionHeight) { }
+		void Reset()																									{ Flags = LoadFlags_Default; Progressive = nullptr; RegionX = 0; RegionY = 0; RegionWidth = 0; RegionHeight = 0; }
+		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Progressive = src.Progressive; RegionX = src.RegionX; RegionY = src.RegionY; RegionWidth = src.RegionWidth; RegionHeight = src.RegionHeight; return *this; }
 		uint32 Flags;
+
+		// If set and the jpg has more than one scan (progressive), the file is decoded a scan at a time and this is
+		// called with a preview after every scan but the last. Previews are Exif-oriented if the flag is set. The final
+		// image is identical to a regular load.
+		tProgressiveCallback Progressive;
+
+		// If RegionWidth and RegionHeight are > 0 only this region of the image is decoded and the loaded image is the
+		// size of the region clipped to the image. The origin is the lower-left like tPicture. Only the iMCU columns
+		// covering the region are decoded, rows above it are skipped without colour conversion, and decoding stops
+		// after its last row. For baseline jpgs memory is the region plus one row. Progressive jpgs are different: every
+		// scan refines every block so libjpeg must entropy-decode all scans into a whole-image coefficient buffer before
+		// the first row is output. Memory is then proportional to the full image and only the IDCT and colour conversion
+		// are limited to the region. The region is in the coordinates of the image as stored. Any Exif orientation is
+		// applied to the decoded region afterwards. Loading fails if the region is entirely outside the image. No previews.
+		int RegionX;
+		int RegionY;
+		int RegionWidth;
+		int RegionHeight;
 	};
 
 	// Creates an invalid tImageJPG. You must call Load or Set manually.
@@ -81,18 +99,47 @@ public:
 
 	const static int DefaultQuality = 95;
 
+	// How the chroma (Cb and Cr) channels are downsampled relative to luma. 444 keeps full chroma resolution. 422
+	// halves it horizontally, 440 vertically, and 420 in both directions.
+	enum class Subsampling
+	{
+		S444,
+		S422,
+		S420,
+		S440
+	};
+
 	struct SaveParams
 	{
 		SaveParams()																									{ Reset(); }
-		SaveParams(const SaveParams& src)																				: Quality(src.Quality) { }
-		void Reset()																									{ Quality = DefaultQuality; }
-		SaveParams& operator=(const SaveParams& src)																	{ Quality = src.Quality; return *this; }
+		SaveParams(const SaveParams& src)																				: Quality(src.Quality), Subsampling(src.Subsampling), FastDCT(src.FastDCT), OptimizeHuffman(src.OptimizeHuffman), Progressive(src.Progressive), NumThreads(src.NumThreads) { }
+		void Reset()																									{ Quality = DefaultQuality; Subsampling = Subsampling::S444; FastDCT = false; OptimizeHuffman = false; Progressive = false; NumThreads = 1; }
+		SaveParams& operator=(const SaveParams& src)																	{ Quality = src.Quality; Subsampling = src.Subsampling; FastDCT = src.FastDCT; OptimizeHuffman = src.OptimizeHuffman; Progressive = src.Progressive; NumThreads = src.NumThreads; return *this; }
 		int Quality;
+		tImageJPG::Subsampling Subsampling;
+
+		// The fast integer DCT is quicker but slightly less accurate than the default slow integer DCT. The
+		// difference is mostly visible at high quality settings.
+		bool FastDCT;
+
+		// Computes Huffman tables for the image instead of using the standard ones. Files are a few percent smaller
+		// at the cost of an extra pass over the coefficients.
+		bool OptimizeHuffman;
+
+		// Writes a progressive jpg that decoders can display at increasing quality as it arrives. Progressive files
+		// always use optimized Huffman tables.
+		bool Progressive;
+
+		// If not 1 the image is split into horizontal bands that are compressed concurrently on up to NumThreads
+		// threads (all cores if <= 0) and joined with restart markers into a single baseline jpg. Decoded pixels are
+		// identical to a single-threaded save. Bands need shared Huffman tables, so this only happens when
+		// OptimizeHuffman and Progressive are both false.
+		int NumThreads;
 	};
 
 	// Saves the tImageJPG to the JPeg file specified. The type of filename must be JPG (jpg or jpeg extension).
 	// The quality int is should be a percent in [1,100]. If the tImageJPG was loaded with LoadFlag_NoDecompress,
-	// the quality setting is ignored. Returns true on success.
+	// the save params are ignored. Returns true on success.
 	bool Save(const tString& jpgFile, int quality) const;
 	bool Save(const tString& jpgFile, const SaveParams& = SaveParams()) const;
 
@@ -144,6 +191,19 @@ public:
 
 private:
 	bool PopulateMetaData(const uint8* jpgFileInMemory, int numBytes);
+
+	// Decodes the whole file with turbojpeg.
+	bool Decode(const uint8* jpgFileInMemory, int numBytes, const LoadParams&);
+
+	// Decodes a multi-scan file one scan at a time calling the progressive callback in between. If the file only has
+	// one scan nothing is decoded, multiScan is false, and true is returned.
+	bool DecodeScans(const uint8* jpgFileInMemory, int numBytes, const LoadParams&, bool& multiScan);
+
+	// Decodes the region in the params with libjpeg's cropping and scanline skipping.
+	bool DecodeRegion(const uint8* jpgFileInMemory, int numBytes, const LoadParams&);
+
+	// Applies the flips and rotates for the Exif orientation value. The pixel format is not cleared.
+	void ExifOrient(uint32 orientation);
 	void ClearPixelData();
 
 	int GetIndex(int x, int y) const																					{ tAssert((x >= 0) && (y >= 0) && (x < Width) && (y < Height)); return y * Width + x; }
@@ -1,7 +1,7 @@
 // tImageKTX.h
 //
-// This knows how to load/save KTX and KTX2 files. It knows the details of the ktx and ktx2 file format and loads the
-// data into multiple layers.
+// This knows how to load KTX and KTX2 files and save KTX2 files. It knows the details of the ktx and ktx2 file format
+// and loads the data into multiple layers. Saving writes layer data directly and may be streamed one layer at a time.
 //
 // Copyright (c) 2022-2024 Tristan Grimmer.
 // Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
@@ -19,15 +19,19 @@
 #include <Image/tPixelFormat.h>
 #include <Image/tLayer.h>
 #include <Image/tBaseImage.h>
+#include <Image/tToneMap.h>
 struct ktxTexture;
 namespace tImage
 {
+class tTexture;
 
 
 // A tImageKTX object represents and knows how to load a ktx and ktx2 files. In general a Khronos Texture is composed of
 // multiple layers -- each one a mipmap. It loads the data into tLayers. It can either decode to R8G8B8A8 layers, or leave
 // the data as-is. Decode from BCn is supported. The layers may be 'stolen' from a tImageKTX so that excessive memcpys
-// are avoided. After they are stolen the tImageKTX is invalid. Cubemaps and mipmaps are supported.
+// are avoided. After they are stolen the tImageKTX is invalid. Cubemaps and mipmaps are supported. Zstd and zlib
+// supercompressed ktx2 files are inflated on load. Basis Universal (ETC1S and UASTC) ktx2 payloads are transcoded on
+// load to the format specified in the LoadParams.
 // @todo 1D and 3D textures are not supported yet.
 // @todo ASTC is not supported yet.
 class tImageKTX : public tBaseImage
@@ -45,7 +49,7 @@ public:
 		LoadFlag_GammaCompression	= 1 << 2,
 		LoadFlag_SRGBCompression	= 1 << 3,	// Same as above but uses the official sRGB transformation. Linear -> sRGB. Approx encoding gamma of 1/2.4 for part of curve.
 		LoadFlag_AutoGamma			= 1 << 4,	// Tries to determine whether to apply sRGB compression based on pixel format. Call GetColourProfile to see if it applied.
-		LoadFlag_ToneMapExposure	= 1 << 5,	// Apply exposure value when loading the ktx. Only affects HDR (linear-colour) formats.
+		LoadFlag_ToneMapExposure	= 1 << 5,	// Apply exposure and the ToneMap operator when loading the ktx. Only affects HDR (linear-colour) formats.
 		LoadFlag_SpreadLuminance	= 1 << 6,	// For KTX files with a single Red or Luminance component, spread it to all the RGB channels (otherwise red only). Does not spread single-channel Alpha formats. Applies only if decoding a ktx is an R-only or L-only format.
 		LoadFlag_CondMultFourDim	= 1 << 7,	// Produce conditional success if image dimension not a multiple of 4. Only checks BC formats,
 		LoadFlag_CondPowerTwoDim	= 1 << 8,	// Produce conditional success if image dimension not a power of 2. Only checks BC formats.
@@ -70,16 +74,34 @@ public:
 	//
 	// Additional parameters may be processed during ktx-loading. Gamma is only used if GammaCompression flag is set.
 	// Exposure >= 0 (black) and only used if ToneMapExposure flag set.
+	//
+	// TranscodeFormat is only used for Basis Universal ktx2 files. Supported formats are R8G8B8A8, BC1DXT1,
+	// BC3DXT4DXT5, BC7, ETC1, ETC2RGBA and ASTC4X4. If Unspecified, R8G8B8A8 is used when decoding (it skips the block
+	// decode entirely) and BC7 is used otherwise. NumThreads is the number of threads used to decode the mipmap levels
+	// and faces. All cores are used if <= 0.
 	struct LoadParams
 	{
 		LoadParams()																									{ Reset(); }
-		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Gamma(src.Gamma), Exposure(src.Exposure) { }
-		void Reset()																									{ Flags = LoadFlags_Default; Gamma = tMath::DefaultGamma; Exposure = 1.0f; }
-		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Gamma = src.Gamma; Exposure = src.Exposure; return *this; }
+		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Gamma(src.Gamma), Exposure(src.Exposure), ToneMap(src.ToneMap), TranscodeFormat(src.TranscodeFormat), NumThreads(src.NumThreads) { }
+		void Reset()																									{ Flags = LoadFlags_Default; Gamma = tMath::DefaultGamma; Exposure = 1.0f; ToneMap = tToneMapOperator::Exposure; TranscodeFormat = tPixelFormat::Unspecified; NumThreads = 0; }
+		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Gamma = src.Gamma; Exposure = src.Exposure; ToneMap = src.ToneMap; TranscodeFormat = src.TranscodeFormat; NumThreads = src.NumThreads; return *this; }
 
 		uint32 Flags;
 		float Gamma;
 		float Exposure;
+		tToneMapOperator ToneMap;
+		tPixelFormat TranscodeFormat;
+		int NumThreads;
+	};
+
+	// The supercompression scheme of the source ktx2 file. Always None for ktx1 files.
+	enum class tSupercompression
+	{
+		None,
+		BasisLZ,
+		Zstd,
+		Zlib,
+		Unknown
 	};
 
 	// Creates an invalid tImageKTX. You must call Load manually.
@@ -132,7 +154,9 @@ public:
 		Fatal_PackedDecodeError,
 		Fatal_BCDecodeError,
 		Fatal_ASTCDecodeError,
-		LastFatal								= Fatal_ASTCDecodeError,
+		Fatal_TranscodeFormatNotSupported,
+		Fatal_TranscodeError,
+		LastFatal								= Fatal_TranscodeError,
 
 		// Since we store states as bits in a 32-bit uint, we need to make sure we don't have too many.
 		NumStateBits,
@@ -145,6 +169,75 @@ public:
 	bool Load(const tString& ktxFile, const LoadParams& = LoadParams());
 	bool Load(const uint8* ktxFileInMemory, int numBytes, const LoadParams& = LoadParams());
 
+	// Saving writes KTX2 files without supercompression. The layer data is written exactly as it is in the tLayers, so
+	// nothing is decoded and block-compressed data is written bit-for-bit. libktx is only used to build the data format
+	// descriptor. Volume textures are not supported.
+	struct SaveParams
+	{
+		SaveParams()																									{ Reset(); }
+		SaveParams(const SaveParams& src)																				: ReverseRowOrder(src.ReverseRowOrder), ColourProfile(src.ColourProfile) { }
+		void Reset()																									{ ReverseRowOrder = true; ColourProfile = tColourProfile::sRGB; }
+		SaveParams& operator=(const SaveParams& src)																	{ ReverseRowOrder = src.ReverseRowOrder; ColourProfile = src.ColourProfile; return *this; }
+
+		// Tacent layers have their origin at the lower-left while ktx2 files normally store the top row first. If the
+		// rows cannot be reversed without a decode (BC6, BC7, ETC, ASTC, PVRTC) they are written in the order given and
+		// the KTXorientation metadata is set to "ru" so readers can tell. The member Save only reverses if the rows of
+		// this object are in tacent order (RowsReversed returns true).
+		bool ReverseRowOrder;
+
+		// Chooses between the SRGB and UNORM VkFormats where both exist.
+		tColourProfile ColourProfile;
+	};
+
+	// Streams a ktx2 file to disk one layer at a time so only the layer currently being written needs to be in memory.
+	// Open writes the headers, level index, data format descriptor, and metadata. Write may then be called once for
+	// every image and mipmap level in any order. Close returns false if any layer was not written. The number of
+	// images is 6 for a cubemap, a multiple of 6 for a cubemap array, or the array size for a texture array. Set
+	// bottomUp to false if the layers are already in ktx2 row order. They are then never reversed and are tagged "rd".
+	class Writer
+	{
+	public:
+		Writer()																										{ }
+		~Writer()																										{ Close(); }
+
+		bool Open
+		(
+			const tString& ktx2File, tPixelFormat, int width, int height,
+			int numMipmaps = 1, int numImages = 1, bool cubemap = false, const SaveParams& = SaveParams(),
+			bool bottomUp = true
+		);
+		bool Write(int image, int mipmap, const tLayer&);
+		bool Close();
+
+		bool IsOpen() const																								{ return File ? true : false; }
+		bool RowsReversed() const																						{ return ReverseRows; }
+
+	private:
+		int GetLayerSize(int mipmap) const;
+		int GetLevelOffset(int mipmap) const;
+
+		tFileHandle File						= nullptr;
+		tPixelFormat PixelFormat				= tPixelFormat::Invalid;
+		int Width								= 0;
+		int Height								= 0;
+		int NumMipmaps							= 0;
+		int NumImages							= 0;
+		int DataOffset							= 0;
+		int Alignment							= 4;
+		bool ReverseRows						= false;
+		bool* Written							= nullptr;		// NumImages * NumMipmaps entries.
+	};
+
+	// Saves all the images and mipmap layers of this object. Decoded (R8G8B8A8) layers are saved as R8G8B8A8. Layers
+	// that were not reversed on load are already in file order and are written unchanged.
+	bool Save(const tString& ktx2File, const SaveParams& = SaveParams()) const;
+
+	// Saves the layers of a tTexture without decoding them. The second version saves a cubemap from six textures in
+	// tFaceIndex order. All six must be valid and have the same pixel format, dimensions, and number of mipmaps. To
+	// avoid holding all the layers in memory at once, use a Writer with tTexture::Encode.
+	static bool Save(const tString& ktx2File, const tTexture&, const SaveParams& = SaveParams());
+	static bool Save(const tString& ktx2File, const tTexture* const faces[tFaceIndex_NumFaces], const SaveParams& = SaveParams());
+
 	// This one sets from a supplied pixel array. If steal is true it takes ownership of the pixels pointer. Otherwise
 	// it just copies the data out.
 	bool Set(tPixel4b* pixels, int width, int height, bool steal = false) override;
@@ -172,6 +265,11 @@ public:
 	bool IsTextureArray() const																							{ return IsArray && (NumArrayLayers > 1); }
 	bool IsVolume3D() const																							{ return !IsArray && (NumArrayLayers > 1); }
 	bool RowsReversed() const																							{ return RowReversalOperationPerformed; }
+	tSupercompression GetSupercompression() const																		{ return Supercompression; }
+
+	// Returns true if the source was a Basis Universal payload that was transcoded on load. GetPixelFormatSrc returns
+	// the transcoded format in this case.
+	bool WasTranscoded() const																							{ return Transcoded; }
 
 	// The number of mipmap levels per image is always the same if there is more than one image in the direct texture
 	// (like for cube maps). Same for the dimensions and pixel format.
@@ -248,6 +346,8 @@ private:
 	bool IsCubeMap							= false;
 	bool IsArray							= false;
 	bool RowReversalOperationPerformed		= false;
+	bool Transcoded							= false;
+	tSupercompression Supercompression		= tSupercompression::None;
 
 	// This will be 1 for textures and 6 for cubemaps.
 	int NumImages							= 0;
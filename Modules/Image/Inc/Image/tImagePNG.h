@@ -19,6 +19,7 @@
 #include <Math/tColour.h>
 #include <Image/tPixelFormat.h>
 #include <Image/tBaseImage.h>
+#include <Image/tPictureT.h>
 namespace tImage
 {
 
@@ -49,11 +50,25 @@ public:
 	struct LoadParams
 	{
 		LoadParams()																									{ Reset(); }
-		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Gamma(src.Gamma) { }
-		void Reset()																									{ Flags = LoadFlags_Default; Gamma = tMath::DefaultGamma; }
-		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Gamma = src.Gamma; return *this; }
+		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Gamma(src.Gamma), Progressive(src.Progressive), RegionX(src.RegionX), RegionY(src.RegionY), RegionWidth(src.RegionWidth), RegionHeight(src.RegionHeight) { }
+		void Reset()																									{ Flags = LoadFlags_Default; Gamma = tMath::DefaultGamma; Progressive = nullptr; RegionX = 0; RegionY = 0; RegionWidth = 0; RegionHeight = 0; }
+		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Gamma = src.Gamma; Progressive = src.Progressive; RegionX = src.RegionX; RegionY = src.RegionY; RegionWidth = src.RegionWidth; RegionHeight = src.RegionHeight; return *this; }
 		uint32 Flags;
 		float Gamma;
+
+		// If set and the png is Adam7 interlaced, this is called with an 8-bpc preview after each of the first 6
+		// passes. Each preview fills the pixels not yet decoded from their nearest decoded neighbour up and to the
+		// left. The gamma and sRGB flags are applied to the previews. Non-interlaced files never call it.
+		tProgressiveCallback Progressive;
+
+		// If RegionWidth and RegionHeight are > 0 only this region of the image is decoded and the loaded image is the
+		// size of the region clipped to the image. The origin is the lower-left like tPicture. Rows before the region
+		// must still be inflated but only one row of the full image is kept in memory. Decoding stops after the last
+		// row of the region. Loading fails if the region is entirely outside the image. No previews are made.
+		int RegionX;
+		int RegionY;
+		int RegionWidth;
+		int RegionHeight;
 	};
 
 	// Creates an invalid tImagePNG. You must call Load manually.
@@ -76,6 +91,9 @@ public:
 	// Constructs from a tPicture.
 	tImagePNG(tPicture& picture, bool steal = true)																		{ Set(picture, steal); }
 
+	// Constructs from a 16-bit picture. The pixels are not reduced to 8 bits.
+	tImagePNG(tPicture4s& picture, bool steal = true)																	{ Set(picture, steal); }
+
 	virtual ~tImagePNG()																								{ Clear(); }
 
 	// Clears the current tImagePNG before loading. Returns success. If false returned, object is invalid.
@@ -95,6 +113,9 @@ public:
 	// Sets from a tPicture.
 	bool Set(tPicture& picture, bool steal = true) override;
 
+	// Sets from a 16-bit picture. Saving will write 16-bpc unless an 8-bpc format is explicitly requested.
+	bool Set(tPicture4s& picture, bool steal = true);
+
 	enum class tFormat
 	{
 		Invalid,			// Invalid must be 0.
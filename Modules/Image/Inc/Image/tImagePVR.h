@@ -19,6 +19,7 @@
 #include "Image/tLayer.h"
 #include "Image/tPixelFormat.h"
 #include <Image/tBaseImage.h>
+#include <Image/tToneMap.h>
 namespace tImage
 {
 
@@ -44,7 +45,7 @@ public:
 		LoadFlag_GammaCompression	= 1 << 2,
 		LoadFlag_SRGBCompression	= 1 << 3,	// Same as above but uses the official sRGB transformation. Linear -> sRGB. Approx encoding gamma of 1/2.4 for part of curve.
 		LoadFlag_AutoGamma			= 1 << 4,	// Tries to determine whether to apply sRGB compression based on pixel format. Call GetColourSpace to see if it applied.
-		LoadFlag_ToneMapExposure	= 1 << 5,	// Apply exposure value when loading. Only affects HDR (linear-colour) formats.
+		LoadFlag_ToneMapExposure	= 1 << 5,	// Apply exposure and the ToneMap operator when loading. Only affects HDR (linear-colour) formats.
 		LoadFlag_SpreadLuminance	= 1 << 6,	// For files with a single Red or Luminance component, spread it to all the RGB channels (otherwise red only). Does not spread single-channel Alpha formats. Applies only if decoding an R-only or L-only format.
 		LoadFlag_CondMultFourDim	= 1 << 7,	// Produce conditional success if image dimension not a multiple of 4. Only checks BC formats,
 		LoadFlag_StrictLoading		= 1 << 8,	// If set ill-formed files will not load. Specifically if format is PVRTC (not PVRTC2) the texture must be POT if this flag set.
@@ -73,13 +74,14 @@ public:
 	struct LoadParams
 	{
 		LoadParams()																									{ Reset(); }
-		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Gamma(src.Gamma), Exposure(src.Exposure), MaxRange(src.MaxRange) { }
-		void Reset()																									{ Flags = LoadFlags_Default; Gamma = tMath::DefaultGamma; Exposure = 1.0f; MaxRange = 8.0f; }
-		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Gamma = src.Gamma; Exposure = src.Exposure; MaxRange = src.MaxRange; return *this; }
+		LoadParams(const LoadParams& src)																				: Flags(src.Flags), Gamma(src.Gamma), Exposure(src.Exposure), ToneMap(src.ToneMap), MaxRange(src.MaxRange) { }
+		void Reset()																									{ Flags = LoadFlags_Default; Gamma = tMath::DefaultGamma; Exposure = 1.0f; ToneMap = tToneMapOperator::Exposure; MaxRange = 8.0f; }
+		LoadParams& operator=(const LoadParams& src)																	{ Flags = src.Flags; Gamma = src.Gamma; Exposure = src.Exposure; ToneMap = src.ToneMap; MaxRange = src.MaxRange; return *this; }
 
 		uint32 Flags;
 		float Gamma;
 		float Exposure;
+		tToneMapOperator ToneMap;
 		float MaxRange;		// Used for RGBM and RGBD only.
 	};
 
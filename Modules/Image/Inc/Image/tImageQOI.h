@@ -45,7 +45,9 @@ public:
 
 	virtual ~tImageQOI()																								{ Clear(); }
 
-	// Clears the current tImageQOI before loading. Returns success. If false returned, object is invalid.
+	// Clears the current tImageQOI before loading. Returns success. If false returned, object is invalid. Both plain
+	// QOI files and the striped variant written when SaveParams::NumStripes > 1 may be loaded. Striped files have
+	// their stripes decoded concurrently.
 	bool Load(const tString& qoiFile);
 	bool Load(const uint8* qoiFileInMemory, int numBytes);
 
@@ -71,11 +73,20 @@ public:
 	struct SaveParams
 	{
 		SaveParams()																									{ Reset(); }
-		SaveParams(const SaveParams& src)																				: Format(src.Format), ColourProfile(src.ColourProfile) { }
-		void Reset()																									{ Format = tFormat::Auto; ColourProfile = tColourProfile::Auto; }
-		SaveParams& operator=(const SaveParams& src)																	{ Format = src.Format; ColourProfile = src.ColourProfile; return *this; }
+		SaveParams(const SaveParams& src)																				: Format(src.Format), ColourProfile(src.ColourProfile), NumStripes(src.NumStripes), NumThreads(src.NumThreads) { }
+		void Reset()																									{ Format = tFormat::Auto; ColourProfile = tColourProfile::Auto; NumStripes = 0; NumThreads = 0; }
+		SaveParams& operator=(const SaveParams& src)																	{ Format = src.Format; ColourProfile = src.ColourProfile; NumStripes = src.NumStripes; NumThreads = src.NumThreads; return *this; }
 		tFormat Format;
 		tColourProfile ColourProfile;	// QOI supports lRGB and sRGB.
+
+		// If NumStripes is > 1 the image is split into that many horizontal bands, each encoded as an independent QOI
+		// stream, and the streams are saved together with an index. This allows both encode and decode to run on
+		// multiple cores. Note that only tImageQOI understands striped files. Other QOI readers will reject them. If
+		// <= 1 (the default) a standard QOI file is written. NumStripes is clamped to the image height.
+		int NumStripes;
+
+		// Maximum number of threads used to encode stripes. If <= 0 all cores are used.
+		int NumThreads;
 	};
 
 	// Saves the tImageQOI to the file specified. The type of filename must be "qoi". If tFormat is Auto, this
@@ -86,6 +97,10 @@ public:
 	tFormat Save(const tString& qoiFile, tFormat, tColourProfile = tColourProfile::Auto) const;
 	tFormat Save(const tString& qoiFile, const SaveParams& = SaveParams()) const;
 
+	// Same as above but saves to memory. On success qoiFileInMemory is set to a new buffer you must delete[] and
+	// numBytes is set to its size. On failure they are set to nullptr and 0.
+	tFormat Save(uint8*& qoiFileInMemory, int& numBytes, const SaveParams& = SaveParams()) const;
+
 	// After this call no memory will be consumed by the object and it will be invalid.
 	void Clear() override;
 	bool IsValid() const override																						{ return Pixels ? true : false; }
@@ -103,6 +118,8 @@ public:
 	tPixel4b* GetPixels() const																							{ return Pixels; }
 
 private:
+	bool LoadStriped(const uint8* qoiFileInMemory, int numBytes);
+
 	int Width						= 0;
 	int Height						= 0;
 	tPixel4b* Pixels				= nullptr;
@@ -21,6 +21,7 @@
 #include <Image/tBaseImage.h>
 namespace tImage
 {
+class tBlockWriter;
 class tPicture;
 
 
@@ -118,6 +119,10 @@ public:
 	tFormat Save(const tString& tgaFile, tFormat, tCompression = tCompression::RLE) const;
 	tFormat Save(const tString& tgaFile, const SaveParams& = SaveParams()) const;
 
+	// Same as above but the tga file is written to memory instead of disk. On success tgaFileInMemory is set to a new
+	// buffer of numBytes that you are responsible for delete[]ing. On failure it is set to nullptr.
+	tFormat Save(uint8*& tgaFileInMemory, int& numBytes, const SaveParams& = SaveParams()) const;
+
 	// After this call no memory will be consumed by the object and it will be invalid.
 	void Clear() override;
 	bool IsValid() const override																						{ return Pixels ? true : false; }
@@ -135,8 +140,11 @@ public:
 	tPixel4b* GetPixels() const																							{ return Pixels; }
 
 private:
-	bool SaveUncompressed(const tString& tgaFile, tFormat) const;
-	bool SaveCompressed(const tString& tgaFile, tFormat) const;
+	// Writes the header and pixel data. Rows are encoded into the writer's buffer so the output goes out in large
+	// blocks. Format must be BPP24 or BPP32.
+	bool Save(tBlockWriter&, tFormat, tCompression) const;
+	void SaveUncompressed(tBlockWriter&, tFormat) const;
+	void SaveCompressed(tBlockWriter&, tFormat) const;
 	void ReadColourBytes(tColour4b& dest, const uint8* src, int bitDepth, bool alphaOpacity);
 
 	int Width					= 0;
@@ -20,6 +20,7 @@
 #include <Image/tFrame.h>
 #include <LibTIFF/include/tiffio.h>
 #include <Image/tBaseImage.h>
+#include <Image/tPictureT.h>
 namespace tImage
 {
 
@@ -92,6 +93,15 @@ public:
 	bool Save(const tString& tiffFile, tFormat, bool useZLibComp = true, int overrideFrameDuration = -1) const;
 	bool Save(const tString& tiffFile, const SaveParams& = SaveParams()) const;
 
+	// Saves a 16-bit picture directly as a single-page TIFF with 16 bits per sample. BPP24 and BPP32 select 3 or 4
+	// samples per pixel (so really 48 and 64 bits). Auto picks 4 samples only if some alpha is not 65535. The
+	// OverrideFrameDuration param is ignored. Returns true on success.
+	static bool Save(const tString& tiffFile, const tPicture4s&, const SaveParams& = SaveParams());
+
+	// Loads the first page of a TIFF with 16 bits per sample and 3 or 4 contiguous samples per pixel, such as the ones
+	// written above, without reducing it to 8 bits. A missing alpha is set to 65535. Any other layout returns false.
+	static bool Load(const tString& tiffFile, tPicture4s&);
+
 	// After this call no memory will be consumed by the object and it will be invalid.
 	void Clear() override;
 	bool IsValid() const override																						{ return (GetNumFrames() >= 1); }
@@ -64,9 +64,9 @@ public:
 	struct SaveParams
 	{
 		SaveParams()																									{ Reset(); }
-		SaveParams(const SaveParams& src)																				: Lossy(src.Lossy), QualityCompstr(src.QualityCompstr), OverrideFrameDuration(src.OverrideFrameDuration) { }
-		void Reset()																									{ Lossy = false; QualityCompstr = 90.0f; OverrideFrameDuration = -1; }
-		SaveParams& operator=(const SaveParams& src)																	{ Lossy = src.Lossy; QualityCompstr = src.QualityCompstr; OverrideFrameDuration = src.OverrideFrameDuration; return *this; }
+		SaveParams(const SaveParams& src)																				: Lossy(src.Lossy), QualityCompstr(src.QualityCompstr), OverrideFrameDuration(src.OverrideFrameDuration), Method(src.Method), ThreadLevel(src.ThreadLevel), NumThreads(src.NumThreads) { }
+		void Reset()																									{ Lossy = false; QualityCompstr = 90.0f; OverrideFrameDuration = -1; Method = 4; ThreadLevel = 0; NumThreads = 0; }
+		SaveParams& operator=(const SaveParams& src)																	{ Lossy = src.Lossy; QualityCompstr = src.QualityCompstr; OverrideFrameDuration = src.OverrideFrameDuration; Method = src.Method; ThreadLevel = src.ThreadLevel; NumThreads = src.NumThreads; return *this; }
 
 		bool Lossy;
 
@@ -76,6 +76,16 @@ public:
 
 		// In milliseconds. Set to >= 0 to override all frames.
 		int OverrideFrameDuration;
+
+		// The libwebp quality/speed trade-off E [0, 6]. 0 is fastest. 6 is slowest but finds the smallest encoding.
+		int Method;
+
+		// Passed on to libwebp. If non-zero the encoder may use an extra thread for some stages of each frame.
+		int ThreadLevel;
+
+		// Frames are encoded independently and then assembled, so multi-frame webps may encode several frames at
+		// once. This is the maximum number of threads used for that. If <= 0 all cores are used.
+		int NumThreads;
 	};
 
 	// Saves the tImageWEBP to the WEBP file specified. The type of filename must be WEBP. If lossy is true it will
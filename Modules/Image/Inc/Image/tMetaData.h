@@ -16,6 +16,7 @@
 
 #pragma once
 #include <Foundation/tString.h>
+#include <Foundation/tList.h>
 #include <System/tChunk.h>
 namespace TinyEXIF { class EXIFInfo; }
 
@@ -177,12 +178,22 @@ class tMetaData
 public:
 	tMetaData()																											: NumTagsValid(0), Data() { }
 	tMetaData(const tMetaData& src)																						{ Set(src); }
-	tMetaData(const uint8* rawJpgImageData, int numBytes)																{ Set(rawJpgImageData, numBytes); }
+	tMetaData(const uint8* imageFileInMemory, int numBytes)																{ Set(imageFileInMemory, numBytes); }
+	tMetaData(const tString& imageFile)																					{ Set(imageFile); }
 	virtual ~tMetaData()																								{ }
 
 	void Clear();
 	bool Set(const tMetaData& src);
-	bool Set(const uint8* rawJpgImageData, int numBytes);
+
+	// Parses the EXIF and XMP metadata out of an image file in memory. Supports jpg, png (eXIf and iTXt chunks), webp
+	// (EXIF and XMP chunks), and tiff. The type is determined from the data, not a filename. No pixels are decoded.
+	bool Set(const uint8* imageFileInMemory, int numBytes);
+
+	// Same as above but reads directly from the file. Only the container headers and the metadata payloads are read,
+	// with everything else (like the compressed pixel data) skipped over, so this is much faster than loading the
+	// image first. For tiff files only the first MaxTIFFHeadBytes are read since tiff metadata may be anywhere.
+	bool Set(const tString& imageFile);
+	static constexpr int MaxTIFFHeadBytes																				= 1024*1024;
 	bool IsValid() const																								{ return NumTagsValid > 0; }
 	int GetNumValidTags() const																							{ return NumTagsValid; }
 
@@ -211,6 +222,7 @@ private:
 	int NumTagsValid;
 	tMetaDatum Data[int(tMetaTag::NumTags)];
 
+	bool SetTags(const TinyEXIF::EXIFInfo&);
 	void SetTags_CamHardware(const TinyEXIF::EXIFInfo&);
 	void SetTags_GeoLocation(const TinyEXIF::EXIFInfo&);
 	void SetTags_CamSettings(const TinyEXIF::EXIFInfo&);
@@ -218,6 +230,13 @@ private:
 };
 
 
+// Reads the metadata for many image files concurrently. results must point to an array with at least
+// imageFiles.GetNumItems() entries. It is filled in the same order as the list. Each entry is populated as if
+// tMetaData::Set(imageFile) was called on it. If numThreads is <= 0 all cores are used. Returns the number of files
+// that had valid metadata.
+int tGetMetaData(tMetaData* results, const tList<tStringItem>& imageFiles, int numThreads = 0);
+
+
 }
 
 
@@ -155,6 +155,9 @@ public:
 	void SetPixel(int x, int y, const tColour4b& c, comp_t channels);
 	void SetAll(const tColour4b& = tColour4b(0, 0, 0), comp_t channels = tCompBit_RGBA);
 
+	// The channel operations below work on four pixels at a time with SIMD where available, and large images are
+	// processed on multiple threads. Results are identical to processing one pixel at a time.
+
 	// Spreads the specified single channel to all RGB channels. If channel is R, G, or B, it spreads to the remainder
 	// of RGB (e.g. R will spread to GB). If channel is alpha, spreads to RGB.
 	void Spread(tComp channel = tComp::R);
@@ -186,6 +189,7 @@ public:
 	int GetArea() const																									{ return Width*Height; }
 	int GetNumPixels() const																							{ return GetArea(); }
 
+	// Rotates by 90 degrees into a new buffer a tile at a time. Large images are rotated on multiple threads.
 	void Rotate90(bool antiClockWise);
 
 	// Rotates image about center point. The resultant image size is always big enough to hold every source pixel. Call
@@ -205,6 +209,7 @@ public:
 		tResampleFilter	downFilter	= tResampleFilter::None
 	);
 
+	// Flips in place without allocating. Large images are flipped on multiple threads.
 	void Flip(bool horizontal);
 
 	enum class Anchor
@@ -231,6 +236,14 @@ public:
 	// Same as above but only check if borders exist. Does not modify picture.
 	bool HasBorders(const tColour4b& = tColour4b::transparent, comp_t channels = tCompBit_A) const;
 
+	// Same test as above but returns the number of matching rows and columns on each side. Returns false if either no
+	// borders or the borders overlap because the image in homogenous in the channels.
+	bool GetBordersSizes
+	(
+		const tColour4b&, comp_t channels,
+		int& numBottomRows, int& numTopRows, int& numLeftCols, int& numRightCols
+	) const;
+
 	// Quantize image colours based on a fixed palette. numColours must be 256 or less. checkExact means no change to
 	// the image will be made if it already contains fewer colours than numColours already. This may or may not be
 	// desireable as the computed or fixed palette would not be used.
@@ -361,13 +374,6 @@ private:
 		tResampleFilter upFilter, tResampleFilter downFilter
 	);
 
-	// Returns false if either no borders or the borders overlap because the image in homogenous in the channels.
-	bool GetBordersSizes
-	(
-		const tColour4b&, comp_t channels,
-		int& numBottomRows, int& numTopRows, int& numLeftCols, int& numRightCols
-	) const;
-
 	int Width				= 0;
 	int Height				= 0;
 	tPixel4b* Pixels			= nullptr;
@@ -500,148 +506,6 @@ inline void tPicture::SetPixel(int x, int y, const tColour4b& c, comp_t channels
 }
 
 
-inline void tPicture::SetAll(const tColour4b& clearColour, comp_t channels)
-{
-	if (!Pixels)
-		return;
-
-	int numPixels = Width*Height;
-	if (channels == tCompBit_RGBA)
-	{
-		for (int p = 0; p < numPixels; p++)
-			Pixels[p] = clearColour;
-	}
-	else
-	{
-		for (int p = 0; p < numPixels; p++)
-		{
-			if (channels & tCompBit_R) Pixels[p].R = clearColour.R;
-			if (channels & tCompBit_G) Pixels[p].G = clearColour.G;
-			if (channels & tCompBit_B) Pixels[p].B = clearColour.B;
-			if (channels & tCompBit_A) Pixels[p].A = clearColour.A;
-		}
-	}
-}
-
-
-inline void tPicture::Spread(tComp channel)
-{
-	int numPixels = Width*Height;
-	for (int p = 0; p < numPixels; p++)
-	{
-		tPixel4b& pixel = Pixels[p];
-		switch (channel)
-		{
-			case tComp::R:	pixel.G = pixel.B = pixel.R;			break;
-			case tComp::G:	pixel.R = pixel.B = pixel.G;			break;
-			case tComp::B:	pixel.R = pixel.G = pixel.B;			break;
-			case tComp::A:	pixel.R = pixel.G = pixel.B = pixel.A;	break;
-		}
-	}
-}
-
-
-inline void tPicture::Swizzle(tComp R, tComp G, tComp B, tComp A)
-{
-	if (!Pixels)
-		return;
-
-	if (R == tComp::Auto) R = tComp::R;
-	if (G == tComp::Auto) G = tComp::G;
-	if (B == tComp::Auto) B = tComp::B;
-	if (A == tComp::Auto) A = tComp::A;
-
-	if ((R == tComp::R) && (G == tComp::G) && (B == tComp::B) && (A == tComp::A))
-		return;
-
-	tPixel4b* newPixels = new tPixel4b[Width*Height];
-	for (int p = 0; p < Width*Height; p++)
-	{
-		tColour4b& src = Pixels[p];
-		tColour4b& dst = newPixels[p];
-		uint8 r =
-			(R==tComp::Zero ? 0   :
-			(R==tComp::Full ? 255 :
-			(R==tComp::R ? src.R  :
-			(R==tComp::G ? src.G  :
-			(R==tComp::B ? src.B  :
-			(R==tComp::A ? src.A  : 0
-			))))));
-		uint8 g =
-			(G==tComp::Zero ? 0  :
-			(G==tComp::Full ? 255 :
-			(G==tComp::R ? src.R  :
-			(G==tComp::G ? src.G  :
-			(G==tComp::B ? src.B  :
-			(G==tComp::A ? src.A  : 0
-			))))));
-		uint8 b =
-			(B==tComp::Zero ? 0   :
-			(B==tComp::Full ? 255 :
-			(B==tComp::R ? src.R  :
-			(B==tComp::G ? src.G  :
-			(B==tComp::B ? src.B  :
-			(B==tComp::A ? src.A  : 0
-			))))));
-		uint8 a =
-			(A==tComp::Zero ? 0   :
-			(A==tComp::Full ? 255 :
-			(A==tComp::R ? src.R  :
-			(A==tComp::G ? src.G  :
-			(A==tComp::B ? src.B  :
-			(A==tComp::A ? src.A  : 255
-			))))));
-		dst.Set(r, g, b, a);
-	}
-	delete[] Pixels;
-	Pixels = newPixels;
-}
-
-
-inline void tPicture::Intensity(comp_t channels)
-{
-	if (!channels)
-		return;
-
-	int numPixels = Width*Height;
-	for (int p = 0; p < numPixels; p++)
-	{
-		tPixel4b& pixel = Pixels[p];
-		int intensity = pixel.Intensity();
-		if (channels & tCompBit_R) pixel.R = intensity;
-		if (channels & tCompBit_G) pixel.G = intensity;
-		if (channels & tCompBit_B) pixel.B = intensity;
-		if (channels & tCompBit_A) pixel.A = intensity;
-	}
-}
-
-
-inline void tPicture::AlphaBlendColour(const tColour4b& blend, comp_t channels, int finalAlpha)
-{
-	if (!Pixels)
-		return;
-
-	tMath::tiClamp(finalAlpha, -1, 255);
-	int numPixels = Width*Height;
-	for (int p = 0; p < numPixels; p++)
-	{
-		tColour4f pixelCol(Pixels[p]);
-		tColour4f blendCol(blend);
-		tColour4f pixel = pixelCol;
-		float alpha = pixelCol.A;
-		float oneMinusAlpha = 1.0f - alpha;
-
-		if (channels & tCompBit_R) pixel.R = pixelCol.R*alpha + blendCol.R*oneMinusAlpha;
-		if (channels & tCompBit_G) pixel.G = pixelCol.G*alpha + blendCol.G*oneMinusAlpha;
-		if (channels & tCompBit_B) pixel.B = pixelCol.B*alpha + blendCol.B*oneMinusAlpha;
-		if (finalAlpha >= 0)
-			pixel.SetA(finalAlpha);
-
-		Pixels[p].Set(pixel);
-	}
-}
-
-
 inline bool tPicture::operator==(const tPicture& src) const
 {
 	if (!Pixels || !src.Pixels)
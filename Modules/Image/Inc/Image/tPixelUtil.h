@@ -14,6 +14,7 @@
 
 #pragma once
 #include <Foundation/tPlatform.h>
+#include <Foundation/tStandard.h>
 #include <Math/tColour.h>
 #include <Image/tPixelFormat.h>
 namespace tImage
@@ -51,7 +52,11 @@ DecodeResult DecodePixelData
 DecodeResult DecodePixelData_Packed	(tPixelFormat, const uint8* data, int dataSize, int w, int h, tColour4b*&, tColour4f*&, float RGBM_RGBD_MaxRange = 8.0f);
 DecodeResult DecodePixelData_Block	(tPixelFormat, const uint8* data, int dataSize, int w, int h, tColour4b*&, tColour4f*&);
 DecodeResult DecodePixelData_ASTC	(tPixelFormat, const uint8* data, int dataSize, int w, int h, tColour4f*&, tColourProfile = tColourProfile::Auto);
-DecodeResult DecodePixelData_PVR	(tPixelFormat, const uint8* data, int dataSize, int w, int h, tColour4b*&, tColour4f*&);
+DecodeResult DecodePixelData_PVR	(tPixelFormat, const uint8* data, int dataSize, int w, int h, tColour4b*&, tColour4f*&, int numThreads = 0);
+
+// PVRTC decodes are split into bands of at least this many word rows (4 pixel rows each) per thread. numThreads above
+// is a maximum. If <= 0 all cores may be used.
+const int PVRMinWordRowsPerThread = 16;
 
 
 constexpr uint32 FourCC(uint8 ch0, uint8 ch1, uint8 ch2, uint8 ch3);
@@ -83,6 +88,81 @@ bool CanReverseRowData(tPixelFormat, int height);
 uint8* CreateReversedRowData(const uint8* pixelData, tPixelFormat pixelDataFormat, int numBlocksW, int numBlocksH);
 
 
+// Channel-order conversion of tightly packed pixel runs. These are used by the uncompressed loaders (BMP, TGA, etc)
+// to decode whole rows at a time. SSE2 (and SSSE3 for the 3-byte variants) is used when the build supports it. The
+// dst and src buffers must not overlap. When converting from 3-byte pixels the alpha is set to 255.
+void ConvertBGRAToRGBA(uint8* dstRGBA, const uint8* srcBGRA, int numPixels);
+void ConvertBGRToRGBA(uint8* dstRGBA, const uint8* srcBGR, int numPixels);
+
+// These go the other way, for the savers. Swapping R and B is its own inverse so the 4-byte version is the same
+// operation as ConvertBGRAToRGBA. The 3-byte version drops the alpha.
+inline void ConvertRGBAToBGRA(uint8* dstBGRA, const uint8* srcRGBA, int numPixels)										{ ConvertBGRAToRGBA(dstBGRA, srcRGBA, numPixels); }
+void ConvertRGBAToBGR(uint8* dstBGR, const uint8* srcRGBA, int numPixels);
+
+
+// Expands Radiance RGBE pixels to linear floats. The src R, G, and B hold the mantissas and A holds the shared
+// exponent (excess 128). Uses the same (mantissa + 0.5) * 2^(exponent - 136) reconstruction as Radiance and the result
+// is exact, including the denormals produced by exponents below 10. An exponent of 0 gives black. The dst alpha is 1.
+void ConvertRGBEToFloat(tColour4f* dst, const tColour4b* src, int numPixels);
+
+
+// Clips the region at x, y of size w by h to a width by height image. The origin is the lower-left like tPicture.
+// Returns false if none of the region is inside the image.
+bool ClipRegion(int& x, int& y, int& w, int& h, int width, int height);
+
+
+// Palette index packing. Packed indices are stored most-significant-bit first within each byte with no padding
+// between indices, which is the order used by tPaletteImage, BMP, and PNG. A row that starts on a byte boundary can be
+// handled by a single call. bitsPerIndex must be in [1, 8]. PackIndices only uses the low bitsPerIndex bits of each
+// src index and writes (numIndices*bitsPerIndex + 7)/8 bytes with any unused bits of the last byte set to 0.
+void PackIndices(uint8* dstPacked, const uint8* srcIndices, int numIndices, int bitsPerIndex);
+void UnpackIndices(uint8* dstIndices, const uint8* srcPacked, int numIndices, int bitsPerIndex);
+
+// Looks up packed indices directly in a palette. The palette must have 2^bitsPerIndex entries. The RGBA version uses
+// SSSE3 shuffles as 16-entry lookup tables for 4 bit and smaller indices. Larger indices go through a table lookup.
+void ExpandIndices(tPixel4b* dst, const uint8* srcPacked, int numIndices, int bitsPerIndex, const tPixel4b* palette);
+void ExpandIndices(tPixel3b* dst, const uint8* srcPacked, int numIndices, int bitsPerIndex, const tPixel3b* palette);
+
+// Encodes a 4x4 block of linear RGB into a 16 byte unsigned BC6H block. The src is 16 colours in row order and alpha is
+// ignored. Negative and NaN components are encoded as 0. Only the single-region mode with 10-bit endpoints is used.
+// Effort 0 takes the endpoints from the bounding box of the block, 1 from its principal axis, and 2 also refines them
+// with a least-squares fit to the selected indices.
+void EncodeBlock_BC6U(uint8* dst, const tColour4f* src, int effort);
+
+
+// Used by the savers that generate their output a row (or block) at a time. When constructed with a file handle the
+// data is accumulated in an internal block-sized buffer and written to the file in large chunks. When constructed
+// without one, everything is accumulated in memory and may be taken with StealBuffer when done. Callers may either
+// Write data they already have, or Reserve space, encode directly into it, and Commit the bytes actually used.
+class tBlockWriter
+{
+public:
+	tBlockWriter(tFileHandle file, int blockSize = 256*1024);
+	tBlockWriter(int initialCapacity);
+	~tBlockWriter()																										{ Flush(); delete[] Buffer; }
+
+	// Returns a pointer to at least numBytes of contiguous space. You must call Commit before the next Reserve or Write.
+	uint8* Reserve(int numBytes);
+	void Commit(int numBytes)																							{ tAssert(Used + numBytes <= Capacity); Used += numBytes; }
+	void Write(const void* src, int numBytes)																			{ uint8* dst = Reserve(numBytes); tStd::tMemcpy(dst, src, numBytes); Commit(numBytes); }
+	void Write(uint8 byte)																								{ Write(&byte, 1); }
+
+	// In file mode this writes out anything pending. Returns false if any write so far has failed.
+	bool Flush();
+	bool HasError() const																								{ return Error; }
+
+	// Memory mode only. The returned buffer is yours to delete[]. Returns nullptr if in file mode or empty.
+	uint8* StealBuffer(int& numBytes);
+
+private:
+	tFileHandle File			= nullptr;
+	uint8* Buffer				= nullptr;
+	int Capacity				= 0;
+	int Used					= 0;
+	bool Error					= false;
+};
+
+
 }
 
 
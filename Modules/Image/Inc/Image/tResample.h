@@ -85,4 +85,23 @@ bool Resample
 );
 
 
+// Same as above for 16-bit and float pixels. There is no intermediate conversion to 8-bit. The 16-bit version clamps
+// to [0, 65535]. The float version does not clamp, so HDR values are preserved (the bicubic and Lanczos filters may
+// produce small negative values from ringing).
+bool Resample
+(
+	tPixel4s* src, int srcW, int srcH,
+	tPixel4s* dst, int dstW, int dstH,
+	tResampleFilter = tResampleFilter::Bilinear,
+	tResampleEdgeMode = tResampleEdgeMode::Clamp
+);
+bool Resample
+(
+	tPixel4f* src, int srcW, int srcH,
+	tPixel4f* dst, int dstW, int dstH,
+	tResampleFilter = tResampleFilter::Bilinear,
+	tResampleEdgeMode = tResampleEdgeMode::Clamp
+);
+
+
 }
@@ -23,16 +23,22 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #pragma once
+#include <functional>
 #include <Foundation/tList.h>
 #include <Foundation/tString.h>
 #include <System/tChunk.h>
 #include "Image/tImageDDS.h"
+#include "Image/tImageASTC.h"
 #include "Image/tPicture.h"
 #include "Image/tResample.h"
 namespace tImage
 {
 
 
+// Receives each mipmap layer as tTexture::Encode produces it, starting with the largest. Return false to stop encoding.
+typedef std::function<bool(const tLayer&, int mipmap, int numMipmaps)> tLayerCallback;
+
+
 // @todo This class needs some work. It's too strongly linked to tImageDDS. It should probably just take in layers and
 // also be able to convert frames to layers and support various types of conversion/compression.
 class tTexture : public tLink<tTexture>
@@ -62,9 +68,9 @@ public:
 	// For simplicity there is only Fast and Production quality settings, and it affects resampling _and_ compression.
 	enum class tQuality
 	{
-		Fast,			// Bilinear resample filter. Fast BCn compress mode.
-		Development,	// Bicubic resample filter. High quality BCn compression.
-		Production		// Lanczos sinc-based resample filter. High quality BCn compression.
+		Fast,			// Bilinear resample filter. Fast BCn compress mode (no BC7 partitions). Fast ASTC preset.
+		Development,	// Bicubic resample filter. High quality BCn compression. Medium ASTC preset.
+		Production		// Lanczos sinc-based resample filter. Highest quality BCn compression. Thorough ASTC preset.
 	};
 
 	// Same as above except that an in-memory tPicture is used instead of a filename. The supplied tPicture will be
@@ -92,6 +98,16 @@ public:
 		tQuality = tQuality::Production, int forceWidth = 0, int forceHeight = 0
 	);
 
+	// Encodes exactly like the tPicture Set above except that each mipmap layer is handed to the callback as soon as it
+	// is encoded rather than being kept. Each layer is deleted after the callback returns so only one is held at a
+	// time. Use with tImageDDS::Writer or tImageKTX::Writer to stream a texture to disk. The tTexture is invalid
+	// afterwards. Returns false if the callback returned false.
+	bool Encode
+	(
+		tPicture& imageObject, const tLayerCallback&, bool generateMipMaps, tPixelFormat = tPixelFormat::Auto,
+		tQuality = tQuality::Production, int forceWidth = 0, int forceHeight = 0
+	);
+
 	void Clear()																										{ Layers.Clear(); Opaque = true; }
 
 	int GetWidth() const				/* Returns width of the main layer. */											{ return IsValid() ? Layers.First()->Width : 0; }
@@ -125,13 +141,28 @@ private:
 	tPixelFormat DeterminePixelFormat(const tPicture&);
 	tResampleFilter DetermineFilter(tQuality);
 	int DetermineBlockEncodeQualityLevel(tQuality);
+	int DetermineBC6HEncodeEffort(tQuality);
+	float DetermineASTCEncodeQuality(tQuality);
+
+	bool ProcessImage(tPicture&, bool generateMipmaps, tPixelFormat, tQuality, int forceWidth, int forceHeight);
+
+	// Appends the layer, or passes it to the LayerCallback and deletes it if there is one. Returns false if the
+	// callback wants encoding to stop.
+	bool AddLayer(tLayer*);
 
 	void ProcessImageTo_R8G8B8_Or_R8G8B8A8(tPicture&, tPixelFormat, bool generateMipmaps, tQuality);
 	void ProcessImageTo_G3B5R5G3(tPicture&, bool generateMipmaps, tQuality);
 	void ProcessImageTo_BCTC(tPicture&, tPixelFormat, bool generateMipmaps, tQuality);
+	void ProcessImageTo_ASTC(tPicture&, tPixelFormat, bool generateMipmaps, tQuality);
 
 	bool Opaque = true;										// Only true if the texture is completely opaque.
 
+	// Only set during Encode.
+	const tLayerCallback* LayerCallback	= nullptr;
+	int NumCallbackLayers					= 0;
+	int NumCallbackMipmaps					= 0;
+	bool CallbackStopped					= false;
+
 	// The tTexture is only valid if there is at least one layer. The texture is considered to have mipmaps if the
 	// number of layers is > 1.
 	tList<tLayer> Layers;
@@ -186,6 +217,30 @@ inline int tTexture::DetermineBlockEncodeQualityLevel(tQuality quality)
 }
 
 
+inline int tTexture::DetermineBC6HEncodeEffort(tQuality quality)
+{
+	switch (quality)
+	{
+		case tQuality::Fast:		return 0;
+		case tQuality::Development:	return 1;
+		case tQuality::Production:	return 2;
+	}
+	return 1;
+}
+
+
+inline float tTexture::DetermineASTCEncodeQuality(tQuality quality)
+{
+	switch (quality)
+	{
+		case tQuality::Fast:		return tASTCEncoder::Quality_Fast;
+		case tQuality::Development:	return tASTCEncoder::Quality_Medium;
+		case tQuality::Production:	return tASTCEncoder::Quality_Thorough;
+	}
+	return tASTCEncoder::Quality_Medium;
+}
+
+
 inline void tTexture::RemoveMipmaps()
 {
 	if (!IsMipmapped())
@@ -0,0 +1,69 @@
+// tToneMap.h
+//
+// Tone-mapping and transfer-function encoding of linear float colours. This is shared by the image loaders that
+// decode HDR data so that exposure, tone-mapping, and sRGB or gamma compression behave identically across formats.
+// The conversions work on whole pixel arrays, use SSE2 on x86/x64, and split large arrays across threads.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Math/tColour.h>
+namespace tImage
+{
+
+
+enum class tToneMapOperator
+{
+	None,				// No tone-mapping. Values above 1.0 clip when quantized.
+	Exposure,			// 1 - exp(-x * Exposure). This is what the LoadFlag_ToneMapExposure loader flags have always done.
+	Reinhard,			// x / (x + 1) after scaling by Exposure.
+	ACESFilmic,			// Narkowicz's fit of the ACES filmic curve after scaling by Exposure.
+	NumOperators
+};
+const char* tGetToneMapOperatorName(tToneMapOperator);
+
+
+struct tToneMapParams
+{
+	tToneMapParams()																									{ Reset(); }
+	tToneMapParams(const tToneMapParams& src)																			: Operator(src.Operator), Exposure(src.Exposure), SRGBCompression(src.SRGBCompression), GammaCompression(src.GammaCompression), Gamma(src.Gamma), NumThreads(src.NumThreads) { }
+	void Reset()																										{ Operator = tToneMapOperator::None; Exposure = 1.0f; SRGBCompression = false; GammaCompression = false; Gamma = tMath::DefaultGamma; NumThreads = 0; }
+	tToneMapParams& operator=(const tToneMapParams& src)																{ Operator = src.Operator; Exposure = src.Exposure; SRGBCompression = src.SRGBCompression; GammaCompression = src.GammaCompression; Gamma = src.Gamma; NumThreads = src.NumThreads; return *this; }
+
+	// Returns true if the float conversions would leave RGB unchanged.
+	bool IsIdentity() const																								{ return (Operator == tToneMapOperator::None) && !SRGBCompression && !GammaCompression; }
+
+	tToneMapOperator Operator;
+	float Exposure;				// A linear multiplier. Not used if Operator is None.
+
+	// Applied after the operator, in this order, to the RGB channels only. Alpha is never modified.
+	bool SRGBCompression;		// Linear -> sRGB using the official transfer function. Output is saturated.
+	bool GammaCompression;		// Linear -> gamma using pow(x, 1/Gamma).
+	float Gamma;
+
+	// Large arrays are split into chunks and processed in parallel. All cores if <= 0.
+	int NumThreads;
+};
+
+
+// Tone-maps and compresses the RGB of the float pixels in place.
+void ToneMap(tColour4f* pixels, int numPixels, const tToneMapParams&);
+
+// Same as above but writes 8-bit pixels. The quantization is the same as tColour4b::Set(const tColour4f&), so the
+// result matches tone-mapping in float and converting afterwards, but it is done in a single pass.
+void ToneMap(tColour4b* dst, const tColour4f* src, int numPixels, const tToneMapParams&);
+
+// Applies only the sRGB and gamma compression of the params to 8-bit pixels in place. The operator and exposure are
+// ignored since LDR data is not tone-mapped. Uses a lookup table so it is exact and fast.
+void EncodeLDR(tColour4b* pixels, int numPixels, const tToneMapParams&);
+
+
+}
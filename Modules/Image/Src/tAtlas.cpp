@@ -0,0 +1,641 @@
+// tAtlas.cpp
+//
+// Texture atlas (sprite-sheet) packing. The MaxRects packer follows Jukka Jylanki's "A Thousand Ways to Pack the Bin"
+// using the best short-side fit heuristic. The Skyline packer uses the bottom-left heuristic from the same paper.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <Foundation/tArray.h>
+#include <Foundation/tSort.h>
+#include <System/tThread.h>
+#include "Image/tAtlas.h"
+namespace tImage {
+
+
+namespace tAtlasPack
+{
+	struct Rect
+	{
+		bool Contains(const Rect& r) const																				{ return (r.X >= X) && (r.Y >= Y) && (r.X+r.W <= X+W) && (r.Y+r.H <= Y+H); }
+		int X, Y, W, H;
+	};
+
+	// An item to pack. W and H include extrusion and padding.
+	struct Item
+	{
+		int Index;
+		int W, H;
+	};
+
+	// Larger sprites first, by longest side then area. This ordering matters a lot for both packers.
+	bool ItemLarger(const Item& a, const Item& b);
+
+	class Bin
+	{
+	public:
+		Bin(int width, int height)																						: Width(width), Height(height) { }
+		virtual ~Bin()																									{ }
+
+		// Returns false if the item does not fit anywhere in the bin. On success placed is set and rotated indicates
+		// whether the item was rotated (placed.W == h in this case).
+		bool Insert(int w, int h, bool allowRotation, Rect& placed, bool& rotated);
+
+	protected:
+		virtual bool Place(int w, int h, bool allowRotation, Rect& placed, bool& rotated)								= 0;
+		int Width, Height;
+
+	private:
+		// The sorted sides of the smallest item known not to fit. Any item at least as big on both sorted sides will not
+		// fit either, which lets full pages be skipped without scanning them.
+		int FailMin																	= 0x7FFFFFFF;
+		int FailMax																	= 0x7FFFFFFF;
+	};
+
+	class MaxRectsBin : public Bin
+	{
+	public:
+		MaxRectsBin(int width, int height);
+
+	protected:
+		bool Place(int w, int h, bool allowRotation, Rect& placed, bool& rotated) override;
+
+	private:
+		void SplitFreeRects(const Rect& used);
+		bool SplitFreeRect(const Rect& freeRect, const Rect& used);
+		void PruneNewRects();
+
+		tArray<Rect> FreeRects;
+		tArray<Rect> NewRects;
+		int MaxFreeW;
+		int MaxFreeH;
+	};
+
+	class SkylineBin : public Bin
+	{
+	public:
+		SkylineBin(int width, int height);
+		~SkylineBin()																									{ delete[] Nodes; }
+
+	protected:
+		bool Place(int w, int h, bool allowRotation, Rect& placed, bool& rotated) override;
+
+	private:
+		// Returns the y the item would rest at if its left edge is at node index. Returns -1 if it doesn't fit.
+		int Fit(int index, int w, int h) const;
+		void AddLevel(int index, const Rect&);
+
+		struct Node { int X, Y, W; };
+		Node* Nodes;
+		int NumNodes;
+	};
+}
+
+
+bool tAtlasPack::ItemLarger(const Item& a, const Item& b)
+{
+	int maxA = tMath::tMax(a.W, a.H);
+	int maxB = tMath::tMax(b.W, b.H);
+	if (maxA != maxB)
+		return maxA > maxB;
+
+	int areaA = a.W*a.H;
+	int areaB = b.W*b.H;
+	if (areaA != areaB)
+		return areaA > areaB;
+
+	return a.Index < b.Index;
+}
+
+
+bool tAtlasPack::Bin::Insert(int w, int h, bool allowRotation, Rect& placed, bool& rotated)
+{
+	int minSide = tMath::tMin(w, h);
+	int maxSide = tMath::tMax(w, h);
+
+	// The sorted-side test is only valid when rotation is allowed. Without rotation compare the sides directly.
+	if (allowRotation ? ((minSide >= FailMin) && (maxSide >= FailMax)) : ((w >= FailMin) && (h >= FailMax)))
+		return false;
+
+	if (Place(w, h, allowRotation, placed, rotated))
+		return true;
+
+	int failA = allowRotation ? minSide : w;
+	int failB = allowRotation ? maxSide : h;
+	if ((failA <= FailMin) && (failB <= FailMax))
+	{
+		FailMin = failA;
+		FailMax = failB;
+	}
+	return false;
+}
+
+
+tAtlasPack::MaxRectsBin::MaxRectsBin(int width, int height) :
+	Bin(width, height),
+	FreeRects(0, 256),
+	NewRects(0, 64),
+	MaxFreeW(width),
+	MaxFreeH(height)
+{
+	FreeRects.Append(Rect{0, 0, width, height});
+}
+
+
+bool tAtlasPack::MaxRectsBin::Place(int w, int h, bool allowRotation, Rect& placed, bool& rotated)
+{
+	bool fitsUnrotated = (w <= MaxFreeW) && (h <= MaxFreeH);
+	bool fitsRotated = allowRotation && (h <= MaxFreeW) && (w <= MaxFreeH);
+	if (!fitsUnrotated && !fitsRotated)
+		return false;
+
+	// Best short-side fit. Ties are broken by the long side.
+	int bestShort = 0x7FFFFFFF;
+	int bestLong = 0x7FFFFFFF;
+	int bestIndex = -1;
+	bool bestRotated = false;
+	int numFree = FreeRects.GetNumElements();
+	for (int f = 0; f < numFree; f++)
+	{
+		const Rect& fr = FreeRects[f];
+		if ((fr.W >= w) && (fr.H >= h))
+		{
+			int leftoverW = fr.W - w;
+			int leftoverH = fr.H - h;
+			int shortSide = tMath::tMin(leftoverW, leftoverH);
+			int longSide = tMath::tMax(leftoverW, leftoverH);
+			if ((shortSide < bestShort) || ((shortSide == bestShort) && (longSide < bestLong)))
+			{
+				bestShort = shortSide; bestLong = longSide; bestIndex = f; bestRotated = false;
+			}
+		}
+
+		if (allowRotation && (fr.W >= h) && (fr.H >= w))
+		{
+			int leftoverW = fr.W - h;
+			int leftoverH = fr.H - w;
+			int shortSide = tMath::tMin(leftoverW, leftoverH);
+			int longSide = tMath::tMax(leftoverW, leftoverH);
+			if ((shortSide < bestShort) || ((shortSide == bestShort) && (longSide < bestLong)))
+			{
+				bestShort = shortSide; bestLong = longSide; bestIndex = f; bestRotated = true;
+			}
+		}
+	}
+
+	if (bestIndex == -1)
+		return false;
+
+	const Rect& fr = FreeRects[bestIndex];
+	placed = bestRotated ? Rect{fr.X, fr.Y, h, w} : Rect{fr.X, fr.Y, w, h};
+	rotated = bestRotated;
+	SplitFreeRects(placed);
+	return true;
+}
+
+
+void tAtlasPack::MaxRectsBin::SplitFreeRects(const Rect& used)
+{
+	// Every free rect that intersects the used rect is replaced by up to four maximal rects around it. Removal swaps
+	// with the last element so the order of the free list is not preserved. The packer does not depend on it.
+	int numFree = FreeRects.GetNumElements();
+	for (int f = 0; f < numFree;)
+	{
+		if (SplitFreeRect(FreeRects[f], used))
+		{
+			FreeRects[f] = FreeRects[numFree-1];
+			FreeRects.Truncate();
+			numFree--;
+		}
+		else
+		{
+			f++;
+		}
+	}
+
+	PruneNewRects();
+	int numNew = NewRects.GetNumElements();
+	if (numNew > 0)
+		FreeRects.Append(NewRects.GetElements(), numNew);
+	while (NewRects.GetNumElements())
+		NewRects.Truncate();
+
+	MaxFreeW = 0;
+	MaxFreeH = 0;
+	numFree = FreeRects.GetNumElements();
+	for (int f = 0; f < numFree; f++)
+	{
+		MaxFreeW = tMath::tMax(MaxFreeW, FreeRects[f].W);
+		MaxFreeH = tMath::tMax(MaxFreeH, FreeRects[f].H);
+	}
+}
+
+
+bool tAtlasPack::MaxRectsBin::SplitFreeRect(const Rect& fr, const Rect& used)
+{
+	if ((used.X >= fr.X+fr.W) || (used.X+used.W <= fr.X) || (used.Y >= fr.Y+fr.H) || (used.Y+used.H <= fr.Y))
+		return false;
+
+	if ((used.X < fr.X+fr.W) && (used.X+used.W > fr.X))
+	{
+		// Below and above the used rect.
+		if ((used.Y > fr.Y) && (used.Y < fr.Y+fr.H))
+			NewRects.Append(Rect{fr.X, fr.Y, fr.W, used.Y - fr.Y});
+		if (used.Y+used.H < fr.Y+fr.H)
+			NewRects.Append(Rect{fr.X, used.Y+used.H, fr.W, fr.Y+fr.H - (used.Y+used.H)});
+	}
+
+	if ((used.Y < fr.Y+fr.H) && (used.Y+used.H > fr.Y))
+	{
+		// Left and right of the used rect.
+		if ((used.X > fr.X) && (used.X < fr.X+fr.W))
+			NewRects.Append(Rect{fr.X, fr.Y, used.X - fr.X, fr.H});
+		if (used.X+used.W < fr.X+fr.W)
+			NewRects.Append(Rect{used.X+used.W, fr.Y, fr.X+fr.W - (used.X+used.W), fr.H});
+	}
+
+	return true;
+}
+
+
+void tAtlasPack::MaxRectsBin::PruneNewRects()
+{
+	// A new rect is a subset of the free rect it was split from, so it can never contain a surviving old free rect.
+	// Only the new rects need to be tested, against the old ones and each other.
+	int numNew = NewRects.GetNumElements();
+	int numFree = FreeRects.GetNumElements();
+	for (int n = 0; n < numNew;)
+	{
+		const Rect& rect = NewRects[n];
+		bool contained = false;
+		for (int f = 0; (f < numFree) && !contained; f++)
+			contained = FreeRects[f].Contains(rect);
+		for (int o = 0; (o < numNew) && !contained; o++)
+			contained = (o != n) && NewRects[o].Contains(rect);
+
+		if (contained)
+		{
+			NewRects[n] = NewRects[numNew-1];
+			NewRects.Truncate();
+			numNew--;
+		}
+		else
+		{
+			n++;
+		}
+	}
+}
+
+
+tAtlasPack::SkylineBin::SkylineBin(int width, int height) :
+	Bin(width, height),
+	Nodes(new Node[width+1]),
+	NumNodes(1)
+{
+	// Every node is at least one pixel wide so there can never be more than width nodes, plus one during insertion.
+	Nodes[0] = Node{0, 0, width};
+}
+
+
+int tAtlasPack::SkylineBin::Fit(int index, int w, int h) const
+{
+	int x = Nodes[index].X;
+	if (x + w > Width)
+		return -1;
+
+	int y = Nodes[index].Y;
+	int widthLeft = w;
+	for (int n = index; widthLeft > 0; n++)
+	{
+		tAssert(n < NumNodes);
+		y = tMath::tMax(y, Nodes[n].Y);
+		if (y + h > Height)
+			return -1;
+		widthLeft -= Nodes[n].W;
+	}
+
+	return y;
+}
+
+
+bool tAtlasPack::SkylineBin::Place(int w, int h, bool allowRotation, Rect& placed, bool& rotated)
+{
+	// Bottom-left. Lowest resulting top edge wins, ties go to the narrower node.
+	int bestTop = 0x7FFFFFFF;
+	int bestWidth = 0x7FFFFFFF;
+	int bestIndex = -1;
+	for (int n = 0; n < NumNodes; n++)
+	{
+		int y = Fit(n, w, h);
+		if ((y >= 0) && ((y + h < bestTop) || ((y + h == bestTop) && (Nodes[n].W < bestWidth))))
+		{
+			bestTop = y + h; bestWidth = Nodes[n].W; bestIndex = n;
+			placed = Rect{Nodes[n].X, y, w, h}; rotated = false;
+		}
+
+		if (!allowRotation || (w == h))
+			continue;
+
+		y = Fit(n, h, w);
+		if ((y >= 0) && ((y + w < bestTop) || ((y + w == bestTop) && (Nodes[n].W < bestWidth))))
+		{
+			bestTop = y + w; bestWidth = Nodes[n].W; bestIndex = n;
+			placed = Rect{Nodes[n].X, y, h, w}; rotated = true;
+		}
+	}
+
+	if (bestIndex == -1)
+		return false;
+
+	AddLevel(bestIndex, placed);
+	return true;
+}
+
+
+void tAtlasPack::SkylineBin::AddLevel(int index, const Rect& rect)
+{
+	// Insert the new top edge, then trim or remove the nodes it now covers.
+	for (int n = NumNodes; n > index; n--)
+		Nodes[n] = Nodes[n-1];
+	Nodes[index] = Node{rect.X, rect.Y + rect.H, rect.W};
+	NumNodes++;
+
+	for (int n = index+1; n < NumNodes;)
+	{
+		const Node& prev = Nodes[n-1];
+		int prevRight = prev.X + prev.W;
+		if (Nodes[n].X >= prevRight)
+			break;
+
+		int shrink = prevRight - Nodes[n].X;
+		Nodes[n].X += shrink;
+		Nodes[n].W -= shrink;
+		if (Nodes[n].W > 0)
+			break;
+
+		for (int m = n; m < NumNodes-1; m++)
+			Nodes[m] = Nodes[m+1];
+		NumNodes--;
+	}
+
+	// Merge neighbours at the same height.
+	for (int n = 0; n < NumNodes-1;)
+	{
+		if (Nodes[n].Y == Nodes[n+1].Y)
+		{
+			Nodes[n].W += Nodes[n+1].W;
+			for (int m = n+1; m < NumNodes-1; m++)
+				Nodes[m] = Nodes[m+1];
+			NumNodes--;
+		}
+		else
+		{
+			n++;
+		}
+	}
+}
+
+
+void tAtlas::Params::Reset()
+{
+	Method			= tMethod::MaxRects;
+	PageWidth		= 2048;
+	PageHeight		= 2048;
+	Padding			= 0;
+	Extrude			= 0;
+	AllowRotation	= false;
+	Trim			= false;
+	TrimColour		= tColour4b::transparent;
+	TrimChannels	= tCompBit_A;
+	Background		= tColour4b::transparent;
+	NumThreads		= 0;
+}
+
+
+void tAtlas::Clear()
+{
+	delete[] Entries;
+	Entries = nullptr;
+	NumEntries = 0;
+
+	delete[] Pages;
+	Pages = nullptr;
+	NumPages = 0;
+	PageWidth = 0;
+	PageHeight = 0;
+}
+
+
+int tAtlas::Pack(const tPicture* const* sprites, int numSprites, const Params& params)
+{
+	Clear();
+	if (!sprites || (numSprites <= 0) || (params.PageWidth <= 0) || (params.PageHeight <= 0))
+		return 0;
+
+	NumEntries = numSprites;
+	Entries = new tAtlasEntry[numSprites];
+	PageWidth = params.PageWidth;
+	PageHeight = params.PageHeight;
+	int extrude = tMath::tMax(params.Extrude, 0);
+	int padding = tMath::tMax(params.Padding, 0);
+
+	// Border detection scans every pixel so it is the expensive part of packing many sprites. Each entry is written
+	// by one thread only.
+	auto trimSprites = [&](int begin, int end)
+	{
+		for (int s = begin; s < end; s++)
+		{
+			const tPicture* sprite = sprites[s];
+			if (!sprite || !sprite->IsValid())
+				continue;
+
+			tAtlasEntry& entry = Entries[s];
+			entry.SrcWidth = sprite->GetWidth();
+			entry.SrcHeight = sprite->GetHeight();
+			entry.Width = entry.SrcWidth;
+			entry.Height = entry.SrcHeight;
+
+			int bottom = 0, top = 0, left = 0, right = 0;
+			if (params.Trim && sprite->GetBordersSizes(params.TrimColour, params.TrimChannels, bottom, top, left, right))
+			{
+				entry.TrimX = left;
+				entry.TrimY = bottom;
+				entry.Width = entry.SrcWidth - left - right;
+				entry.Height = entry.SrcHeight - bottom - top;
+			}
+		}
+	};
+	tSystem::tParallelFor(numSprites, trimSprites, params.Trim ? params.NumThreads : 1);
+
+	// Items include extrusion on both sides and padding on one. The bins are enlarged by the padding so sprites
+	// touching the right or top page edge do not waste it.
+	tAtlasPack::Item* items = new tAtlasPack::Item[numSprites];
+	int numItems = 0;
+	for (int s = 0; s < numSprites; s++)
+	{
+		if (Entries[s].SrcWidth <= 0)
+			continue;
+		items[numItems++] = tAtlasPack::Item{ s, Entries[s].Width + 2*extrude + padding, Entries[s].Height + 2*extrude + padding };
+	}
+	tSort::tQuick(items, numItems, tAtlasPack::ItemLarger);
+
+	int binW = PageWidth + padding;
+	int binH = PageHeight + padding;
+	tArray<tAtlasPack::Bin*> bins(0, 16);
+	int numPacked = 0;
+	for (int i = 0; i < numItems; i++)
+	{
+		const tAtlasPack::Item& item = items[i];
+		tAtlasPack::Rect placed;
+		bool rotated = false;
+		int page = -1;
+		int numBins = bins.GetNumElements();
+		for (int b = 0; (b < numBins) && (page == -1); b++)
+			if (bins[b]->Insert(item.W, item.H, params.AllowRotation, placed, rotated))
+				page = b;
+
+		if (page == -1)
+		{
+			tAtlasPack::Bin* bin = nullptr;
+			if (params.Method == tMethod::Skyline)
+				bin = new tAtlasPack::SkylineBin(binW, binH);
+			else
+				bin = new tAtlasPack::MaxRectsBin(binW, binH);
+
+			// If it doesn't fit in an empty page it never will. Leave the entry unpacked and discard the bin.
+			if (!bin->Insert(item.W, item.H, params.AllowRotation, placed, rotated))
+			{
+				delete bin;
+				continue;
+			}
+			bins.Append(bin);
+			page = numBins;
+		}
+
+		tAtlasEntry& entry = Entries[item.Index];
+		entry.Page = page;
+		entry.Rotated = rotated;
+		if (rotated)
+			tStd::tSwap(entry.Width, entry.Height);
+		entry.X = placed.X + extrude;
+		entry.Y = placed.Y + extrude;
+		entry.U0 = float(entry.X) / float(PageWidth);
+		entry.V0 = float(entry.Y) / float(PageHeight);
+		entry.U1 = float(entry.X + entry.Width) / float(PageWidth);
+		entry.V1 = float(entry.Y + entry.Height) / float(PageHeight);
+		numPacked++;
+	}
+
+	NumPages = bins.GetNumElements();
+	for (int b = 0; b < NumPages; b++)
+		delete bins[b];
+	delete[] items;
+
+	return numPacked;
+}
+
+
+int tAtlas::Build(const tPicture* const* sprites, int numSprites, const Params& params)
+{
+	int numPacked = Pack(sprites, numSprites, params);
+	if (NumPages > 0)
+		Composite(sprites, params);
+
+	return numPacked;
+}
+
+
+void tAtlas::Composite(const tPicture* const* sprites, const Params& params)
+{
+	Pages = new tPicture[NumPages];
+	int extrude = tMath::tMax(params.Extrude, 0);
+
+	// Bucket the entries by page so each page can be composited independently.
+	int* pageStart = new int[NumPages+1];
+	int* pageEntries = new int[NumEntries];
+	tStd::tMemset(pageStart, 0, sizeof(int)*(NumPages+1));
+	for (int e = 0; e < NumEntries; e++)
+		if (Entries[e].Page >= 0)
+			pageStart[Entries[e].Page + 1]++;
+	for (int p = 0; p < NumPages; p++)
+		pageStart[p+1] += pageStart[p];
+
+	int* pageFill = new int[NumPages];
+	tStd::tMemcpy(pageFill, pageStart, sizeof(int)*NumPages);
+	for (int e = 0; e < NumEntries; e++)
+		if (Entries[e].Page >= 0)
+			pageEntries[pageFill[Entries[e].Page]++] = e;
+	delete[] pageFill;
+
+	// Pages do not overlap so they are composited concurrently. Each sprite is first gathered, with rotation and
+	// extrusion applied, into a region buffer which is then copied to the page with CopyRegion.
+	auto compositePages = [&](int begin, int end)
+	{
+		int regionCapacity = 0;
+		tColour4b* region = nullptr;
+		for (int p = begin; p < end; p++)
+		{
+			tPicture& page = Pages[p];
+			page.Set(PageWidth, PageHeight, params.Background);
+			for (int i = pageStart[p]; i < pageStart[p+1]; i++)
+			{
+				const tAtlasEntry& entry = Entries[pageEntries[i]];
+				const tPicture* sprite = sprites[pageEntries[i]];
+				int regionW = entry.Width + 2*extrude;
+				int regionH = entry.Height + 2*extrude;
+				if (regionW*regionH > regionCapacity)
+				{
+					delete[] region;
+					regionCapacity = regionW*regionH;
+					region = new tColour4b[regionCapacity];
+				}
+
+				for (int ry = 0; ry < regionH; ry++)
+				{
+					int cy = tMath::tClamp(ry - extrude, 0, entry.Height-1);
+					for (int rx = 0; rx < regionW; rx++)
+					{
+						int cx = tMath::tClamp(rx - extrude, 0, entry.Width-1);
+
+						// A clockwise rotation maps source (sx, sy) to (sy, trimmedW-1-sx). The trimmed width is the
+						// placed height when rotated.
+						int sx = entry.Rotated ? (entry.Height-1 - cy) : cx;
+						int sy = entry.Rotated ? cx : cy;
+						region[ry*regionW + rx] = sprite->GetPixel(entry.TrimX + sx, entry.TrimY + sy);
+					}
+				}
+
+				page.CopyRegion(regionW, regionH, region, entry.X - extrude, entry.Y - extrude);
+			}
+		}
+		delete[] region;
+	};
+	tSystem::tParallelFor(NumPages, compositePages, params.NumThreads);
+
+	delete[] pageEntries;
+	delete[] pageStart;
+}
+
+
+float tAtlas::GetOccupancy() const
+{
+	if ((NumPages <= 0) || (PageWidth <= 0) || (PageHeight <= 0))
+		return 0.0f;
+
+	int64 spriteArea = 0;
+	for (int e = 0; e < NumEntries; e++)
+		if (Entries[e].Page >= 0)
+			spriteArea += int64(Entries[e].Width) * Entries[e].Height;
+
+	return float(double(spriteArea) / (double(NumPages) * double(PageWidth) * double(PageHeight)));
+}
+
+
+}
@@ -0,0 +1,558 @@
+// tConvert.cpp
+//
+// Batch image conversion. A pipeline of Read, Decode, Transform, Encode and Write stages connected by bounded queues.
+// See the header for an overview.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <mutex>
+#include <condition_variable>
+#include <System/tFile.h>
+#include <System/tThread.h>
+#include <System/tTime.h>
+#include "Image/tConvert.h"
+#include "Image/tImageAPNG.h"
+#include "Image/tImageASTC.h"
+#include "Image/tImageBMP.h"
+#include "Image/tImageDDS.h"
+#include "Image/tImageEXR.h"
+#include "Image/tImageGIF.h"
+#include "Image/tImageHDR.h"
+#include "Image/tImageICO.h"
+#include "Image/tImageJPG.h"
+#include "Image/tImageKTX.h"
+#include "Image/tImagePKM.h"
+#include "Image/tImagePNG.h"
+#include "Image/tImagePVR.h"
+#include "Image/tImageQOI.h"
+#include "Image/tImageTGA.h"
+#include "Image/tImageTIFF.h"
+#include "Image/tImageWEBP.h"
+#include "Image/tImageXPM.h"
+namespace tImage {
+
+
+namespace tConvert
+{
+	// A job's working data as it moves through the stages. Deleting it frees whatever buffers it still holds.
+	struct WorkItem : public tLink<WorkItem>
+	{
+		WorkItem(tConvertJob* job);
+		~WorkItem()																										{ delete[] FileData; delete[] EncodedData; }
+
+		tConvertJob* Job;
+		tSystem::tFileType SrcType;
+		tSystem::tFileType DstType;
+		uint8* FileData																= nullptr;
+		int FileSize																= 0;
+		tPicture Picture;
+		uint8* EncodedData															= nullptr;
+		int EncodedSize																= 0;
+	};
+
+	// Shared state. Everything here is protected by Mutex. Queues[s] holds items waiting for stage s. There is no
+	// queue for the Read stage since its input is the job list.
+	struct Pipeline
+	{
+		Pipeline(const tConvertParams& params, int numJobs);
+
+		// Removes an item from the queue of the next compute stage that has work and room downstream. Later stages are
+		// preferred so items drain out of the pipeline and memory stays bounded. Must be called with Mutex held.
+		// Returns nullptr if nothing is runnable.
+		WorkItem* TakeComputeItem(tConvertStage& stage);
+
+		// Records the outcome of running stage on item. On success the item moves to the next queue. On failure the
+		// job is marked and the item deleted. Must be called with Mutex held.
+		void Complete(WorkItem*, tConvertStage, bool success, int64 numBytes, double seconds);
+
+		void ReadThread(tList<tConvertJob>& jobs);
+		void WriteThread();
+		void ComputeThread();
+
+		const tConvertParams& Params;
+		int Capacity;
+		std::mutex Mutex;
+		std::condition_variable Changed;
+		tList<WorkItem> Queues[int(tConvertStage::NumStages)];
+		int InFlight[int(tConvertStage::NumStages)];
+
+		// Number of jobs that have not yet left the Encode stage. When it reaches zero the compute threads exit.
+		int NumComputePending;
+		int NumSucceeded															= 0;
+		tConvertStats Stats;
+	};
+
+	bool CanDecodeFromMemory(tSystem::tFileType);
+	bool CanEncodeToMemory(tSystem::tFileType);
+	template<typename T> bool DecodeMemory(WorkItem&);
+	template<typename T> bool DecodeFile(WorkItem&);
+	template<typename T> bool EncodeMemory(WorkItem&);
+	template<typename T> bool EncodeFile(WorkItem&);
+
+	bool Decode(WorkItem&);
+	bool Transform(WorkItem&, const tConvertParams&);
+	bool Encode(WorkItem&);
+	bool Write(WorkItem&);
+
+	// Savers either return a bool or a tFormat that is Invalid on failure.
+	bool IsSaved(bool saved)																							{ return saved; }
+	template<typename F> bool IsSaved(F format)																			{ return format != F::Invalid; }
+
+	double GetSeconds(int64 startCount);
+}
+
+
+const char* tGetConvertStageName(tConvertStage stage)
+{
+	switch (stage)
+	{
+		case tConvertStage::Read:		return "Read";
+		case tConvertStage::Decode:		return "Decode";
+		case tConvertStage::Transform:	return "Transform";
+		case tConvertStage::Encode:		return "Encode";
+		case tConvertStage::Write:		return "Write";
+	}
+	return "Invalid";
+}
+
+
+void tConvertParams::Reset()
+{
+	NumThreads			= 0;
+	QueueCapacity		= 8;
+	ResampleWidth		= 0;
+	ResampleHeight		= 0;
+	ResampleFilter		= tResampleFilter::Bilinear;
+	ResampleEdgeMode	= tResampleEdgeMode::Clamp;
+	Brightness			= -1.0f;
+	Contrast			= -1.0f;
+	QuantizeColours		= 0;
+	QuantizeMethod		= tQuantize::Method::Wu;
+	Transform			= nullptr;
+}
+
+
+tConvert::WorkItem::WorkItem(tConvertJob* job) :
+	Job(job),
+	SrcType(tSystem::tGetFileType(job->SrcFile)),
+	DstType(tSystem::tGetFileType(job->DstFile))
+{
+}
+
+
+double tConvert::GetSeconds(int64 startCount)
+{
+	int64 count = tSystem::tGetHardwareTimerCount() - startCount;
+	return double(count) / double(tSystem::tGetHardwareTimerFrequency());
+}
+
+
+bool tConvert::CanDecodeFromMemory(tSystem::tFileType type)
+{
+	switch (type)
+	{
+		case tSystem::tFileType::TGA:	case tSystem::tFileType::BMP:	case tSystem::tFileType::QOI:
+		case tSystem::tFileType::PNG:	case tSystem::tFileType::GIF:	case tSystem::tFileType::WEBP:
+		case tSystem::tFileType::XPM:	case tSystem::tFileType::JPG:	case tSystem::tFileType::DDS:
+		case tSystem::tFileType::KTX:	case tSystem::tFileType::KTX2:	case tSystem::tFileType::PVR:
+		case tSystem::tFileType::ASTC:	case tSystem::tFileType::PKM:	case tSystem::tFileType::ICO:
+			return true;
+	}
+	return false;
+}
+
+
+bool tConvert::CanEncodeToMemory(tSystem::tFileType type)
+{
+	switch (type)
+	{
+		case tSystem::tFileType::TGA:	case tSystem::tFileType::BMP:	case tSystem::tFileType::QOI:
+			return true;
+	}
+	return false;
+}
+
+
+template<typename T> bool tConvert::DecodeMemory(WorkItem& item)
+{
+	T image;
+	if (!image.Load(item.FileData, item.FileSize))
+		return false;
+
+	// The compressed bytes are no longer needed. Free them now rather than when the item is done.
+	delete[] item.FileData;
+	item.FileData = nullptr;
+	item.Picture.Set(image, true);
+	return item.Picture.IsValid();
+}
+
+
+template<typename T> bool tConvert::DecodeFile(WorkItem& item)
+{
+	T image;
+	if (!image.Load(item.Job->SrcFile))
+		return false;
+
+	item.Picture.Set(image, true);
+	return item.Picture.IsValid();
+}
+
+
+template<typename T> bool tConvert::EncodeMemory(WorkItem& item)
+{
+	T image;
+	if (!image.Set(item.Picture, true))
+		return false;
+
+	return image.Save(item.EncodedData, item.EncodedSize) != T::tFormat::Invalid;
+}
+
+
+template<typename T> bool tConvert::EncodeFile(WorkItem& item)
+{
+	T image;
+	if (!image.Set(item.Picture, true))
+		return false;
+
+	return IsSaved(image.Save(item.Job->DstFile));
+}
+
+
+bool tConvert::Decode(WorkItem& item)
+{
+	switch (item.SrcType)
+	{
+		case tSystem::tFileType::TGA:	return DecodeMemory<tImageTGA>(item);
+		case tSystem::tFileType::BMP:	return DecodeMemory<tImageBMP>(item);
+		case tSystem::tFileType::QOI:	return DecodeMemory<tImageQOI>(item);
+		case tSystem::tFileType::PNG:	return DecodeMemory<tImagePNG>(item);
+		case tSystem::tFileType::GIF:	return DecodeMemory<tImageGIF>(item);
+		case tSystem::tFileType::WEBP:	return DecodeMemory<tImageWEBP>(item);
+		case tSystem::tFileType::XPM:	return DecodeMemory<tImageXPM>(item);
+		case tSystem::tFileType::JPG:	return DecodeMemory<tImageJPG>(item);
+		case tSystem::tFileType::DDS:	return DecodeMemory<tImageDDS>(item);
+		case tSystem::tFileType::KTX:
+		case tSystem::tFileType::KTX2:	return DecodeMemory<tImageKTX>(item);
+		case tSystem::tFileType::PVR:	return DecodeMemory<tImagePVR>(item);
+		case tSystem::tFileType::ASTC:	return DecodeMemory<tImageASTC>(item);
+		case tSystem::tFileType::PKM:	return DecodeMemory<tImagePKM>(item);
+		case tSystem::tFileType::ICO:	return DecodeMemory<tImageICO>(item);
+
+		// These loaders only read from disk so the Read stage skips them and the decode does its own I/O.
+		case tSystem::tFileType::APNG:	return DecodeFile<tImageAPNG>(item);
+		case tSystem::tFileType::TIFF:	return DecodeFile<tImageTIFF>(item);
+		case tSystem::tFileType::HDR:	return DecodeFile<tImageHDR>(item);
+		case tSystem::tFileType::EXR:	return DecodeFile<tImageEXR>(item);
+	}
+	return false;
+}
+
+
+bool tConvert::Transform(WorkItem& item, const tConvertParams& params)
+{
+	tPicture& picture = item.Picture;
+	if ((params.ResampleWidth > 0) || (params.ResampleHeight > 0))
+	{
+		int srcW = picture.GetWidth();
+		int srcH = picture.GetHeight();
+		int dstW = params.ResampleWidth;
+		int dstH = params.ResampleHeight;
+		if (dstW <= 0)
+			dstW = tMath::tMax(1, int(int64(srcW)*dstH / srcH));
+		if (dstH <= 0)
+			dstH = tMath::tMax(1, int(int64(srcH)*dstW / srcW));
+
+		if ((dstW != srcW) || (dstH != srcH))
+		{
+			if (!picture.Resample(dstW, dstH, params.ResampleFilter, params.ResampleEdgeMode))
+				return false;
+		}
+	}
+
+	// Adjustments are always computed from the session's original pixels, so brightness and contrast each get their
+	// own session in order for the contrast to apply to the brightened image.
+	if (params.Brightness >= 0.0f)
+	{
+		if (!picture.AdjustmentBegin())
+			return false;
+		picture.AdjustBrightness(tMath::tSaturate(params.Brightness));
+		picture.AdjustmentEnd();
+	}
+
+	if (params.Contrast >= 0.0f)
+	{
+		if (!picture.AdjustmentBegin())
+			return false;
+		picture.AdjustContrast(tMath::tSaturate(params.Contrast));
+		picture.AdjustmentEnd();
+	}
+
+	if ((params.QuantizeColours >= 2) && (params.QuantizeColours <= 256))
+	{
+		bool quantized = false;
+		switch (params.QuantizeMethod)
+		{
+			case tQuantize::Method::Fixed:		quantized = picture.QuantizeFixed(params.QuantizeColours);		break;
+			case tQuantize::Method::Spatial:	quantized = picture.QuantizeSpatial(params.QuantizeColours);	break;
+			case tQuantize::Method::Neu:		quantized = picture.QuantizeNeu(params.QuantizeColours);		break;
+			case tQuantize::Method::Wu:			quantized = picture.QuantizeWu(params.QuantizeColours);			break;
+		}
+
+		// A false return with a valid picture means it already had few enough colours. That is not an error.
+		if (!quantized && !picture.IsValid())
+			return false;
+	}
+
+	if (params.Transform && !params.Transform(picture))
+		return false;
+
+	return picture.IsValid();
+}
+
+
+bool tConvert::Encode(WorkItem& item)
+{
+	switch (item.DstType)
+	{
+		case tSystem::tFileType::TGA:	return EncodeMemory<tImageTGA>(item);
+		case tSystem::tFileType::BMP:	return EncodeMemory<tImageBMP>(item);
+		case tSystem::tFileType::QOI:	return EncodeMemory<tImageQOI>(item);
+
+		// These writers only save to disk. The encode writes the file directly and the Write stage has nothing left
+		// to do for them.
+		case tSystem::tFileType::PNG:	return EncodeFile<tImagePNG>(item);
+		case tSystem::tFileType::JPG:	return EncodeFile<tImageJPG>(item);
+		case tSystem::tFileType::WEBP:	return EncodeFile<tImageWEBP>(item);
+		case tSystem::tFileType::TIFF:	return EncodeFile<tImageTIFF>(item);
+	}
+	return false;
+}
+
+
+bool tConvert::Write(WorkItem& item)
+{
+	if (!CanEncodeToMemory(item.DstType))
+		return true;
+
+	return tSystem::tCreateFile(item.Job->DstFile, item.EncodedData, item.EncodedSize);
+}
+
+
+tConvert::Pipeline::Pipeline(const tConvertParams& params, int numJobs) :
+	Params(params),
+	Capacity(tMath::tMax(params.QueueCapacity, 1)),
+	NumComputePending(numJobs)
+{
+	for (int s = 0; s < int(tConvertStage::NumStages); s++)
+		InFlight[s] = 0;
+}
+
+
+tConvert::WorkItem* tConvert::Pipeline::TakeComputeItem(tConvertStage& stage)
+{
+	const tConvertStage order[] = { tConvertStage::Encode, tConvertStage::Transform, tConvertStage::Decode };
+	for (tConvertStage s : order)
+	{
+		int curr = int(s);
+		int next = curr + 1;
+
+		// Items being processed count against the downstream capacity so the bound holds with many threads.
+		if (Queues[curr].IsEmpty() || (Queues[next].Count() + InFlight[curr] >= Capacity))
+			continue;
+
+		InFlight[curr]++;
+		stage = s;
+		return Queues[curr].Remove();
+	}
+
+	return nullptr;
+}
+
+
+void tConvert::Pipeline::Complete(WorkItem* item, tConvertStage stage, bool success, int64 numBytes, double seconds)
+{
+	tConvertStageStats& stats = Stats.Stages[int(stage)];
+	stats.BusySeconds += seconds;
+	if (stage != tConvertStage::Read)
+		InFlight[int(stage)]--;
+
+	if (success)
+	{
+		stats.NumItems++;
+		stats.NumBytes += numBytes;
+		if (stage == tConvertStage::Encode)
+			NumComputePending--;
+
+		if (stage == tConvertStage::Write)
+		{
+			item->Job->Success = true;
+			NumSucceeded++;
+			delete item;
+		}
+		else
+		{
+			Queues[int(stage) + 1].Append(item);
+		}
+	}
+	else
+	{
+		stats.NumFailed++;
+		if (stage <= tConvertStage::Encode)
+			NumComputePending--;
+
+		item->Job->Success = false;
+		item->Job->FailedStage = stage;
+		delete item;
+	}
+
+	Changed.notify_all();
+}
+
+
+void tConvert::Pipeline::ReadThread(tList<tConvertJob>& jobs)
+{
+	for (tConvertJob* job = jobs.First(); job; job = job->Next())
+	{
+		// Only this thread appends to the Decode queue, so once there is room it stays available until the push. We
+		// wait before reading so a full queue does not also hold an extra file in memory.
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			Changed.wait(lock, [this]() { return Queues[int(tConvertStage::Decode)].Count() < Capacity; });
+		}
+
+		WorkItem* item = new WorkItem(job);
+		int64 start = tSystem::tGetHardwareTimerCount();
+		bool success = true;
+		if (CanDecodeFromMemory(item->SrcType))
+		{
+			item->FileData = tSystem::tLoadFile(job->SrcFile, nullptr, &item->FileSize);
+			success = item->FileData ? true : false;
+		}
+		else if (!tSystem::tFileExists(job->SrcFile))
+		{
+			success = false;
+		}
+		double seconds = GetSeconds(start);
+
+		std::lock_guard<std::mutex> lock(Mutex);
+		Complete(item, tConvertStage::Read, success, item->FileSize, seconds);
+	}
+}
+
+
+void tConvert::Pipeline::WriteThread()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	while (true)
+	{
+		tList<WorkItem>& queue = Queues[int(tConvertStage::Write)];
+		Changed.wait(lock, [this, &queue]() { return !queue.IsEmpty() || (NumComputePending == 0); });
+		if (queue.IsEmpty())
+			return;
+
+		WorkItem* item = queue.Remove();
+		InFlight[int(tConvertStage::Write)]++;
+		lock.unlock();
+
+		int64 start = tSystem::tGetHardwareTimerCount();
+		bool success = Write(*item);
+		double seconds = GetSeconds(start);
+
+		lock.lock();
+		Complete(item, tConvertStage::Write, success, item->EncodedSize, seconds);
+	}
+}
+
+
+void tConvert::Pipeline::ComputeThread()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	while (true)
+	{
+		tConvertStage stage = tConvertStage::NumStages;
+		WorkItem* item = nullptr;
+		Changed.wait(lock, [this, &item, &stage]() { item = TakeComputeItem(stage); return item || (NumComputePending == 0); });
+		if (!item)
+			return;
+		lock.unlock();
+
+		int64 start = tSystem::tGetHardwareTimerCount();
+		bool success = false;
+		int64 numBytes = 0;
+		switch (stage)
+		{
+			case tConvertStage::Decode:
+				success = Decode(*item);
+				numBytes = int64(item->Picture.GetWidth()) * item->Picture.GetHeight() * sizeof(tPixel4b);
+				break;
+
+			case tConvertStage::Transform:
+				success = Transform(*item, Params);
+				numBytes = int64(item->Picture.GetWidth()) * item->Picture.GetHeight() * sizeof(tPixel4b);
+				break;
+
+			case tConvertStage::Encode:
+				success = Encode(*item);
+				numBytes = item->EncodedSize;
+				break;
+		}
+		double seconds = GetSeconds(start);
+
+		lock.lock();
+		Complete(item, stage, success, numBytes, seconds);
+	}
+}
+
+
+int tConvertBatch(tList<tConvertJob>& jobs, const tConvertParams& params, tConvertStats* stats)
+{
+	int numJobs = jobs.Count();
+	for (tConvertJob* job = jobs.First(); job; job = job->Next())
+	{
+		job->Success = false;
+		job->FailedStage = tConvertStage::NumStages;
+	}
+
+	if (stats)
+		*stats = tConvertStats();
+	if (numJobs <= 0)
+		return 0;
+
+	int64 start = tSystem::tGetHardwareTimerCount();
+	tConvert::Pipeline pipeline(params, numJobs);
+	int numCompute = tSystem::tGetNumWorkerThreads(numJobs, params.NumThreads);
+
+	// The calling thread is one of the compute threads.
+	std::thread reader(&tConvert::Pipeline::ReadThread, &pipeline, std::ref(jobs));
+	std::thread writer(&tConvert::Pipeline::WriteThread, &pipeline);
+	std::thread* compute = new std::thread[numCompute-1];
+	for (int t = 0; t < numCompute-1; t++)
+		compute[t] = std::thread(&tConvert::Pipeline::ComputeThread, &pipeline);
+
+	pipeline.ComputeThread();
+	for (int t = 0; t < numCompute-1; t++)
+		compute[t].join();
+	reader.join();
+	writer.join();
+	delete[] compute;
+
+	if (stats)
+	{
+		*stats = pipeline.Stats;
+		stats->WallSeconds = tConvert::GetSeconds(start);
+		stats->NumComputeThreads = numCompute;
+	}
+
+	return pipeline.NumSucceeded;
+}
+
+
+}
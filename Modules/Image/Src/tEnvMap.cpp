@@ -0,0 +1,564 @@
+// tEnvMap.cpp
+//
+// Equirectangular to cubemap conversion and prefiltering of environment maps. The specular filter importance samples
+// the GGX distribution and the irradiance filter importance samples the cosine lobe, both using a Hammersley sequence.
+// To keep the sample counts low each sample reads from a box-filtered mipmap of the source faces chosen so the texel
+// footprint roughly matches the solid angle the sample represents. See 'GPU-Based Importance Sampling' in GPU Gems 3.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <Foundation/tSmallFloat.h>
+#include <Math/tVector3.h>
+#include <System/tThread.h>
+#include "Image/tEnvMap.h"
+#if defined(ARCHITECTURE_X64) || defined(ARCHITECTURE_X86)
+	#define ENVMAP_SSE2
+	#include <emmintrin.h>
+#endif
+using namespace tMath;
+namespace tImage {
+
+
+namespace tEnv
+{
+	// RGBA accumulator. All the filtering is weighted sums of texels so this is all that is needed to keep the colour
+	// maths in SIMD registers.
+	#ifdef ENVMAP_SSE2
+	struct Vec4 { __m128 V; };
+	inline Vec4 Zero()																									{ return { _mm_setzero_ps() }; }
+	inline Vec4 Load(const tColour4f& c)																				{ return { _mm_loadu_ps(c.E) }; }
+	inline void Store(tColour4f& c, Vec4 v)																				{ _mm_storeu_ps(c.E, v.V); }
+	inline Vec4 Scale(Vec4 v, float s)																					{ return { _mm_mul_ps(v.V, _mm_set1_ps(s)) }; }
+	inline Vec4 MulAdd(Vec4 acc, Vec4 v, float s)																		{ return { _mm_add_ps(acc.V, _mm_mul_ps(v.V, _mm_set1_ps(s))) }; }
+	inline Vec4 Lerp(Vec4 a, Vec4 b, float t)																			{ return { _mm_add_ps(a.V, _mm_mul_ps(_mm_sub_ps(b.V, a.V), _mm_set1_ps(t))) }; }
+	#else
+	struct Vec4 { float V[4]; };
+	inline Vec4 Zero()																									{ return { { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+	inline Vec4 Load(const tColour4f& c)																				{ return { { c.E[0], c.E[1], c.E[2], c.E[3] } }; }
+	inline void Store(tColour4f& c, Vec4 v)																				{ for (int e = 0; e < 4; e++) c.E[e] = v.V[e]; }
+	inline Vec4 Scale(Vec4 v, float s)																					{ for (int e = 0; e < 4; e++) v.V[e] *= s; return v; }
+	inline Vec4 MulAdd(Vec4 acc, Vec4 v, float s)																		{ for (int e = 0; e < 4; e++) acc.V[e] += v.V[e]*s; return acc; }
+	inline Vec4 Lerp(Vec4 a, Vec4 b, float t)																			{ for (int e = 0; e < 4; e++) a.V[e] += (b.V[e]-a.V[e])*t; return a; }
+	#endif
+
+	// Cube faces use the D3D/KTX convention. s goes right and t goes down, both in [-1, 1]. Since our rows go bottom to
+	// top, t is 1 at row 0. The returned direction is not normalized.
+	tVector3 FaceDirection(int face, float s, float t);
+	void DirectionToFace(int& face, float& s, float& t, const tVector3& dir);
+
+	// Direction through the centre of texel (x, y) of a face of the given size.
+	tVector3 TexelDirection(int face, int x, int y, int size);
+
+	// Returns the ith of n Hammersley points in [0, 1)^2.
+	void Hammersley(float& x, float& y, int i, int n);
+
+	// The source faces plus a box-filtered mipmap chain for them. Level 0 points at the caller's pixels.
+	struct SourceCube
+	{
+		SourceCube(const tPicture4f faces[tFaceIndex_NumFaces], int numThreads);
+		~SourceCube();
+
+		Vec4 Bilinear(int level, int face, float s, float t) const;
+		Vec4 Sample(const tVector3& dir, float lod) const;
+
+		int NumLevels;
+		int Sizes[32];
+		tColour4f* Faces[32][tFaceIndex_NumFaces];
+	};
+
+	// A tangent-space sample direction about +Z with its weight and the source level to read it from. The tables are
+	// computed once per filter and shared by every texel.
+	struct Sample
+	{
+		tVector3 Dir;
+		float Weight;
+		float Lod;
+	};
+
+	// Lod for a sample with the given pdf, where the level 0 source texel solid angle is texelSolidAngle.
+	float GetSampleLod(float pdf, int numSamples, float texelSolidAngle, int numLevels);
+
+	// Returns the number of samples with non-zero weight written to samples.
+	int ComputeSpecularSamples(Sample* samples, int numSamples, float roughness, float texelSolidAngle, int numLevels);
+	int ComputeIrradianceSamples(Sample* samples, int numSamples, float texelSolidAngle, int numLevels);
+
+	// Weighted average of the source in the sample directions about dir, which must be normalized.
+	tColour4f Filter(const SourceCube&, const tVector3& dir, const Sample* samples, int numSamples);
+
+	bool ValidateFaces(const tPicture4f faces[tFaceIndex_NumFaces]);
+	inline bool IsValidFormat(tPixelFormat fmt)																		{ return (fmt == tPixelFormat::R32G32B32A32f) || (fmt == tPixelFormat::R16G16B16A16f); }
+
+	// Allocates a layer of the given format. Use StoreTexel to fill it in.
+	tLayer* CreateLayer(tPixelFormat, int size);
+	void StoreTexel(tLayer*, int index, const tColour4f&);
+}
+
+
+tVector3 tEnv::FaceDirection(int face, float s, float t)
+{
+	switch (face)
+	{
+		case tFaceIndex_PosX:	return tVector3( 1.0f,   -t,   -s);
+		case tFaceIndex_NegX:	return tVector3(-1.0f,   -t,    s);
+		case tFaceIndex_PosY:	return tVector3(    s, 1.0f,    t);
+		case tFaceIndex_NegY:	return tVector3(    s,-1.0f,   -t);
+		case tFaceIndex_PosZ:	return tVector3(    s,   -t, 1.0f);
+		case tFaceIndex_NegZ:	return tVector3(   -s,   -t,-1.0f);
+	}
+	return tVector3(0.0f, 0.0f, 1.0f);
+}
+
+
+void tEnv::DirectionToFace(int& face, float& s, float& t, const tVector3& dir)
+{
+	float ax = tMath::tAbs(dir.x);
+	float ay = tMath::tAbs(dir.y);
+	float az = tMath::tAbs(dir.z);
+	if ((ax >= ay) && (ax >= az))
+	{
+		float rcp = 1.0f / ax;
+		face = (dir.x >= 0.0f) ? tFaceIndex_PosX : tFaceIndex_NegX;
+		s = (dir.x >= 0.0f) ? -dir.z*rcp : dir.z*rcp;
+		t = -dir.y*rcp;
+	}
+	else if (ay >= az)
+	{
+		float rcp = 1.0f / ay;
+		face = (dir.y >= 0.0f) ? tFaceIndex_PosY : tFaceIndex_NegY;
+		s = dir.x*rcp;
+		t = (dir.y >= 0.0f) ? dir.z*rcp : -dir.z*rcp;
+	}
+	else
+	{
+		float rcp = 1.0f / az;
+		face = (dir.z >= 0.0f) ? tFaceIndex_PosZ : tFaceIndex_NegZ;
+		s = (dir.z >= 0.0f) ? dir.x*rcp : -dir.x*rcp;
+		t = -dir.y*rcp;
+	}
+}
+
+
+tVector3 tEnv::TexelDirection(int face, int x, int y, int size)
+{
+	float s = 2.0f*(float(x) + 0.5f)/float(size) - 1.0f;
+	float t = 1.0f - 2.0f*(float(y) + 0.5f)/float(size);
+	tVector3 dir = FaceDirection(face, s, t);
+	dir.Normalize();
+	return dir;
+}
+
+
+void tEnv::Hammersley(float& x, float& y, int i, int n)
+{
+	uint32 bits = uint32(i);
+	bits = (bits << 16) | (bits >> 16);
+	bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+	bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+	bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+	bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+	x = float(i) / float(n);
+	y = float(bits) * 2.3283064365386963e-10f;
+}
+
+
+tEnv::SourceCube::SourceCube(const tPicture4f faces[tFaceIndex_NumFaces], int numThreads) :
+	NumLevels(1)
+{
+	Sizes[0] = faces[0].GetWidth();
+	for (int f = 0; f < tFaceIndex_NumFaces; f++)
+		Faces[0][f] = faces[f].GetPixels();
+
+	while (Sizes[NumLevels-1] > 1)
+	{
+		int level = NumLevels;
+		int srcSize = Sizes[level-1];
+		int size = srcSize >> 1;
+		Sizes[level] = size;
+		for (int f = 0; f < tFaceIndex_NumFaces; f++)
+			Faces[level][f] = new tColour4f[size*size];
+
+		// A 2x2 box. If the source size is odd the last source row and column are dropped, which is fine for the
+		// purpose of reducing aliasing in the filtered lookups.
+		tSystem::tParallelFor
+		(
+			tFaceIndex_NumFaces*size,
+			[&](int begin, int end)
+			{
+				for (int row = begin; row < end; row++)
+				{
+					int f = row / size;
+					int y = row % size;
+					const tColour4f* src0 = Faces[level-1][f] + (2*y)*srcSize;
+					const tColour4f* src1 = src0 + srcSize;
+					tColour4f* dst = Faces[level][f] + y*size;
+					for (int x = 0; x < size; x++)
+					{
+						Vec4 sum = Load(src0[2*x]);
+						sum = MulAdd(sum, Load(src0[2*x+1]), 1.0f);
+						sum = MulAdd(sum, Load(src1[2*x]), 1.0f);
+						sum = MulAdd(sum, Load(src1[2*x+1]), 1.0f);
+						Store(dst[x], Scale(sum, 0.25f));
+					}
+				}
+			},
+			numThreads
+		);
+		NumLevels++;
+	}
+}
+
+
+tEnv::SourceCube::~SourceCube()
+{
+	for (int level = 1; level < NumLevels; level++)
+		for (int f = 0; f < tFaceIndex_NumFaces; f++)
+			delete[] Faces[level][f];
+}
+
+
+tEnv::Vec4 tEnv::SourceCube::Bilinear(int level, int face, float s, float t) const
+{
+	// Samples clamp at the face edges rather than reading across the seam into the neighbouring face. At the sample
+	// counts used the difference is not visible.
+	int size = Sizes[level];
+	float maxCoord = float(size - 1);
+	float fx = tMath::tClamp((s + 1.0f)*0.5f*float(size) - 0.5f, 0.0f, maxCoord);
+	float fy = tMath::tClamp((1.0f - t)*0.5f*float(size) - 0.5f, 0.0f, maxCoord);
+	int x0 = int(fx);
+	int y0 = int(fy);
+	int x1 = tMath::tMin(x0 + 1, size - 1);
+	int y1 = tMath::tMin(y0 + 1, size - 1);
+	float wx = fx - float(x0);
+	float wy = fy - float(y0);
+
+	const tColour4f* pixels = Faces[level][face];
+	Vec4 bottom = Lerp(Load(pixels[y0*size + x0]), Load(pixels[y0*size + x1]), wx);
+	Vec4 top = Lerp(Load(pixels[y1*size + x0]), Load(pixels[y1*size + x1]), wx);
+	return Lerp(bottom, top, wy);
+}
+
+
+tEnv::Vec4 tEnv::SourceCube::Sample(const tVector3& dir, float lod) const
+{
+	int face; float s, t;
+	DirectionToFace(face, s, t, dir);
+
+	int level = int(lod);
+	float frac = lod - float(level);
+	if ((level >= NumLevels-1) || (frac <= 0.0f))
+		return Bilinear(tMath::tMin(level, NumLevels-1), face, s, t);
+
+	return Lerp(Bilinear(level, face, s, t), Bilinear(level+1, face, s, t), frac);
+}
+
+
+float tEnv::GetSampleLod(float pdf, int numSamples, float texelSolidAngle, int numLevels)
+{
+	// The +1 biases towards the blurrier level. It is what makes low sample counts band-free.
+	if (pdf <= 0.0f)
+		return float(numLevels - 1);
+	float sampleSolidAngle = 1.0f / (float(numSamples) * pdf);
+	float lod = 0.5f*log2f(sampleSolidAngle / texelSolidAngle) + 1.0f;
+	return tMath::tClamp(lod, 0.0f, float(numLevels - 1));
+}
+
+
+int tEnv::ComputeSpecularSamples(Sample* samples, int numSamples, float roughness, float texelSolidAngle, int numLevels)
+{
+	// GGX with alpha = roughness^2. With the view direction equal to the normal the pdf of the reflected direction is
+	// D(h) * NoH / (4 * VoH) = D(h) / 4.
+	float alpha = roughness*roughness;
+	float alpha2 = alpha*alpha;
+	int count = 0;
+	for (int i = 0; i < numSamples; i++)
+	{
+		float xi0, xi1;
+		Hammersley(xi0, xi1, i, numSamples);
+		float phi = tMath::TwoPi * xi0;
+		float cosTheta = tMath::tSqrt((1.0f - xi1) / (1.0f + (alpha2 - 1.0f)*xi1));
+		float sinTheta = tMath::tSqrt(tMath::tMax(1.0f - cosTheta*cosTheta, 0.0f));
+		tVector3 h(sinTheta*tMath::tCos(phi), sinTheta*tMath::tSin(phi), cosTheta);
+
+		// Reflect the view direction (0,0,1) about h.
+		tVector3 l(2.0f*cosTheta*h.x, 2.0f*cosTheta*h.y, 2.0f*cosTheta*cosTheta - 1.0f);
+		float nol = l.z;
+		if (nol <= 0.0f)
+			continue;
+
+		float denom = (alpha2 - 1.0f)*cosTheta*cosTheta + 1.0f;
+		float d = alpha2 / (tMath::Pi * denom*denom);
+		samples[count].Dir = l;
+		samples[count].Weight = nol;
+		samples[count].Lod = GetSampleLod(d*0.25f, numSamples, texelSolidAngle, numLevels);
+		count++;
+	}
+	return count;
+}
+
+
+int tEnv::ComputeIrradianceSamples(Sample* samples, int numSamples, float texelSolidAngle, int numLevels)
+{
+	// Cosine-weighted hemisphere directions. The pdf is cos(theta)/pi which cancels the cosine in the integrand, so the
+	// weights are all equal.
+	for (int i = 0; i < numSamples; i++)
+	{
+		float xi0, xi1;
+		Hammersley(xi0, xi1, i, numSamples);
+		float phi = tMath::TwoPi * xi0;
+		float cosTheta = tMath::tSqrt(1.0f - xi1);
+		float sinTheta = tMath::tSqrt(xi1);
+		samples[i].Dir = tVector3(sinTheta*tMath::tCos(phi), sinTheta*tMath::tSin(phi), cosTheta);
+		samples[i].Weight = 1.0f;
+		samples[i].Lod = GetSampleLod(cosTheta / tMath::Pi, numSamples, texelSolidAngle, numLevels);
+	}
+	return numSamples;
+}
+
+
+tColour4f tEnv::Filter(const SourceCube& source, const tVector3& dir, const Sample* samples, int numSamples)
+{
+	tVector3 up = (tMath::tAbs(dir.z) < 0.999f) ? tVector3(0.0f, 0.0f, 1.0f) : tVector3(1.0f, 0.0f, 0.0f);
+	tVector3 tangent = up % dir;
+	tangent.Normalize();
+	tVector3 bitangent = dir % tangent;
+
+	Vec4 sum = Zero();
+	float totalWeight = 0.0f;
+	for (int i = 0; i < numSamples; i++)
+	{
+		const Sample& sample = samples[i];
+		tVector3 l = sample.Dir.x*tangent + sample.Dir.y*bitangent + sample.Dir.z*dir;
+		sum = MulAdd(sum, source.Sample(l, sample.Lod), sample.Weight);
+		totalWeight += sample.Weight;
+	}
+
+	tColour4f result;
+	Store(result, Scale(sum, (totalWeight > 0.0f) ? 1.0f/totalWeight : 0.0f));
+	result.A = 1.0f;
+	return result;
+}
+
+
+bool tEnv::ValidateFaces(const tPicture4f faces[tFaceIndex_NumFaces])
+{
+	int size = faces[0].GetWidth();
+	if (size < 1)
+		return false;
+
+	for (int f = 0; f < tFaceIndex_NumFaces; f++)
+		if (!faces[f].IsValid() || (faces[f].GetWidth() != size) || (faces[f].GetHeight() != size))
+			return false;
+
+	return true;
+}
+
+
+tLayer* tEnv::CreateLayer(tPixelFormat fmt, int size)
+{
+	int bytesPerPixel = (fmt == tPixelFormat::R32G32B32A32f) ? 16 : 8;
+	uint8* data = new uint8[size*size*bytesPerPixel];
+	return new tLayer(fmt, size, size, data, true);
+}
+
+
+void tEnv::StoreTexel(tLayer* layer, int index, const tColour4f& c)
+{
+	if (layer->PixelFormat == tPixelFormat::R32G32B32A32f)
+	{
+		((tColour4f*)layer->Data)[index] = c;
+		return;
+	}
+
+	uint16* dst = ((uint16*)layer->Data) + index*4;
+	for (int e = 0; e < 4; e++)
+		dst[e] = FloatToHalfRaw(c.E[e]);
+}
+
+
+bool EquirectToCubemap(tPicture4f faces[tFaceIndex_NumFaces], const tPicture4f& panorama, int faceSize, int numThreads)
+{
+	if (!panorama.IsValid() || (faceSize < 1))
+		return false;
+
+	for (int f = 0; f < tFaceIndex_NumFaces; f++)
+		faces[f].Set(faceSize, faceSize);
+
+	int panW = panorama.GetWidth();
+	int panH = panorama.GetHeight();
+	const tColour4f* src = panorama.GetPixels();
+	tSystem::tParallelFor
+	(
+		tFaceIndex_NumFaces*faceSize,
+		[&](int begin, int end)
+		{
+			for (int row = begin; row < end; row++)
+			{
+				int f = row / faceSize;
+				int y = row % faceSize;
+				tColour4f* dst = faces[f].GetPixels() + y*faceSize;
+				for (int x = 0; x < faceSize; x++)
+				{
+					tVector3 dir = tEnv::TexelDirection(f, x, y, faceSize);
+
+					// Longitude wraps. Latitude is clamped at the poles.
+					float u = 0.5f + tMath::tArcTan(dir.x, dir.z) / tMath::TwoPi;
+					float v = tMath::tArcCos(tMath::tClamp(dir.y, -1.0f, 1.0f)) / tMath::Pi;
+					float fx = u*float(panW) - 0.5f;
+					float fy = tMath::tClamp(float(panH) - 0.5f - v*float(panH), 0.0f, float(panH - 1));
+
+					float flx = tMath::tFloor(fx);
+					int x0 = int(flx);
+					float wx = fx - flx;
+					int x1 = x0 + 1;
+					x0 = ((x0 % panW) + panW) % panW;
+					x1 = ((x1 % panW) + panW) % panW;
+					int y0 = int(fy);
+					int y1 = tMath::tMin(y0 + 1, panH - 1);
+					float wy = fy - float(y0);
+
+					tEnv::Vec4 bottom = tEnv::Lerp(tEnv::Load(src[y0*panW + x0]), tEnv::Load(src[y0*panW + x1]), wx);
+					tEnv::Vec4 top = tEnv::Lerp(tEnv::Load(src[y1*panW + x0]), tEnv::Load(src[y1*panW + x1]), wx);
+					tEnv::Store(dst[x], tEnv::Lerp(bottom, top, wy));
+				}
+			}
+		},
+		numThreads
+	);
+
+	return true;
+}
+
+
+bool PrefilterSpecular(tList<tLayer> layers[tFaceIndex_NumFaces], const tPicture4f faces[tFaceIndex_NumFaces], const tEnvMapParams& params)
+{
+	if (!tEnv::ValidateFaces(faces) || !tEnv::IsValidFormat(params.PixelFormat) || (params.NumSpecularSamples < 1))
+		return false;
+
+	int size = faces[0].GetWidth();
+	int fullChain = tMath::tLog2(size) + 1;
+	int numMipmaps = ((params.NumSpecularMipmaps <= 0) || (params.NumSpecularMipmaps > fullChain)) ? fullChain : params.NumSpecularMipmaps;
+
+	// Mipmap 0 has zero roughness so it is the source. The alpha is forced to 1 to match the filtered mipmaps.
+	tLayer* mipLayers[32][tFaceIndex_NumFaces];
+	for (int f = 0; f < tFaceIndex_NumFaces; f++)
+	{
+		layers[f].Empty();
+		for (int m = 0; m < numMipmaps; m++)
+		{
+			mipLayers[m][f] = tEnv::CreateLayer(params.PixelFormat, tMath::tMax(size >> m, 1));
+			layers[f].Append(mipLayers[m][f]);
+		}
+
+		const tColour4f* src = faces[f].GetPixels();
+		for (int p = 0; p < size*size; p++)
+		{
+			tColour4f c = src[p];
+			c.A = 1.0f;
+			tEnv::StoreTexel(mipLayers[0][f], p, c);
+		}
+	}
+	if (numMipmaps == 1)
+		return true;
+
+	tEnv::SourceCube source(faces, params.NumThreads);
+	float texelSolidAngle = 4.0f*tMath::Pi / (6.0f*float(size)*float(size));
+	int numSamples = params.NumSpecularSamples;
+	tEnv::Sample* samples = new tEnv::Sample[(numMipmaps-1)*numSamples];
+	int sampleCounts[32];
+	int texelOffsets[32];
+	int numTexels = 0;
+	for (int m = 1; m < numMipmaps; m++)
+	{
+		float roughness = float(m) / float(numMipmaps - 1);
+		sampleCounts[m] = tEnv::ComputeSpecularSamples(samples + (m-1)*numSamples, numSamples, roughness, texelSolidAngle, source.NumLevels);
+		texelOffsets[m] = numTexels;
+		int mipSize = tMath::tMax(size >> m, 1);
+		numTexels += tFaceIndex_NumFaces*mipSize*mipSize;
+	}
+	texelOffsets[numMipmaps] = numTexels;
+
+	// Every texel of every filtered mipmap costs the same so they are all flattened into one range. This keeps all the
+	// threads busy even for the small mipmaps.
+	tSystem::tParallelFor
+	(
+		numTexels,
+		[&](int begin, int end)
+		{
+			int m = 1;
+			for (int i = begin; i < end; i++)
+			{
+				while (i >= texelOffsets[m+1])
+					m++;
+
+				int mipSize = tMath::tMax(size >> m, 1);
+				int local = i - texelOffsets[m];
+				int f = local / (mipSize*mipSize);
+				int p = local % (mipSize*mipSize);
+				tVector3 dir = tEnv::TexelDirection(f, p % mipSize, p / mipSize, mipSize);
+				tColour4f c = tEnv::Filter(source, dir, samples + (m-1)*numSamples, sampleCounts[m]);
+				tEnv::StoreTexel(mipLayers[m][f], p, c);
+			}
+		},
+		params.NumThreads
+	);
+
+	delete[] samples;
+	return true;
+}
+
+
+bool ComputeIrradiance(tList<tLayer> layers[tFaceIndex_NumFaces], const tPicture4f faces[tFaceIndex_NumFaces], const tEnvMapParams& params)
+{
+	if
+	(
+		!tEnv::ValidateFaces(faces) || !tEnv::IsValidFormat(params.PixelFormat) ||
+		(params.IrradianceSize < 1) || (params.NumIrradianceSamples < 1)
+	)
+		return false;
+
+	tEnv::SourceCube source(faces, params.NumThreads);
+	int srcSize = faces[0].GetWidth();
+	float texelSolidAngle = 4.0f*tMath::Pi / (6.0f*float(srcSize)*float(srcSize));
+	int numSamples = params.NumIrradianceSamples;
+	tEnv::Sample* samples = new tEnv::Sample[numSamples];
+	tEnv::ComputeIrradianceSamples(samples, numSamples, texelSolidAngle, source.NumLevels);
+
+	int size = params.IrradianceSize;
+	tLayer* faceLayers[tFaceIndex_NumFaces];
+	for (int f = 0; f < tFaceIndex_NumFaces; f++)
+	{
+		layers[f].Empty();
+		faceLayers[f] = tEnv::CreateLayer(params.PixelFormat, size);
+		layers[f].Append(faceLayers[f]);
+	}
+
+	tSystem::tParallelFor
+	(
+		tFaceIndex_NumFaces*size*size,
+		[&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				int f = i / (size*size);
+				int p = i % (size*size);
+				tVector3 dir = tEnv::TexelDirection(f, p % size, p / size, size);
+				tEnv::StoreTexel(faceLayers[f], p, tEnv::Filter(source, dir, samples, numSamples));
+			}
+		},
+		params.NumThreads
+	);
+
+	delete[] samples;
+	return true;
+}
+
+
+}
@@ -13,9 +13,11 @@
 // AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <zlib.h>
 #include <Foundation/tStandard.h>
 #include <Foundation/tString.h>
 #include <System/tFile.h>
+#include <System/tThread.h>
 #include "Image/tImageAPNG.h"
 #include "Image/tPicture.h"
 #include "apngdis.h"
@@ -25,42 +27,697 @@ namespace tImage
 {
 
 
-bool tImageAPNG::IsAnimatedPNG(const tString& pngFile)
+namespace tAPNG
 {
-	int numBytes = 2048;
+	// PNG stores all multi-byte integers big-endian.
+	uint32 GetU32(const uint8* src)																						{ return (uint32(src[0]) << 24) | (uint32(src[1]) << 16) | (uint32(src[2]) << 8) | uint32(src[3]); }
+	uint16 GetU16(const uint8* src)																						{ return uint16((src[0] << 8) | src[1]); }
+	void PutU32(uint8* dst, uint32 v)																					{ dst[0] = uint8(v >> 24); dst[1] = uint8(v >> 16); dst[2] = uint8(v >> 8); dst[3] = uint8(v); }
+	void PutU16(uint8* dst, uint16 v)																					{ dst[0] = uint8(v >> 8); dst[1] = uint8(v); }
+
+	enum DisposeOp																										{ DisposeOp_None, DisposeOp_Background, DisposeOp_Previous };
+	enum BlendOp																										{ BlendOp_Source, BlendOp_Over };
+
+	// Converts an fcTL delay fraction to seconds and a tFrame duration to an fcTL numerator in milliseconds.
+	float GetDuration(uint delayNum, uint delayDen);
+	uint16 GetDelayNumerator(const tFrame*, int overrideFrameDuration);
+
+	// A frame rectangle as stored in the file. Coordinates are in PNG space where y increases downwards. When saving,
+	// Data is the compressed and filtered rectangle. When loading, Spans point to the IDAT or fdAT payloads in the
+	// file and Pixels receives the decoded rectangle, top row first.
+	struct RectFrame
+	{
+		RectFrame()																										: X(0), Y(0), W(0), H(0), DelayNum(0), DelayDen(0), DisposeOp(DisposeOp_None), BlendOp(BlendOp_Source), Data(nullptr), NumBytes(0), Pixels(nullptr) { }
+		~RectFrame()																									{ delete[] Data; delete[] Pixels; }
 
-	// Remember, tLoadFileHead modifies numBytes if the file is smaller than the head-size requested.
-	uint8* headData = tSystem::tLoadFileHead(pngFile, numBytes);
-	if (!headData)
+		int X, Y, W, H;
+		uint DelayNum, DelayDen;
+		int DisposeOp, BlendOp;
+
+		uint8* Data;
+		int NumBytes;
+
+		std::vector<std::pair<const uint8*, int>> Spans;
+		tPixel4b* Pixels;
+	};
+
+	// Computes the smallest rectangle containing every pixel of curr that differs from prev. Only RGB is compared when
+	// bpp is 3. If the frames are identical a 1x1 rectangle at the origin is returned since APNG frames can't be empty.
+	void GetDirtyRect(RectFrame&, const tFrame* prev, const tFrame* curr, int bpp);
+
+	// Filters and deflates the rectangle of the frame into rect.Data. Like apngasm, both an unfiltered and an
+	// adaptively filtered version are tried at a fast compression level and the smaller is recompressed at the best
+	// level. Returns success.
+	bool CompressRect(RectFrame&, const tFrame*, int bpp);
+	uint8* Deflate(int& numBytes, const uint8* src, int srcBytes, int level, int strategy);
+	uint8 PaethPredictor(int a, int b, int c);
+
+	// Writes a chunk including its length and CRC. If sequence is >= 0 it is written as the first 4 bytes of the data.
+	bool WriteChunk(tFileHandle, const char* type, const uint8* data, int numBytes, int sequence = -1);
+	bool SaveFrames(const tString& apngFile, const tList<tFrame>&, int bpp, int overrideFrameDuration, int numThreads);
+
+	// Finds the frames of an 8-bit RGB or RGBA, non-interlaced APNG whose default image is the first frame. Returns
+	// false for anything else so the caller can fall back to apngdis.
+	bool ParseFrames(std::vector<RectFrame>&, int& width, int& height, int& bpp, const uint8* data, int numBytes);
+
+	// Inflates and unfilters the frame's spans into rect.Pixels. Returns success.
+	bool DecodeRect(RectFrame&, int bpp);
+
+	// Composites the decoded rectangle onto a bottom-up canvas. The over operation matches apngdis exactly.
+	void BlendRect(tPixel4b* canvas, int width, int height, const RectFrame&);
+
+	// Decodes with the tacent decoder or apngdis respectively. Frames is left empty if false is returned.
+	bool DecodeFrames(tList<tFrame>& frames, const tString& apngFile);
+	bool DisassembleFrames(tList<tFrame>& frames, const tString& apngFile);
+}
+
+
+float tAPNG::GetDuration(uint delayNum, uint delayDen)
+{
+	// From the official apng spec:
+	// The delay_num and delay_den parameters together specify a fraction indicating the time to display
+	// the current frame, in seconds. If the denominator is 0, it is to be treated as if it were 100 (that
+	// is, delay_num then specifies 1/100ths of a second). If the the value of the numerator is 0 the decoder
+	// should render the next frame as quickly as possible, though viewers may impose a reasonable lower bound.
+	if (delayDen == 0)
+		delayDen = 100;
+	return (delayNum == 0) ? 1.0f/60.0f : float(delayNum) / float(delayDen);
+}
+
+
+uint16 tAPNG::GetDelayNumerator(const tFrame* frame, int overrideFrameDuration)
+{
+	// Default is numerator = 0. Fast as possible. Use when frameDur = 0. The denominator is always 1000.
+	uint delayNumer = 0;
+	if (overrideFrameDuration < 0)
+	{
+		// We use milliseconds here since the apng format uses 16bit unsigned (65535 max) for numerator and denominator.
+		// A max numerator of 65535 gives us ~65 seconds max per frame, which seems reasonable.
+		float frameDur = frame->Duration;
+		if (frameDur > 0.0f)
+			delayNumer = uint(frameDur * 1000.0f);
+	}
+	else
+	{
+		if (overrideFrameDuration > 0)
+			delayNumer = overrideFrameDuration;
+	}
+	return uint16(tMath::tMin(delayNumer, 65535u));
+}
+
+
+void tAPNG::GetDirtyRect(RectFrame& rect, const tFrame* prev, const tFrame* curr, int bpp)
+{
+	int width = curr->Width;
+	int height = curr->Height;
+	uint32 mask = (bpp == 4) ? 0xFFFFFFFF : tColour4b(255, 255, 255, 0).BP;
+
+	// Rows are bottom-up in tFrames. We track the extents in tFrame space and flip at the end.
+	int minX = width; int maxX = -1;
+	int minR = height; int maxR = -1;
+	for (int r = 0; r < height; r++)
+	{
+		const tPixel4b* prevRow = prev->Pixels + r*width;
+		const tPixel4b* currRow = curr->Pixels + r*width;
+		if ((bpp == 4) && (tStd::tMemcmp(prevRow, currRow, width*sizeof(tPixel4b)) == 0))
+			continue;
+
+		int left = 0;
+		while ((left < width) && !((prevRow[left].BP ^ currRow[left].BP) & mask))
+			left++;
+		if (left == width)
+			continue;
+
+		int right = width-1;
+		while (!((prevRow[right].BP ^ currRow[right].BP) & mask))
+			right--;
+
+		minX = tMath::tMin(minX, left);		maxX = tMath::tMax(maxX, right);
+		minR = tMath::tMin(minR, r);		maxR = tMath::tMax(maxR, r);
+	}
+
+	if (maxX < 0)
+	{
+		rect.X = 0; rect.Y = 0; rect.W = 1; rect.H = 1;
+		return;
+	}
+
+	rect.X = minX;
+	rect.W = maxX - minX + 1;
+	rect.Y = (height-1) - maxR;
+	rect.H = maxR - minR + 1;
+}
+
+
+uint8 tAPNG::PaethPredictor(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = tMath::tAbs(p - a);
+	int pb = tMath::tAbs(p - b);
+	int pc = tMath::tAbs(p - c);
+	if ((pa <= pb) && (pa <= pc))
+		return uint8(a);
+	return (pb <= pc) ? uint8(b) : uint8(c);
+}
+
+
+uint8* tAPNG::Deflate(int& numBytes, const uint8* src, int srcBytes, int level, int strategy)
+{
+	numBytes = 0;
+	z_stream stream;
+	tStd::tMemset(&stream, 0, sizeof(stream));
+	if (deflateInit2(&stream, level, Z_DEFLATED, 15, 8, strategy) != Z_OK)
+		return nullptr;
+
+	int dstBytes = int(deflateBound(&stream, srcBytes));
+	uint8* dst = new uint8[dstBytes];
+	stream.next_in		= (Bytef*)src;
+	stream.avail_in		= srcBytes;
+	stream.next_out		= dst;
+	stream.avail_out	= dstBytes;
+	if (deflate(&stream, Z_FINISH) == Z_STREAM_END)
+		numBytes = int(stream.total_out);
+	deflateEnd(&stream);
+
+	if (!numBytes)
+	{
+		delete[] dst;
+		return nullptr;
+	}
+	return dst;
+}
+
+
+bool tAPNG::CompressRect(RectFrame& rect, const tFrame* frame, int bpp)
+{
+	int rowBytes = rect.W*bpp;
+	int rawBytes = (rowBytes+1) * rect.H;
+	uint8* unfiltered = new uint8[rawBytes];
+	uint8* filtered = new uint8[rawBytes];
+	uint8* candidates = new uint8[rowBytes*4];
+
+	for (int y = 0; y < rect.H; y++)
+	{
+		const tPixel4b* src = frame->Pixels + ((frame->Height-1) - (rect.Y+y))*frame->Width + rect.X;
+		uint8* raw = unfiltered + y*(rowBytes+1) + 1;
+		unfiltered[y*(rowBytes+1)] = 0;
+		for (int x = 0; x < rect.W; x++)
+			tStd::tMemcpy(raw + x*bpp, &src[x], bpp);
+
+		// Try sub, up, average, and paeth, and keep whichever has the smallest sum of absolute values. This is the
+		// same heuristic libpng uses. The previous row of the first row is all zeros.
+		const uint8* up = y ? raw - (rowBytes+1) : nullptr;
+		uint8* dst = filtered + y*(rowBytes+1);
+		int bestFilter = 0;
+		int bestSum = 0;
+		for (int i = 0; i < rowBytes; i++)
+			bestSum += tMath::tAbs(int(int8(raw[i])));
+
+		for (int f = 1; f <= 4; f++)
+		{
+			uint8* cand = candidates + (f-1)*rowBytes;
+			int sum = 0;
+			for (int i = 0; i < rowBytes; i++)
+			{
+				int a = (i >= bpp) ? raw[i-bpp] : 0;
+				int b = up ? up[i] : 0;
+				int c = (up && (i >= bpp)) ? up[i-bpp] : 0;
+				uint8 pred = 0;
+				switch (f)
+				{
+					case 1: pred = uint8(a);					break;
+					case 2: pred = uint8(b);					break;
+					case 3: pred = uint8((a+b) >> 1);			break;
+					case 4: pred = PaethPredictor(a, b, c);		break;
+				}
+				cand[i] = raw[i] - pred;
+				sum += tMath::tAbs(int(int8(cand[i])));
+			}
+			if (sum < bestSum)
+			{
+				bestSum = sum;
+				bestFilter = f;
+			}
+		}
+
+		dst[0] = uint8(bestFilter);
+		tStd::tMemcpy(dst+1, bestFilter ? candidates + (bestFilter-1)*rowBytes : raw, rowBytes);
+	}
+	delete[] candidates;
+
+	int unfilteredSize = 0; int filteredSize = 0;
+	delete[] Deflate(unfilteredSize, unfiltered, rawBytes, Z_BEST_SPEED+1, Z_DEFAULT_STRATEGY);
+	delete[] Deflate(filteredSize, filtered, rawBytes, Z_BEST_SPEED+1, Z_FILTERED);
+	bool useFiltered = filteredSize && (!unfilteredSize || (filteredSize < unfilteredSize));
+	rect.Data = useFiltered ?
+		Deflate(rect.NumBytes, filtered, rawBytes, Z_BEST_COMPRESSION, Z_FILTERED) :
+		Deflate(rect.NumBytes, unfiltered, rawBytes, Z_BEST_COMPRESSION, Z_DEFAULT_STRATEGY);
+
+	delete[] unfiltered;
+	delete[] filtered;
+	return rect.Data ? true : false;
+}
+
+
+bool tAPNG::WriteChunk(tFileHandle file, const char* type, const uint8* data, int numBytes, int sequence)
+{
+	uint8 header[12];
+	int headerBytes = (sequence >= 0) ? 12 : 8;
+	PutU32(header, uint32(numBytes + headerBytes - 8));
+	tStd::tMemcpy(header+4, type, 4);
+	if (sequence >= 0)
+		PutU32(header+8, uint32(sequence));
+
+	uint32 crc = crc32(0, header+4, headerBytes-4);
+	crc = crc32(crc, data, numBytes);
+	uint8 footer[4];
+	PutU32(footer, crc);
+
+	return
+		(tWriteFile(file, header, headerBytes) == headerBytes) &&
+		(tWriteFile(file, data, numBytes) == numBytes) &&
+		(tWriteFile(file, footer, 4) == 4);
+}
+
+
+bool tAPNG::SaveFrames(const tString& apngFile, const tList<tFrame>& frameList, int bpp, int overrideFrameDuration, int numThreads)
+{
+	int numFrames = frameList.GetNumItems();
+	const tFrame** frames = new const tFrame*[numFrames];
+	int index = 0;
+	for (const tFrame* frame = frameList.Head(); frame; frame = frame->Next())
+		frames[index++] = frame;
+
+	int width = frames[0]->Width;
+	int height = frames[0]->Height;
+
+	// The rectangle for a frame only depends on it and the frame before, so every frame can be diffed and compressed
+	// independently. With dispose none and blend source the canvas after each frame is exactly that frame.
+	RectFrame* rects = new RectFrame[numFrames];
+	tParallelFor
+	(
+		numFrames,
+		[frames, rects, bpp, overrideFrameDuration, width, height](int begin, int end)
+		{
+			for (int f = begin; f < end; f++)
+			{
+				RectFrame& rect = rects[f];
+				if (f == 0)
+				{
+					rect.W = width;
+					rect.H = height;
+				}
+				else
+				{
+					GetDirtyRect(rect, frames[f-1], frames[f], bpp);
+				}
+				rect.DelayNum = GetDelayNumerator(frames[f], overrideFrameDuration);
+				rect.DelayDen = 1000;
+				CompressRect(rect, frames[f], bpp);
+			}
+		},
+		numThreads
+	);
+	delete[] frames;
+
+	bool success = true;
+	for (int f = 0; f < numFrames; f++)
+		success = success && rects[f].Data;
+
+	tFileHandle file = success ? tOpenFile(apngFile.Chr(), "wb") : nullptr;
+	if (!file)
+	{
+		delete[] rects;
 		return false;
+	}
 
-	uint8 acTL[] = { 'a', 'c', 'T', 'L' };
-	uint8 IDAT[] = { 'I', 'D', 'A', 'T' };
-	uint8* actlLoc = (uint8*)tStd::tMemsrch(headData, numBytes, acTL, sizeof(acTL));
-	if (!actlLoc)
+	const uint8 signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	success = (tWriteFile(file, signature, sizeof(signature)) == sizeof(signature));
+
+	uint8 ihdr[13];
+	PutU32(ihdr+0, width);
+	PutU32(ihdr+4, height);
+	ihdr[8] = 8;								// Bit depth.
+	ihdr[9] = (bpp == 4) ? 6 : 2;				// Colour type RGBA or RGB.
+	ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;	// Compression, filter, and interlace methods.
+	success = success && WriteChunk(file, "IHDR", ihdr, sizeof(ihdr));
+
+	// A single frame is written as a plain png.
+	bool animated = (numFrames > 1);
+	if (animated)
+	{
+		uint8 actl[8];
+		PutU32(actl+0, numFrames);
+		PutU32(actl+4, 0);						// Loop forever.
+		success = success && WriteChunk(file, "acTL", actl, sizeof(actl));
+	}
+
+	int sequence = 0;
+	for (int f = 0; (f < numFrames) && success; f++)
+	{
+		const RectFrame& rect = rects[f];
+		if (animated)
+		{
+			uint8 fctl[26];
+			PutU32(fctl+0, sequence++);
+			PutU32(fctl+4, rect.W);
+			PutU32(fctl+8, rect.H);
+			PutU32(fctl+12, rect.X);
+			PutU32(fctl+16, rect.Y);
+			PutU16(fctl+20, uint16(rect.DelayNum));
+			PutU16(fctl+22, uint16(rect.DelayDen));
+			fctl[24] = DisposeOp_None;
+			fctl[25] = BlendOp_Source;
+			success = WriteChunk(file, "fcTL", fctl, sizeof(fctl));
+		}
+
+		if (f == 0)
+			success = success && WriteChunk(file, "IDAT", rect.Data, rect.NumBytes);
+		else
+			success = success && WriteChunk(file, "fdAT", rect.Data, rect.NumBytes, sequence++);
+	}
+
+	success = success && WriteChunk(file, "IEND", nullptr, 0);
+	tCloseFile(file);
+	delete[] rects;
+	return success;
+}
+
+
+bool tAPNG::ParseFrames(std::vector<RectFrame>& frames, int& width, int& height, int& bpp, const uint8* data, int numBytes)
+{
+	const uint8 signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	if ((numBytes < 8+25) || tStd::tMemcmp(data, signature, 8))
 		return false;
 
-	// Now for safety we also make sure there is an IDAT after the acTL.
-	uint8* idatLoc = (uint8*)tStd::tMemsrch(actlLoc+sizeof(acTL), numBytes - (actlLoc-headData) - sizeof(acTL), IDAT, sizeof(IDAT));
+	const uint8* ihdr = data + 8;
+	if ((GetU32(ihdr) != 13) || tStd::tMemcmp(ihdr+4, "IHDR", 4))
+		return false;
 
-	bool found = idatLoc ? true : false;
-	delete[] headData;
-	return found;
+	width = int(GetU32(ihdr+8));
+	height = int(GetU32(ihdr+12));
+	int bitDepth = ihdr[16];
+	int colourType = ihdr[17];
+	int interlace = ihdr[20];
+	if ((width <= 0) || (height <= 0) || (int64(width)*int64(height) > (1 << 28)))
+		return false;
+	if ((bitDepth != 8) || ((colourType != 2) && (colourType != 6)) || (interlace != 0))
+		return false;
+	bpp = (colourType == 6) ? 4 : 3;
+
+	bool animated = false;
+	bool ended = false;
+	const uint8* chunk = ihdr + 25;
+	const uint8* end = data + numBytes;
+	while (!ended && (end - chunk >= 12))
+	{
+		uint32 length = GetU32(chunk);
+		if (length > uint32(end - chunk - 12))
+			return false;
+		const uint8* type = chunk + 4;
+		const uint8* payload = chunk + 8;
+		chunk += length + 12;
+
+		if (!tStd::tMemcmp(type, "acTL", 4))
+		{
+			animated = true;
+		}
+		else if (!tStd::tMemcmp(type, "fcTL", 4))
+		{
+			if (!animated || (length != 26))
+				return false;
+
+			frames.emplace_back();
+			RectFrame& rect = frames.back();
+			rect.W			= int(GetU32(payload+4));
+			rect.H			= int(GetU32(payload+8));
+			rect.X			= int(GetU32(payload+12));
+			rect.Y			= int(GetU32(payload+16));
+			rect.DelayNum	= GetU16(payload+20);
+			rect.DelayDen	= GetU16(payload+22);
+			rect.DisposeOp	= payload[24];
+			rect.BlendOp	= payload[25];
+			if
+			(
+				(rect.W <= 0) || (rect.H <= 0) || (rect.X < 0) || (rect.Y < 0) ||
+				(int64(rect.X) + rect.W > width) || (int64(rect.Y) + rect.H > height) ||
+				(rect.DisposeOp > DisposeOp_Previous) || (rect.BlendOp > BlendOp_Over)
+			)
+				return false;
+
+			// There is nothing to blend with or restore to for the first frame.
+			if (frames.size() == 1)
+			{
+				rect.BlendOp = BlendOp_Source;
+				if (rect.DisposeOp == DisposeOp_Previous)
+					rect.DisposeOp = DisposeOp_Background;
+			}
+		}
+		else if (!tStd::tMemcmp(type, "IDAT", 4))
+		{
+			// A default image that is not part of the animation is left to apngdis.
+			if (frames.size() != 1)
+				return false;
+			frames.back().Spans.push_back(std::make_pair(payload, int(length)));
+		}
+		else if (!tStd::tMemcmp(type, "fdAT", 4))
+		{
+			if ((frames.size() < 2) || (length < 4))
+				return false;
+			frames.back().Spans.push_back(std::make_pair(payload+4, int(length-4)));
+		}
+		else if (!tStd::tMemcmp(type, "tRNS", 4) || !tStd::tMemcmp(type, "PLTE", 4))
+		{
+			return false;
+		}
+		else if (!tStd::tMemcmp(type, "IEND", 4))
+		{
+			ended = true;
+		}
+	}
+
+	if (!animated || frames.empty())
+		return false;
+	for (const RectFrame& rect : frames)
+		if (rect.Spans.empty())
+			return false;
+
+	return true;
 }
 
 
-bool tImageAPNG::Load(const tString& apngFile)
+bool tAPNG::DecodeRect(RectFrame& rect, int bpp)
 {
-	Clear();
+	int rowBytes = rect.W*bpp;
+	int rawBytes = (rowBytes+1) * rect.H;
+	uint8* raw = new uint8[rawBytes];
 
-	// Note that many apng files still have a .png extension/filetype, so we support both here.
-	tSystem::tFileType filetype = tSystem::tGetFileType(apngFile);
-	if ((filetype != tSystem::tFileType::APNG) && (filetype != tSystem::tFileType::PNG))
+	z_stream stream;
+	tStd::tMemset(&stream, 0, sizeof(stream));
+	if (inflateInit(&stream) != Z_OK)
+	{
+		delete[] raw;
+		return false;
+	}
+	stream.next_out = raw;
+	stream.avail_out = rawBytes;
+	int result = Z_OK;
+	for (int s = 0; (s < int(rect.Spans.size())) && (result == Z_OK); s++)
+	{
+		stream.next_in = (Bytef*)rect.Spans[s].first;
+		stream.avail_in = rect.Spans[s].second;
+		result = inflate(&stream, Z_NO_FLUSH);
+		if ((result == Z_BUF_ERROR) && stream.avail_out)
+			result = Z_OK;
+	}
+	bool complete = (stream.avail_out == 0) && ((result == Z_OK) || (result == Z_STREAM_END));
+	inflateEnd(&stream);
+	if (!complete)
+	{
+		delete[] raw;
 		return false;
+	}
 
-	if (!tFileExists(apngFile))
+	rect.Pixels = new tPixel4b[rect.W*rect.H];
+	const uint8* up = nullptr;
+	for (int y = 0; y < rect.H; y++)
+	{
+		uint8* row = raw + y*(rowBytes+1) + 1;
+		int filter = row[-1];
+		if (filter > 4)
+		{
+			delete[] raw;
+			delete[] rect.Pixels;
+			rect.Pixels = nullptr;
+			return false;
+		}
+
+		// The row before the first is treated as all zeros, which turns up into none and paeth into sub.
+		if (!up && (filter == 2))
+			filter = 0;
+		else if (!up && (filter == 4))
+			filter = 1;
+
+		switch (filter)
+		{
+			case 1:
+				for (int i = bpp; i < rowBytes; i++)
+					row[i] += row[i-bpp];
+				break;
+
+			case 2:
+				for (int i = 0; i < rowBytes; i++)
+					row[i] += up[i];
+				break;
+
+			case 3:
+				for (int i = 0; i < rowBytes; i++)
+					row[i] += uint8((((i >= bpp) ? row[i-bpp] : 0) + (up ? up[i] : 0)) >> 1);
+				break;
+
+			case 4:
+				for (int i = 0; i < bpp; i++)
+					row[i] += up[i];
+				for (int i = bpp; i < rowBytes; i++)
+					row[i] += PaethPredictor(row[i-bpp], up[i], up[i-bpp]);
+				break;
+		}
+
+		tPixel4b* dst = rect.Pixels + y*rect.W;
+		for (int x = 0; x < rect.W; x++)
+			dst[x].Set(row[x*bpp+0], row[x*bpp+1], row[x*bpp+2], (bpp == 4) ? row[x*bpp+3] : uint8(255));
+		up = row;
+	}
+
+	delete[] raw;
+	return true;
+}
+
+
+void tAPNG::BlendRect(tPixel4b* canvas, int width, int height, const RectFrame& rect)
+{
+	for (int y = 0; y < rect.H; y++)
+	{
+		const tPixel4b* src = rect.Pixels + y*rect.W;
+		tPixel4b* dst = canvas + ((height-1) - (rect.Y+y))*width + rect.X;
+		if (rect.BlendOp == BlendOp_Source)
+		{
+			tStd::tMemcpy(dst, src, rect.W*sizeof(tPixel4b));
+			continue;
+		}
+
+		for (int x = 0; x < rect.W; x++)
+		{
+			const tPixel4b& s = src[x];
+			tPixel4b& d = dst[x];
+			if ((s.A == 255) || ((s.A != 0) && (d.A == 0)))
+			{
+				d = s;
+			}
+			else if (s.A != 0)
+			{
+				int u = s.A*255;
+				int v = (255-s.A)*d.A;
+				int al = u + v;
+				d.R = uint8((s.R*u + d.R*v) / al);
+				d.G = uint8((s.G*u + d.G*v) / al);
+				d.B = uint8((s.B*u + d.B*v) / al);
+				d.A = uint8(al/255);
+			}
+		}
+	}
+}
+
+
+bool tAPNG::DecodeFrames(tList<tFrame>& frameList, const tString& apngFile)
+{
+	int numBytes = 0;
+	uint8* data = tLoadFile(apngFile, nullptr, &numBytes);
+	if (!data)
 		return false;
 
+	std::vector<RectFrame> frames;
+	int width = 0; int height = 0; int bpp = 0;
+	if (!ParseFrames(frames, width, height, bpp, data, numBytes))
+	{
+		delete[] data;
+		return false;
+	}
+
+	// Frames are decoded concurrently in batches and then composited in order. Batching bounds how many decoded
+	// rectangles are alive at once. Compositing only touches each frame's rectangle on the canvas.
+	int numFrames = int(frames.size());
+	int batchSize = 4*tGetNumWorkerThreads(numFrames);
+	tPixel4b* canvas = new tPixel4b[width*height];
+	tStd::tMemset(canvas, 0, width*height*sizeof(tPixel4b));
+	tPixel4b* previous = nullptr;
+	bool success = true;
+	for (int batch = 0; (batch < numFrames) && success; batch += batchSize)
+	{
+		int batchCount = tMath::tMin(batchSize, numFrames - batch);
+		tParallelFor
+		(
+			batchCount,
+			[&frames, batch, bpp](int begin, int end)
+			{
+				for (int f = batch+begin; f < batch+end; f++)
+					DecodeRect(frames[f], bpp);
+			}
+		);
+
+		for (int f = batch; (f < batch+batchCount) && success; f++)
+		{
+			RectFrame& rect = frames[f];
+			success = rect.Pixels ? true : false;
+			if (!success)
+				break;
+
+			if (rect.DisposeOp == DisposeOp_Previous)
+			{
+				delete[] previous;
+				previous = new tPixel4b[rect.W*rect.H];
+				for (int y = 0; y < rect.H; y++)
+					tStd::tMemcpy(previous + y*rect.W, canvas + ((height-1) - (rect.Y+y))*width + rect.X, rect.W*sizeof(tPixel4b));
+			}
+
+			BlendRect(canvas, width, height, rect);
+
+			tFrame* newFrame = new tFrame;
+			newFrame->Width = width;
+			newFrame->Height = height;
+			newFrame->Pixels = new tPixel4b[width*height];
+			newFrame->Duration = GetDuration(rect.DelayNum, rect.DelayDen);
+			tStd::tMemcpy(newFrame->Pixels, canvas, width*height*sizeof(tPixel4b));
+			frameList.Append(newFrame);
+
+			for (int y = 0; y < rect.H; y++)
+			{
+				tPixel4b* dst = canvas + ((height-1) - (rect.Y+y))*width + rect.X;
+				if (rect.DisposeOp == DisposeOp_Background)
+					tStd::tMemset(dst, 0, rect.W*sizeof(tPixel4b));
+				else if (rect.DisposeOp == DisposeOp_Previous)
+					tStd::tMemcpy(dst, previous + y*rect.W, rect.W*sizeof(tPixel4b));
+			}
+
+			delete[] rect.Pixels;
+			rect.Pixels = nullptr;
+		}
+	}
+
+	delete[] previous;
+	delete[] canvas;
+	delete[] data;
+	if (!success)
+	{
+		while (tFrame* frame = frameList.Remove())
+			delete frame;
+	}
+	return success;
+}
+
+
+bool tAPNG::DisassembleFrames(tList<tFrame>& frameList, const tString& apngFile)
+{
 	std::vector<APngDis::Image> frames;
 
 	// We assume here that load_apng can hande UTF-8 filenames.
@@ -78,17 +735,7 @@ bool tImageAPNG::Load(const tString& apngFile)
 		newFrame->Width = width;
 		newFrame->Height = height;
 		newFrame->Pixels = new tPixel4b[width * height];
-
-		// From the official apng spec:
-		// The delay_num and delay_den parameters together specify a fraction indicating the time to display
-		// the current frame, in seconds. If the denominator is 0, it is to be treated as if it were 100 (that
-		// is, delay_num then specifies 1/100ths of a second). If the the value of the numerator is 0 the decoder
-		// should render the next frame as quickly as possible, though viewers may impose a reasonable lower bound.
-		uint dnum = srcFrame.delay_num;
-		uint dden = srcFrame.delay_den;
-		if (dden == 0)
-			dden = 100;
-		newFrame->Duration = (dnum == 0) ? 1.0f/60.0f : float(dnum) / float(dden);
+		newFrame->Duration = GetDuration(srcFrame.delay_num, srcFrame.delay_den);
 
 		tAssert(srcFrame.bpp == 4);
 		for (int r = 0; r < height; r++)
@@ -98,13 +745,59 @@ bool tImageAPNG::Load(const tString& apngFile)
 			tStd::tMemcpy(dstRowData, srcRowData, width*4);
 		}
 
-		Frames.Append(newFrame);
+		frameList.Append(newFrame);
 	}
 
 	for (int f = 0; f < frames.size(); f++)
 		frames[f].free();
 	frames.clear();
 
+	return true;
+}
+
+
+bool tImageAPNG::IsAnimatedPNG(const tString& pngFile)
+{
+	int numBytes = 2048;
+
+	// Remember, tLoadFileHead modifies numBytes if the file is smaller than the head-size requested.
+	uint8* headData = tSystem::tLoadFileHead(pngFile, numBytes);
+	if (!headData)
+		return false;
+
+	uint8 acTL[] = { 'a', 'c', 'T', 'L' };
+	uint8 IDAT[] = { 'I', 'D', 'A', 'T' };
+	uint8* actlLoc = (uint8*)tStd::tMemsrch(headData, numBytes, acTL, sizeof(acTL));
+	if (!actlLoc)
+		return false;
+
+	// Now for safety we also make sure there is an IDAT after the acTL.
+	uint8* idatLoc = (uint8*)tStd::tMemsrch(actlLoc+sizeof(acTL), numBytes - (actlLoc-headData) - sizeof(acTL), IDAT, sizeof(IDAT));
+
+	bool found = idatLoc ? true : false;
+	delete[] headData;
+	return found;
+}
+
+
+bool tImageAPNG::Load(const tString& apngFile, const LoadParams& params)
+{
+	Clear();
+
+	// Note that many apng files still have a .png extension/filetype, so we support both here.
+	tSystem::tFileType filetype = tSystem::tGetFileType(apngFile);
+	if ((filetype != tSystem::tFileType::APNG) && (filetype != tSystem::tFileType::PNG))
+		return false;
+
+	if (!tFileExists(apngFile))
+		return false;
+
+	// The tacent decoder handles the common 8-bit RGB(A) case and returns false for everything else.
+	bool direct = !(params.Flags & LoadFlag_ForceApngDis);
+	bool loaded = (direct && tAPNG::DecodeFrames(Frames, apngFile)) || tAPNG::DisassembleFrames(Frames, apngFile);
+	if (!loaded)
+		return false;
+
 	PixelFormatSrc		= tPixelFormat::R8G8B8A8;
 	PixelFormat			= tPixelFormat::R8G8B8A8;
 
@@ -264,6 +957,13 @@ tImageAPNG::tFormat tImageAPNG::Save(const tString& apngFile, const SaveParams&
 	if (!bytesPerPixel)
 		return tFormat::Invalid;
 
+	if (params.DirtyRects)
+	{
+		if (!tAPNG::SaveFrames(apngFile, Frames, bytesPerPixel, overrideFrameDuration, params.NumThreads))
+			return tFormat::Invalid;
+		return (bytesPerPixel == 3) ? tFormat::BPP24 : tFormat::BPP32;
+	}
+
 	std::vector<APngAsm::Image> images;
 	images.resize(Frames.GetNumItems());
 
@@ -293,29 +993,8 @@ tImageAPNG::tFormat tImageAPNG::Save(const tString& apngFile, const SaveParams&
 			}
 		}
 
-		// From the official apng spec:
-		// The delay_num and delay_den parameters together specify a fraction indicating the time to display
-		// the current frame, in seconds. If the denominator is 0, it is to be treated as if it were 100 (that
-		// is, delay_num then specifies 1/100ths of a second). If the the value of the numerator is 0 the decoder
-		// should render the next frame as quickly as possible, though viewers may impose a reasonable lower bound.
-		// Default is numerator = 0. Fast as possible. Use when frameDur = 0.
-		uint delayNumer = 0;
-		uint delayDenom = 1000;
-		if (overrideFrameDuration < 0)
-		{
-			// We use milliseconds here since the apng format uses 16bit unsigned (65535 max) for numerator and denominator.
-			// A max numerator of 65535 gives us ~65 seconds max per frame, which seems reasonable.
-			float frameDur = frame->Duration;
-			if (frameDur > 0.0f)
-				delayNumer = uint(frameDur * 1000.0f);
-		}
-		else
-		{
-			if (overrideFrameDuration > 0)
-				delayNumer = overrideFrameDuration;
-		}
-		img.delay_num = delayNumer;
-		img.delay_den = delayDenom;
+		img.delay_num = tAPNG::GetDelayNumerator(frame, overrideFrameDuration);
+		img.delay_den = 1000;
 	}
 
 	int errCode = APngAsm::save_apng((char*)apngFile.Chr(), images, 0, 0, 0, 0);
@@ -16,6 +16,7 @@
 
 #include <System/tFile.h>
 #include <System/tMachine.h>
+#include <System/tThread.h>
 #include "Image/tImageASTC.h"
 #include "Image/tPixelUtil.h"
 #include "Image/tPicture.h"
@@ -66,6 +67,97 @@ tPixelFormat tASTC::GetFormatFromBlockDimensions(int blockW, int blockH)
 }
 
 
+tASTCEncoder::tASTCEncoder(tPixelFormat astcFormat, float quality, tColourProfile profile, int numThreads) :
+	Format(astcFormat)
+{
+	if (!tIsASTCFormat(astcFormat))
+		return;
+
+	// We only encode from 8-bit pixels so the HDR profiles don't apply.
+	astcenc_profile profileastc = (profile == tColourProfile::LDRlRGBA) ? ASTCENC_PRF_LDR : ASTCENC_PRF_LDR_SRGB;
+	astcenc_config config;
+	astcenc_error result = astcenc_config_init
+	(
+		profileastc, tGetBlockWidth(astcFormat), tGetBlockHeight(astcFormat), 1,
+		tMath::tClamp(quality, 0.0f, 100.0f), 0, &config
+	);
+	if (result != ASTCENC_SUCCESS)
+		return;
+
+	NumThreads = (numThreads <= 0) ? tMath::tMax(tSystem::tGetNumCores(), 1) : numThreads;
+	result = astcenc_context_alloc(&config, NumThreads, &Context);
+	if (result != ASTCENC_SUCCESS)
+		Context = nullptr;
+}
+
+
+tASTCEncoder::~tASTCEncoder()
+{
+	if (Context)
+		astcenc_context_free(Context);
+}
+
+
+uint8* tASTCEncoder::Encode(int& numBytes, const tPixel4b* pixels, int width, int height, bool reverseRows)
+{
+	numBytes = 0;
+	if (!Context || !pixels || (width <= 0) || (height <= 0))
+		return nullptr;
+
+	// astcenc reads a single contiguous slice in block row order, so reversing the rows requires a copy.
+	tPixel4b* reversed = nullptr;
+	if (reverseRows)
+	{
+		reversed = new tPixel4b[width*height];
+		for (int r = 0; r < height; r++)
+			tStd::tMemcpy(reversed + r*width, pixels + ((height-1)-r)*width, width*sizeof(tPixel4b));
+	}
+
+	void* slices[1] = { reversed ? (void*)reversed : (void*)pixels };
+	astcenc_image image;
+	image.dim_x = width;
+	image.dim_y = height;
+	image.dim_z = 1;
+	image.data_type = ASTCENC_TYPE_U8;
+	image.data = slices;
+	astcenc_swizzle swizzle { ASTCENC_SWZ_R, ASTCENC_SWZ_G, ASTCENC_SWZ_B, ASTCENC_SWZ_A };
+
+	// All ASTC blocks are 16 bytes regardless of block dimensions.
+	int outputSize = tGetNumBlocks(tGetBlockWidth(Format), width) * tGetNumBlocks(tGetBlockHeight(Format), height) * 16;
+	uint8* outputData = new uint8[outputSize];
+
+	// Each participating thread must call in with a unique index. astcenc schedules the blocks between them
+	// dynamically and every call returns once the whole image is done.
+	astcenc_error* results = new astcenc_error[NumThreads];
+	tSystem::tParallelFor
+	(
+		NumThreads,
+		[this, &image, &swizzle, outputData, outputSize, results](int begin, int end)
+		{
+			for (int t = begin; t < end; t++)
+				results[t] = astcenc_compress_image(Context, &image, &swizzle, outputData, outputSize, t);
+		},
+		NumThreads
+	);
+	astcenc_compress_reset(Context);
+
+	bool success = true;
+	for (int t = 0; t < NumThreads; t++)
+		success = success && (results[t] == ASTCENC_SUCCESS);
+
+	delete[] results;
+	delete[] reversed;
+	if (!success)
+	{
+		delete[] outputData;
+		return nullptr;
+	}
+
+	numBytes = outputSize;
+	return outputData;
+}
+
+
 bool tImageASTC::Load(const tString& astcFile, const LoadParams& params)
 {
 	Clear();
@@ -157,34 +249,26 @@ bool tImageASTC::Load(const uint8* astcInMemory, int numBytes, const LoadParams&
 	if (result != DecodeResult::Success)
 		return false;
 
-	// Apply any decode flags.
+	// Apply any decode flags. Tone-mapping, compression, and conversion to RGBA32 happen in a single pass.
 	tAssert(decoded4f);
-	bool flagTone = (params.Flags & tImageASTC::LoadFlag_ToneMapExposure) ? true : false;
-	bool flagSRGB = (params.Flags & tImageASTC::LoadFlag_SRGBCompression) ? true : false;
-	bool flagGama = (params.Flags & tImageASTC::LoadFlag_GammaCompression)? true : false;
-	if (flagTone || flagSRGB || flagGama)
+	tToneMapParams toneParams;
+	if (params.Flags & tImageASTC::LoadFlag_ToneMapExposure)
 	{
-		for (int p = 0; p < width*height; p++)
-		{
-			tColour4f& colour = decoded4f[p];
-			if (flagTone)
-				colour.TonemapExposure(params.Exposure, tCompBit_RGB);
-			if (flagSRGB)
-				colour.LinearToSRGB(tCompBit_RGB);
-			if (flagGama)
-				colour.LinearToGamma(params.Gamma, tCompBit_RGB);
-		}
+		toneParams.Operator = params.ToneMap;
+		toneParams.Exposure = params.Exposure;
 	}
+	toneParams.SRGBCompression = (params.Flags & tImageASTC::LoadFlag_SRGBCompression) ? true : false;
+	toneParams.GammaCompression = (params.Flags & tImageASTC::LoadFlag_GammaCompression) ? true : false;
+	toneParams.Gamma = params.Gamma;
 
 	// We're decoded. Need to update the current colour profile.
-	if (flagSRGB) ColourProfile = tColourProfile::sRGB;
-	if (flagGama) ColourProfile = tColourProfile::gRGB;
+	if (toneParams.SRGBCompression) ColourProfile = tColourProfile::sRGB;
+	if (toneParams.GammaCompression) ColourProfile = tColourProfile::gRGB;
 
 	// Converts to RGBA32 into the decoded4b array. Cleans up the float buffer.
 	tAssert(!decoded4b);
 	decoded4b = new tColour4b[width*height];
-	for (int p = 0; p < width*height; p++)
-		decoded4b[p].Set(decoded4f[p]);
+	ToneMap(decoded4b, decoded4f, width*height, toneParams);
 	delete[] decoded4f;
 
 	// Give decoded4b to layer.
@@ -269,6 +353,60 @@ bool tImageASTC::Set(tPicture& picture, bool steal)
 }
 
 
+bool tImageASTC::Save(const tString& astcFile, const SaveParams& params) const
+{
+	if (!IsValid() || (tSystem::tGetFileType(astcFile) != tSystem::tFileType::ASTC))
+		return false;
+
+	int width = Layer->Width;
+	int height = Layer->Height;
+	tPixelFormat format = Layer->PixelFormat;
+	uint8* blocks = nullptr;
+	int numBytes = 0;
+	bool encoded = false;
+	if (tIsASTCFormat(format))
+	{
+		blocks = Layer->Data;
+		numBytes = Layer->GetDataSize();
+	}
+	else if ((format == tPixelFormat::R8G8B8A8) && tIsASTCFormat(params.Format))
+	{
+		tASTCEncoder encoder(params.Format, params.Quality, ColourProfile, params.NumThreads);
+		blocks = encoder.Encode(numBytes, (tPixel4b*)Layer->Data, width, height, true);
+		format = params.Format;
+		encoded = true;
+	}
+	if (!blocks)
+		return false;
+
+	tASTC::Header header;
+	header.Magic[0] = 0x13; header.Magic[1] = 0xAB; header.Magic[2] = 0xA1; header.Magic[3] = 0x5C;
+	header.BlockW = tGetBlockWidth(format);
+	header.BlockH = tGetBlockHeight(format);
+	header.BlockD = 1;
+	for (int b = 0; b < 3; b++)
+	{
+		header.DimX[b] = (width  >> (b*8)) & 0xFF;
+		header.DimY[b] = (height >> (b*8)) & 0xFF;
+		header.DimZ[b] = (b == 0) ? 1 : 0;
+	}
+
+	bool success = false;
+	tFileHandle file = tSystem::tOpenFile(astcFile.Chr(), "wb");
+	if (file)
+	{
+		success =
+			(tSystem::tWriteFile(file, &header, sizeof(header)) == sizeof(header)) &&
+			(tSystem::tWriteFile(file, blocks, numBytes) == numBytes);
+		tSystem::tCloseFile(file);
+	}
+
+	if (encoded)
+		delete[] blocks;
+	return success;
+}
+
+
 tFrame* tImageASTC::GetFrame(bool steal)
 {
 	// Data must be decoded for this to work.
@@ -38,6 +38,7 @@
 #include <Foundation/tArray.h>
 #include "Image/tImageBMP.h"
 #include "Image/tPicture.h"
+#include "Image/tPixelUtil.h"
 using namespace tSystem;
 namespace tImage
 {
@@ -50,22 +51,34 @@ bool tImageBMP::Load(const tString& bmpFile)
 	if ((tSystem::tGetFileType(bmpFile) != tSystem::tFileType::BMP) || !tFileExists(bmpFile))
 		return false;
 
-	tFileHandle file = tOpenFile(bmpFile.Chars(), "rb");
-	if (!file)
+	// One read of the whole file is far cheaper than the many small reads (and seeks) needed to pull out pixels or rows
+	// individually. Everything after this decodes straight from memory.
+	int numBytes = 0;
+	uint8* bmpFileInMemory = tLoadFile(bmpFile, nullptr, &numBytes);
+	bool success = Load(bmpFileInMemory, numBytes);
+	delete[] bmpFileInMemory;
+
+	return success;
+}
+
+
+bool tImageBMP::Load(const uint8* bmpFileInMemory, int numBytes)
+{
+	Clear();
+
+	tStaticAssert(sizeof(Header) == 14);
+	tStaticAssert(sizeof(InfoHeader) == 40);
+	if (!bmpFileInMemory || (numBytes < int(sizeof(Header) + sizeof(InfoHeader))))
 		return false;
-	
+
+	const uint8* end = bmpFileInMemory + numBytes;
 	Header bmpHeader;
-	tStaticAssert(sizeof(bmpHeader) == 14);
-	tReadFile(file, &bmpHeader, 14);
+	tStd::tMemcpy(&bmpHeader, bmpFileInMemory, sizeof(Header));
 	if (bmpHeader.FourCC != FourCC)
-	{
-		tCloseFile(file);
 		return false;
-	}
 
 	InfoHeader infoHeader;
-	tStaticAssert(sizeof(infoHeader) == 40);
-	tReadFile(file, &infoHeader, 40);
+	tStd::tMemcpy(&infoHeader, bmpFileInMemory + sizeof(Header), sizeof(InfoHeader));
 
 	// Some sanity-checking.
 	// @todo Support jpeg and png compression.
@@ -74,10 +87,11 @@ bool tImageBMP::Load(const tString& bmpFile)
 	(
 		((infoHeader.HeaderSize != 40) && (infoHeader.HeaderSize != 108) && (infoHeader.HeaderSize != 124))	||
 		(infoHeader.NumPlanes != 1)																			||
-		((infoHeader.Compression == 4) || (infoHeader.Compression == 5))
+		((infoHeader.Compression == 4) || (infoHeader.Compression == 5))									||
+		(infoHeader.Width <= 0) || (infoHeader.Height == 0)													||
+		(bmpHeader.Offset <= 0) || (bmpHeader.Offset >= numBytes)
 	)
 	{
-		tCloseFile(file);
 		return false;
 	}
 
@@ -91,83 +105,103 @@ bool tImageBMP::Load(const tString& bmpFile)
 		Height = -Height;
 	}
 
-	// Is this bmp indexed (using a palette)?
-	PaletteColour* palette = nullptr;
+	// Is this bmp indexed (using a palette)? The palette always has 256 entries so that a bad index in the pixel data
+	// can never read past the end of it. Unused entries are black.
+	PaletteColour palette[256];
+	tStd::tMemset(palette, 0, sizeof(palette));
 	if (infoHeader.BPP <= 8)
 	{
-		tFileSeek(file, 14 + infoHeader.HeaderSize, tSeekOrigin::Set);
-		if (infoHeader.ColoursUsed == 0)
+		// Only 1, 4, and 8 bit indexes allowed.
+		if ((infoHeader.BPP != 1) && (infoHeader.BPP != 4) && (infoHeader.BPP != 8))
 		{
-			// Only 1, 4, and 8 bit indexes allowed.
-			if ((infoHeader.BPP != 1) && (infoHeader.BPP != 4) && (infoHeader.BPP != 8))
-			{
-				tCloseFile(file);
-				Clear();			// Clears Width and Height.
-				return false;
-			}
-			infoHeader.ColoursUsed = 1 << infoHeader.BPP;
+			Clear();			// Clears Width and Height.
+			return false;
 		}
-		palette = new PaletteColour[infoHeader.ColoursUsed];
-		tReadFile(file, palette, sizeof(PaletteColour)*infoHeader.ColoursUsed);
+		int numColours = infoHeader.ColoursUsed;
+		if ((numColours <= 0) || (numColours > (1 << infoHeader.BPP)))
+			numColours = 1 << infoHeader.BPP;
+
+		const uint8* paletteData = bmpFileInMemory + sizeof(Header) + infoHeader.HeaderSize;
+		if (paletteData + numColours*sizeof(PaletteColour) > end)
+		{
+			Clear();
+			return false;
+		}
+		tStd::tMemcpy(palette, paletteData, numColours*sizeof(PaletteColour));
 	}
 
+	// The uncompressed indexed readers expand whole rows straight from this RGBA version of the palette.
+	tPixel4b expandPalette[256];
+	for (int c = 0; c < 256; c++)
+		expandPalette[c].Set(palette[c].R, palette[c].G, palette[c].B);
+
 	uint8* buf = new uint8[Width * Height * 4];
-	tStd::tMemset(buf, 0x00, Width*Height * 4);
-	tFileSeek(file, bmpHeader.Offset, tSeekOrigin::Set);
+	const uint8* src = bmpFileInMemory + bmpHeader.Offset;
 	PixelFormatSrc = tPixelFormat::R8G8B8A8;
 
+	// The RLE readers may skip pixels so the buffer must start out clear. The others write every pixel.
+	bool isRLE = (infoHeader.Compression == 1) || (infoHeader.Compression == 2);
+	if (isRLE)
+		tStd::tMemset(buf, 0x00, Width*Height * 4);
+
+	bool success = true;
 	switch (infoHeader.BPP)
 	{
 		case 32:
-			ReadRow_Pixels32(file, buf);
+			success = ReadRow_Pixels32(src, end, buf, flipped);
 			PixelFormatSrc = tPixelFormat::R8G8B8A8;
 			break;
 
 		case 24:
-			ReadRow_Pixels24(file, buf);
+			success = ReadRow_Pixels24(src, end, buf, flipped);
 			PixelFormatSrc = tPixelFormat::R8G8B8;
 			break;
 
 		case 16: 
-			ReadRow_Pixels16(file, buf);
+			success = ReadRow_Pixels16(src, end, buf, flipped);
 			PixelFormatSrc = tPixelFormat::G3B5A1R5G2;
 			break;
 
 		case 8:
-			tAssert(palette);
 			if (infoHeader.Compression == 1)
-				ReadRow_IndexedRLE8(file, buf, palette);
+				ReadRow_IndexedRLE8(src, end, buf, palette);
 			else
-				ReadRow_Indexed8(file, buf, palette);
+				success = ReadRow_Indexed(src, end, buf, flipped, 8, expandPalette);
 			PixelFormatSrc = tPixelFormat::PAL8BIT;
 			break;
 
 		case 4:
-			tAssert(palette);
 			if (infoHeader.Compression == 2)
-				ReadRow_IndexedRLE4(file, buf, palette);
+				ReadRow_IndexedRLE4(src, end, buf, palette);
 			else
-				ReadRow_Indexed4(file, buf, palette);
+				success = ReadRow_Indexed(src, end, buf, flipped, 4, expandPalette);
 			PixelFormatSrc = tPixelFormat::PAL4BIT;
 			break;
 
 		case 1:
-			tAssert(palette);
-			ReadRow_Indexed1(file, buf, palette);
+			success = ReadRow_Indexed(src, end, buf, flipped, 1, expandPalette);
 			PixelFormatSrc = tPixelFormat::PAL1BIT;
 			break;
+
+		default:
+			success = false;
+			break;
 	}
 
+	if (!success)
+	{
+		delete[] buf;
+		Clear();
+		return false;
+	}
 	Pixels = (tPixel4b*)buf;
-	delete[] palette;
-	tCloseFile(file);
 
-	if (flipped)
+	// The non-RLE readers already wrote their rows in flipped order. Only RLE data needs a second pass.
+	if (flipped && isRLE)
 	{
 		tPixel4b* newPixels = new tPixel4b[Width * Height];
 		for (int y = 0; y < Height; y++)
-			for (int x = 0; x < Width; x++)
-				newPixels[ y*Width + x ] = Pixels[ (Height-1-y)*Width + x ];
+			tStd::tMemcpy(newPixels + y*Width, Pixels + (Height-1-y)*Width, Width*sizeof(tPixel4b));
 		delete[] Pixels;
 		Pixels = newPixels;
 	}
@@ -180,289 +214,219 @@ bool tImageBMP::Load(const tString& bmpFile)
 }
 
 
-void tImageBMP::ReadRow_Pixels32(tFileHandle file, uint8* dest)
+bool tImageBMP::ReadRow_Pixels32(const uint8* src, const uint8* end, uint8* dest, bool flip)
 {
-	for (int p = 0; p < Width*Height; p++)
+	int rowBytes = Width*4;
+	if (src + rowBytes*Height > end)
+		return false;
+
+	for (int y = 0; y < Height; y++, src += rowBytes)
 	{
-		uint8 pixel[4];
-		tReadFile(file, pixel, 4);
-		*(dest++) = pixel[2];
-		*(dest++) = pixel[1];
-		*(dest++) = pixel[0];
-		*(dest++) = pixel[3];
+		uint8* row = dest + (flip ? (Height-1-y) : y)*rowBytes;
+		ConvertBGRAToRGBA(row, src, Width);
 	}
+	return true;
 }
 
 
-void tImageBMP::ReadRow_Pixels24(tFileHandle file, uint8* dest)
+bool tImageBMP::ReadRow_Pixels24(const uint8* src, const uint8* end, uint8* dest, bool flip)
 {
-	int rowPad = (Width*3 % 4) ? 4 - (Width*3 % 4) : 0;
-	for (int y = 0; y < Height; y++)
-	{
-		for (int x = 0; x < Width; x++)
-		{
-			uint8 pixel[3];
-			tReadFile(file, pixel, 3);
-			*(dest++) = pixel[2];
-			*(dest++) = pixel[1];
-			*(dest++) = pixel[0];
-			*(dest++) = 0xFF;
-		}
+	// Rows are padded to 4-byte boundaries. The last row's padding is not always present so we don't require it.
+	int rowBytes = Width*3;
+	int rowStride = (rowBytes + 3) & ~3;
+	if (src + rowStride*(Height-1) + rowBytes > end)
+		return false;
 
-		if (rowPad)
-			tFileSeek(file, rowPad, tSeekOrigin::Current);
+	for (int y = 0; y < Height; y++, src += rowStride)
+	{
+		uint8* row = dest + (flip ? (Height-1-y) : y)*Width*4;
+		ConvertBGRToRGBA(row, src, Width);
 	}
+	return true;
 }
 
 
-void tImageBMP::ReadRow_Pixels16(tFileHandle file, uint8* dest)
+bool tImageBMP::ReadRow_Pixels16(const uint8* src, const uint8* end, uint8* dest, bool flip)
 {
-	int rowPad = (Width*2 % 4) ? 4 - (Width*2 % 4) : 0;
-	for (int y = 0; y < Height; y++)
+	int rowBytes = Width*2;
+	int rowStride = (rowBytes + 3) & ~3;
+	if (src + rowStride*(Height-1) + rowBytes > end)
+		return false;
+
+	for (int y = 0; y < Height; y++, src += rowStride)
 	{
-		for (int x = 0; x < Width; x++)
+		uint8* d = dest + (flip ? (Height-1-y) : y)*Width*4;
+		const uint8* s = src;
+		for (int x = 0; x < Width; x++, s += 2)
 		{
-			uint16 pixel;
-			tReadFile(file, &pixel, 2);
+			uint16 pixel = uint16(s[0]) | (uint16(s[1]) << 8);
 			uint16 b = (pixel >> 10)	& 0x1F;
 			uint16 g = (pixel >> 5)		& 0x1F;
 			uint16 r = (pixel >> 0)		& 0x1F;
-			*(dest++) = r*8;
-			*(dest++) = g*8;
-			*(dest++) = b*8;
-			*(dest++) = 0xFF;		// @todo Correct? Should we not read the 1-bit alpha?
-		}
-
-		if (rowPad)
-			tFileSeek(file, rowPad, tSeekOrigin::Current);
-	}
-}
-
-
-void tImageBMP::ReadRow_Indexed8(tFileHandle file, uint8* dest, PaletteColour* palette)
-{
-	int rowPad = (Width % 4) ? 4 - (Width % 4) : 0;
-	for (int y = 0; y < Height; y++)
-	{
-		for (int x = 0; x < Width; x++)
-		{
-			uint8 index;
-			tReadFile(file, &index, 1);
-			*(dest++) = palette[index].R;
-			*(dest++) = palette[index].G;
-			*(dest++) = palette[index].B;
-			*(dest++) = 0xFF;
+			*(d++) = r*8;
+			*(d++) = g*8;
+			*(d++) = b*8;
+			*(d++) = 0xFF;		// @todo Correct? Should we not read the 1-bit alpha?
 		}
-		if (rowPad)
-			tFileSeek(file, rowPad, tSeekOrigin::Current);
 	}
+	return true;
 }
 
 
-void tImageBMP::ReadRow_Indexed4(tFileHandle file, uint8* dest, PaletteColour* palette)
+bool tImageBMP::ReadRow_Indexed(const uint8* src, const uint8* end, uint8* dest, bool flip, int bpp, const tPixel4b* palette)
 {
-	int size = (Width+1) / 2;
-	int rowPad = (size % 4) ? 4 - (size % 4) : 0;
-	tArray<uint8> rowStride(size);
-
-	for (int y = 0; y < Height; y++)
-	{
-		tReadFile(file, (uint8*)rowStride, size);
-		for (int x = 0; x < Width; x++)
-		{
-			uint8 byte = rowStride[x/2];
-			uint8 index = (x % 2) ? 0x0F & byte : byte >> 4;
-			*(dest++) = palette[index].R;
-			*(dest++) = palette[index].G;
-			*(dest++) = palette[index].B;
-			*(dest++) = 0xFF;
-		}
-		if (rowPad)
-			tFileSeek(file, rowPad, tSeekOrigin::Current);
-	}
-}
-
+	// Each row is packed most-significant-bit first and starts on a 4-byte boundary.
+	int size = (Width*bpp + 7) / 8;
+	int rowStride = (size + 3) & ~3;
+	if (src + rowStride*(Height-1) + size > end)
+		return false;
 
-void tImageBMP::ReadRow_Indexed1(tFileHandle file, uint8* dest, PaletteColour* palette)
-{
-	int size = (Width + 7) / 8;
-	int rowPad = (size % 4) ? 4 - (size % 4) : 0;
-	tArray<uint8> rowStride(size);
-	
-	for (int y = 0; y < Height; y++)
+	for (int y = 0; y < Height; y++, src += rowStride)
 	{
-		tReadFile(file, (uint8*)rowStride, size);
-		for (int x = 0; x < Width; x++)
-		{
-			int bit = (x % 8) + 1;
-			uint8 byte = rowStride[x/8];
-			uint8 index = byte >> (8-bit);
-			index &= 0x01;
-			*(dest++) = palette[index].R;
-			*(dest++) = palette[index].G;
-			*(dest++) = palette[index].B;
-			*(dest++) = 0xFF;
-		}
-		if (rowPad)
-			tFileSeek(file, rowPad, tSeekOrigin::Current);
+		tPixel4b* row = (tPixel4b*)dest + (flip ? (Height-1-y) : y)*Width;
+		ExpandIndices(row, src, Width, bpp, palette);
 	}
+	return true;
 }
 
 
-void tImageBMP::ReadRow_IndexedRLE8(tFileHandle file, uint8* dest, PaletteColour* palette)
+void tImageBMP::ReadRow_IndexedRLE8(const uint8* src, const uint8* end, uint8* dest, const PaletteColour* palette)
 {
-	uint8 byte = 0;
 	int currentLine = 0;
 	uint8* d = dest;
+	uint8* dend = dest + Width*Height*4;
 
-	bool keepReading = true;
-	while (keepReading)
+	// Running off the end of the source is treated like an end-of-bitmap marker. Writes are clamped to the buffer.
+	while ((src + 2 <= end) && (d < dend))
 	{
-		byte = tGetc(file);
+		uint8 byte = *src++;
 		if (byte)
 		{
-			int index = tGetc(file);
-			for (int i = 0; i < byte; i++)
+			int index = *src++;
+			for (int i = 0; (i < byte) && (d < dend); i++)
 			{
 				*d++ = palette[index].R;
 				*d++ = palette[index].G;
 				*d++ = palette[index].B;
 				*d++ = 0xFF;
 			}
+			continue;
 		}
-		else
-		{
-			byte = tGetc(file);
-			switch (byte) 
-			{
-				case 0:
-					currentLine++;
-					d = dest + currentLine*Width*4;
-					break;
 
-				case 1:
-					keepReading = false;
-					break;
+		byte = *src++;
+		if (byte == 1)
+			break;
 
-				case 2:
-				{
-					int xoffset = tGetc(file);
-					int yoffset = tGetc(file);
-					currentLine += yoffset;
-					d += yoffset*Width*4 + xoffset*4;
-					break;
-				}
+		switch (byte) 
+		{
+			case 0:
+				currentLine++;
+				d = dest + currentLine*Width*4;
+				break;
+
+			case 2:
+			{
+				if (src + 2 > end)
+					return;
+				int xoffset = *src++;
+				int yoffset = *src++;
+				currentLine += yoffset;
+				d += yoffset*Width*4 + xoffset*4;
+				break;
+			}
 
-				default:
+			default:
+			{
+				if (src + byte > end)
+					return;
+				for (int i = 0; (i < byte) && (d < dend); i++)
 				{
-					for (int i = 0; i < byte; i++)
-					{
-						int index = tGetc(file);
-						*d++ = palette[index].R;
-						*d++ = palette[index].G;
-						*d++ = palette[index].B;
-						*d++ = 0xFF;
-					}
-					if (byte % 2)
-						tFileSeek(file, 1, tSeekOrigin::Current);
-					break;
+					int index = src[i];
+					*d++ = palette[index].R;
+					*d++ = palette[index].G;
+					*d++ = palette[index].B;
+					*d++ = 0xFF;
 				}
+				src += byte + (byte % 2);
+				break;
 			}
 		}
-		if (d >= dest + Width*Height*4)
-			keepReading = false;
 	}
 }
 
 
-void tImageBMP::ReadRow_IndexedRLE4(tFileHandle file, uint8* dest, PaletteColour* palette)
+void tImageBMP::ReadRow_IndexedRLE4(const uint8* src, const uint8* end, uint8* dest, const PaletteColour* palette)
 {
 	int currentLine = 0;
 	uint8* d = dest;
-	bool keepReading = true;
-	while (keepReading)
+	uint8* dend = dest + Width*Height*4;
+	auto writeIndex = [&d, dend, palette](uint8 index)
 	{
-		uint8 byte1 = tGetc(file);
+		if (d >= dend)
+			return;
+		*(d++) = palette[index].R;
+		*(d++) = palette[index].G;
+		*(d++) = palette[index].B;
+		*(d++) = 0x0F;
+	};
+
+	while ((src + 2 <= end) && (d < dend))
+	{
+		uint8 byte1 = *src++;
+		uint8 byte2 = *src++;
 		if (byte1)
 		{
-			uint8 byte2 = tGetc(file);
 			uint8 index1 = byte2 >> 4;
 			uint8 index2 = byte2 & 0x0F;
 			for (int i = 0; i < (byte1 / 2); i++)
 			{
-				*(d++) = palette[index1].R;
-				*(d++) = palette[index1].G;
-				*(d++) = palette[index1].B;
-				*(d++) = 0x0F;
-
-				*(d++) = palette[index2].R;
-				*(d++) = palette[index2].G;
-				*(d++) = palette[index2].B;
-				*(d++) = 0x0F;
+				writeIndex(index1);
+				writeIndex(index2);
 			}
 			if (byte1 % 2)
-			{
-				*(d++) = palette[index1].R;
-				*(d++) = palette[index1].G;
-				*(d++) = palette[index1].B;
-				*(d++) = 0x0F;
-			}
+				writeIndex(index1);
+			continue;
 		}
-		else // Absolute mode.
-		{	
-			uint8 byte2 = tGetc(file);
-			switch (byte2)
-			{
-				case 0:
-					currentLine++;
-					d = dest + currentLine*Width*4;
-					break;
 
-				case 1:
-					keepReading = false;
-					break;
+		// Absolute mode.
+		if (byte2 == 1)
+			break;
 
-				case 2:
+		switch (byte2)
+		{
+			case 0:
+				currentLine++;
+				d = dest + currentLine*Width*4;
+				break;
+
+			case 2:
+			{
+				if (src + 2 > end)
+					return;
+				int xoffset = *src++;
+				int yoffset = *src++;
+				currentLine += yoffset;
+				d += yoffset*Width*4 + xoffset*4;
+				break;
+			}
+
+			default:
+			{
+				// Absolute runs are padded to a 16-bit boundary.
+				int numRunBytes = (byte2 + 1)/2;
+				if (src + numRunBytes > end)
+					return;
+				for (int i = 0; i < (byte2/2); i++)
 				{
-					int xoffset = tGetc(file);
-					int yoffset = tGetc(file);
-					currentLine += yoffset;
-					d += yoffset*Width*4 + xoffset*4;
-					break;
+					writeIndex(src[i] >> 4);
+					writeIndex(src[i] & 0x0F);
 				}
-
-				default:
-					for (int i = 0; i < (byte2/2); i++)
-					{
-						byte1 = tGetc(file);
-						uint8 index1 = byte1 >> 4;
-						*(d++) = palette[index1].R;
-						*(d++) = palette[index1].G;
-						*(d++) = palette[index1].B;
-						*(d++) = 0x0F;
-
-						uint8 index2 = byte1 & 0x0F;
-						*(d++) = palette[index2].R;
-						*(d++) = palette[index2].G;
-						*(d++) = palette[index2].B;
-						*(d++) = 0x0F;
-					}
-					if (byte2 % 2)
-					{
-						byte1 = tGetc(file);
-						uint8 index = byte1 >> 4;
-						*(d++) = palette[index].R;
-						*(d++) = palette[index].G;
-						*(d++) = palette[index].B;
-						*(d++) = 0x0F;
-					}
-					if (((byte2 + 1)/2) % 2)
-						tFileSeek(file, 1, tSeekOrigin::Current);
-					break;
+				if (byte2 % 2)
+					writeIndex(src[byte2/2] >> 4);
+				src += numRunBytes + (numRunBytes % 2);
+				break;
 			}
 		}
-		if (d >= dest + Width*Height*4)
-			keepReading = false;
 	}
 }
 
@@ -581,14 +545,56 @@ tImageBMP::tFormat tImageBMP::Save(const tString& bmpFile, const SaveParams& par
 	if (!file)
 		return tFormat::Invalid;
 
+	tBlockWriter writer(file);
+	bool success = Save(writer, format);
+	success = writer.Flush() && success;
+	tCloseFile(file);
+
+	if (!success)
+		return tFormat::Invalid;
+
+	return format;
+}
+
+
+tImageBMP::tFormat tImageBMP::Save(uint8*& bmpFileInMemory, int& numBytes, const SaveParams& params) const
+{
+	bmpFileInMemory = nullptr;
+	numBytes = 0;
+	tFormat format = params.Format;
+	if (!IsValid() || (format == tFormat::Invalid))
+		return tFormat::Invalid;
+
+	if (format == tFormat::Auto)
+		format = IsOpaque() ? tFormat::BPP24 : tFormat::BPP32;
+
+	// The size is known exactly up-front so the writer never needs to grow.
+	int bytesPerPixel = (format == tFormat::BPP24) ? 3 : 4;
+	int rowStride = (Width*bytesPerPixel + 3) & ~3;
+	tBlockWriter writer(54 + rowStride*Height);
+	if (!Save(writer, format))
+		return tFormat::Invalid;
+
+	bmpFileInMemory = writer.StealBuffer(numBytes);
+	return format;
+}
+
+
+bool tImageBMP::Save(tBlockWriter& writer, tFormat format) const
+{
+	if ((format != tFormat::BPP24) && (format != tFormat::BPP32))
+		return false;
+
 	int bytesPerPixel = (format == tFormat::BPP24) ? 3 : 4;
+	int rowBytes = Width*bytesPerPixel;
+	int rowStride = (rowBytes + 3) & ~3;
 
 	Header bmpHeader;
 	bmpHeader.FourCC				= FourCC;
-	bmpHeader.Size					= Width*Height*bytesPerPixel + 54;
+	bmpHeader.Size					= rowStride*Height + 54;
 	bmpHeader.AppId					= 0;
 	bmpHeader.Offset				= 54;
-	tWriteFile(file, &bmpHeader, sizeof(Header));
+	writer.Write(&bmpHeader, sizeof(Header));
 	
 	InfoHeader infoHeader;
 	infoHeader.HeaderSize			= 40;
@@ -597,34 +603,28 @@ tImageBMP::tFormat tImageBMP::Save(const tString& bmpFile, const SaveParams& par
 	infoHeader.NumPlanes			= 1;
 	infoHeader.BPP					= bytesPerPixel*8;
 	infoHeader.Compression			= 0;
-	infoHeader.ImageSize			= Width * Height * bytesPerPixel;
+	infoHeader.ImageSize			= rowStride*Height;
 	infoHeader.HorizontalResolution	= 0;
 	infoHeader.VerticalResolution	= 0;
 	infoHeader.ColoursUsed			= 0;
 	infoHeader.ColoursImportant		= 0;
-	tWriteFile(file, &infoHeader, sizeof(InfoHeader));
+	writer.Write(&infoHeader, sizeof(InfoHeader));
 	
-	uint8* p = (uint8*)Pixels;
-	int rowPad = (Width*bytesPerPixel % 4) ? 4 - (Width*bytesPerPixel % 4) : 0;
-	uint8 zeroPad[4];
-	tStd::tMemset(zeroPad, 0, 4);
+	// Each row, including its zero padding to a 4-byte boundary, is swizzled straight into the writer's buffer.
 	for (int y = 0; y < Height; y++)
 	{
-		for (int x = 0; x < Width; x++)
-		{
-			uint8 sample[4];
-			sample[2] = *p++;
-			sample[1] = *p++;
-			sample[0] = *p++;
-			sample[3] = *p++;
-			tWriteFile(file, sample, bytesPerPixel);
-		}
-		if (rowPad)
-			tWriteFile(file, zeroPad, rowPad);
+		const uint8* src = (const uint8*)(Pixels + y*Width);
+		uint8* dst = writer.Reserve(rowStride);
+		if (bytesPerPixel == 3)
+			ConvertRGBAToBGR(dst, src, Width);
+		else
+			ConvertRGBAToBGRA(dst, src, Width);
+		for (int pad = rowBytes; pad < rowStride; pad++)
+			dst[pad] = 0;
+		writer.Commit(rowStride);
 	}
 	
-	tCloseFile(file);
-	return format;
+	return !writer.HasError();
 }
 
 
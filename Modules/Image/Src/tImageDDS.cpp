@@ -18,6 +18,7 @@
 #include "Image/tImageDDS.h"
 #include "Image/tPixelUtil.h"
 #include "Image/tPicture.h"
+#include "Image/tTexture.h"
 namespace tImage
 {
 
@@ -514,6 +515,11 @@ namespace tDDS
 	void GetFormatInfo_FromDXGIFormat		(tPixelFormat&, tColourProfile&, tAlphaMode&, tChannelType&, uint32 dxgiFormat);
 	void GetFormatInfo_FromFourCC			(tPixelFormat&, tColourProfile&, tAlphaMode&, tChannelType&, uint32 fourCC);
 	void GetFormatInfo_FromComponentMasks	(tPixelFormat&, tColourProfile&, tAlphaMode&, tChannelType&, const FormatData&);
+
+	// The inverses of the above used when saving. GetDXGIFormat returns DXGIFMT_UNKNOWN if there is no DXGI format for
+	// the pixel format. GetComponentMasks returns false if the pixel format cannot be described by a legacy header.
+	DXGIFMT GetDXGIFormat(tPixelFormat, tColourProfile);
+	bool GetComponentMasks(FormatData&, tPixelFormat);
 }
 
 
@@ -856,6 +862,103 @@ void tDDS::GetFormatInfo_FromComponentMasks(tPixelFormat& format, tColourProfile
 }
 
 
+tDDS::DXGIFMT tDDS::GetDXGIFormat(tPixelFormat format, tColourProfile profile)
+{
+	// The loader treats both the UNORM and UNORM_SRGB variants as sRGB so either round-trips. We write the variant that
+	// says what the data actually is.
+	bool srgb = (profile == tColourProfile::sRGB);
+
+	#define F(f) case tPixelFormat::f
+	#define D(d) return DXGIFMT_##d;
+	#define S(d) return srgb ? DXGIFMT_##d##_SRGB : DXGIFMT_##d;
+	switch (format)
+	{
+		F(BC1DXT1):
+		F(BC1DXT1A):				S(BC1_UNORM)
+		F(BC2DXT2DXT3):				S(BC2_UNORM)
+		F(BC3DXT4DXT5):				S(BC3_UNORM)
+		F(BC4ATI1U):				D(BC4_UNORM)
+		F(BC4ATI1S):				D(BC4_SNORM)
+		F(BC5ATI2U):				D(BC5_UNORM)
+		F(BC5ATI2S):				D(BC5_SNORM)
+		F(BC6U):					D(BC6H_UF16)
+		F(BC6S):					D(BC6H_SF16)
+		F(BC7):						S(BC7_UNORM)
+
+		F(A8):						D(A8_UNORM)
+		F(R8):						D(R8_UNORM)
+		F(R8G8):					D(R8G8_UNORM)
+		F(R8G8B8A8):				S(R8G8B8A8_UNORM)
+		F(B8G8R8A8):				S(B8G8R8A8_UNORM)
+		F(G3B5R5G3):				D(B5G6R5_UNORM)
+		F(G4B4A4R4):				D(B4G4R4A4_UNORM)
+		F(G3B5A1R5G2):				D(B5G5R5A1_UNORM)
+
+		F(R16f):					D(R16_FLOAT)
+		F(R16G16f):					D(R16G16_FLOAT)
+		F(R16G16B16A16f):			D(R16G16B16A16_FLOAT)
+		F(R32f):					D(R32_FLOAT)
+		F(R32G32f):					D(R32G32_FLOAT)
+		F(R32G32B32f):				D(R32G32B32_FLOAT)
+		F(R32G32B32A32f):			D(R32G32B32A32_FLOAT)
+		F(B10G11R11uf):				D(R11G11B10_FLOAT)
+		F(E5B9G9R9uf):				D(R9G9B9E5_SHAREDEXP)
+
+		F(ASTC4X4):					S(EXT_ASTC_4X4_UNORM)
+		F(ASTC5X4):					S(EXT_ASTC_5X4_UNORM)
+		F(ASTC5X5):					S(EXT_ASTC_5X5_UNORM)
+		F(ASTC6X5):					S(EXT_ASTC_6X5_UNORM)
+		F(ASTC6X6):					S(EXT_ASTC_6X6_UNORM)
+		F(ASTC8X5):					S(EXT_ASTC_8X5_UNORM)
+		F(ASTC8X6):					S(EXT_ASTC_8X6_UNORM)
+		F(ASTC8X8):					S(EXT_ASTC_8X8_UNORM)
+		F(ASTC10X5):				S(EXT_ASTC_10X5_UNORM)
+		F(ASTC10X6):				S(EXT_ASTC_10X6_UNORM)
+		F(ASTC10X8):				S(EXT_ASTC_10X8_UNORM)
+		F(ASTC10X10):				S(EXT_ASTC_10X10_UNORM)
+		F(ASTC12X10):				S(EXT_ASTC_12X10_UNORM)
+		F(ASTC12X12):				S(EXT_ASTC_12X12_UNORM)
+
+		default:
+			break;
+	}
+	#undef F
+	#undef D
+	#undef S
+
+	return DXGIFMT_UNKNOWN;
+}
+
+
+bool tDDS::GetComponentMasks(FormatData& fmtData, tPixelFormat format)
+{
+	// These are the masks GetFormatInfo_FromComponentMasks expects. Remember the masks are little-endian.
+	tStd::tMemset(&fmtData, 0, sizeof(FormatData));
+	fmtData.Size = sizeof(FormatData);
+	switch (format)
+	{
+		case tPixelFormat::R8G8B8:
+			fmtData.Flags = DDFormatFlags_RGB;		fmtData.RGBBitCount = 24;
+			fmtData.MaskRed = 0x0000FF;				fmtData.MaskGreen = 0x00FF00;		fmtData.MaskBlue = 0xFF0000;
+			return true;
+
+		case tPixelFormat::B8G8R8:
+			fmtData.Flags = DDFormatFlags_RGB;		fmtData.RGBBitCount = 24;
+			fmtData.MaskRed = 0xFF0000;				fmtData.MaskGreen = 0x00FF00;		fmtData.MaskBlue = 0x0000FF;
+			return true;
+
+		case tPixelFormat::L8:
+			fmtData.Flags = DDFormatFlags_L;		fmtData.RGBBitCount = 8;
+			fmtData.MaskRed = 0xFF;
+			return true;
+
+		default:
+			break;
+	}
+
+	return false;
+}
+
 tImageDDS::tImageDDS()
 {
 	tStd::tMemset(Layers, 0, sizeof(Layers));
@@ -911,7 +1014,7 @@ bool tImageDDS::Set(tPixel4b* pixels, int width, int height, bool steal)
 	ChannelType						= tChannelType::UNORM;
 	IsCubeMap						= false;
 	IsModernDX10					= false;
-	RowReversalOperationPerformed	= false;
+	RowReversalOperationPerformed	= true;			// The pixels are in tacent row order.
 	NumImages						= 1;
 	NumMipmapLayers					= 1;
 
@@ -1455,50 +1558,32 @@ bool tImageDDS::Load(const uint8* ddsData, int ddsDataSize, const LoadParams& pa
 				return false;
 			}
 
-			// Apply any decode flags.
+			// Apply any decode flags. HDR (float) data is tone-mapped and converted to 32-bit in a single pass. LDR data
+			// only gets sRGB or gamma compression.
 			tAssert(decoded4f || decoded4b);
-			bool flagTone = (params.Flags & tImageDDS::LoadFlag_ToneMapExposure) ? true : false;
-			bool flagSRGB = (params.Flags & tImageDDS::LoadFlag_SRGBCompression) ? true : false;
-			bool flagGama = (params.Flags & tImageDDS::LoadFlag_GammaCompression)? true : false;
-			if (decoded4f && (flagTone || flagSRGB || flagGama))
+			tToneMapParams toneParams;
+			if (params.Flags & tImageDDS::LoadFlag_ToneMapExposure)
 			{
-				for (int p = 0; p < w*h; p++)
-				{
-					tColour4f& colour = decoded4f[p];
-					if (flagTone)
-						colour.TonemapExposure(params.Exposure, tCompBit_RGB);
-					if (flagSRGB)
-						colour.LinearToSRGB(tCompBit_RGB);
-					if (flagGama)
-						colour.LinearToGamma(params.Gamma, tCompBit_RGB);
-				}
-			}
-			if (decoded4b && (flagSRGB || flagGama))
-			{
-				for (int p = 0; p < w*h; p++)
-				{
-					tColour4f colour(decoded4b[p]);
-					if (flagSRGB)
-						colour.LinearToSRGB(tCompBit_RGB);
-					if (flagGama)
-						colour.LinearToGamma(params.Gamma, tCompBit_RGB);
-					decoded4b[p].SetR(colour.R);
-					decoded4b[p].SetG(colour.G);
-					decoded4b[p].SetB(colour.B);
-				}
+				toneParams.Operator = params.ToneMap;
+				toneParams.Exposure = params.Exposure;
 			}
+			toneParams.SRGBCompression = (params.Flags & tImageDDS::LoadFlag_SRGBCompression) ? true : false;
+			toneParams.GammaCompression = (params.Flags & tImageDDS::LoadFlag_GammaCompression) ? true : false;
+			toneParams.Gamma = params.Gamma;
 
-			// Update the layer with the 32-bit RGBA decoded data. If the data was HDR (float)
-			// convert it to 32 bit. Start by getting rid of the existing layer pixel data.
+			// Update the layer with the 32-bit RGBA decoded data. Start by getting rid of the existing layer pixel data.
 			delete[] layer->Data;
 			if (decoded4f)
 			{
 				tAssert(!decoded4b);
 				decoded4b = new tColour4b[w*h];
-				for (int p = 0; p < w*h; p++)
-					decoded4b[p].Set(decoded4f[p]);
+				ToneMap(decoded4b, decoded4f, w*h, toneParams);
 				delete[] decoded4f;
 			}
+			else
+			{
+				EncodeLDR(decoded4b, w*h, toneParams);
+			}
 
 			// Possibly spread the L/Red channel.
 			if (spread && tIsLuminanceFormat(layer->PixelFormat))
@@ -1554,6 +1639,274 @@ bool tImageDDS::Load(const uint8* ddsData, int ddsDataSize, const LoadParams& pa
 }
 
 
+bool tImageDDS::Writer::Open
+(
+	const tString& ddsFile, tPixelFormat format, int width, int height,
+	int numMipmaps, int numImages, bool cubemap, const SaveParams& params
+)
+{
+	Close();
+	if ((width <= 0) || (height <= 0) || (numMipmaps < 1) || (numMipmaps > MaxMipmapLayers) || (numImages < 1))
+		return false;
+
+	if (cubemap && (numImages % 6))
+		return false;
+
+	if (!tIsBCFormat(format) && !tIsASTCFormat(format) && !tIsPackedFormat(format))
+		return false;
+
+	tDDS::Header header;
+	tStd::tMemset(&header, 0, sizeof(header));
+	tDDS::DX10Header headerDX10;
+	tStd::tMemset(&headerDX10, 0, sizeof(headerDX10));
+
+	tDDS::DXGIFMT dxgiFormat = tDDS::GetDXGIFormat(format, params.ColourProfile);
+	bool modern = (dxgiFormat != tDDS::DXGIFMT_UNKNOWN);
+	if (modern)
+	{
+		header.Format.Size			= sizeof(tDDS::FormatData);
+		header.Format.Flags			= tDDS::DDFormatFlags_FourCC;
+		header.Format.FourCC		= tDDS::D3DFMT_DX10;
+		headerDX10.DxgiFormat		= dxgiFormat;
+		headerDX10.Dimension		= tDDS::D3D10_DIMENSION_TEXTURE2D;
+		headerDX10.MiscFlag			= cubemap ? tDDS::D3D11_MISCFLAG_TEXTURECUBE : 0;
+		headerDX10.ArraySize		= cubemap ? numImages/6 : numImages;
+	}
+	else
+	{
+		// A legacy header can only describe a single texture or a single cubemap.
+		if (!tDDS::GetComponentMasks(header.Format, format) || (numImages != (cubemap ? 6 : 1)))
+			return false;
+	}
+
+	PixelFormat	= format;
+	Width		= width;
+	Height		= height;
+	NumMipmaps	= numMipmaps;
+	NumImages	= numImages;
+	DataOffset	= sizeof(uint32) + sizeof(tDDS::Header) + (modern ? sizeof(tDDS::DX10Header) : 0);
+
+	bool compressed = tIsBCFormat(format) || tIsASTCFormat(format);
+	header.Size					= sizeof(tDDS::Header);
+	header.Flags				= tDDS::HeaderFlag_Caps | tDDS::HeaderFlag_Height | tDDS::HeaderFlag_Width | tDDS::HeaderFlag_PixelFormat;
+	header.Flags				|= compressed ? tDDS::HeaderFlag_LinearSize : tDDS::HeaderFlag_Pitch;
+	header.Height				= height;
+	header.Width				= width;
+	header.PitchLinearSize		= compressed ? GetLayerSize(0) : (width*tGetBitsPerPixel(format) + 7) / 8;
+	header.MipmapCount			= numMipmaps;
+
+	header.Capabilities.FlagsCapsBasic = tDDS::CapsBasicFlag_Texture;
+	if (numMipmaps > 1)
+	{
+		header.Flags |= tDDS::HeaderFlag_MipmapCount;
+		header.Capabilities.FlagsCapsBasic |= tDDS::CapsBasicFlag_Mipmap | tDDS::CapsBasicFlag_Complex;
+	}
+	if (numImages > 1)
+		header.Capabilities.FlagsCapsBasic |= tDDS::CapsBasicFlag_Complex;
+
+	// Older readers ignore the DX10 misc flag so the caps are set for cubemaps in either case.
+	if (cubemap)
+		header.Capabilities.FlagsCapsExtra =
+			tDDS::CapsExtraFlag_CubeMap |
+			tDDS::CapsExtraFlag_CubeMapPosX | tDDS::CapsExtraFlag_CubeMapNegX |
+			tDDS::CapsExtraFlag_CubeMapPosY | tDDS::CapsExtraFlag_CubeMapNegY |
+			tDDS::CapsExtraFlag_CubeMapPosZ | tDDS::CapsExtraFlag_CubeMapNegZ;
+
+	// Same rule as loading. We only reverse if every level can be reversed without a decode.
+	ReverseRows = false;
+	if (params.ReverseRowOrder)
+	{
+		ReverseRows = true;
+		int h = height;
+		for (int mipmap = 0; mipmap < numMipmaps; mipmap++)
+		{
+			if (!CanReverseRowData(format, h))
+			{
+				ReverseRows = false;
+				break;
+			}
+			h /= 2; tMath::tiClampMin(h, 1);
+		}
+	}
+
+	File = tSystem::tOpenFile(ddsFile.Chr(), "wb");
+	if (!File)
+		return false;
+
+	uint32 magic = FourCC('D','D','S',' ');
+	bool ok = (tSystem::tWriteFile(File, &magic, sizeof(magic)) == sizeof(magic));
+	ok = ok && (tSystem::tWriteFile(File, &header, sizeof(header)) == sizeof(header));
+	if (modern)
+		ok = ok && (tSystem::tWriteFile(File, &headerDX10, sizeof(headerDX10)) == sizeof(headerDX10));
+	if (!ok)
+	{
+		tSystem::tCloseFile(File);
+		File = nullptr;
+		return false;
+	}
+
+	Written = new bool[NumImages*NumMipmaps];
+	for (int w = 0; w < NumImages*NumMipmaps; w++)
+		Written[w] = false;
+
+	return true;
+}
+
+
+bool tImageDDS::Writer::Write(int image, int mipmap, const tLayer& layer)
+{
+	if (!File || (image < 0) || (image >= NumImages) || (mipmap < 0) || (mipmap >= NumMipmaps))
+		return false;
+
+	int width  = Width  >> mipmap; tMath::tiClampMin(width, 1);
+	int height = Height >> mipmap; tMath::tiClampMin(height, 1);
+	if (!layer.IsValid() || (layer.PixelFormat != PixelFormat) || (layer.Width != width) || (layer.Height != height))
+		return false;
+
+	int numBytes = GetLayerSize(mipmap);
+	tAssert(layer.GetDataSize() == numBytes);
+
+	// Reversal is its own inverse so the same function used when loading takes us back to top-down rows.
+	uint8* reversed = nullptr;
+	if (ReverseRows)
+	{
+		int numBlocksW = tGetNumBlocks(tGetBlockWidth(PixelFormat), width);
+		int numBlocksH = tGetNumBlocks(tGetBlockHeight(PixelFormat), height);
+		reversed = CreateReversedRowData(layer.Data, PixelFormat, numBlocksW, numBlocksH);
+		if (!reversed)
+			return false;
+	}
+
+	// Seeking past the end is fine. Any gap is filled by the layers written later.
+	tSystem::tFileSeek(File, GetLayerOffset(image, mipmap));
+	int numWritten = tSystem::tWriteFile(File, reversed ? reversed : layer.Data, numBytes);
+	delete[] reversed;
+	if (numWritten != numBytes)
+		return false;
+
+	Written[image*NumMipmaps + mipmap] = true;
+	return true;
+}
+
+
+bool tImageDDS::Writer::Close()
+{
+	if (!File)
+		return false;
+
+	tSystem::tCloseFile(File);
+	File = nullptr;
+
+	bool complete = true;
+	for (int w = 0; w < NumImages*NumMipmaps; w++)
+		if (!Written[w])
+			complete = false;
+
+	delete[] Written;
+	Written = nullptr;
+	return complete;
+}
+
+
+int tImageDDS::Writer::GetLayerSize(int mipmap) const
+{
+	int width  = Width  >> mipmap; tMath::tiClampMin(width, 1);
+	int height = Height >> mipmap; tMath::tiClampMin(height, 1);
+	int numBlocksW = tGetNumBlocks(tGetBlockWidth(PixelFormat), width);
+	int numBlocksH = tGetNumBlocks(tGetBlockHeight(PixelFormat), height);
+	return numBlocksW * numBlocksH * tGetBytesPerBlock(PixelFormat);
+}
+
+
+int tImageDDS::Writer::GetLayerOffset(int image, int mipmap) const
+{
+	// The dds layout is image-major. All the mipmaps of the first image come before any of the second.
+	int imageSize = 0;
+	int mipmapOffset = 0;
+	for (int m = 0; m < NumMipmaps; m++)
+	{
+		if (m == mipmap)
+			mipmapOffset = imageSize;
+		imageSize += GetLayerSize(m);
+	}
+
+	return DataOffset + image*imageSize + mipmapOffset;
+}
+
+
+bool tImageDDS::Save(const tString& ddsFile, const SaveParams& params) const
+{
+	if (!IsValid())
+		return false;
+
+	// Layers that were not reversed on load are still in file order. Reversing them again would flip the image.
+	SaveParams writeParams(params);
+	writeParams.ReverseRowOrder = params.ReverseRowOrder && RowReversalOperationPerformed;
+
+	tLayer* main = Layers[0][0];
+	Writer writer;
+	if (!writer.Open(ddsFile, main->PixelFormat, main->Width, main->Height, NumMipmapLayers, NumImages, IsCubeMap, writeParams))
+		return false;
+
+	for (int image = 0; image < NumImages; image++)
+		for (int layer = 0; layer < NumMipmapLayers; layer++)
+			if (!Layers[layer][image] || !writer.Write(image, layer, *Layers[layer][image]))
+				return false;
+
+	return writer.Close();
+}
+
+
+bool tImageDDS::Save(const tString& ddsFile, const tTexture& texture, const SaveParams& params)
+{
+	if (!texture.IsValid())
+		return false;
+
+	Writer writer;
+	if (!writer.Open(ddsFile, texture.GetPixelFormat(), texture.GetWidth(), texture.GetHeight(), texture.GetNumMipmaps(), 1, false, params))
+		return false;
+
+	int mipmap = 0;
+	for (tLayer* layer = texture.GetFirstLayer(); layer; layer = layer->Next(), mipmap++)
+		if (!writer.Write(0, mipmap, *layer))
+			return false;
+
+	return writer.Close();
+}
+
+
+bool tImageDDS::Save(const tString& ddsFile, const tTexture* const faces[tFaceIndex_NumFaces], const SaveParams& params)
+{
+	// A dds cubemap always has all six faces and they must all match.
+	const tTexture* first = faces[0];
+	for (int face = 0; face < tFaceIndex_NumFaces; face++)
+	{
+		const tTexture* texture = faces[face];
+		if
+		(
+			!texture || !texture->IsValid() ||
+			(texture->GetPixelFormat() != first->GetPixelFormat()) || (texture->GetNumMipmaps() != first->GetNumMipmaps()) ||
+			(texture->GetWidth() != first->GetWidth()) || (texture->GetHeight() != first->GetHeight())
+		)
+			return false;
+	}
+
+	Writer writer;
+	if (!writer.Open(ddsFile, first->GetPixelFormat(), first->GetWidth(), first->GetHeight(), first->GetNumMipmaps(), tFaceIndex_NumFaces, true, params))
+		return false;
+
+	for (int face = 0; face < tFaceIndex_NumFaces; face++)
+	{
+		int mipmap = 0;
+		for (tLayer* layer = faces[face]->GetFirstLayer(); layer; layer = layer->Next(), mipmap++)
+			if (!writer.Write(face, mipmap, *layer))
+				return false;
+	}
+
+	return writer.Close();
+}
+
+
 const char* tImageDDS::GetStateDesc(StateBit state)
 {
 	return StateDescriptions[int(state)];
@@ -31,11 +31,13 @@
 #include <Foundation/tString.h>
 #include <System/tMachine.h>
 #include <System/tFile.h>
+#include <System/tThread.h>
 #include "Image/tImageEXR.h"
 #include "Image/tPicture.h"
 #include <OpenEXR/loadImage.h>
 #include <OpenEXR/ImfMultiPartInputFile.h>
 #include <OpenEXR/halfFunction.h>
+#include <OpenEXR/ImfRgbaFile.h>
 using namespace tSystem;
 using namespace IMF;
 using namespace IMATH;
@@ -254,23 +256,61 @@ bool tImageEXR::Load(const tString& exrFile, const LoadParams& loadParams)
 		//    display's maximum intensity. (84.65 if the screen's gamma is 2.2)
 		// 7) Clamp the values to [0, 255].
 		//
-		// Texview has 0,0 at bottom-left. Rows start from bottom.
-		int p = 0;
-		for (int yi = height-1; yi >= 0; yi--)
-		{
-			for (int xi = 0; xi < width; xi++)
+		// If a tone-map operator is chosen it replaces steps 2 to 7. Each thread maps its own rows.
+		tToneMapParams toneParams;
+		toneParams.Operator			= loadParams.ToneMap;
+		toneParams.Exposure			= tMath::tPow(2.0f, exposure);
+		toneParams.GammaCompression	= true;
+		toneParams.Gamma			= gamma;
+		toneParams.NumThreads		= 1;
+		bool toneMap = (loadParams.ToneMap != tToneMapOperator::None);
+
+		// Texview has 0,0 at bottom-left. Rows start from bottom. The half functions are lookup tables that are only
+		// read here, so rows may be converted in any order.
+		tSystem::tParallelFor
+		(
+			height,
+			[&](int begin, int end)
 			{
-				int idx = yi*width + xi;
-				const IMF::Rgba& rawPixel = pixels[idx];
-				newFrame->Pixels[p++] = tPixel4b
-				(
-					EXR::Dither( redGamma(rawPixel.r), xi, yi ),
-					EXR::Dither( grnGamma(rawPixel.g), xi, yi ),
-					EXR::Dither( bluGamma(rawPixel.b), xi, yi ),
-					uint8( tMath::tClamp( tMath::tFloatToInt(float(rawPixel.a)*255.0f), 0, 0xFF ) )
-				);
-			}
-		}
+				tColour4f* rowFloat = toneMap ? new tColour4f[width] : nullptr;
+				for (int r = begin; r < end; r++)
+				{
+					int yi = (height-1) - r;
+					const IMF::Rgba* rawRow = &pixels[yi*width];
+					tPixel4b* dstRow = newFrame->Pixels + r*width;
+					if (toneMap)
+					{
+						for (int xi = 0; xi < width; xi++)
+						{
+							const IMF::Rgba& rawPixel = rawRow[xi];
+							rowFloat[xi].Set
+							(
+								tMath::tMax(float(rawPixel.r) - defog*fogR, 0.0f),
+								tMath::tMax(float(rawPixel.g) - defog*fogG, 0.0f),
+								tMath::tMax(float(rawPixel.b) - defog*fogB, 0.0f),
+								tMath::tSaturate(float(rawPixel.a))
+							);
+						}
+						ToneMap(dstRow, rowFloat, width, toneParams);
+						continue;
+					}
+
+					for (int xi = 0; xi < width; xi++)
+					{
+						const IMF::Rgba& rawPixel = rawRow[xi];
+						dstRow[xi] = tPixel4b
+						(
+							EXR::Dither( redGamma(rawPixel.r), xi, yi ),
+							EXR::Dither( grnGamma(rawPixel.g), xi, yi ),
+							EXR::Dither( bluGamma(rawPixel.b), xi, yi ),
+							uint8( tMath::tClamp( tMath::tFloatToInt(float(rawPixel.a)*255.0f), 0, 0xFF ) )
+						);
+					}
+				}
+				delete[] rowFloat;
+			},
+			loadParams.NumThreads
+		);
 
 		Frames.Append(newFrame);
 	}
@@ -373,6 +413,105 @@ bool tImageEXR::Set(tPicture& picture, bool steal)
 }
 
 
+bool tImageEXR::Save(const tString& exrFile, const tPicture4f& picture, const SaveParams& params)
+{
+	if (!picture.IsValid())
+		return false;
+
+	if (tSystem::tGetFileType(exrFile) != tSystem::tFileType::EXR)
+		return false;
+
+	int w = picture.GetWidth();
+	int h = picture.GetHeight();
+	const tPixel4f* pixels = picture.GetPixels();
+
+	// OpenEXR wants the rows top to bottom.
+	bool opaque = true;
+	Rgba* halfPixels = new Rgba[w*h];
+	for (int y = 0; y < h; y++)
+	{
+		const tPixel4f* srcRow = pixels + (h-y-1)*w;
+		Rgba* dstRow = halfPixels + y*w;
+		for (int x = 0; x < w; x++)
+		{
+			dstRow[x] = Rgba(srcRow[x].R, srcRow[x].G, srcRow[x].B, srcRow[x].A);
+			if (srcRow[x].A != 1.0f)
+				opaque = false;
+		}
+	}
+
+	int numThreads = (params.NumThreads > 0) ? params.NumThreads : tGetNumCores();
+	bool success = true;
+	try
+	{
+		RgbaOutputFile file
+		(
+			exrFile.Chr(), w, h, opaque ? WRITE_RGB : WRITE_RGBA,
+			1.0f, V2f(0.0f, 0.0f), 1.0f, INCREASING_Y,
+			params.UseZLibCompression ? ZIP_COMPRESSION : NO_COMPRESSION,
+			numThreads
+		);
+		file.setFrameBuffer(halfPixels, 1, w);
+		file.writePixels(h);
+	}
+	catch (IEX_NAMESPACE::BaseExc& err)
+	{
+		tPrintf("Error: Can't write exr file. %s\n", err.what());
+		success = false;
+	}
+
+	delete[] halfPixels;
+	return success;
+}
+
+
+bool tImageEXR::Load(const tString& exrFile, tPicture4f& picture)
+{
+	picture.Clear();
+	if (tSystem::tGetFileType(exrFile) != tSystem::tFileType::EXR)
+		return false;
+
+	if (!tFileExists(exrFile))
+		return false;
+
+	Rgba* halfPixels = nullptr;
+	int w = 0; int h = 0;
+	try
+	{
+		RgbaInputFile file(exrFile.Chr(), tGetNumCores());
+		Box2i dataWindow = file.dataWindow();
+		w = dataWindow.max.x - dataWindow.min.x + 1;
+		h = dataWindow.max.y - dataWindow.min.y + 1;
+		if ((w <= 0) || (h <= 0))
+			return false;
+
+		halfPixels = new Rgba[w*h];
+		file.setFrameBuffer(halfPixels - dataWindow.min.x - dataWindow.min.y*w, 1, w);
+		file.readPixels(dataWindow.min.y, dataWindow.max.y);
+	}
+	catch (IEX_NAMESPACE::BaseExc& err)
+	{
+		tPrintf("Error: Can't read exr file. %s\n", err.what());
+		delete[] halfPixels;
+		return false;
+	}
+
+	// OpenEXR rows go top to bottom.
+	picture.Set(w, h);
+	tPixel4f* pixels = picture.GetPixels();
+	for (int y = 0; y < h; y++)
+	{
+		const Rgba* srcRow = halfPixels + y*w;
+		tPixel4f* dstRow = pixels + (h-y-1)*w;
+		for (int x = 0; x < w; x++)
+			dstRow[x].Set(float(srcRow[x].r), float(srcRow[x].g), float(srcRow[x].b), float(srcRow[x].a));
+	}
+
+	delete[] halfPixels;
+	return true;
+}
+
+
 tFrame* tImageEXR::GetFrame(bool steal)
 {
 	if (!IsValid())
@@ -20,6 +20,7 @@
 #include <gifenc/gifenc.h>
 #include "Image/tImageGIF.h"
 #include "Image/tPicture.h"
+#include "Image/tPixelUtil.h"
 using namespace tSystem;
 namespace tImage
 {
@@ -61,12 +62,38 @@ void tImageGIF::FrameLoadCallback(struct GIF_WHDR* whdr)
 	uint32 iter = whdr->intr ? 0 : 4;
     uint32 ifin = !iter ? 4 : 5;
 
+	// The palette is turned into an RGBA lookup table once per frame. The transparent entry maps to 0 like RGBA does.
+	// Indices past the end of the palette give opaque black.
+	tPixel4b palette[256];
+	for (int c = 0; c < 256; c++)
+	{
+		if (c == whdr->tran)
+			palette[c].BP = 0;
+		else if (c < whdr->clrs)
+			palette[c].Set(whdr->cpal[c].R, whdr->cpal[c].G, whdr->cpal[c].B);
+		else
+			palette[c].Set(0, 0, 0);
+	}
+
+	// Each source row is contiguous so frames without transparency can be expanded a row at a time. With transparency
+	// the pixels of the previous frame must show through, so those are skipped.
 	int y = 0;
-	for (uint32 dsrc = (uint32)-1; iter < ifin; iter++)
-		for (int yoff = 16U >> ((iter > 1) ? iter : 1), y = (8 >> iter) & 7; y < whdr->fryd; y += yoff)
+	const uint8* src = whdr->bptr;
+	for (; iter < ifin; iter++)
+	{
+		for (int yoff = 16U >> ((iter > 1) ? iter : 1), y = (8 >> iter) & 7; y < whdr->fryd; y += yoff, src += whdr->frxd)
+		{
+			tPixel4b* dst = pict + whdr->xdim * y + ddst;
+			if (whdr->tran < 0)
+			{
+				ExpandIndices(dst, src, whdr->frxd, 8, palette);
+				continue;
+			}
 			for (int x = 0; x < whdr->frxd; x++)
-				if (whdr->tran != (long)whdr->bptr[++dsrc])
-					pict[whdr->xdim * y + x + ddst].BP = RGBA(dsrc);
+				if (whdr->tran != long(src[x]))
+					dst[x] = palette[src[x]];
+		}
+	}
 
 	tFrame* frame = new tFrame;
 	frame->Width = Width;
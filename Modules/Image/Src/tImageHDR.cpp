@@ -40,8 +40,10 @@
 #include <Foundation/tStandard.h>
 #include <Foundation/tString.h>
 #include <System/tFile.h>
+#include <System/tThread.h>
 #include "Image/tImageHDR.h"
 #include "Image/tPicture.h"
+#include "Image/tPixelUtil.h"
 using namespace tSystem;
 namespace tImage
 {
@@ -49,10 +51,12 @@ namespace tImage
 
 void tImageHDR::SetupGammaTables(float gammaCorr)
 {
-	double gamma = double(gammaCorr);
-	if (GammaTable)
+	if (GammaTable && (gammaCorr == TableGamma))
 		return;
 
+	CleanupGammaTables();
+	TableGamma = gammaCorr;
+	double gamma = double(gammaCorr);
 	double invGamma = 1.0 / gamma;
 
 	// This table is used to convert from Radiance format to 24-bit.
@@ -90,27 +94,33 @@ void tImageHDR::CleanupGammaTables()
 	ExponentTable = nullptr;
 	if (GammaTable) free(GammaTable);
 	GammaTable = nullptr;
+	TableGamma = 0.0f;
 }
 
 
-bool tImageHDR::LegacyReadRadianceColours(tPixel4b* scanline, int len)
+bool tImageHDR::LegacyReadRadianceColours(tPixel4b* scanline, int len, const uint8*& readP, const uint8* endP)
 {
 	int  rshift = 0;
 	int  i;
 	
 	while (len > 0)
 	{
-		scanline[0].R = GetB();
-		scanline[0].G = GetB();
-		scanline[0].B = GetB();
-		scanline[0].A = i = GetB();
+		scanline[0].R = GetB(readP, endP);
+		scanline[0].G = GetB(readP, endP);
+		scanline[0].B = GetB(readP, endP);
+		scanline[0].A = i = GetB(readP, endP);
 		if (i == EOF)
 			return false;
 		if (scanline[0].R == 1 && scanline[0].G == 1 && scanline[0].B == 1)
 		{
-			for (i = scanline[0].A << rshift; i > 0; i--)
+			// A run may not extend past the end of the scanline.
+			int64 count = int64(scanline[0].A) << rshift;
+			if ((rshift > 24) || (count > len))
+				return false;
+			tPixel4b prev = scanline[-1];
+			for (i = int(count); i > 0; i--)
 			{
-				scanline[0] = scanline[-1];
+				scanline[0] = prev;
 				scanline++;
 				len--;
 			}
@@ -127,26 +137,26 @@ bool tImageHDR::LegacyReadRadianceColours(tPixel4b* scanline, int len)
 }
 
 
-bool tImageHDR::ReadRadianceColours(tPixel4b* scanline, int len)
+bool tImageHDR::ReadRadianceColours(tPixel4b* scanline, int len, const uint8*& readP, const uint8* endP)
 {
 	int  i, j;
 	int  code, val;
 	
 	// Determine if scanline is legacy and needs to be processed the old way.
 	if ((len < MinScanLen) | (len > MaxScanLen))
-		return LegacyReadRadianceColours(scanline, len);
+		return LegacyReadRadianceColours(scanline, len, readP, endP);
 
-	i = GetB();
+	i = GetB(readP, endP);
 	if (i == EOF)
 		return false;
 	if (i != 2)
 	{
-		UngetB(i);
-		return LegacyReadRadianceColours(scanline, len);
+		readP--;
+		return LegacyReadRadianceColours(scanline, len, readP, endP);
 	}
-	scanline[0].G = GetB();
-	scanline[0].B = GetB();
-	i = GetB();
+	scanline[0].G = GetB(readP, endP);
+	scanline[0].B = GetB(readP, endP);
+	i = GetB(readP, endP);
 	if (i == EOF)
 		return false;
 
@@ -154,7 +164,7 @@ bool tImageHDR::ReadRadianceColours(tPixel4b* scanline, int len)
 	{
 		scanline[0].R = 2;
 		scanline[0].A = i;
-		return LegacyReadRadianceColours(scanline+1, len-1);
+		return LegacyReadRadianceColours(scanline+1, len-1, readP, endP);
 	}
 	if ((scanline[0].B << 8 | i) != len)
 		return false;
@@ -164,7 +174,7 @@ bool tImageHDR::ReadRadianceColours(tPixel4b* scanline, int len)
 	{
 	    for (j = 0; j < len; )
 		{
-			code = GetB();
+			code = GetB(readP, endP);
 			if (code == EOF)
 				return false;
 
@@ -172,7 +182,7 @@ bool tImageHDR::ReadRadianceColours(tPixel4b* scanline, int len)
 			{
 				// RLE run.
 				code &= 127;
-				val = GetB();
+				val = GetB(readP, endP);
 				if (val == EOF)
 					return false;
 				if (j + code > len)
@@ -185,13 +195,10 @@ bool tImageHDR::ReadRadianceColours(tPixel4b* scanline, int len)
 				// New non-RLE colour.
 				if (j + code > len)
 		    		return false;	// Overrun.
+				if (code > endP - readP)
+					return false;
 				while (code--)
-				{
-					val = GetB();
-					if (val == EOF)
-						return false;
-					scanline[j++].E[i] = val;
-				}
+					scanline[j++].E[i] = *readP++;
 			}
 	    }
 	}
@@ -199,11 +206,74 @@ bool tImageHDR::ReadRadianceColours(tPixel4b* scanline, int len)
 }
 
 
-bool tImageHDR::ConvertRadianceToGammaCorrected(tPixel4b* scan, int len)
+bool tImageHDR::LegacySkipRadianceColours(int len, const uint8*& readP, const uint8* endP)
+{
+	int rshift = 0;
+	while (len > 0)
+	{
+		if (endP - readP < 4)
+			return false;
+		const uint8* colour = readP;
+		readP += 4;
+		if (colour[0] == 1 && colour[1] == 1 && colour[2] == 1)
+		{
+			int64 count = int64(colour[3]) << rshift;
+			if ((rshift > 24) || (count > len))
+				return false;
+			len -= int(count);
+			rshift += 8;
+		}
+		else
+		{
+			len--;
+			rshift = 0;
+		}
+	}
+	return true;
+}
+
+
+bool tImageHDR::SkipRadianceColours(int len, const uint8*& readP, const uint8* endP)
 {
-	if (!GammaTable)
+	// This must follow exactly the same decisions as ReadRadianceColours.
+	if ((len < MinScanLen) | (len > MaxScanLen))
+		return LegacySkipRadianceColours(len, readP, endP);
+
+	if (endP - readP < 4)
 		return false;
+	if (readP[0] != 2)
+		return LegacySkipRadianceColours(len, readP, endP);
+
+	const uint8* start = readP;
+	readP += 4;
+	if (start[1] != 2 || start[2] & 128)
+		return LegacySkipRadianceColours(len-1, readP, endP);
+	if ((start[2] << 8 | start[3]) != len)
+		return false;
+
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < len; )
+		{
+			int code = GetB(readP, endP);
+			if (code == EOF)
+				return false;
 
+			int count = (code > 128) ? (code & 127) : code;
+			int numBytes = (code > 128) ? 1 : code;
+			if ((j + count > len) || (numBytes > endP - readP))
+				return false;
+			j += count;
+			readP += numBytes;
+		}
+	}
+	return true;
+}
+
+
+void tImageHDR::ConvertRadianceToGammaCorrected(tPixel4b* dest, const tPixel4b* scan, int len) const
+{
+	tAssert(GammaTable);
 	while (len-- > 0)
 	{
 		int expo = scan[0].A - ExpXS;
@@ -211,40 +281,40 @@ bool tImageHDR::ConvertRadianceToGammaCorrected(tPixel4b* scan, int len)
 		{
 			if (expo < -MaxGammaShift-8)
 			{
-				scan[0].MakeBlack();
+				dest[0].MakeBlack();
 			}
 			else
 			{
 				int i = (-MaxGammaShift-1) - expo;
-				scan[0].R = GammaTable[MaxGammaShift][ ((scan[0].R >> i) + 1) >> 1 ];
-				scan[0].G = GammaTable[MaxGammaShift][ ((scan[0].G >> i) + 1) >> 1 ];
-				scan[0].B = GammaTable[MaxGammaShift][ ((scan[0].B >> i) + 1) >> 1 ];
+				dest[0].R = GammaTable[MaxGammaShift][ ((scan[0].R >> i) + 1) >> 1 ];
+				dest[0].G = GammaTable[MaxGammaShift][ ((scan[0].G >> i) + 1) >> 1 ];
+				dest[0].B = GammaTable[MaxGammaShift][ ((scan[0].B >> i) + 1) >> 1 ];
 			}
 		}
 		else if (expo > 0)
 		{
 			if (expo > 8)
 			{
-				scan[0].MakeWhite();
+				dest[0].MakeWhite();
 			}
 			else
 			{
 				int i;
-				i = (scan[0].R<<1 | 1) << (expo-1);		scan[0].R = i > 255 ? 255 : GammaTable[0][i];
-				i = (scan[0].G<<1 | 1) << (expo-1);		scan[0].G = i > 255 ? 255 : GammaTable[0][i];
-				i = (scan[0].B<<1 | 1) << (expo-1);		scan[0].B = i > 255 ? 255 : GammaTable[0][i];
+				i = (scan[0].R<<1 | 1) << (expo-1);		dest[0].R = i > 255 ? 255 : GammaTable[0][i];
+				i = (scan[0].G<<1 | 1) << (expo-1);		dest[0].G = i > 255 ? 255 : GammaTable[0][i];
+				i = (scan[0].B<<1 | 1) << (expo-1);		dest[0].B = i > 255 ? 255 : GammaTable[0][i];
 			}
 		}
 		else
 		{
-			scan[0].R = GammaTable[-expo][scan[0].R];
-			scan[0].G = GammaTable[-expo][scan[0].G];
-			scan[0].B = GammaTable[-expo][scan[0].B];
+			dest[0].R = GammaTable[-expo][scan[0].R];
+			dest[0].G = GammaTable[-expo][scan[0].G];
+			dest[0].B = GammaTable[-expo][scan[0].B];
 		}
-		scan[0].A = ExpXS;
+		dest[0].A = 255;
 		scan++;
+		dest++;
 	}
-	return true;
 }
 
 
@@ -291,14 +361,9 @@ bool tImageHDR::Load(uint8* hdrFileInMemory, int numBytes, const LoadParams& loa
 	if ((numBytes <= 0) || !hdrFileInMemory)
 		return false;
 
-	float gammaCorr = loadParams.Gamma;
-	int exposureAdj = loadParams.Exposure;
-	SetupGammaTables(gammaCorr);
-
 	// Search for the first double 0x0A (linefeed).
-	// Note that hdrFileInMemory has an extra EOF at the end. The (numBytes+1)th character.
 	int doubleLFIndex = -1;
-	for (int c = 0; c < numBytes; c++)
+	for (int c = 0; c < numBytes-1; c++)
 	{
 		if ((hdrFileInMemory[c] == 0x0A) && (hdrFileInMemory[c+1] == 0x0A))
 		{
@@ -307,10 +372,7 @@ bool tImageHDR::Load(uint8* hdrFileInMemory, int numBytes, const LoadParams& loa
 		}
 	}
 	if (doubleLFIndex == -1)
-	{
-		CleanupGammaTables();
 		return false;
-	}
 
 	// We are not allowed any '\0' characters in the header. Some Mac-generated images have one!
 	for (int c = 0; c < doubleLFIndex; c++)
@@ -319,19 +381,24 @@ bool tImageHDR::Load(uint8* hdrFileInMemory, int numBytes, const LoadParams& loa
 			hdrFileInMemory[c] = '_';
 	}
 
+	// The resolution line follows the double linefeed. We temporarily terminate the header there for the searches.
+	char* headerEnd = (char*)hdrFileInMemory + doubleLFIndex + 2;
+	char* eolRes = (char*)tStd::tMemchr(headerEnd, '\n', numBytes - (doubleLFIndex + 2));
+	if (!eolRes)
+		return false;
+	*eolRes = '\0';
 	char* foundY = tStd::tStrstr((char*)hdrFileInMemory, "-Y");
 	char* foundX = tStd::tStrstr((char*)hdrFileInMemory, "+X");
-	char* eolY = tStd::tStrchr(foundY, '\n');
-	char* eolX = tStd::tStrchr(foundX, '\n');
+	*eolRes = '\n';
+	char* eolY = foundY ? tStd::tStrchr(foundY, '\n') : nullptr;
+	char* eolX = foundX ? tStd::tStrchr(foundX, '\n') : nullptr;
 	if (!eolX || (eolX != eolY))
-	{
-		CleanupGammaTables();
 		return false;
-	}
 	*eolX = '\0';
 	tString header((char*)hdrFileInMemory);
 	*eolX = '\n';
-	ReadP = (uint8*)(eolX+1);
+	const uint8* readP = (const uint8*)(eolX+1);
+	const uint8* endP = hdrFileInMemory + numBytes;
 
 	tList<tStringItem> lines;
 	tStd::tExplode(lines, header, '\n');
@@ -343,48 +410,112 @@ bool tImageHDR::Load(uint8* hdrFileInMemory, int numBytes, const LoadParams& loa
 
 	tList<tStringItem> comps;
 	tStd::tExplode(comps, *resLine, ' ');
-	Height = comps.First()->Next()->AsInt();
-	Width = comps.First()->Next()->Next()->Next()->AsInt();
-
-	Pixels = new tPixel4b[Width*Height];
-	tPixel4b* scanin = new tPixel4b[Width];
+	if (comps.GetNumItems() < 4)
+		return false;
+	int height = comps.First()->Next()->AsInt();
+	int width = comps.First()->Next()->Next()->Next()->AsInt();
+	if ((width <= 0) || (height <= 0) || (int64(width)*int64(height) > int64(0x7FFFFFFF) / int64(sizeof(tPixel4f))))
+		return false;
 
+	// Scanlines are variable length so we need one sequential pass to find where each one starts. This only parses
+	// the run-length codes, so it is much faster than decoding.
+	const uint8** scanlineStart = new const uint8*[height];
 	bool ok = true;
-	for (int y = Height-1; y >= 0; y--)
+	for (int s = 0; (s < height) && ok; s++)
 	{
-		ok = ReadRadianceColours(scanin, Width);
-		if (!ok)
-			break;
-
-		AdjustExposure(scanin, Width, exposureAdj);
-
-		ok = ConvertRadianceToGammaCorrected(scanin, Width);
-		if (!ok)
-			break;
-
-		WriteP = (uint8*)&Pixels[y * Width];
-		for (int x = 0; x < Width; x++)
-		{
-			PutB(scanin[x].R);
-			PutB(scanin[x].G);
-			PutB(scanin[x].B);
-			PutB(255);
-		}
+		scanlineStart[s] = readP;
+		ok = SkipRadianceColours(width, readP, endP);
+	}
+	if (!ok)
+	{
+		delete[] scanlineStart;
+		return false;
 	}
 
-	CleanupGammaTables();
-	delete[] scanin;
+	bool outputFloat = loadParams.OutputFloat;
+	int exposureAdj = loadParams.Exposure;
+	bool toneMap = !outputFloat && (loadParams.ToneMap != tToneMapOperator::None);
+	if (outputFloat)
+		Pixels4f = new tPixel4f[width*height];
+	else
+		Pixels = new tPixel4b[width*height];
+
+	// The gamma tables must be ready before the threads start. After this they are only read.
+	if (!outputFloat && !toneMap)
+		SetupGammaTables(loadParams.Gamma);
+
+	// The exposure is already applied to the RGBE exponents so the operator gets a unit multiplier. Each thread maps
+	// its own scanlines so the tone-mapper itself is single-threaded here.
+	tToneMapParams toneParams;
+	toneParams.Operator			= loadParams.ToneMap;
+	toneParams.Exposure			= 1.0f;
+	toneParams.GammaCompression	= true;
+	toneParams.Gamma			= loadParams.Gamma;
+	toneParams.NumThreads		= 1;
+
+	// The first scanline in the file is the top row. Each thread has its own scanline buffer. The extra pixel at the
+	// front is for legacy runs that start at the beginning of a scanline.
+	bool* scanlineOK = new bool[height];
+	tSystem::tParallelFor
+	(
+		height,
+		[&](int begin, int end)
+		{
+			tPixel4b* scanBuffer = new tPixel4b[width+1];
+			scanBuffer[0].MakeZero();
+			tPixel4b* scanin = scanBuffer + 1;
+			tColour4f* scanFloat = toneMap ? new tColour4f[width] : nullptr;
+			for (int s = begin; s < end; s++)
+			{
+				const uint8* scanP = scanlineStart[s];
+				scanlineOK[s] = ReadRadianceColours(scanin, width, scanP, endP);
+				if (!scanlineOK[s])
+					continue;
+
+				AdjustExposure(scanin, width, exposureAdj);
+				int y = (height-1) - s;
+				if (outputFloat)
+				{
+					ConvertRGBEToFloat(Pixels4f + y*width, scanin, width);
+				}
+				else if (toneMap)
+				{
+					ConvertRGBEToFloat(scanFloat, scanin, width);
+					ToneMap(Pixels + y*width, scanFloat, width, toneParams);
+				}
+				else
+					ConvertRadianceToGammaCorrected(Pixels + y*width, scanin, width);
+			}
+			delete[] scanFloat;
+			delete[] scanBuffer;
+		},
+		loadParams.NumThreads
+	);
+
+	for (int s = 0; s < height; s++)
+		ok = ok && scanlineOK[s];
+	delete[] scanlineOK;
+	delete[] scanlineStart;
 	if (!ok)
 	{
-		delete[] Pixels;
-		Pixels = nullptr;
+		Clear();
 		return false;
 	}
 
+	Width = width;
+	Height = height;
 	PixelFormatSrc = tPixelFormat::RADIANCE;
-	PixelFormat = tPixelFormat::R8G8B8A8;
 	ColourProfileSrc = tColourProfile::HDRa;	// The source pixels are HDR.
-	ColourProfile = tColourProfile::sRGB;		// The decoded pixels are in sRGB space.
+	if (outputFloat)
+	{
+		PixelFormat = tPixelFormat::R32G32B32A32f;
+		ColourProfile = tColourProfile::HDRa;	// The decoded pixels are linear HDR.
+	}
+	else
+	{
+		PixelFormat = tPixelFormat::R8G8B8A8;
+		ColourProfile = tColourProfile::sRGB;	// The decoded pixels are in sRGB space.
+	}
 	return true;
 }
 
@@ -459,7 +590,7 @@ bool tImageHDR::Set(tPicture& picture, bool steal)
 
 tFrame* tImageHDR::GetFrame(bool steal)
 {
-	if (!IsValid())
+	if (!Pixels)
 		return nullptr;
 
 	tFrame* frame = new tFrame();
@@ -488,4 +619,13 @@ tPixel4b* tImageHDR::StealPixels()
 }
 
 
+tPixel4f* tImageHDR::StealPixels4f()
+{
+	tPixel4f* pixels = Pixels4f;
+	Pixels4f = nullptr;
+	Clear();
+	return pixels;
+}
+
+
 }
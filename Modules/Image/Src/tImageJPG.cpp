@@ -16,16 +16,308 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <System/tFile.h>
+#include <System/tThread.h>
 #include "Image/tImageJPG.h"
 #include "Image/tPicture.h"
+#include "Image/tPixelUtil.h"
 #include "turbojpeg.h"
-
-
+#include <csetjmp>
+#include <cstdio>
+#include "jpeglib.h"
 using namespace tSystem;
 namespace tImage
 {
 
 
+namespace tJPG
+{
+	// The default libjpeg error handler exits the process. This one jumps back to the decode function instead.
+	struct ErrorManager
+	{
+		jpeg_error_mgr Mgr;		// Must be first.
+		jmp_buf Jump;
+	};
+	void ErrorExit(j_common_ptr);
+	void OutputMessage(j_common_ptr)																					{ }
+	void InitErrorManager(jpeg_decompress_struct&, ErrorManager&);
+	void InitErrorManager(jpeg_compress_struct&, ErrorManager&);
+
+	// Returns the number of scans (SOS markers) in the file. Marker segments are skipped so embedded thumbnails are
+	// not counted.
+	int CountScans(const uint8* jpgFileInMemory, int numBytes);
+
+	// Gets the luma sampling factors for the subsampling mode. Chroma is always 1x1 so these are also the MCU size in
+	// 8x8 blocks.
+	void GetSamplingFactors(tImageJPG::Subsampling, int& hSamp, int& vSamp);
+
+	// Compresses numRows rows of the image starting at jpg row startRow. Jpg rows go top to bottom while the pixels
+	// go bottom to top. If restartInterval is > 0 a restart happens every restartInterval MCUs. On success jpgBuf is
+	// allocated by libjpeg and must be released with free.
+	bool Compress
+	(
+		uint8*& jpgBuf, ulong& jpgSize, const tPixel4b* pixels, int width, int height,
+		int startRow, int numRows, const tImageJPG::SaveParams&, int restartInterval = 0
+	);
+
+	// Same result as Compress for the whole image, but the image is split into bands of MCU rows that are compressed
+	// concurrently. Each band is exactly one restart interval so they can be joined into a single baseline scan by
+	// placing a restart marker between them. Huffman tables must not be optimized and the output is not progressive.
+	bool CompressBands(uint8*& jpgBuf, ulong& jpgSize, const tPixel4b* pixels, int width, int height, const tImageJPG::SaveParams&);
+
+	// Returns the offset of the first byte of entropy-coded data after the first scan header, or -1 if there isn't
+	// one. If frameHeight is >= 0 the height in a baseline frame header is overwritten with it.
+	int FindScanData(uint8* jpg, int numBytes, int frameHeight = -1);
+}
+
+
+void tJPG::ErrorExit(j_common_ptr cinfo)
+{
+	ErrorManager* errorManager = (ErrorManager*)cinfo->err;
+	longjmp(errorManager->Jump, 1);
+}
+
+
+void tJPG::InitErrorManager(jpeg_decompress_struct& cinfo, ErrorManager& errorManager)
+{
+	cinfo.err = jpeg_std_error(&errorManager.Mgr);
+	errorManager.Mgr.error_exit = ErrorExit;
+	errorManager.Mgr.output_message = OutputMessage;
+}
+
+
+void tJPG::InitErrorManager(jpeg_compress_struct& cinfo, ErrorManager& errorManager)
+{
+	cinfo.err = jpeg_std_error(&errorManager.Mgr);
+	errorManager.Mgr.error_exit = ErrorExit;
+	errorManager.Mgr.output_message = OutputMessage;
+}
+
+
+int tJPG::CountScans(const uint8* jpg, int numBytes)
+{
+	int numScans = 0;
+	int i = 2;
+	while (i+3 < numBytes)
+	{
+		// Skip anything that isn't a marker including fill bytes.
+		uint8 marker = jpg[i+1];
+		if ((jpg[i] != 0xFF) || (marker == 0xFF))
+		{
+			i++;
+			continue;
+		}
+
+		// End of image.
+		if (marker == 0xD9)
+			break;
+
+		// Stand-alone markers have no length.
+		if ((marker == 0x01) || ((marker >= 0xD0) && (marker <= 0xD7)))
+		{
+			i += 2;
+			continue;
+		}
+
+		int length = (jpg[i+2] << 8) | jpg[i+3];
+		i += 2 + length;
+		if (marker != 0xDA)
+			continue;
+
+		// Entropy-coded data follows a scan header. Any 0xFF in it is followed by a stuffed zero or a restart marker.
+		numScans++;
+		while ((i+1 < numBytes) && !((jpg[i] == 0xFF) && (jpg[i+1] != 0x00) && ((jpg[i+1] < 0xD0) || (jpg[i+1] > 0xD7))))
+			i++;
+	}
+
+	return numScans;
+}
+
+
+void tJPG::GetSamplingFactors(tImageJPG::Subsampling subsampling, int& hSamp, int& vSamp)
+{
+	hSamp = ((subsampling == tImageJPG::Subsampling::S422) || (subsampling == tImageJPG::Subsampling::S420)) ? 2 : 1;
+	vSamp = ((subsampling == tImageJPG::Subsampling::S440) || (subsampling == tImageJPG::Subsampling::S420)) ? 2 : 1;
+}
+
+
+bool tJPG::Compress
+(
+	uint8*& jpgBuf, ulong& jpgSize, const tPixel4b* pixels, int width, int height,
+	int startRow, int numRows, const tImageJPG::SaveParams& params, int restartInterval
+)
+{
+	jpgBuf = nullptr;
+	jpgSize = 0;
+
+	// Errors longjmp back here. Nothing between here and the libjpeg calls below may need destructing. The mem
+	// destination frees and replaces its buffer whenever it grows but only writes the new pointer back to jpgBuf when
+	// terminated, so it is terminated first to make jpgBuf the live buffer before freeing it.
+	jpeg_compress_struct cinfo;
+	cinfo.dest = nullptr;
+	ErrorManager errorManager;
+	InitErrorManager(cinfo, errorManager);
+	if (setjmp(errorManager.Jump))
+	{
+		if (cinfo.dest)
+			cinfo.dest->term_destination(&cinfo);
+		jpeg_destroy_compress(&cinfo);
+		free(jpgBuf);
+		jpgBuf = nullptr;
+		jpgSize = 0;
+		return false;
+	}
+
+	jpeg_create_compress(&cinfo);
+	jpeg_mem_dest(&cinfo, &jpgBuf, &jpgSize);
+	cinfo.image_width = width;
+	cinfo.image_height = numRows;
+	cinfo.input_components = 4;
+	cinfo.in_color_space = JCS_EXT_RGBA;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, params.Quality, TRUE);
+	cinfo.dct_method = params.FastDCT ? JDCT_IFAST : JDCT_ISLOW;
+	cinfo.optimize_coding = params.OptimizeHuffman ? TRUE : FALSE;
+	cinfo.restart_interval = restartInterval;
+
+	int hSamp, vSamp;
+	GetSamplingFactors(params.Subsampling, hSamp, vSamp);
+	cinfo.comp_info[0].h_samp_factor = hSamp;
+	cinfo.comp_info[0].v_samp_factor = vSamp;
+	for (int c = 1; c < cinfo.num_components; c++)
+	{
+		cinfo.comp_info[c].h_samp_factor = 1;
+		cinfo.comp_info[c].v_samp_factor = 1;
+	}
+	if (params.Progressive)
+		jpeg_simple_progression(&cinfo);
+
+	jpeg_start_compress(&cinfo, TRUE);
+	while (cinfo.next_scanline < cinfo.image_height)
+	{
+		JSAMPROW row = (JSAMPROW)(pixels + (height - 1 - startRow - int(cinfo.next_scanline))*width);
+		jpeg_write_scanlines(&cinfo, &row, 1);
+	}
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+	return true;
+}
+
+
+bool tJPG::CompressBands(uint8*& jpgBuf, ulong& jpgSize, const tPixel4b* pixels, int width, int height, const tImageJPG::SaveParams& params)
+{
+	jpgBuf = nullptr;
+	jpgSize = 0;
+
+	// The restart interval is a 16-bit count of MCUs, which limits how many MCU rows fit in a band.
+	int hSamp, vSamp;
+	GetSamplingFactors(params.Subsampling, hSamp, vSamp);
+	int mcuRowHeight = 8*vSamp;
+	int mcusPerRow = (width + 8*hSamp - 1) / (8*hSamp);
+	int numMCURows = (height + mcuRowHeight - 1) / mcuRowHeight;
+	int numThreads = tSystem::tGetNumWorkerThreads(numMCURows, params.NumThreads);
+	int bandMCURows = tMath::tMin((numMCURows + numThreads - 1) / numThreads, 0xFFFF / mcusPerRow);
+	int numBands = (bandMCURows > 0) ? (numMCURows + bandMCURows - 1) / bandMCURows : 1;
+	if (numBands <= 1)
+		return Compress(jpgBuf, jpgSize, pixels, width, height, 0, height, params);
+
+	uint8** bandBufs = new uint8*[numBands];
+	ulong* bandSizes = new ulong[numBands];
+	bool* bandCompressed = new bool[numBands];
+	int bandHeight = bandMCURows*mcuRowHeight;
+	auto compressBands = [&](int begin, int end)
+	{
+		for (int b = begin; b < end; b++)
+		{
+			int startRow = b*bandHeight;
+			int numRows = tMath::tMin(bandHeight, height - startRow);
+			bandCompressed[b] = Compress(bandBufs[b], bandSizes[b], pixels, width, height, startRow, numRows, params, bandMCURows*mcusPerRow);
+		}
+	};
+	tSystem::tParallelFor(numBands, compressBands, params.NumThreads);
+
+	// The first band supplies the headers with the frame height patched to the full image. The others contribute only
+	// their entropy-coded data, which runs from the end of the scan header up to the EOI marker.
+	bool success = true;
+	int* dataStart = new int[numBands];
+	ulong totalSize = 0;
+	for (int b = 0; b < numBands; b++)
+	{
+		int start = bandCompressed[b] ? FindScanData(bandBufs[b], int(bandSizes[b]), b ? -1 : height) : -1;
+		if ((start < 0) || (bandSizes[b] < ulong(start) + 2))
+		{
+			success = false;
+			continue;
+		}
+		dataStart[b] = b ? start : 0;
+		totalSize += bandSizes[b] - dataStart[b];
+	}
+
+	// Every band after the first is preceded by the RSTn marker that ends the previous interval. RSTn cycle through
+	// 0 to 7. The 2 bytes of each band's EOI marker make room for these and the final EOI.
+	if (success)
+	{
+		jpgBuf = (uint8*)malloc(totalSize);
+		jpgSize = totalSize;
+		uint8* dst = jpgBuf;
+		for (int b = 0; b < numBands; b++)
+		{
+			if (b)
+			{
+				*dst++ = 0xFF;
+				*dst++ = uint8(0xD0 + ((b-1) & 7));
+			}
+			int numDataBytes = int(bandSizes[b]) - dataStart[b] - 2;
+			tStd::tMemcpy(dst, bandBufs[b] + dataStart[b], numDataBytes);
+			dst += numDataBytes;
+		}
+		*dst++ = 0xFF;
+		*dst++ = 0xD9;
+	}
+
+	for (int b = 0; b < numBands; b++)
+		if (bandCompressed[b])
+			free(bandBufs[b]);
+	delete[] dataStart;
+	delete[] bandCompressed;
+	delete[] bandSizes;
+	delete[] bandBufs;
+	return success;
+}
+
+
+int tJPG::FindScanData(uint8* jpg, int numBytes, int frameHeight)
+{
+	int i = 2;
+	while (i+3 < numBytes)
+	{
+		if (jpg[i] != 0xFF)
+			return -1;
+
+		// Fill bytes.
+		uint8 marker = jpg[i+1];
+		if (marker == 0xFF)
+		{
+			i++;
+			continue;
+		}
+
+		// The SOF0 segment is the length, precision, then the 16-bit big-endian height.
+		if ((marker == 0xC0) && (frameHeight >= 0) && (i+6 < numBytes))
+		{
+			jpg[i+5] = uint8(frameHeight >> 8);
+			jpg[i+6] = uint8(frameHeight & 0xFF);
+		}
+
+		int length = (jpg[i+2] << 8) | jpg[i+3];
+		i += 2 + length;
+		if (marker == 0xDA)
+			return (i <= numBytes) ? i : -1;
+	}
+
+	return -1;
+}
+
+
 void tImageJPG::Clear()
 {
 	Width = 0;
@@ -80,6 +372,48 @@ bool tImageJPG::Load(const uint8* jpgFileInMemory, int numBytes, const LoadParam
 
 	PopulateMetaData(jpgFileInMemory, numBytes);
 
+	// Scan by scan decoding is only needed for previews. Single-scan files always use turbojpeg. Regions take
+	// precedence over previews.
+	bool success = false;
+	if ((params.RegionWidth > 0) && (params.RegionHeight > 0))
+	{
+		success = DecodeRegion(jpgFileInMemory, numBytes, params);
+	}
+	else
+	{
+		bool multiScan = false;
+		success = params.Progressive ? DecodeScans(jpgFileInMemory, numBytes, params, multiScan) : true;
+		if (success && !multiScan)
+			success = Decode(jpgFileInMemory, numBytes, params);
+	}
+
+	if (!success)
+	{
+		Clear();
+		return false;
+	}
+
+	// The flips and rotates do not clear the pixel format.
+	if ((params.Flags & LoadFlag_ExifOrient))
+	{
+		const tMetaDatum& datum = MetaData[tMetaTag::Orientation];
+		if (datum.IsSet())
+			ExifOrient(datum.Uint32);
+	}
+
+	PixelFormatSrc = tPixelFormat::R8G8B8;
+	PixelFormat = tPixelFormat::R8G8B8A8;
+
+	// JPG file are assumed to be in sRGB.
+	ColourProfileSrc = tColourProfile::sRGB;
+	ColourProfile = tColourProfile::sRGB;
+
+	return true;
+}
+
+
+bool tImageJPG::Decode(const uint8* jpgFileInMemory, int numBytes, const LoadParams& params)
+{
 	tjhandle tjInstance = tjInitDecompress();
 	if (!tjInstance)
 		return false;
@@ -88,7 +422,10 @@ bool tImageJPG::Load(const uint8* jpgFileInMemory, int numBytes, const LoadParam
 	int colourSpace = 0;
 	int headerResult = tjDecompressHeader3(tjInstance, jpgFileInMemory, numBytes, &Width, &Height, &subSamp, &colourSpace);
 	if (headerResult < 0)
+	{
+		tjDestroy(tjInstance);
 		return false;
+	}
 
 	int numPixels = Width * Height;
 	Pixels = new tPixel4b[numPixels];
@@ -124,66 +461,195 @@ bool tImageJPG::Load(const uint8* jpgFileInMemory, int numBytes, const LoadParam
 	}
 
 	tjDestroy(tjInstance);
-	if (abortLoad)
+	return !abortLoad;
+}
+
+
+bool tImageJPG::DecodeScans(const uint8* jpgFileInMemory, int numBytes, const LoadParams& params, bool& multiScan)
+{
+	multiScan = false;
+
+	// Errors longjmp back here. Nothing between here and the libjpeg calls below may need destructing.
+	jpeg_decompress_struct cinfo;
+	tJPG::ErrorManager errorManager;
+	tJPG::InitErrorManager(cinfo, errorManager);
+	if (setjmp(errorManager.Jump))
 	{
-		Clear();
+		jpeg_destroy_decompress(&cinfo);
 		return false;
 	}
 
-	// The flips and rotates below do not clear the pixel format.
-	if ((params.Flags & LoadFlag_ExifOrient))
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, jpgFileInMemory, numBytes);
+	jpeg_read_header(&cinfo, TRUE);
+	if (!jpeg_has_multiple_scans(&cinfo))
 	{
-		const tMetaDatum& datum = MetaData[tMetaTag::Orientation];
-		if (datum.IsSet())
+		jpeg_destroy_decompress(&cinfo);
+		return true;
+	}
+	multiScan = true;
+
+	// Same output settings as the turbojpeg path. Block smoothing only changes scans before the last, so the final
+	// image matches a regular load.
+	cinfo.buffered_image = TRUE;
+	cinfo.out_color_space = JCS_EXT_RGBA;
+	cinfo.dct_method = JDCT_ISLOW;
+	jpeg_start_decompress(&cinfo);
+
+	Width = cinfo.output_width;
+	Height = cinfo.output_height;
+	Pixels = new tPixel4b[Width*Height];
+	int numScans = tJPG::CountScans(jpgFileInMemory, numBytes);
+	const tMetaDatum& orientation = MetaData[tMetaTag::Orientation];
+	bool orient = (params.Flags & LoadFlag_ExifOrient) && orientation.IsSet();
+
+	// Each output pass shows everything received up to and including the current scan. jpeg_finish_output reads up
+	// to the next scan so the input is complete after the output pass for the last scan.
+	for (int scan = 0; ; scan++)
+	{
+		jpeg_start_output(&cinfo, cinfo.input_scan_number);
+		while (cinfo.output_scanline < cinfo.output_height)
 		{
-			switch (datum.Uint32)
-			{
-				case 0:		// Unspecified
-				case 1:		// NoTransform
-					break;
-
-				case 2:		// Flip-Y.
-					Flip(true);
-					break;
-
-				case 3:		// Flip-XY
-					Flip(false);
-					Flip(true);
-					break;
-
-				case 4:		// Flip-X
-					Flip(false);
-					break;
-
-				case 5:		// Rot-CW90 Flip-Y
-					Flip(true);
-					Rotate90(true);
-					break;
-				
-				case 6:		// Rot-ACW90
-					Rotate90(false);
-					break;
-
-				case 7:		// Rot-ACW90 Flip-Y
-					Flip(true);
-					Rotate90(false);
-					break;
-
-				case 8:		// Rot-CW90
-					Rotate90(true);
-					break;
-			}
+			JSAMPROW row = (JSAMPROW)(Pixels + ((Height-1) - int(cinfo.output_scanline))*Width);
+			jpeg_read_scanlines(&cinfo, &row, 1);
 		}
+		jpeg_finish_output(&cinfo);
+		if (jpeg_input_complete(&cinfo))
+			break;
+
+		tFrame preview;
+		if (orient)
+		{
+			tImageJPG oriented(Pixels, Width, Height);
+			oriented.ExifOrient(orientation.Uint32);
+			preview.StealFrom(oriented.Pixels, oriented.Width, oriented.Height);
+			oriented.Pixels = nullptr;
+		}
+		else
+		{
+			preview.Set(Pixels, Width, Height);
+		}
+		preview.PixelFormatSrc = tPixelFormat::R8G8B8;
+		params.Progressive(preview, scan, tMath::tMax(numScans, scan+2));
 	}
 
-	PixelFormatSrc = tPixelFormat::R8G8B8;
-	PixelFormat = tPixelFormat::R8G8B8A8;
+	jpeg_finish_decompress(&cinfo);
+	bool warned = (errorManager.Mgr.num_warnings > 0);
+	jpeg_destroy_decompress(&cinfo);
+	return !(warned && (params.Flags & LoadFlag_Strict));
+}
 
-	// JPG file are assumed to be in sRGB.
-	ColourProfileSrc = tColourProfile::sRGB;
-	ColourProfile = tColourProfile::sRGB;
 
-	return true;
+bool tImageJPG::DecodeRegion(const uint8* jpgFileInMemory, int numBytes, const LoadParams& params)
+{
+	// Errors longjmp back here. The row buffer is volatile so it can be freed after the jump.
+	jpeg_decompress_struct cinfo;
+	tJPG::ErrorManager errorManager;
+	tJPG::InitErrorManager(cinfo, errorManager);
+	tPixel4b* volatile rowBuffer = nullptr;
+	if (setjmp(errorManager.Jump))
+	{
+		delete[] rowBuffer;
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, jpgFileInMemory, numBytes);
+	jpeg_read_header(&cinfo, TRUE);
+	cinfo.out_color_space = JCS_EXT_RGBA;
+	cinfo.dct_method = JDCT_ISLOW;
+
+	// For progressive files this reads every scan into the full-image coefficient buffer.
+	jpeg_start_decompress(&cinfo);
+
+	int regionX = params.RegionX;
+	int regionY = params.RegionY;
+	int regionW = params.RegionWidth;
+	int regionH = params.RegionHeight;
+	if (!ClipRegion(regionX, regionY, regionW, regionH, cinfo.output_width, cinfo.output_height))
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+
+	// Fancy upsampling of subsampled chroma reads neighbouring samples, so the crop and skip keep a margin of one
+	// iMCU around the region. This makes the region exactly match the same pixels of a full decode. The crop is also
+	// widened to iMCU boundaries so the decoded rows may start left of the region.
+	int marginX = cinfo.max_h_samp_factor * DCTSIZE;
+	int marginY = cinfo.max_v_samp_factor * DCTSIZE;
+	int cropLeft = tMath::tMax(regionX - marginX, 0);
+	int cropRight = tMath::tMin(regionX + regionW + marginX, int(cinfo.output_width));
+	JDIMENSION cropX = cropLeft;
+	JDIMENSION cropW = cropRight - cropLeft;
+	jpeg_crop_scanline(&cinfo, &cropX, &cropW);
+	int skipX = regionX - int(cropX);
+
+	int top = cinfo.output_height - (regionY + regionH);
+	int skipRows = tMath::tMax(top - marginY, 0);
+	if (skipRows > 0)
+		jpeg_skip_scanlines(&cinfo, skipRows);
+
+	Width = regionW;
+	Height = regionH;
+	Pixels = new tPixel4b[Width*Height];
+	rowBuffer = new tPixel4b[cropW];
+	for (int y = skipRows; y < top+Height; y++)
+	{
+		JSAMPROW row = (JSAMPROW)rowBuffer;
+		jpeg_read_scanlines(&cinfo, &row, 1);
+		if (y >= top)
+			tStd::tMemcpy(Pixels + ((Height-1) - (y-top))*Width, rowBuffer + skipX, Width*sizeof(tPixel4b));
+	}
+
+	// Nothing below the region is decoded.
+	delete[] rowBuffer;
+	bool warned = (errorManager.Mgr.num_warnings > 0);
+	jpeg_abort_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+	return !(warned && (params.Flags & LoadFlag_Strict));
+}
+
+
+void tImageJPG::ExifOrient(uint32 orientation)
+{
+	switch (orientation)
+	{
+		case 0:		// Unspecified
+		case 1:		// NoTransform
+			break;
+
+		case 2:		// Flip-Y.
+			Flip(true);
+			break;
+
+		case 3:		// Flip-XY
+			Flip(false);
+			Flip(true);
+			break;
+
+		case 4:		// Flip-X
+			Flip(false);
+			break;
+
+		case 5:		// Rot-CW90 Flip-Y
+			Flip(true);
+			Rotate90(true);
+			break;
+		
+		case 6:		// Rot-ACW90
+			Rotate90(false);
+			break;
+
+		case 7:		// Rot-ACW90 Flip-Y
+			Flip(true);
+			Rotate90(false);
+			break;
+
+		case 8:		// Rot-CW90
+			Rotate90(true);
+			break;
+	}
 }
 
 
@@ -449,38 +915,24 @@ bool tImageJPG::Save(const tString& jpgFile, const SaveParams& params) const
 		return (numWritten == MemImageSize);
 	}
 
-	tjhandle tjInstance = tjInitCompress();
-	if (!tjInstance)
-		return false;
-
 	uint8* jpegBuf = nullptr;
 	ulong jpegSize = 0;
-
-	int flags = 0;
-	flags |= TJFLAG_BOTTOMUP;
-	//flags |= TJFLAG_FASTUPSAMPLE;
-	//flags |= TJFLAG_FASTDCT;
-	flags |= TJFLAG_ACCURATEDCT;
-
-    int compResult = tjCompress2(tjInstance, (uint8*)Pixels, Width, 0, Height, TJPF_RGBA,
-    	&jpegBuf, &jpegSize, TJSAMP_444, params.Quality, flags);
-
-	tjDestroy(tjInstance);
-	if (compResult < 0)
-	{
-		tjFree(jpegBuf);
+	bool banded = (params.NumThreads != 1) && !params.OptimizeHuffman && !params.Progressive;
+	bool compressed = banded ?
+		tJPG::CompressBands(jpegBuf, jpegSize, Pixels, Width, Height, params) :
+		tJPG::Compress(jpegBuf, jpegSize, Pixels, Width, Height, 0, Height, params);
+	if (!compressed)
 		return false;
-	}
 
 	tFileHandle fileHandle = tOpenFile(jpgFile.Chars(), "wb");
 	if (!fileHandle)
 	{
-		tjFree(jpegBuf);
+		free(jpegBuf);
 		return false;
 	}
 	bool success = tWriteFile(fileHandle, jpegBuf, jpegSize);
 	tCloseFile(fileHandle);
-	tjFree(jpegBuf);
+	free(jpegBuf);
 
 	return success;
 }
@@ -16,9 +16,11 @@
 #include <Foundation/tString.h>
 #include <Foundation/tSmallFloat.h>
 #include <System/tMachine.h>
+#include <System/tThread.h>
 #include "Image/tImageKTX.h"
 #include "Image/tPixelUtil.h"
 #include "Image/tPicture.h"
+#include "Image/tTexture.h"
 #include "bcdec/bcdec.h"
 #include "etcdec/etcdec.h"
 #include "astcenc.h"
@@ -39,6 +41,50 @@ namespace tKTX
 	// satellite information cannot be determined, in which case they get set the their 'unspecified' enumerants.
 	void GetFormatInfo_FromGLFormat(tPixelFormat&, tColourProfile&, tAlphaMode&, tChannelType&, uint32 glType, uint32 glFormat, uint32 glInternalFormat);
 	void GetFormatInfo_FromVKFormat(tPixelFormat&, tColourProfile&, tAlphaMode&, tChannelType&, uint32 vkFormat);
+
+	// Returns the libktx transcode target for a Basis Universal payload. Returns KTX_TTF_NOSELECTION if the pixel
+	// format is not a supported target.
+	ktx_transcode_fmt_e GetTranscodeFormat(tPixelFormat);
+	tImageKTX::tSupercompression GetSupercompression(ktxSupercmpScheme);
+
+	// The inverse of GetFormatInfo_FromVKFormat used when saving. Returns VK_FORMAT_UNDEFINED if the pixel format has
+	// no VkFormat or the writer does not support it.
+	uint32 GetVKFormat(tPixelFormat, tColourProfile);
+
+	// The KTX2 typeSize. This is the size of the data type used for each component. 1 for block formats.
+	uint32 GetTypeSize(tPixelFormat);
+
+	// Appends a KTX2 key/value pair, including its trailing padding, to the supplied buffer. Returns the new size.
+	int AppendKeyValue(uint8* buffer, int size, const char* key, const char* value);
+}
+
+
+ktx_transcode_fmt_e tKTX::GetTranscodeFormat(tPixelFormat format)
+{
+	switch (format)
+	{
+		case tPixelFormat::R8G8B8A8:		return KTX_TTF_RGBA32;
+		case tPixelFormat::BC1DXT1:			return KTX_TTF_BC1_RGB;
+		case tPixelFormat::BC3DXT4DXT5:		return KTX_TTF_BC3_RGBA;
+		case tPixelFormat::BC7:				return KTX_TTF_BC7_RGBA;
+		case tPixelFormat::ETC1:			return KTX_TTF_ETC1_RGB;
+		case tPixelFormat::ETC2RGBA:		return KTX_TTF_ETC2_RGBA;
+		case tPixelFormat::ASTC4X4:			return KTX_TTF_ASTC_4x4_RGBA;
+	}
+	return KTX_TTF_NOSELECTION;
+}
+
+
+tImageKTX::tSupercompression tKTX::GetSupercompression(ktxSupercmpScheme scheme)
+{
+	switch (scheme)
+	{
+		case KTX_SS_NONE:		return tImageKTX::tSupercompression::None;
+		case KTX_SS_BASIS_LZ:	return tImageKTX::tSupercompression::BasisLZ;
+		case KTX_SS_ZSTD:		return tImageKTX::tSupercompression::Zstd;
+		case KTX_SS_ZLIB:		return tImageKTX::tSupercompression::Zlib;
+	}
+	return tImageKTX::tSupercompression::Unknown;
 }
 
 
@@ -518,6 +564,122 @@ void tKTX::GetFormatInfo_FromVKFormat(tPixelFormat& format, tColourProfile& prof
 }
 
 
+uint32 tKTX::GetVKFormat(tPixelFormat format, tColourProfile profile)
+{
+	bool srgb = (profile == tColourProfile::sRGB);
+
+	// ETC and EAC are not here because tLayer does not know their block sizes yet.
+	#define F(f) case tPixelFormat::f
+	#define V(v) return VK_FORMAT_##v;
+	#define S(u, s) return srgb ? VK_FORMAT_##s : VK_FORMAT_##u;
+	switch (format)
+	{
+		F(R8):						S(R8_UNORM,						R8_SRGB)
+		F(R8G8):					S(R8G8_UNORM,					R8G8_SRGB)
+		F(R8G8B8):					S(R8G8B8_UNORM,					R8G8B8_SRGB)
+		F(R8G8B8A8):				S(R8G8B8A8_UNORM,				R8G8B8A8_SRGB)
+		F(B8G8R8):					S(B8G8R8_UNORM,					B8G8R8_SRGB)
+		F(B8G8R8A8):				S(B8G8R8A8_UNORM,				B8G8R8A8_SRGB)
+		F(G3B5R5G3):				V(B5G6R5_UNORM_PACK16)
+		F(G4B4A4R4):				V(B4G4R4A4_UNORM_PACK16)
+		F(G3B5A1R5G2):				V(B5G5R5A1_UNORM_PACK16)
+
+		F(R16f):					V(R16_SFLOAT)
+		F(R16G16f):					V(R16G16_SFLOAT)
+		F(R16G16B16f):				V(R16G16B16_SFLOAT)
+		F(R16G16B16A16f):			V(R16G16B16A16_SFLOAT)
+		F(R32f):					V(R32_SFLOAT)
+		F(R32G32f):					V(R32G32_SFLOAT)
+		F(R32G32B32f):				V(R32G32B32_SFLOAT)
+		F(R32G32B32A32f):			V(R32G32B32A32_SFLOAT)
+		F(B10G11R11uf):				V(B10G11R11_UFLOAT_PACK32)
+		F(E5B9G9R9uf):				V(E5B9G9R9_UFLOAT_PACK32)
+
+		F(BC1DXT1):					S(BC1_RGB_UNORM_BLOCK,			BC1_RGB_SRGB_BLOCK)
+		F(BC1DXT1A):				S(BC1_RGBA_UNORM_BLOCK,			BC1_RGBA_SRGB_BLOCK)
+		F(BC2DXT2DXT3):				S(BC2_UNORM_BLOCK,				BC2_SRGB_BLOCK)
+		F(BC3DXT4DXT5):				S(BC3_UNORM_BLOCK,				BC3_SRGB_BLOCK)
+		F(BC4ATI1U):				V(BC4_UNORM_BLOCK)
+		F(BC4ATI1S):				V(BC4_SNORM_BLOCK)
+		F(BC5ATI2U):				V(BC5_UNORM_BLOCK)
+		F(BC5ATI2S):				V(BC5_SNORM_BLOCK)
+		F(BC6U):					V(BC6H_UFLOAT_BLOCK)
+		F(BC6S):					V(BC6H_SFLOAT_BLOCK)
+		F(BC7):						S(BC7_UNORM_BLOCK,				BC7_SRGB_BLOCK)
+
+		F(PVRBPP4):					S(PVRTC1_4BPP_UNORM_BLOCK_IMG,	PVRTC1_4BPP_SRGB_BLOCK_IMG)
+		F(PVRBPP2):					S(PVRTC1_2BPP_UNORM_BLOCK_IMG,	PVRTC1_2BPP_SRGB_BLOCK_IMG)
+
+		F(ASTC4X4):					S(ASTC_4x4_UNORM_BLOCK,			ASTC_4x4_SRGB_BLOCK)
+		F(ASTC5X4):					S(ASTC_5x4_UNORM_BLOCK,			ASTC_5x4_SRGB_BLOCK)
+		F(ASTC5X5):					S(ASTC_5x5_UNORM_BLOCK,			ASTC_5x5_SRGB_BLOCK)
+		F(ASTC6X5):					S(ASTC_6x5_UNORM_BLOCK,			ASTC_6x5_SRGB_BLOCK)
+		F(ASTC6X6):					S(ASTC_6x6_UNORM_BLOCK,			ASTC_6x6_SRGB_BLOCK)
+		F(ASTC8X5):					S(ASTC_8x5_UNORM_BLOCK,			ASTC_8x5_SRGB_BLOCK)
+		F(ASTC8X6):					S(ASTC_8x6_UNORM_BLOCK,			ASTC_8x6_SRGB_BLOCK)
+		F(ASTC8X8):					S(ASTC_8x8_UNORM_BLOCK,			ASTC_8x8_SRGB_BLOCK)
+		F(ASTC10X5):				S(ASTC_10x5_UNORM_BLOCK,		ASTC_10x5_SRGB_BLOCK)
+		F(ASTC10X6):				S(ASTC_10x6_UNORM_BLOCK,		ASTC_10x6_SRGB_BLOCK)
+		F(ASTC10X8):				S(ASTC_10x8_UNORM_BLOCK,		ASTC_10x8_SRGB_BLOCK)
+		F(ASTC10X10):				S(ASTC_10x10_UNORM_BLOCK,		ASTC_10x10_SRGB_BLOCK)
+		F(ASTC12X10):				S(ASTC_12x10_UNORM_BLOCK,		ASTC_12x10_SRGB_BLOCK)
+		F(ASTC12X12):				S(ASTC_12x12_UNORM_BLOCK,		ASTC_12x12_SRGB_BLOCK)
+
+		default:
+			break;
+	}
+	#undef F
+	#undef V
+	#undef S
+
+	return VK_FORMAT_UNDEFINED;
+}
+
+
+uint32 tKTX::GetTypeSize(tPixelFormat format)
+{
+	switch (format)
+	{
+		case tPixelFormat::G3B5R5G3:
+		case tPixelFormat::G4B4A4R4:
+		case tPixelFormat::G3B5A1R5G2:
+		case tPixelFormat::R16f:
+		case tPixelFormat::R16G16f:
+		case tPixelFormat::R16G16B16f:
+		case tPixelFormat::R16G16B16A16f:
+			return 2;
+
+		case tPixelFormat::R32f:
+		case tPixelFormat::R32G32f:
+		case tPixelFormat::R32G32B32f:
+		case tPixelFormat::R32G32B32A32f:
+		case tPixelFormat::B10G11R11uf:
+		case tPixelFormat::E5B9G9R9uf:
+			return 4;
+
+		default:
+			break;
+	}
+
+	return 1;
+}
+
+
+int tKTX::AppendKeyValue(uint8* buffer, int size, const char* key, const char* value)
+{
+	// The key and the value are both written with their null terminators. Each entry is padded to 4 bytes.
+	int keyLen = tStd::tStrlen(key) + 1;
+	int valueLen = tStd::tStrlen(value) + 1;
+	uint32 keyAndValueByteLength = keyLen + valueLen;
+	tStd::tMemcpy(buffer + size, &keyAndValueByteLength, sizeof(uint32));		size += sizeof(uint32);
+	tStd::tMemcpy(buffer + size, key, keyLen);									size += keyLen;
+	tStd::tMemcpy(buffer + size, value, valueLen);								size += valueLen;
+	while (size % 4)
+		buffer[size++] = 0;
+
+	return size;
+}
+
 tImageKTX::tImageKTX()
 {
 	tStd::tMemset(Layers, 0, sizeof(Layers));
@@ -563,6 +725,8 @@ void tImageKTX::Clear()
 	IsCubeMap						= false;
 	IsArray							= false;
 	RowReversalOperationPerformed	= false;
+	Transcoded						= false;
+	Supercompression				= tSupercompression::None;
 	NumImages						= 0;
 	NumArrayLayers					= 0;
 	NumMipmapLayers					= 0;
@@ -746,9 +910,11 @@ bool tImageKTX::Set(tPixel4b* pixels, int width, int height, bool steal)
 	if (!pixels || (width <= 0) || (height <= 0))
 		return false;
 
+	// The pixels are in tacent row order, the same as a ktx loaded with LoadFlag_ReverseRowOrder.
 	Layers[0][0] = new tLayer(tPixelFormat::R8G8B8A8, width, height, (uint8*)pixels, steal);
 	AlphaMode = tAlphaMode::Normal;
 	ChannelType = tChannelType::UNORM;
+	RowReversalOperationPerformed = true;
 	NumImages = 1;
 	NumMipmapLayers = 1;
 
@@ -1023,6 +1189,34 @@ bool tImageKTX::LoadFromTexture(ktxTexture* texture, const LoadParams& paramsIn)
 	}
 	else if (ktx2)
 	{
+		// Zstd and zlib payloads were already inflated by libktx when the image data was loaded. Basis Universal
+		// payloads (ETC1S with BasisLZ, or UASTC) have no vkFormat and must be transcoded before we can continue.
+		Supercompression = tKTX::GetSupercompression(ktx2->supercompressionScheme);
+		if (ktxTexture2_NeedsTranscoding(ktx2))
+		{
+			tPixelFormat target = params.TranscodeFormat;
+			if (target == tPixelFormat::Unspecified)
+				target = (params.Flags & LoadFlag_Decode) ? tPixelFormat::R8G8B8A8 : tPixelFormat::BC7;
+
+			ktx_transcode_fmt_e transcodeFormat = tKTX::GetTranscodeFormat(target);
+			if (transcodeFormat == KTX_TTF_NOSELECTION)
+			{
+				ktxTexture_Destroy(texture);
+				SetStateBit(StateBit::Fatal_TranscodeFormatNotSupported);
+				return false;
+			}
+
+			// On success libktx replaces the image data and sets vkFormat to match the target.
+			result = ktxTexture2_TranscodeBasis(ktx2, transcodeFormat, 0);
+			if (result != KTX_SUCCESS)
+			{
+				ktxTexture_Destroy(texture);
+				SetStateBit(StateBit::Fatal_TranscodeError);
+				return false;
+			}
+			Transcoded = true;
+		}
+
 		tKTX::GetFormatInfo_FromVKFormat(PixelFormatSrc, ColourProfileSrc, AlphaMode, ChannelType, ktx2->vkFormat);
 		if (fileType == tSystem::tFileType::KTX)
 			SetStateBit(StateBit::Conditional_ExtVersionMismatch);
@@ -1184,11 +1378,17 @@ bool tImageKTX::LoadFromTexture(ktxTexture* texture, const LoadParams& paramsIn)
 		}
 	}
 
-	bool didRowReversalAfterDecode = false;
-	for (int image = 0; image < NumImages; image++)
+	// Each mipmap level of each face decodes independently so they are spread over the available cores. Levels shrink
+	// by 4x each step, so the top level dominates. For cubemaps the six faces keep all threads busy.
+	bool reverseAfterDecode = reverseRowOrderRequested && !RowReversalOperationPerformed;
+	DecodeResult decodeResults[MaxMipmapLayers*MaxImages];
+	int numDecodes = NumImages*NumMipmapLayers;
+	auto decodeLayers = [&](int begin, int end)
 	{
-		for (int layerNum = 0; layerNum < NumMipmapLayers; layerNum++)
+		for (int d = begin; d < end; d++)
 		{
+			int image = d / NumMipmapLayers;
+			int layerNum = d % NumMipmapLayers;
 			tLayer* layer = Layers[layerNum][image];
 			int w = layer->Width;
 			int h = layer->Height;
@@ -1198,69 +1398,41 @@ bool tImageKTX::LoadFromTexture(ktxTexture* texture, const LoadParams& paramsIn)
 			// The decoded4f format used for HDR images.
 			tColour4b* decoded4b = nullptr;
 			tColour4f* decoded4f = nullptr;
-			DecodeResult result = DecodePixelData
+			decodeResults[d] = DecodePixelData
 			(
 				layer->PixelFormat, layer->Data, layer->GetDataSize(),
 				w, h, decoded4b, decoded4f
 			);
-
-			if (result != DecodeResult::Success)
+			if (decodeResults[d] != DecodeResult::Success)
+				continue;
+
+			// Apply any decode flags. HDR (float) data is tone-mapped and converted to 32-bit in a single pass. LDR data
+			// only gets sRGB or gamma compression.
+			tAssert(decoded4f || decoded4b);
+			tToneMapParams toneParams;
+			if (params.Flags & tImageKTX::LoadFlag_ToneMapExposure)
 			{
-				Clear();
-				switch (result)
-				{
-					case DecodeResult::PackedDecodeError:	SetStateBit(StateBit::Fatal_PackedDecodeError);			break;
-					case DecodeResult::BlockDecodeError:	SetStateBit(StateBit::Fatal_BCDecodeError);				break;
-					case DecodeResult::ASTCDecodeError:		SetStateBit(StateBit::Fatal_ASTCDecodeError);			break;
-					default:								SetStateBit(StateBit::Fatal_PixelFormatNotSupported);	break;
-				}
-				return false;
+				toneParams.Operator = params.ToneMap;
+				toneParams.Exposure = params.Exposure;
 			}
+			toneParams.SRGBCompression = (params.Flags & tImageKTX::LoadFlag_SRGBCompression) ? true : false;
+			toneParams.GammaCompression = (params.Flags & tImageKTX::LoadFlag_GammaCompression) ? true : false;
+			toneParams.Gamma = params.Gamma;
+			toneParams.NumThreads = (numDecodes > 1) ? 1 : params.NumThreads;
 
-			// Apply any decode flags.
-			tAssert(decoded4b || decoded4f);
-			bool flagTone = (params.Flags & tImageKTX::LoadFlag_ToneMapExposure) ? true : false;
-			bool flagSRGB = (params.Flags & tImageKTX::LoadFlag_SRGBCompression) ? true : false;
-			bool flagGama = (params.Flags & tImageKTX::LoadFlag_GammaCompression)? true : false;
-			if (decoded4f && (flagTone || flagSRGB || flagGama))
-			{
-				for (int p = 0; p < w*h; p++)
-				{
-					tColour4f& colour = decoded4f[p];
-					if (flagTone)
-						colour.TonemapExposure(params.Exposure, tCompBit_RGB);
-					if (flagSRGB)
-						colour.LinearToSRGB(tCompBit_RGB);
-					if (flagGama)
-						colour.LinearToGamma(params.Gamma, tCompBit_RGB);
-				}
-			}
-			if (decoded4b && (flagSRGB || flagGama))
-			{
-				for (int p = 0; p < w*h; p++)
-				{
-					tColour4f colour(decoded4b[p]);
-					if (flagSRGB)
-						colour.LinearToSRGB(tCompBit_RGB);
-					if (flagGama)
-						colour.LinearToGamma(params.Gamma, tCompBit_RGB);
-					decoded4b[p].SetR(colour.R);
-					decoded4b[p].SetG(colour.G);
-					decoded4b[p].SetB(colour.B);
-				}
-			}
-
-			// Update the layer with the 32-bit RGBA decoded data. If the data was HDR (float)
-			// convert it to 32 bit. Start by getting ride of the existing layer pixel data.
+			// Update the layer with the 32-bit RGBA decoded data. Start by getting rid of the existing layer pixel data.
 			delete[] layer->Data;
 			if (decoded4f)
 			{
 				tAssert(!decoded4b);
 				decoded4b = new tColour4b[w*h];
-				for (int p = 0; p < w*h; p++)
-					decoded4b[p].Set(decoded4f[p]);
+				ToneMap(decoded4b, decoded4f, w*h, toneParams);
 				delete[] decoded4f;
 			}
+			else
+			{
+				EncodeLDR(decoded4b, w*h, toneParams);
+			}
 
 			// Possibly spread the L/Red channel.
 			if (spread && tIsLuminanceFormat(layer->PixelFormat))
@@ -1276,17 +1448,16 @@ bool tImageKTX::LoadFromTexture(ktxTexture* texture, const LoadParams& paramsIn)
 			layer->PixelFormat = tPixelFormat::R8G8B8A8;
 
 			// We've got one more chance to reverse the rows here (if we still need to) because we were asked to decode.
-			if (reverseRowOrderRequested && !RowReversalOperationPerformed && (layer->PixelFormat == tPixelFormat::R8G8B8A8))
+			if (reverseAfterDecode)
 			{
 				// This shouldn't ever fail. Too easy to reverse RGBA 32-bit.
 				uint8* reversedRowData = tImage::CreateReversedRowData(layer->Data, layer->PixelFormat, w, h);
 				tAssert(reversedRowData);
 				delete[] layer->Data;
 				layer->Data = reversedRowData;
-				didRowReversalAfterDecode = true;
 			}
 
-			if ((params.Flags & LoadFlag_SwizzleBGR2RGB) && (layer->PixelFormat == tPixelFormat::R8G8B8A8))
+			if (params.Flags & LoadFlag_SwizzleBGR2RGB)
 			{
 				for (int xy = 0; xy < w*h; xy++)
 				{
@@ -1295,9 +1466,27 @@ bool tImageKTX::LoadFromTexture(ktxTexture* texture, const LoadParams& paramsIn)
 				}
 			}
 		}
+	};
+	tSystem::tParallelFor(numDecodes, decodeLayers, params.NumThreads);
+
+	for (int d = 0; d < numDecodes; d++)
+	{
+		if (decodeResults[d] == DecodeResult::Success)
+			continue;
+
+		ktxTexture_Destroy(texture);
+		Clear();
+		switch (decodeResults[d])
+		{
+			case DecodeResult::PackedDecodeError:	SetStateBit(StateBit::Fatal_PackedDecodeError);			break;
+			case DecodeResult::BlockDecodeError:	SetStateBit(StateBit::Fatal_BCDecodeError);				break;
+			case DecodeResult::ASTCDecodeError:		SetStateBit(StateBit::Fatal_ASTCDecodeError);			break;
+			default:								SetStateBit(StateBit::Fatal_PixelFormatNotSupported);	break;
+		}
+		return false;
 	}
 
-	if (reverseRowOrderRequested && !RowReversalOperationPerformed && didRowReversalAfterDecode)
+	if (reverseAfterDecode)
 		RowReversalOperationPerformed = true;
 
 	if (params.Flags & LoadFlag_SRGBCompression)  ColourProfile = tColourProfile::LDRsRGB_LDRlA;
@@ -1316,6 +1505,287 @@ bool tImageKTX::LoadFromTexture(ktxTexture* texture, const LoadParams& paramsIn)
 }
 
 
+bool tImageKTX::Writer::Open
+(
+	const tString& ktx2File, tPixelFormat format, int width, int height,
+	int numMipmaps, int numImages, bool cubemap, const SaveParams& params, bool bottomUp
+)
+{
+	Close();
+	if ((width <= 0) || (height <= 0) || (numMipmaps < 1) || (numMipmaps > MaxMipmapLayers) || (numImages < 1))
+		return false;
+
+	if (cubemap && (numImages % 6))
+		return false;
+
+	uint32 vkFormat = tKTX::GetVKFormat(format, params.ColourProfile);
+	int bytesPerBlock = tGetBytesPerBlock(format);
+	if ((vkFormat == VK_FORMAT_UNDEFINED) || (bytesPerBlock <= 0))
+		return false;
+
+	PixelFormat	= format;
+	Width		= width;
+	Height		= height;
+	NumMipmaps	= numMipmaps;
+	NumImages	= numImages;
+
+	int numFaces = cubemap ? 6 : 1;
+	int numLayers = numImages / numFaces;
+
+	// libktx builds the data format descriptor for us. No image storage is allocated.
+	ktxTextureCreateInfo createInfo;
+	tStd::tMemset(&createInfo, 0, sizeof(createInfo));
+	createInfo.vkFormat			= vkFormat;
+	createInfo.baseWidth		= width;
+	createInfo.baseHeight		= height;
+	createInfo.baseDepth		= 1;
+	createInfo.numDimensions	= 2;
+	createInfo.numLevels		= numMipmaps;
+	createInfo.numLayers		= numLayers;
+	createInfo.numFaces			= numFaces;
+	createInfo.isArray			= (numLayers > 1) ? KTX_TRUE : KTX_FALSE;
+	createInfo.generateMipmaps	= KTX_FALSE;
+
+	ktxTexture2* texture = nullptr;
+	KTX_error_code result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_NO_STORAGE, &texture);
+	if ((result != KTX_SUCCESS) || !texture || !texture->pDfd)
+	{
+		if (texture)
+			ktxTexture_Destroy(ktxTexture(texture));
+		return false;
+	}
+
+	int dfdSize = texture->pDfd[0];
+	uint8* dfd = new uint8[dfdSize];
+	tStd::tMemcpy(dfd, texture->pDfd, dfdSize);
+	ktxTexture_Destroy(ktxTexture(texture));
+
+	// Same rule as loading. We only reverse if every level can be reversed without a decode.
+	ReverseRows = false;
+	if (bottomUp && params.ReverseRowOrder)
+	{
+		ReverseRows = true;
+		int h = height;
+		for (int mipmap = 0; mipmap < numMipmaps; mipmap++)
+		{
+			if (!CanReverseRowData(format, h))
+			{
+				ReverseRows = false;
+				break;
+			}
+			h /= 2; tMath::tiClampMin(h, 1);
+		}
+	}
+
+	// Key/value data. The keys must be sorted. The orientation records the row order actually written. Tacent rows go
+	// up, so only bottom-up layers that were not reversed are tagged "ru".
+	uint8 kvd[64];
+	int kvdSize = 0;
+	kvdSize = tKTX::AppendKeyValue(kvd, kvdSize, "KTXorientation", (bottomUp && !ReverseRows) ? "ru" : "rd");
+	kvdSize = tKTX::AppendKeyValue(kvd, kvdSize, "KTXwriter", "Tacent");
+
+	// Identifier, header, and index are all fixed size. The level index has an entry for every mipmap.
+	const uint8 identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+	const int headerSize = sizeof(identifier) + 9*sizeof(uint32) + 4*sizeof(uint32) + 2*sizeof(uint64);
+	int levelIndexSize = numMipmaps * 3*sizeof(uint64);
+	int dfdOffset = headerSize + levelIndexSize;
+	int kvdOffset = dfdOffset + dfdSize;
+
+	// Every level must start on a multiple of the least common multiple of the texel block size and 4.
+	Alignment = tMath::tLCM(bytesPerBlock, 4);
+	DataOffset = kvdOffset + kvdSize;
+	DataOffset = ((DataOffset + Alignment - 1) / Alignment) * Alignment;
+
+	uint32 header[9] =
+	{
+		vkFormat, tKTX::GetTypeSize(format), uint32(width), uint32(height), 0,
+		uint32((numLayers > 1) ? numLayers : 0), uint32(numFaces), uint32(numMipmaps), KTX_SS_NONE
+	};
+	uint32 index[4] = { uint32(dfdOffset), uint32(dfdSize), uint32(kvdOffset), uint32(kvdSize) };
+	uint64 sgdIndex[2] = { 0, 0 };
+
+	File = tSystem::tOpenFile(ktx2File.Chr(), "wb");
+	if (!File)
+	{
+		delete[] dfd;
+		return false;
+	}
+
+	bool ok = (tSystem::tWriteFile(File, identifier, sizeof(identifier)) == sizeof(identifier));
+	ok = ok && (tSystem::tWriteFile(File, header, sizeof(header)) == sizeof(header));
+	ok = ok && (tSystem::tWriteFile(File, index, sizeof(index)) == sizeof(index));
+	ok = ok && (tSystem::tWriteFile(File, sgdIndex, sizeof(sgdIndex)) == sizeof(sgdIndex));
+	for (int mipmap = 0; ok && (mipmap < numMipmaps); mipmap++)
+	{
+		uint64 levelSize = uint64(GetLayerSize(mipmap)) * numImages;
+		uint64 level[3] = { uint64(GetLevelOffset(mipmap)), levelSize, levelSize };
+		ok = (tSystem::tWriteFile(File, level, sizeof(level)) == sizeof(level));
+	}
+	ok = ok && (tSystem::tWriteFile(File, dfd, dfdSize) == dfdSize);
+	ok = ok && (tSystem::tWriteFile(File, kvd, kvdSize) == kvdSize);
+	delete[] dfd;
+	if (!ok)
+	{
+		tSystem::tCloseFile(File);
+		File = nullptr;
+		return false;
+	}
+
+	Written = new bool[NumImages*NumMipmaps];
+	for (int w = 0; w < NumImages*NumMipmaps; w++)
+		Written[w] = false;
+
+	return true;
+}
+
+
+bool tImageKTX::Writer::Write(int image, int mipmap, const tLayer& layer)
+{
+	if (!File || (image < 0) || (image >= NumImages) || (mipmap < 0) || (mipmap >= NumMipmaps))
+		return false;
+
+	int width  = Width  >> mipmap; tMath::tiClampMin(width, 1);
+	int height = Height >> mipmap; tMath::tiClampMin(height, 1);
+	if (!layer.IsValid() || (layer.PixelFormat != PixelFormat) || (layer.Width != width) || (layer.Height != height))
+		return false;
+
+	int numBytes = GetLayerSize(mipmap);
+	tAssert(layer.GetDataSize() == numBytes);
+
+	uint8* reversed = nullptr;
+	if (ReverseRows)
+	{
+		int numBlocksW = tGetNumBlocks(tGetBlockWidth(PixelFormat), width);
+		int numBlocksH = tGetNumBlocks(tGetBlockHeight(PixelFormat), height);
+		reversed = CreateReversedRowData(layer.Data, PixelFormat, numBlocksW, numBlocksH);
+		if (!reversed)
+			return false;
+	}
+
+	// Within a level the images are ordered by array layer and then by face, which is the order of the image index.
+	tSystem::tFileSeek(File, GetLevelOffset(mipmap) + image*numBytes);
+	int numWritten = tSystem::tWriteFile(File, reversed ? reversed : layer.Data, numBytes);
+	delete[] reversed;
+	if (numWritten != numBytes)
+		return false;
+
+	Written[image*NumMipmaps + mipmap] = true;
+	return true;
+}
+
+
+bool tImageKTX::Writer::Close()
+{
+	if (!File)
+		return false;
+
+	tSystem::tCloseFile(File);
+	File = nullptr;
+
+	bool complete = true;
+	for (int w = 0; w < NumImages*NumMipmaps; w++)
+		if (!Written[w])
+			complete = false;
+
+	delete[] Written;
+	Written = nullptr;
+	return complete;
+}
+
+
+int tImageKTX::Writer::GetLayerSize(int mipmap) const
+{
+	int width  = Width  >> mipmap; tMath::tiClampMin(width, 1);
+	int height = Height >> mipmap; tMath::tiClampMin(height, 1);
+	int numBlocksW = tGetNumBlocks(tGetBlockWidth(PixelFormat), width);
+	int numBlocksH = tGetNumBlocks(tGetBlockHeight(PixelFormat), height);
+	return numBlocksW * numBlocksH * tGetBytesPerBlock(PixelFormat);
+}
+
+
+int tImageKTX::Writer::GetLevelOffset(int mipmap) const
+{
+	// KTX2 stores the smallest level first.
+	int offset = DataOffset;
+	for (int m = NumMipmaps-1; m > mipmap; m--)
+	{
+		offset += GetLayerSize(m) * NumImages;
+		offset = ((offset + Alignment - 1) / Alignment) * Alignment;
+	}
+
+	return offset;
+}
+
+
+bool tImageKTX::Save(const tString& ktx2File, const SaveParams& params) const
+{
+	if (!IsValid())
+		return false;
+
+	// Layers that were not reversed on load are still in file order. Reversing them again would flip the image.
+	tLayer* main = Layers[0][0];
+	Writer writer;
+	if (!writer.Open(ktx2File, main->PixelFormat, main->Width, main->Height, NumMipmapLayers, NumImages, IsCubeMap, params, RowReversalOperationPerformed))
+		return false;
+
+	for (int image = 0; image < NumImages; image++)
+		for (int layer = 0; layer < NumMipmapLayers; layer++)
+			if (!Layers[layer][image] || !writer.Write(image, layer, *Layers[layer][image]))
+				return false;
+
+	return writer.Close();
+}
+
+
+bool tImageKTX::Save(const tString& ktx2File, const tTexture& texture, const SaveParams& params)
+{
+	if (!texture.IsValid())
+		return false;
+
+	Writer writer;
+	if (!writer.Open(ktx2File, texture.GetPixelFormat(), texture.GetWidth(), texture.GetHeight(), texture.GetNumMipmaps(), 1, false, params))
+		return false;
+
+	int mipmap = 0;
+	for (tLayer* layer = texture.GetFirstLayer(); layer; layer = layer->Next(), mipmap++)
+		if (!writer.Write(0, mipmap, *layer))
+			return false;
+
+	return writer.Close();
+}
+
+
+bool tImageKTX::Save(const tString& ktx2File, const tTexture* const faces[tFaceIndex_NumFaces], const SaveParams& params)
+{
+	const tTexture* first = faces[0];
+	for (int face = 0; face < tFaceIndex_NumFaces; face++)
+	{
+		const tTexture* texture = faces[face];
+		if
+		(
+			!texture || !texture->IsValid() ||
+			(texture->GetPixelFormat() != first->GetPixelFormat()) || (texture->GetNumMipmaps() != first->GetNumMipmaps()) ||
+			(texture->GetWidth() != first->GetWidth()) || (texture->GetHeight() != first->GetHeight())
+		)
+			return false;
+	}
+
+	Writer writer;
+	if (!writer.Open(ktx2File, first->GetPixelFormat(), first->GetWidth(), first->GetHeight(), first->GetNumMipmaps(), tFaceIndex_NumFaces, true, params))
+		return false;
+
+	for (int face = 0; face < tFaceIndex_NumFaces; face++)
+	{
+		int mipmap = 0;
+		for (tLayer* layer = faces[face]->GetFirstLayer(); layer; layer = layer->Next(), mipmap++)
+			if (!writer.Write(face, mipmap, *layer))
+				return false;
+	}
+
+	return writer.Close();
+}
+
+
 const char* tImageKTX::GetStateDesc(StateBit state)
 {
 	return StateDescriptions[int(state)];
@@ -1340,7 +1810,9 @@ const char* tImageKTX::StateDescriptions[] =
 	"Fatal Error. Maximum number of mipmap levels exceeded.",
 	"Fatal Error. Unable to decode packed pixels.",
 	"Fatal Error. Unable to decode BC pixels.",
-	"Fatal Error. Unable to decode ASTC pixels."
+	"Fatal Error. Unable to decode ASTC pixels.",
+	"Fatal Error. Transcode format not supported for Basis Universal data.",
+	"Fatal Error. Unable to transcode Basis Universal data."
 };
 tStaticAssert(tNumElements(tImageKTX::StateDescriptions) == int(tImageKTX::StateBit::NumStateBits));
 tStaticAssert(int(tImageKTX::StateBit::NumStateBits) <= int(tImageKTX::StateBit::MaxStateBits));
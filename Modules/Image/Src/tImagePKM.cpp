@@ -17,6 +17,7 @@
 #include <System/tFile.h>
 #include "Image/tImagePKM.h"
 #include "Image/tPixelUtil.h"
+#include "Image/tToneMap.h"
 #include "Image/tPicture.h"
 #include "etcdec/etcdec.h"
 using namespace tSystem;
@@ -220,45 +221,25 @@ bool tImagePKM::Load(const uint8* pkmFileInMemory, int numBytes, const LoadParam
 	if (result != DecodeResult::Success)
 		return false;
 
-	// Apply any decode flags.
+	// Apply any decode flags. PKM data is never HDR so there is no tone-mapping, only sRGB or gamma compression.
 	tAssert(decoded4f || decoded4b);
-	bool flagSRGB = (params.Flags & tImagePKM::LoadFlag_SRGBCompression) ? true : false;
-	bool flagGama = (params.Flags & tImagePKM::LoadFlag_GammaCompression)? true : false;
-	if (decoded4f && (flagSRGB || flagGama))
-	{
-		for (int p = 0; p < width*height; p++)
-		{
-			tColour4f& colour = decoded4f[p];
-			if (flagSRGB)
-				colour.LinearToSRGB(tCompBit_RGB);
-			if (flagGama)
-				colour.LinearToGamma(params.Gamma, tCompBit_RGB);
-		}
-	}
-	if (decoded4b && (flagSRGB || flagGama))
-	{
-		for (int p = 0; p < width*height; p++)
-		{
-			tColour4f colour(decoded4b[p]);
-			if (flagSRGB)
-				colour.LinearToSRGB(tCompBit_RGB);
-			if (flagGama)
-				colour.LinearToGamma(params.Gamma, tCompBit_RGB);
-			decoded4b[p].SetR(colour.R);
-			decoded4b[p].SetG(colour.G);
-			decoded4b[p].SetB(colour.B);
-		}
-	}
+	tToneMapParams toneParams;
+	toneParams.SRGBCompression = (params.Flags & tImagePKM::LoadFlag_SRGBCompression) ? true : false;
+	toneParams.GammaCompression = (params.Flags & tImagePKM::LoadFlag_GammaCompression) ? true : false;
+	toneParams.Gamma = params.Gamma;
 
 	// Converts to RGBA32 into the decoded4b array.
 	if (decoded4f)
 	{
 		tAssert(!decoded4b);
 		decoded4b = new tColour4b[width*height];
-		for (int p = 0; p < width*height; p++)
-			decoded4b[p].Set(decoded4f[p]);
+		ToneMap(decoded4b, decoded4f, width*height, toneParams);
 		delete[] decoded4f;
 	}
+	else
+	{
+		EncodeLDR(decoded4b, width*height, toneParams);
+	}
 
 	// Possibly spread the L/Red channel.
 	if (spread && tIsLuminanceFormat(PixelFormatSrc))
@@ -35,6 +35,8 @@
 #include "Image/tImagePNG.h"
 #include "Image/tImageJPG.h"		// Because some jpg/jfif files have a png extension in the wild. Scary but true.
 #include "Image/tPicture.h"
+#include "Image/tPixelUtil.h"
+#include "Image/tToneMap.h"
 using namespace tSystem;
 namespace tImage
 {
@@ -214,6 +216,199 @@ bool tImagePNG::Load(const uint8* pngFileInMemory, int numBytes, const LoadParam
 #endif
 
 
+#ifdef USE_SPNG_LIBRARY
+namespace tPNG
+{
+	// Decodes an indexed png to packed indices and expands them through the palette a row at a time. This is faster
+	// than having spng look up the palette for every pixel and lets us reverse the rows in the same pass.
+	bool DecodeIndexed(spng_ctx*, const spng_plte&, int width, int height, int bitDepth, tPixel4b*& pixels);
+
+	// Decodes an interlaced png a row at a time into rawPixels (RGBA8 or RGBA16, top row first), calling the
+	// progressive callback after every pass but the last.
+	bool DecodeProgressive(spng_ctx*, int fmt, uint8* rawPixels, size_t rawPixelsSize, int width, int height, const tImagePNG::LoadParams&);
+
+	// Makes an 8-bpc bottom-row-first preview from the partially decoded rawPixels once the Adam7 pass has completed.
+	// Missing pixels are copied from the top-left of the block the pass has filled so far.
+	void MakePreview(tFrame& preview, const uint8* rawPixels, bool raw16, int width, int height, int pass, const tToneMapParams&);
+
+	// Decodes the rows from top to top+height-1 (counting from the top of the image) of a png. Only the columns from
+	// left to left+width-1 are kept. regionPixels is width*height RGBA8 or RGBA16 pixels, top row first.
+	bool DecodeRegion(spng_ctx*, int fmt, bool interlaced, int imageWidth, int left, int top, int width, int height, uint8* regionPixels);
+
+	// Size of the blocks of the image filled after each Adam7 pass.
+	const int Adam7BlockWidth[7]	= { 8, 4, 4, 2, 2, 1, 1 };
+	const int Adam7BlockHeight[7]	= { 8, 8, 4, 4, 2, 2, 1 };
+
+	// The columns of each Adam7 pass.
+	const int Adam7XStart[7]		= { 0, 4, 0, 2, 0, 1, 0 };
+	const int Adam7XDelta[7]		= { 8, 8, 4, 4, 2, 2, 1 };
+}
+
+
+bool tPNG::DecodeIndexed(spng_ctx* ctx, const spng_plte& plte, int width, int height, int bitDepth, tPixel4b*& pixels)
+{
+	size_t rawIndicesSize = 0;
+	if (spng_decoded_image_size(ctx, SPNG_FMT_PNG, &rawIndicesSize))
+		return false;
+
+	// Rows are byte aligned. For interlaced sub-byte images spng ORs the indices in, so the buffer must start clear.
+	int bytesPerRow = (width*bitDepth + 7) / 8;
+	if (rawIndicesSize < size_t(bytesPerRow)*height)
+		return false;
+
+	uint8* rawIndices = new uint8[rawIndicesSize];
+	tStd::tMemset(rawIndices, 0, rawIndicesSize);
+	if (spng_decode_image(ctx, rawIndices, rawIndicesSize, SPNG_FMT_PNG, 0))
+	{
+		delete[] rawIndices;
+		return false;
+	}
+
+	// Same palette spng would build. Entries past the end are opaque black and tRNS supplies the alphas it covers.
+	struct spng_trns trns = { 0 };
+	if (spng_get_trns(ctx, &trns))
+		trns.n_type3_entries = 0;
+
+	tPixel4b palette[256];
+	for (int c = 0; c < 256; c++)
+	{
+		uint8 alpha = (c < int(trns.n_type3_entries)) ? trns.type3_alpha[c] : 0xFF;
+		if (c < int(plte.n_entries))
+			palette[c].Set(plte.entries[c].red, plte.entries[c].green, plte.entries[c].blue, alpha);
+		else
+			palette[c].Set(0, 0, 0, alpha);
+	}
+
+	// Reverse rows as we expand into the final buffer.
+	pixels = new tPixel4b[width*height];
+	for (int y = 0; y < height; y++)
+		ExpandIndices(pixels + ((height-1)-y)*width, rawIndices + y*bytesPerRow, width, bitDepth, palette);
+
+	delete[] rawIndices;
+	return true;
+}
+
+
+bool tPNG::DecodeProgressive(spng_ctx* ctx, int fmt, uint8* rawPixels, size_t rawPixelsSize, int width, int height, const tImagePNG::LoadParams& params)
+{
+	if (spng_decode_image(ctx, nullptr, 0, fmt, SPNG_DECODE_TRNS | SPNG_DECODE_PROGRESSIVE))
+		return false;
+
+	// The previews get the same compression the final image will. Passes with no pixels are skipped by spng so the
+	// pass index can jump.
+	tToneMapParams toneParams;
+	toneParams.SRGBCompression	= (params.Flags & tImagePNG::LoadFlag_SRGBCompression) ? true : false;
+	toneParams.GammaCompression	= (params.Flags & tImagePNG::LoadFlag_GammaCompression) ? true : false;
+	toneParams.Gamma			= params.Gamma;
+
+	size_t bytesPerRow = rawPixelsSize / height;
+	bool raw16 = (fmt == SPNG_FMT_RGBA16);
+	int currentPass = -1;
+	int errCode = 0;
+	do
+	{
+		struct spng_row_info rowInfo = { 0 };
+		errCode = spng_get_row_info(ctx, &rowInfo);
+		if (errCode)
+			break;
+
+		if (rowInfo.pass != currentPass)
+		{
+			if (currentPass >= 0)
+			{
+				tFrame preview;
+				MakePreview(preview, rawPixels, raw16, width, height, currentPass, toneParams);
+				params.Progressive(preview, currentPass, 7);
+			}
+			currentPass = rowInfo.pass;
+		}
+		errCode = spng_decode_row(ctx, rawPixels + rowInfo.row_num*bytesPerRow, bytesPerRow);
+	}
+	while (!errCode);
+
+	return (errCode == SPNG_EOI);
+}
+
+
+bool tPNG::DecodeRegion(spng_ctx* ctx, int fmt, bool interlaced, int imageWidth, int left, int top, int width, int height, uint8* regionPixels)
+{
+	if (spng_decode_image(ctx, nullptr, 0, fmt, SPNG_DECODE_TRNS | SPNG_DECODE_PROGRESSIVE))
+		return false;
+
+	int pixelSize = (fmt == SPNG_FMT_RGBA16) ? sizeof(tPixel4s) : sizeof(tPixel4b);
+	size_t bytesPerRow = size_t(imageWidth)*pixelSize;
+	uint8* row = new uint8[bytesPerRow];
+	int lastPass = interlaced ? 6 : 0;
+	int errCode = 0;
+	do
+	{
+		struct spng_row_info rowInfo = { 0 };
+		errCode = spng_get_row_info(ctx, &rowInfo);
+		if (errCode)
+			break;
+
+		// Once the last pass is below the region we're done.
+		int y = rowInfo.row_num;
+		if ((rowInfo.pass == lastPass) && (y >= top+height))
+			break;
+
+		errCode = spng_decode_row(ctx, row, bytesPerRow);
+		if ((errCode && (errCode != SPNG_EOI)) || (y < top) || (y >= top+height))
+			continue;
+
+		// Rows of the early Adam7 passes only have the pixels of that pass written.
+		uint8* dst = regionPixels + size_t(y-top)*width*pixelSize;
+		int pass = interlaced ? rowInfo.pass : 6;
+		if (pass == 6)
+		{
+			tStd::tMemcpy(dst, row + left*pixelSize, width*pixelSize);
+			continue;
+		}
+
+		int xStart = Adam7XStart[pass];
+		int xDelta = Adam7XDelta[pass];
+		int first = (left <= xStart) ? xStart : xStart + ((left - xStart + xDelta - 1) / xDelta) * xDelta;
+		for (int x = first; x < left+width; x += xDelta)
+			tStd::tMemcpy(dst + (x-left)*pixelSize, row + x*pixelSize, pixelSize);
+	}
+	while (!errCode);
+
+	delete[] row;
+	return !errCode || (errCode == SPNG_EOI);
+}
+
+
+void tPNG::MakePreview(tFrame& preview, const uint8* rawPixels, bool raw16, int width, int height, int pass, const tToneMapParams& toneParams)
+{
+	tAssert((pass >= 0) && (pass < 7));
+	int blockW = Adam7BlockWidth[pass];
+	int blockH = Adam7BlockHeight[pass];
+	tPixel4b* pixels = new tPixel4b[width*height];
+	for (int y = 0; y < height; y++)
+	{
+		int srcY = (y / blockH) * blockH;
+		tPixel4b* dstRow = pixels + ((height-1)-y)*width;
+		if (raw16)
+		{
+			const tPixel4s* srcRow = (const tPixel4s*)rawPixels + srcY*width;
+			for (int x = 0; x < width; x++)
+				dstRow[x].Set(srcRow[(x / blockW) * blockW]);
+		}
+		else
+		{
+			const tPixel4b* srcRow = (const tPixel4b*)rawPixels + srcY*width;
+			for (int x = 0; x < width; x++)
+				dstRow[x] = srcRow[(x / blockW) * blockW];
+		}
+	}
+
+	EncodeLDR(pixels, width*height, toneParams);
+	preview.StealFrom(pixels, width, height);
+	preview.PixelFormatSrc = tPixelFormat::R8G8B8A8;
+}
+#endif
+
+
 #ifdef USE_SPNG_LIBRARY
 bool tImagePNG::Load(const uint8* pngFileInMemory, int numBytes, const LoadParams& paramsIn)
 {
@@ -315,51 +510,104 @@ bool tImagePNG::Load(const uint8* pngFileInMemory, int numBytes, const LoadParam
 		return false;
 	}
 
-	// Output format, does not depend on source PNG format except for SPNG_FMT_PNG, which is the PNGs format in
-	// host-endian (or big-endian for SPNG_FMT_RAW). Note that for these two formats < 8-bit images are left byte-packed.
-	// Here we decode to a 16 bit buffer if the src is 16 bit to keep full precision. For non-16-bit per component
-	// buffers, including palettized, we decode to RGBA8.
-	int fmt = (bitDepth == 16) ? SPNG_FMT_RGBA16 : SPNG_FMT_RGBA8;
-
-	size_t rawPixelsSize = 0;
-	errCode = spng_decoded_image_size(ctx, fmt, &rawPixelsSize);
-	if (errCode)
+	// Indexed images do their own palette lookup. Without a palette spng reports the error in the regular path. For
+	// progressive decodes spng expands the palette so previews are available after each pass.
+	// Region decodes also go through spng a row at a time.
+	bool interlaced = (ihdr.interlace_method == SPNG_INTERLACE_ADAM7);
+	bool region = (params.RegionWidth > 0) && (params.RegionHeight > 0);
+	int regionX = params.RegionX;
+	int regionY = params.RegionY;
+	int regionW = params.RegionWidth;
+	int regionH = params.RegionHeight;
+	if (region && !ClipRegion(regionX, regionY, regionW, regionH, Width, Height))
 	{
 		spng_ctx_free(ctx);
 		Clear();
 		return false;
 	}
 
-	uint8* rawPixels = new uint8[rawPixelsSize];
-
-	// Decode the image in one go. I'm pretty sure we always want to decode transparency.
-	// Certainly for palettized images it is required.
-	errCode = spng_decode_image(ctx, rawPixels, rawPixelsSize, fmt, SPNG_DECODE_TRNS);
-	if (errCode)
+	bool progressive = params.Progressive && interlaced && !region;
+	if ((ihdr.color_type == SPNG_COLOR_TYPE_INDEXED) && (plte.n_entries > 0) && !progressive && !region)
 	{
-		delete[] rawPixels;
+		bool success = tPNG::DecodeIndexed(ctx, plte, Width, Height, bitDepth, Pixels8);
 		spng_ctx_free(ctx);
-		Clear();
-		return false;
-	}
-
-	// Reverse rows as we copy into our final buffer.
-	if (fmt == SPNG_FMT_RGBA8)
-	{
-		Pixels8 = new tPixel4b[numPixels];
-		int bytesPerRow = Width*sizeof(tPixel4b);
-		for (int y = Height-1; y >= 0; y--)
-			tStd::tMemcpy((uint8*)Pixels8 + ((Height-1)-y)*bytesPerRow, rawPixels + y*bytesPerRow, bytesPerRow);
+		if (!success)
+		{
+			Clear();
+			return false;
+		}
 	}
 	else
 	{
-		Pixels16 = new tPixel4s[numPixels];
-		int bytesPerRow = Width*sizeof(tPixel4s);
-		for (int y = Height-1; y >= 0; y--)
-			tStd::tMemcpy((uint8*)Pixels16 + ((Height-1)-y)*bytesPerRow, rawPixels + y*bytesPerRow, bytesPerRow);
+		// Output format, does not depend on source PNG format except for SPNG_FMT_PNG, which is the PNGs format in
+		// host-endian (or big-endian for SPNG_FMT_RAW). Note that for these two formats < 8-bit images are left
+		// byte-packed. Here we decode to a 16 bit buffer if the src is 16 bit to keep full precision. For non-16-bit per
+		// component buffers we decode to RGBA8.
+		int fmt = (bitDepth == 16) ? SPNG_FMT_RGBA16 : SPNG_FMT_RGBA8;
+
+		size_t rawPixelsSize = 0;
+		errCode = spng_decoded_image_size(ctx, fmt, &rawPixelsSize);
+		if (errCode)
+		{
+			spng_ctx_free(ctx);
+			Clear();
+			return false;
+		}
+
+		// For regions only the region is allocated and the image becomes the size of the region.
+		if (region)
+		{
+			int pixelSize = (fmt == SPNG_FMT_RGBA16) ? sizeof(tPixel4s) : sizeof(tPixel4b);
+			rawPixelsSize = size_t(regionW)*regionH*pixelSize;
+		}
+		uint8* rawPixels = new uint8[rawPixelsSize];
+
+		// Decode the image in one go unless previews or a region were requested. I'm pretty sure we always want to
+		// decode transparency. Certainly for palettized images it is required.
+		if (region)
+		{
+			int top = Height - (regionY + regionH);
+			errCode = tPNG::DecodeRegion(ctx, fmt, interlaced, Width, regionX, top, regionW, regionH, rawPixels) ? 0 : 1;
+			Width = regionW;
+			Height = regionH;
+			numPixels = Width * Height;
+		}
+		else if (progressive)
+		{
+			// Row decoding only writes the pixels of the current pass.
+			tStd::tMemset(rawPixels, 0, rawPixelsSize);
+			errCode = tPNG::DecodeProgressive(ctx, fmt, rawPixels, rawPixelsSize, Width, Height, params) ? 0 : 1;
+		}
+		else
+		{
+			errCode = spng_decode_image(ctx, rawPixels, rawPixelsSize, fmt, SPNG_DECODE_TRNS);
+		}
+		if (errCode)
+		{
+			delete[] rawPixels;
+			spng_ctx_free(ctx);
+			Clear();
+			return false;
+		}
+
+		// Reverse rows as we copy into our final buffer.
+		if (fmt == SPNG_FMT_RGBA8)
+		{
+			Pixels8 = new tPixel4b[numPixels];
+			int bytesPerRow = Width*sizeof(tPixel4b);
+			for (int y = Height-1; y >= 0; y--)
+				tStd::tMemcpy((uint8*)Pixels8 + ((Height-1)-y)*bytesPerRow, rawPixels + y*bytesPerRow, bytesPerRow);
+		}
+		else
+		{
+			Pixels16 = new tPixel4s[numPixels];
+			int bytesPerRow = Width*sizeof(tPixel4s);
+			for (int y = Height-1; y >= 0; y--)
+				tStd::tMemcpy((uint8*)Pixels16 + ((Height-1)-y)*bytesPerRow, rawPixels + y*bytesPerRow, bytesPerRow);
+		}
+		delete[] rawPixels;
+		spng_ctx_free(ctx);
 	}
-	delete[] rawPixels;
-	spng_ctx_free(ctx);
 
 	if ((params.Flags & LoadFlag_ForceToBpc8) && Pixels16)
 	{
@@ -512,6 +760,22 @@ bool tImagePNG::Set(tPicture& picture, bool steal)
 }
 
 
+bool tImagePNG::Set(tPicture4s& picture, bool steal)
+{
+	Clear();
+	if (!picture.IsValid())
+		return false;
+
+	// Get the dimensions first since stealing invalidates the picture.
+	int width = picture.GetWidth();
+	int height = picture.GetHeight();
+	tPixel4s* pixels = steal ? picture.StealPixels() : picture.GetPixels();
+	bool success = Set(pixels, width, height, steal);
+	tAssert(success);
+	return true;
+}
+
+
 tFrame* tImagePNG::GetFrame(bool steal)
 {
 	if (!IsValid())
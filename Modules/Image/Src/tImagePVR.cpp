@@ -1147,50 +1147,32 @@ tLayer* tImagePVR::CreateNewLayer(const LoadParams& params, const uint8* srcPixe
 		return nullptr;
 	}
 
-	// Apply any decode flags.
+	// Apply any decode flags. HDR (float) data is tone-mapped and converted to 32-bit in a single pass. LDR data
+	// only gets sRGB or gamma compression.
 	tAssert(decoded4f || decoded4b);
-	bool flagTone = (params.Flags & tImagePVR::LoadFlag_ToneMapExposure) ? true : false;
-	bool flagSRGB = (params.Flags & tImagePVR::LoadFlag_SRGBCompression) ? true : false;
-	bool flagGama = (params.Flags & tImagePVR::LoadFlag_GammaCompression)? true : false;
-	if (decoded4f && (flagTone || flagSRGB || flagGama))
+	tToneMapParams toneParams;
+	if (params.Flags & tImagePVR::LoadFlag_ToneMapExposure)
 	{
-		for (int p = 0; p < width*height; p++)
-		{
-			tColour4f& colour = decoded4f[p];
-			if (flagTone)
-				colour.TonemapExposure(params.Exposure, tCompBit_RGB);
-			if (flagSRGB)
-				colour.LinearToSRGB(tCompBit_RGB);
-			if (flagGama)
-				colour.LinearToGamma(params.Gamma, tCompBit_RGB);
-		}
-	}
-	if (decoded4b && (flagSRGB || flagGama))
-	{
-		for (int p = 0; p < width*height; p++)
-		{
-			tColour4f colour(decoded4b[p]);
-			if (flagSRGB)
-				colour.LinearToSRGB(tCompBit_RGB);
-			if (flagGama)
-				colour.LinearToGamma(params.Gamma, tCompBit_RGB);
-			decoded4b[p].SetR(colour.R);
-			decoded4b[p].SetG(colour.G);
-			decoded4b[p].SetB(colour.B);
-		}
+		toneParams.Operator = params.ToneMap;
+		toneParams.Exposure = params.Exposure;
 	}
+	toneParams.SRGBCompression = (params.Flags & tImagePVR::LoadFlag_SRGBCompression) ? true : false;
+	toneParams.GammaCompression = (params.Flags & tImagePVR::LoadFlag_GammaCompression) ? true : false;
+	toneParams.Gamma = params.Gamma;
 
-	// Update the layer with the 32-bit RGBA decoded data. If the data was HDR (float)
-	// convert it to 32 bit. Start by getting rid of the existing layer pixel data.
+	// Update the layer with the 32-bit RGBA decoded data. Start by getting rid of the existing layer pixel data.
 	delete[] layer->Data;
 	if (decoded4f)
 	{
 		tAssert(!decoded4b);
 		decoded4b = new tColour4b[width*height];
-		for (int p = 0; p < width*height; p++)
-			decoded4b[p].Set(decoded4f[p]);
+		ToneMap(decoded4b, decoded4f, width*height, toneParams);
 		delete[] decoded4f;
 	}
+	else
+	{
+		EncodeLDR(decoded4b, width*height, toneParams);
+	}
 
 	// Possibly spread the L/Red channel.
 	if (spread && tIsLuminanceFormat(layer->PixelFormat))
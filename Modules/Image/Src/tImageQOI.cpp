@@ -15,6 +15,7 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #include <System/tFile.h>
+#include <System/tThread.h>
 #include "Image/tImageQOI.h"
 #include "Image/tPicture.h"
 #define QOI_NO_STDIO
@@ -24,6 +25,80 @@ namespace tImage
 {
 
 
+// Helper functions and constants for the striped container. A striped file is:
+//   "qois" magic, uint32 width, uint32 height, uint8 channels, uint8 colourspace, uint32 numStripes,
+//   uint32 numBytes for each stripe, followed by the stripes themselves.
+// All integers are big-endian like QOI. Each stripe is a complete standard QOI image the full width of the picture.
+// Stripes are stored top to bottom like the rows in a QOI file.
+namespace tQOI
+{
+	const int StripedHeaderSize = 18;
+	const int QOIHeaderSize = 14;
+
+	void WriteBE32(uint8* dest, uint32 value);
+	uint32 ReadBE32(const uint8* src);
+	bool IsStriped(const uint8* data, int numBytes)																		{ return (numBytes >= 4) && (data[0] == 'q') && (data[1] == 'o') && (data[2] == 'i') && (data[3] == 's'); }
+
+	// Encodes numRows rows starting at row top (counting down from the top of the image) as a standalone QOI image.
+	// Tacent pixels are stored bottom-up so the rows are reversed here. Returns a buffer that must be free()d, or
+	// nullptr on failure.
+	void* EncodeRows(const tPixel4b* pixels, int width, int height, int top, int numRows, int channels, int colourspace, int& outLength);
+}
+
+
+void tQOI::WriteBE32(uint8* dest, uint32 value)
+{
+	dest[0] = uint8(value >> 24);
+	dest[1] = uint8(value >> 16);
+	dest[2] = uint8(value >> 8);
+	dest[3] = uint8(value);
+}
+
+
+uint32 tQOI::ReadBE32(const uint8* src)
+{
+	return (uint32(src[0]) << 24) | (uint32(src[1]) << 16) | (uint32(src[2]) << 8) | uint32(src[3]);
+}
+
+
+void* tQOI::EncodeRows(const tPixel4b* pixels, int width, int height, int top, int numRows, int channels, int colourspace, int& outLength)
+{
+	outLength = 0;
+	uint8* rows = new uint8[width*numRows*channels];
+	int bytesPerRow = width*channels;
+	for (int r = 0; r < numRows; r++)
+	{
+		const tPixel4b* srcRow = pixels + ((height-1) - (top+r))*width;
+		uint8* dstRow = rows + r*bytesPerRow;
+		if (channels == 4)
+		{
+			tStd::tMemcpy(dstRow, srcRow, bytesPerRow);
+			continue;
+		}
+
+		for (int x = 0; x < width; x++)
+		{
+			dstRow[x*3 + 0] = srcRow[x].R;
+			dstRow[x*3 + 1] = srcRow[x].G;
+			dstRow[x*3 + 2] = srcRow[x].B;
+		}
+	}
+
+	qoi_desc qoiDesc;
+	qoiDesc.channels	= channels;
+	qoiDesc.colorspace	= colourspace;
+	qoiDesc.height		= numRows;
+	qoiDesc.width		= width;
+
+	// Encode raw RGB or RGBA pixels into a QOI image in memory. The function either returns NULL on failure (invalid
+	// parameters or malloc failed) or a pointer to the encoded data on success. On success the out_len is set to the
+	// size in bytes of the encoded data. The returned qoi data should be free()d after use.
+	void* memImage = qoi_encode(rows, &qoiDesc, &outLength);
+	delete[] rows;
+	return memImage;
+}
+
+
 bool tImageQOI::Load(const tString& qoiFile)
 {
 	Clear();
@@ -49,6 +124,9 @@ bool tImageQOI::Load(const uint8* qoiFileInMemory, int numBytes)
 	if ((numBytes <= 0) || !qoiFileInMemory)
 		return false;
 
+	if (tQOI::IsStriped(qoiFileInMemory, numBytes))
+		return LoadStriped(qoiFileInMemory, numBytes);
+
 	// Decode a QOI image from memory. The function either returns NULL on failure (invalid parameters or malloc failed)
 	// or a pointer to the decoded pixels. On success, the qoi_desc struct is filled with the description from the file
 	// header. The returned pixel data should be free()d after use.
@@ -76,6 +154,125 @@ bool tImageQOI::Load(const uint8* qoiFileInMemory, int numBytes)
 }
 
 
+bool tImageQOI::LoadStriped(const uint8* qoiFileInMemory, int numBytes)
+{
+	if (numBytes < tQOI::StripedHeaderSize)
+		return false;
+
+	int width			= int(tQOI::ReadBE32(qoiFileInMemory + 4));
+	int height			= int(tQOI::ReadBE32(qoiFileInMemory + 8));
+	int channels		= qoiFileInMemory[12];
+	int colourspace		= qoiFileInMemory[13];
+	int numStripes		= int(tQOI::ReadBE32(qoiFileInMemory + 14));
+	if
+	(
+		(width <= 0) || (height <= 0) || ((channels != 3) && (channels != 4)) ||
+		(numStripes <= 0) || (numStripes > height) || (int64(width)*int64(height) > int64(QOI_PIXELS_MAX))
+	)
+		return false;
+
+	int indexEnd = tQOI::StripedHeaderSize + numStripes*4;
+	if (indexEnd > numBytes)
+		return false;
+
+	// Before decoding anything we work out where every stripe's data is and which rows it covers. The stripe height
+	// comes from its own QOI header so the stripes don't need to be the same size. They must, however, exactly cover
+	// the image.
+	int* stripeOffset	= new int[numStripes];
+	int* stripeSize		= new int[numStripes];
+	int* stripeTop		= new int[numStripes];
+	int* stripeRows		= new int[numStripes];
+	bool* stripeOK		= new bool[numStripes];
+	int offset = indexEnd;
+	int top = 0;
+	bool valid = true;
+	for (int s = 0; (s < numStripes) && valid; s++)
+	{
+		int size = int(tQOI::ReadBE32(qoiFileInMemory + tQOI::StripedHeaderSize + s*4));
+		if ((size < tQOI::QOIHeaderSize) || (size > numBytes - offset))
+		{
+			valid = false;
+			break;
+		}
+
+		const uint8* stripe = qoiFileInMemory + offset;
+		int stripeWidth = int(tQOI::ReadBE32(stripe + 4));
+		int rows = int(tQOI::ReadBE32(stripe + 8));
+		if ((stripeWidth != width) || (rows <= 0) || (rows > height - top))
+		{
+			valid = false;
+			break;
+		}
+
+		stripeOffset[s]	= offset;
+		stripeSize[s]	= size;
+		stripeTop[s]	= top;
+		stripeRows[s]	= rows;
+		stripeOK[s]		= false;
+		offset += size;
+		top += rows;
+	}
+
+	if (valid && (top == height))
+	{
+		Pixels = new tPixel4b[width*height];
+		tSystem::tParallelFor
+		(
+			numStripes,
+			[&](int begin, int end)
+			{
+				for (int s = begin; s < end; s++)
+				{
+					qoi_desc results;
+					void* reversedPixels = qoi_decode(qoiFileInMemory + stripeOffset[s], stripeSize[s], &results, 4);
+					if (!reversedPixels)
+						continue;
+
+					if ((int(results.width) == width) && (int(results.height) == stripeRows[s]))
+					{
+						// Stripe rows are top-down. Row r of the stripe is row (Height-1)-(top+r) of ours.
+						int bytesPerRow = width*4;
+						for (int r = 0; r < stripeRows[s]; r++)
+						{
+							int y = (height-1) - (stripeTop[s] + r);
+							tStd::tMemcpy((uint8*)Pixels + y*bytesPerRow, (uint8*)reversedPixels + r*bytesPerRow, bytesPerRow);
+						}
+						stripeOK[s] = true;
+					}
+					free(reversedPixels);
+				}
+			}
+		);
+
+		for (int s = 0; s < numStripes; s++)
+			valid = valid && stripeOK[s];
+	}
+	else
+	{
+		valid = false;
+	}
+
+	delete[] stripeOffset;
+	delete[] stripeSize;
+	delete[] stripeTop;
+	delete[] stripeRows;
+	delete[] stripeOK;
+	if (!valid)
+	{
+		Clear();
+		return false;
+	}
+
+	Width				= width;
+	Height				= height;
+	PixelFormatSrc		= (channels == 3) ? tPixelFormat::R8G8B8 : tPixelFormat::R8G8B8A8;
+	PixelFormat			= tPixelFormat::R8G8B8A8;
+	ColourProfileSrc	= (colourspace == QOI_LINEAR) ? tColourProfile::lRGB : tColourProfile::sRGB;
+	ColourProfile		= ColourProfileSrc;
+	return true;
+}
+
+
 bool tImageQOI::Set(tPixel4b* pixels, int width, int height, bool steal)
 {
 	Clear();
@@ -178,14 +375,45 @@ tImageQOI::tFormat tImageQOI::Save(const tString& qoiFile, tFormat format, tColo
 
 tImageQOI::tFormat tImageQOI::Save(const tString& qoiFile, const SaveParams& params) const
 {
-	tFormat format = params.Format;
-	tColourProfile profile = params.ColourProfile;
-	if (!IsValid() || (format == tFormat::Invalid))
+	if (!IsValid() || (params.Format == tFormat::Invalid))
 		return tFormat::Invalid;
 
 	if (tSystem::tGetFileType(qoiFile) != tSystem::tFileType::QOI)
 		return tFormat::Invalid;
 
+	uint8* qoiFileInMemory = nullptr;
+	int numBytes = 0;
+	tFormat format = Save(qoiFileInMemory, numBytes, params);
+	if (format == tFormat::Invalid)
+		return tFormat::Invalid;
+
+	tFileHandle file = tSystem::tOpenFile(qoiFile.Chr(), "wb");
+	if (!file)
+	{
+		delete[] qoiFileInMemory;
+		return tFormat::Invalid;
+	}
+
+	int numWritten = tSystem::tWriteFile(file, qoiFileInMemory, numBytes);
+	tSystem::tCloseFile(file);
+	delete[] qoiFileInMemory;
+
+	if (numWritten != numBytes)
+		return tFormat::Invalid;
+
+	return format;
+}
+
+
+tImageQOI::tFormat tImageQOI::Save(uint8*& qoiFileInMemory, int& numBytes, const SaveParams& params) const
+{
+	qoiFileInMemory = nullptr;
+	numBytes = 0;
+	tFormat format = params.Format;
+	tColourProfile profile = params.ColourProfile;
+	if (!IsValid() || (format == tFormat::Invalid))
+		return tFormat::Invalid;
+
 	if (format == tFormat::Auto)
 	{
 		if (IsOpaque())
@@ -196,61 +424,87 @@ tImageQOI::tFormat tImageQOI::Save(const tString& qoiFile, const SaveParams& par
 	if (profile == tColourProfile::Auto)
 		profile = ColourProfileSrc;
 
-	tFileHandle file = tSystem::tOpenFile(qoiFile.Chr(), "wb");
-	if (!file)
-		return tFormat::Invalid;
-
-	qoi_desc qoiDesc;
-	qoiDesc.channels	= (format == tFormat::BPP24) ? 3 : 4;
+	int channels = (format == tFormat::BPP24) ? 3 : 4;
 
 	// This also catches space being set to invalid. Basically if it's not linear, it's sRGB.
-	qoiDesc.colorspace	= (profile == tColourProfile::lRGB) ? QOI_LINEAR : QOI_SRGB;
-	qoiDesc.height		= Height;
-	qoiDesc.width		= Width;
+	int colourspace = (profile == tColourProfile::lRGB) ? QOI_LINEAR : QOI_SRGB;
 
-	// No matter the format, we need to reverse the rows before saving.
-	tPixel4b* reversedRows = new tPixel4b[Width*Height];
-	int bytesPerRow = Width*4;
-	for (int y = Height-1; y >= 0; y--)
-		tStd::tMemcpy((uint8*)reversedRows + ((Height-1)-y)*bytesPerRow, (uint8*)Pixels + y*bytesPerRow, bytesPerRow);
+	// For a plain QOI file we just hand back a copy of the single encoded stream.
+	if (params.NumStripes <= 1)
+	{
+		int outLength = 0;
+		void* memImage = tQOI::EncodeRows(Pixels, Width, Height, 0, Height, channels, colourspace, outLength);
+		if (!memImage)
+			return tFormat::Invalid;
+
+		tAssert(outLength);
+		qoiFileInMemory = new uint8[outLength];
+		tStd::tMemcpy(qoiFileInMemory, memImage, outLength);
+		numBytes = outLength;
+		free(memImage);
+		return format;
+	}
 
-	// If we're saving in 24bit we need to convert our source data to 24bit.
-	uint8* pixels		= (uint8*)reversedRows;
-	bool deletePixels	= false;
-	if (format == tFormat::BPP24)
+	// Every stripe except possibly the last has the same number of rows. The stripe count is recomputed so there are
+	// no empty stripes at the end.
+	int numStripes		= tMath::tMin(params.NumStripes, Height);
+	int rowsPerStripe	= (Height + numStripes - 1) / numStripes;
+	numStripes			= (Height + rowsPerStripe - 1) / rowsPerStripe;
+
+	void** stripeData	= new void*[numStripes];
+	int* stripeSize		= new int[numStripes];
+	tSystem::tParallelFor
+	(
+		numStripes,
+		[&](int begin, int end)
+		{
+			for (int s = begin; s < end; s++)
+			{
+				int top = s*rowsPerStripe;
+				int rows = tMath::tMin(rowsPerStripe, Height - top);
+				stripeData[s] = tQOI::EncodeRows(Pixels, Width, Height, top, rows, channels, colourspace, stripeSize[s]);
+			}
+		},
+		params.NumThreads
+	);
+
+	int64 total = tQOI::StripedHeaderSize + numStripes*4;
+	bool success = true;
+	for (int s = 0; s < numStripes; s++)
 	{
-		int numPixels = Width*Height;
-		pixels = new uint8[numPixels*3];
-		for (int p = 0; p < numPixels; p++)
+		success = success && stripeData[s];
+		if (stripeData[s])
+			total += stripeSize[s];
+	}
+	success = success && (total <= int64(0x7FFFFFFF));
+
+	if (success)
+	{
+		numBytes = int(total);
+		qoiFileInMemory = new uint8[numBytes];
+		uint8* header = qoiFileInMemory;
+		header[0] = 'q'; header[1] = 'o'; header[2] = 'i'; header[3] = 's';
+		tQOI::WriteBE32(header + 4, Width);
+		tQOI::WriteBE32(header + 8, Height);
+		header[12] = uint8(channels);
+		header[13] = uint8(colourspace);
+		tQOI::WriteBE32(header + 14, numStripes);
+
+		uint8* dest = qoiFileInMemory + tQOI::StripedHeaderSize + numStripes*4;
+		for (int s = 0; s < numStripes; s++)
 		{
-			pixels[p*3 + 0] = reversedRows[p].R;
-			pixels[p*3 + 1] = reversedRows[p].G;
-			pixels[p*3 + 2] = reversedRows[p].B;
+			tQOI::WriteBE32(header + tQOI::StripedHeaderSize + s*4, stripeSize[s]);
+			tStd::tMemcpy(dest, stripeData[s], stripeSize[s]);
+			dest += stripeSize[s];
 		}
-		deletePixels = true;
 	}
 
-	// Encode raw RGB or RGBA pixels into a QOI image in memory. The function either returns NULL on failure (invalid
-	// parameters or malloc failed) or a pointer to the encoded data on success. On success the out_len is set to the
-	// size in bytes of the encoded data. The returned qoi data should be free()d after use.
-	int outLength = 0;
-	void* memImage = qoi_encode(pixels, &qoiDesc, &outLength);
-	if (deletePixels)
-		delete[] pixels;
-	delete[] reversedRows;
-
-	if (!memImage)
-		return tFormat::Invalid;
-		
-	tAssert(outLength);
-	int numWritten = tSystem::tWriteFile(file, memImage, outLength);
-	tSystem::tCloseFile(file);
-	free(memImage);
-	
-	if (numWritten != outLength)
-		return tFormat::Invalid;
+	for (int s = 0; s < numStripes; s++)
+		free(stripeData[s]);
+	delete[] stripeData;
+	delete[] stripeSize;
 
-	return format;
+	return success ? format : tFormat::Invalid;
 }
 
 
@@ -14,9 +14,11 @@
 // AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <Foundation/tArray.h>
 #include <System/tFile.h>
 #include "Image/tImageTGA.h"
 #include "Image/tPicture.h"
+#include "Image/tPixelUtil.h"
 using namespace tSystem;
 namespace tImage
 {
@@ -380,24 +382,16 @@ tImageTGA::tFormat tImageTGA::Save(const tString& tgaFile, const SaveParams& par
 		return tFormat::Invalid;
 
 	if (format == tFormat::Auto)
-	{
-		if (IsOpaque())
-			format = tFormat::BPP24;
-		else
-			format = tFormat::BPP32;
-	}
+		format = IsOpaque() ? tFormat::BPP24 : tFormat::BPP32;
 
-	bool success = false;
-	switch (params.Compression)
-	{
-		case tCompression::None:
-			success = SaveUncompressed(tgaFile, format);
-			break;
+	tFileHandle file = tOpenFile(tgaFile.Chr(), "wb");
+	if (!file)
+		return tFormat::Invalid;
 
-		case tCompression::RLE:
-			success = SaveCompressed(tgaFile, format);
-			break;
-	}
+	tBlockWriter writer(file);
+	bool success = Save(writer, format, params.Compression);
+	success = writer.Flush() && success;
+	tCloseFile(file);
 
 	if (!success)
 		return tFormat::Invalid;
@@ -406,14 +400,32 @@ tImageTGA::tFormat tImageTGA::Save(const tString& tgaFile, const SaveParams& par
 }
 
 
-bool tImageTGA::SaveUncompressed(const tString& tgaFile, tFormat format) const
+tImageTGA::tFormat tImageTGA::Save(uint8*& tgaFileInMemory, int& numBytes, const SaveParams& params) const
+{
+	tgaFileInMemory = nullptr;
+	numBytes = 0;
+	tFormat format = params.Format;
+	if (!IsValid() || (format == tFormat::Invalid))
+		return tFormat::Invalid;
+
+	if (format == tFormat::Auto)
+		format = IsOpaque() ? tFormat::BPP24 : tFormat::BPP32;
+
+	// The uncompressed size is a good initial guess for both compression types. RLE is usually smaller.
+	int bytesPerPixel = (format == tFormat::BPP24) ? 3 : 4;
+	tBlockWriter writer(int(sizeof(tTGA::Header)) + Width*Height*bytesPerPixel);
+	if (!Save(writer, format, params.Compression))
+		return tFormat::Invalid;
+
+	tgaFileInMemory = writer.StealBuffer(numBytes);
+	return format;
+}
+
+
+bool tImageTGA::Save(tBlockWriter& writer, tFormat format, tCompression compression) const
 {
 	if ((format != tFormat::BPP24) && (format != tFormat::BPP32))
 		return false;
-	
-	tFileHandle file = tOpenFile(tgaFile.Chr(), "wb");
-	if (!file)
-		return false;
 
 	uint8 bitDepth = (format == tFormat::BPP24) ? 24 : 32;
 
@@ -425,159 +437,116 @@ bool tImageTGA::SaveUncompressed(const tString& tgaFile, tFormat format) const
 	uint8 imageDesc = 0x00;
 	imageDesc |= (bitDepth == 24) ? 0 : 8;
 
-	// We'll be writing a 24 or 32bit uncompressed tga.
-	tPutc(0, file);									// ID string length.
-	tPutc(0, file);									// Colour map type.
-	tPutc(2, file);									// 2 = Uncompressed True Colour (2=true colour + no compression bit). Not palletized.
-	tPutc(0, file); tPutc(0, file);
-	tPutc(0, file); tPutc(0, file);
-	tPutc(0, file);
-	tPutc(0, file); tPutc(0, file);					// X origin.
-	tPutc(0, file); tPutc(0, file);					// Y origin.
+	// We'll be writing a 24 or 32bit tga. Data type 2 is uncompressed true colour. 10 is RLE compressed true colour
+	// (2=true colour + 8=RLE). Neither is palettized. The header is written in one go.
 	uint16 w = Width;
 	uint16 h = Height;
-	tPutc((w & 0x00FF), file);						// Width.
-	tPutc((w & 0xFF00) >> 8, file);
-	tPutc((h & 0x00FF), file);						// Height.
-	tPutc((h & 0xFF00) >> 8, file);
-	tPutc(bitDepth, file);							// 24 or 32 bit depth.  RGB or RGBA.
-	tPutc(imageDesc, file);							// Image desc.  See above.
+	uint8 header[sizeof(tTGA::Header)] =
+	{
+		0,											// ID string length.
+		0,											// Colour map type.
+		uint8((compression == tCompression::RLE) ? 10 : 2),
+		0, 0, 0, 0, 0,								// Colour map specification.
+		0, 0,										// X origin.
+		0, 0,										// Y origin.
+		uint8(w & 0x00FF), uint8((w & 0xFF00) >> 8),	// Width.
+		uint8(h & 0x00FF), uint8((h & 0xFF00) >> 8),	// Height.
+		bitDepth,									// 24 or 32 bit depth. RGB or RGBA.
+		imageDesc									// Image desc. See above.
+	};
+	writer.Write(header, sizeof(header));
 
 	// If we had a non-zero ID string length, we'd write length characters here.
-	int numPixels = Width*Height;
-	for (int p = 0; p < numPixels; p++)
+	switch (compression)
 	{
-		tPixel4b& pixel = Pixels[p];
-		tPutc(pixel.B, file);
-		tPutc(pixel.G, file);
-		tPutc(pixel.R, file);
+		case tCompression::None:
+			SaveUncompressed(writer, format);
+			break;
 
-		if (format == tFormat::BPP32)
-			tPutc(pixel.A, file);
+		case tCompression::RLE:
+			SaveCompressed(writer, format);
+			break;
 	}
 
-	tCloseFile(file);
-	return true;
+	return !writer.HasError();
 }
 
 
-bool tImageTGA::SaveCompressed(const tString& tgaFile, tFormat format) const
+void tImageTGA::SaveUncompressed(tBlockWriter& writer, tFormat format) const
 {
-	if ((format != tFormat::BPP24) && (format != tFormat::BPP32))
-		return false;
-
-	// Open the file.
-	tFileHandle file = tOpenFile(tgaFile.Chr(), "wb");
-	if (!file)
-		return false;
-
-	uint8 bitDepth = (format == tFormat::BPP24) ? 24 : 32;
-	int bytesPerPixel = bitDepth / 8;
-
-	// imageDesc has the following important fields:
-	// Bits 0-3:	Number of attribute bits associated with each pixel. For a 16bit image, this would be 0 or 1. For a
-	//				24-bit image, it should be 0. For a 32-bit image, it should be 8.
-	// Bit 5:		Orientation. If set, the image is upside down.
-	uint8 imageDesc = 0;
-	imageDesc |= (bitDepth == 24) ? 0 : 8;
-
-	// We'll be writing a 24 or 32bit compressed tga.
-	tPutc(0, file);									// ID string length.
-	tPutc(0, file);									// Colour map type.
-	tPutc(10, file);								// 10 = RLE Compressed True Colour (2=true colour + 8=RLE). Not palletized.
-	tPutc(0, file); tPutc(0, file);
-	tPutc(0, file); tPutc(0, file);
-	tPutc(0, file);
+	// Each row is swizzled straight into the writer's buffer.
+	int bytesPerPixel = (format == tFormat::BPP24) ? 3 : 4;
+	int rowBytes = Width*bytesPerPixel;
+	for (int y = 0; y < Height; y++)
+	{
+		const uint8* src = (const uint8*)(Pixels + y*Width);
+		uint8* dst = writer.Reserve(rowBytes);
+		if (bytesPerPixel == 3)
+			ConvertRGBAToBGR(dst, src, Width);
+		else
+			ConvertRGBAToBGRA(dst, src, Width);
+		writer.Commit(rowBytes);
+	}
+}
 
-	tPutc(0, file); tPutc(0, file);					// X origin.
-	tPutc(0, file); tPutc(0, file);					// Y origin.
-	uint16 w = Width;
-	uint16 h = Height;
-	tPutc((w & 0x00FF), file);						// Width.
-	tPutc((w & 0xFF00) >> 8, file);
-	tPutc((h & 0x00FF), file);						// Height.
-	tPutc((h & 0xFF00) >> 8, file);
 
-	tPutc(bitDepth, file);							// 24 or 32 bit depth. RGB or RGBA.
-	tPutc(imageDesc, file);							// Image desc.  See above.
+void tImageTGA::SaveCompressed(tBlockWriter& writer, tFormat format) const
+{
+	int bytesPerPixel = (format == tFormat::BPP24) ? 3 : 4;
 
-	int numPixels = Height * Width;
-	int index = 0;
-	uint32 colour = 0;
-	uint32* chunkBuffer = new uint32[128];
+	// Pixels are compared in their original RGBA form. For 24-bit output the alpha is ignored when comparing.
+	uint32 compareMask = (bytesPerPixel == 4) ? 0xFFFFFFFF : 0x00FFFFFF;
+	tArray<uint8> rowBuffer(Width*bytesPerPixel);
 
-	// Now we write the pixel packets.  Each packet is either raw or rle.
-	while (index < numPixels)
+	// Packets never cross scanlines. This is what version 2 of the spec asks for and keeps the encoder row-based. The
+	// worst case for a row is every pixel in its own raw packet so we reserve that much up-front.
+	int maxRowBytes = Width*(bytesPerPixel+1);
+	for (int y = 0; y < Height; y++)
 	{
-		bool rlePacket = false;
-		tPixel4b& pixelColour = Pixels[index];
-
-		// Note that we process alphas as zeros if we are writing 24bits only. This ensures the colour comparisons work
-		// properly -- we ignore alpha. Zero is used because the uint32 colour values are initialized to all 0s.
-		uint8 alpha = (bytesPerPixel == 4) ? pixelColour.A : 0;
-		colour = pixelColour.B + (pixelColour.G << 8) + (pixelColour.R << 16) + (alpha << 24);
-
-		chunkBuffer[0] = colour;
-		int rleCount = 1;
+		const uint32* row = (const uint32*)(Pixels + y*Width);
+		uint8* swizzled = rowBuffer.GetElements();
+		if (bytesPerPixel == 3)
+			ConvertRGBAToBGR(swizzled, (const uint8*)row, Width);
+		else
+			ConvertRGBAToBGRA(swizzled, (const uint8*)row, Width);
 
-		// We try to find repeating bytes with a minimum length of 2 pixels. Maximum repeating chunk size is 128 pixels
-		// as the first bit of the count is used for the packet type.
-		while (index + rleCount < numPixels)
+		uint8* dst = writer.Reserve(maxRowBytes);
+		uint8* d = dst;
+		int x = 0;
+		while (x < Width)
 		{
-			tPixel4b& nextPixelColour = Pixels[index+rleCount];
-			uint8 alp = (bytesPerPixel == 4) ? nextPixelColour.A : 0;
-			uint32 nextCol = nextPixelColour.B + (nextPixelColour.G << 8) + (nextPixelColour.R << 16) + (alp << 24);
-
-			if (colour != nextCol || rleCount == 128)
+			// Look for a run of at least 2 identical pixels. Maximum chunk size is 128 pixels as the first bit of the
+			// count is used for the packet type.
+			uint32 colour = row[x] & compareMask;
+			int runCount = 1;
+			while ((x + runCount < Width) && (runCount < 128) && ((row[x+runCount] & compareMask) == colour))
+				runCount++;
+
+			if (runCount > 1)
 			{
-				rlePacket = (rleCount > 1) ? true : false;
-				break;
+				*d++ = uint8(128 | (runCount - 1));
+				tStd::tMemcpy(d, swizzled + x*bytesPerPixel, bytesPerPixel);
+				d += bytesPerPixel;
+				x += runCount;
+				continue;
 			}
-			rleCount++;
-		}
 
-		if (rlePacket)
-		{
-			tPutc(128 | (rleCount - 1), file);
-			tWriteFile(file, &colour, bytesPerPixel);
-		}
-		else
-		{
-			rleCount = 1;
-			while (index + rleCount < numPixels)
+			// Raw packet. Extend it until we hit the start of a run (two identical pixels) or the 128 pixel limit.
+			int rawCount = 1;
+			while ((x + rawCount < Width) && (rawCount < 128))
 			{
-				tPixel4b& nextPixelColour = Pixels[index+rleCount];
-				uint8 alp = (bytesPerPixel == 4) ? nextPixelColour.A : 0;
-				uint32 nextCol = nextPixelColour.B + (nextPixelColour.G << 8) + (nextPixelColour.R << 16) + (alp << 24);
-
-				if ((colour != nextCol && rleCount < 128) || rleCount < 3)
-				{
-					chunkBuffer[rleCount] = colour = nextCol;
-				}
-				else
-				{
-					// Check if the exit condition was the start of a repeating colour.
-					if (colour == nextCol)
-						rleCount -= 2;
+				int next = x + rawCount;
+				if ((next + 1 < Width) && ((row[next] & compareMask) == (row[next+1] & compareMask)))
 					break;
-				}
-				rleCount++;
-			}
-
-			// Write the raw packet data.
-			tPutc(rleCount - 1, file);
-			for (int i = 0; i < rleCount; i++)
-			{
-				colour = chunkBuffer[i];
-				tWriteFile(file, &colour, bytesPerPixel);
+				rawCount++;
 			}
+			*d++ = uint8(rawCount - 1);
+			tStd::tMemcpy(d, swizzled + x*bytesPerPixel, rawCount*bytesPerPixel);
+			d += rawCount*bytesPerPixel;
+			x += rawCount;
 		}
-		index += rleCount;
+		writer.Commit(int(d - dst));
 	}
-
-	delete[] chunkBuffer;
-	tCloseFile(file);
-	return true;
 }
 
 
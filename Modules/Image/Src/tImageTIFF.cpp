@@ -339,4 +339,148 @@ bool tImageTIFF::Save(const tString& tiffFile, const SaveParams& params) const
 }
 
 
+bool tImageTIFF::Save(const tString& tiffFile, const tPicture4s& picture, const SaveParams& params)
+{
+	if (!picture.IsValid() || (params.Format == tFormat::Invalid))
+		return false;
+
+	if (tSystem::tGetFileType(tiffFile) != tSystem::tFileType::TIFF)
+		return false;
+
+	int w = picture.GetWidth();
+	int h = picture.GetHeight();
+	const tPixel4s* pixels = picture.GetPixels();
+
+	int samplesPerPixel = 0;
+	switch (params.Format)
+	{
+		case tFormat::Auto:
+			samplesPerPixel = 3;
+			for (int p = 0; p < w*h; p++)
+			{
+				if (pixels[p].A != 0xFFFF)
+				{
+					samplesPerPixel = 4;
+					break;
+				}
+			}
+			break;
+		case tFormat::BPP24:	samplesPerPixel = 3;	break;
+		case tFormat::BPP32:	samplesPerPixel = 4;	break;
+	}
+	if (!samplesPerPixel)
+		return false;
+
+	TIFF* tiff = TIFFOpen(tiffFile.Chr(), "wb");
+	if (!tiff)
+		return false;
+
+	TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, w);
+	TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, h);
+	TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, samplesPerPixel);
+	TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, 16);
+	TIFFSetField(tiff, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+	TIFFSetField(tiff, TIFFTAG_COMPRESSION, params.UseZLibCompression ? COMPRESSION_DEFLATE : COMPRESSION_NONE);
+	TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+	TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+	if (samplesPerPixel == 4)
+	{
+		uint16 extraSampleTypes[] = { EXTRASAMPLE_UNASSALPHA };
+		TIFFSetField(tiff, TIFFTAG_EXTRASAMPLES, tNumElements(extraSampleTypes), extraSampleTypes);
+	}
+
+	int rowSize = TIFFScanlineSize(tiff);
+	tAssert(rowSize == (w*samplesPerPixel*2));
+	uint16* rowBuf = (uint16*)_TIFFmalloc(rowSize);
+
+	// Samples are written in native byte order. LibTIFF records the order in the header.
+	bool success = true;
+	TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(tiff, rowSize));
+	for (int r = 0; r < h; r++)
+	{
+		const tPixel4s* srcRow = pixels + (h-r-1)*w;
+		for (int x = 0; x < w; x++)
+		{
+			rowBuf[x*samplesPerPixel + 0] = srcRow[x].R;
+			rowBuf[x*samplesPerPixel + 1] = srcRow[x].G;
+			rowBuf[x*samplesPerPixel + 2] = srcRow[x].B;
+			if (samplesPerPixel == 4)
+				rowBuf[x*samplesPerPixel + 3] = srcRow[x].A;
+		}
+
+		if (TIFFWriteScanline(tiff, rowBuf, r, 0) < 0)
+		{
+			success = false;
+			break;
+		}
+	}
+
+	_TIFFfree(rowBuf);
+	TIFFClose(tiff);
+	return success;
+}
+
+
+bool tImageTIFF::Load(const tString& tiffFile, tPicture4s& picture)
+{
+	picture.Clear();
+	if (tSystem::tGetFileType(tiffFile) != tSystem::tFileType::TIFF)
+		return false;
+
+	if (!tFileExists(tiffFile))
+		return false;
+
+	TIFF* tiff = TIFFOpen(tiffFile.Chr(), "rb");
+	if (!tiff)
+		return false;
+
+	uint32 w = 0; uint32 h = 0;
+	uint16 bitsPerSample = 0; uint16 samplesPerPixel = 0;
+	uint16 planarConfig = PLANARCONFIG_CONTIG; uint16 sampleFormat = SAMPLEFORMAT_UINT;
+	TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &w);
+	TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &h);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planarConfig);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &sampleFormat);
+	if
+	(
+		(w == 0) || (h == 0) || (bitsPerSample != 16) || ((samplesPerPixel != 3) && (samplesPerPixel != 4)) ||
+		(planarConfig != PLANARCONFIG_CONTIG) || (sampleFormat != SAMPLEFORMAT_UINT) ||
+		(TIFFScanlineSize(tiff) != tmsize_t(w*samplesPerPixel*2))
+	)
+	{
+		TIFFClose(tiff);
+		return false;
+	}
+
+	// LibTIFF swaps the samples to native byte order. Rows are stored top to bottom.
+	picture.Set(int(w), int(h));
+	tPixel4s* pixels = picture.GetPixels();
+	uint16* rowBuf = (uint16*)_TIFFmalloc(TIFFScanlineSize(tiff));
+	bool success = true;
+	for (uint32 r = 0; r < h; r++)
+	{
+		if (TIFFReadScanline(tiff, rowBuf, r, 0) < 0)
+		{
+			success = false;
+			break;
+		}
+
+		tPixel4s* dstRow = pixels + (h-r-1)*w;
+		for (uint32 x = 0; x < w; x++)
+		{
+			const uint16* src = rowBuf + x*samplesPerPixel;
+			dstRow[x].Set(src[0], src[1], src[2], (samplesPerPixel == 4) ? src[3] : uint16(0xFFFF));
+		}
+	}
+
+	_TIFFfree(rowBuf);
+	TIFFClose(tiff);
+	if (!success)
+		picture.Clear();
+	return success;
+}
+
+
 }
@@ -16,6 +16,7 @@
 #include <Foundation/tStandard.h>
 #include <Foundation/tString.h>
 #include <System/tFile.h>
+#include <System/tThread.h>
 #include "Image/tImageWEBP.h"
 #include "Image/tPicture.h"
 #include "WebP/include/mux.h"
@@ -316,6 +317,41 @@ tFrame* tImageWEBP::GetFrame(bool steal)
 }
 
 
+namespace tWEBP
+{
+	// Encodes one frame as a standalone webp bitstream into the supplied (initialized) writer. The writer may hold
+	// partial data on failure and should always be cleared by the caller.
+	bool EncodeFrame(const WebPConfig&, const tFrame&, WebPMemoryWriter&);
+}
+
+
+bool tWEBP::EncodeFrame(const WebPConfig& config, const tFrame& frame, WebPMemoryWriter& writer)
+{
+	WebPPicture pic;
+	if (!WebPPictureInit(&pic))
+		return false;
+
+	// This is inefficient here. I'm reversing the rows so I can use the simple
+	// WebPPictureImportRGBA. But this is a waste of memory and time.
+	tFrame normFrame(frame);
+	normFrame.ReverseRows();
+
+	pic.width = normFrame.Width;
+	pic.height = normFrame.Height;
+	if (!WebPPictureImportRGBA(&pic, (uint8*)normFrame.Pixels, normFrame.Width*sizeof(tPixel4b)))
+	{
+		WebPPictureFree(&pic);
+		return false;
+	}
+
+	pic.writer = WebPMemoryWrite;
+	pic.custom_ptr = &writer;
+	int success = WebPEncode(&config, &pic);
+	WebPPictureFree(&pic);
+	return success ? true : false;
+}
+
+
 bool tImageWEBP::Save(const tString& webpFile, bool lossy, float qualityCompstr, int overrideFrameDuration) const
 {
 	SaveParams params;
@@ -339,8 +375,9 @@ bool tImageWEBP::Save(const tString& webpFile, const SaveParams& params) const
 	if (!success)
 		return false;
 
-	// config.method is the quality/speed trade-off (0=fast, 6=slower-better).
 	config.lossless = params.Lossy ? 0 : 1;
+	config.method = tMath::tClamp(params.Method, 0, 6);
+	config.thread_level = params.ThreadLevel ? 1 : 0;
 
 	// Additional config parameters in lossy mode.
 	if (params.Lossy)
@@ -354,59 +391,56 @@ bool tImageWEBP::Save(const tString& webpFile, const SaveParams& params) const
 	if (!success)
 		return false;
 
-	// Setup the muxer so we can put more than one image in a file.
+	// Every frame is a standalone webp bitstream so they can all be encoded at the same time. The config is only read
+	// by WebPEncode so it is safe to share.
+	int numFrames = Frames.GetNumItems();
+	const tFrame** frames = new const tFrame*[numFrames];
+	WebPMemoryWriter* writers = new WebPMemoryWriter[numFrames];
+	bool* encoded = new bool[numFrames];
+	int frameIndex = 0;
+	for (const tFrame* frame = Frames.First(); frame; frame = frame->Next())
+		frames[frameIndex++] = frame;
+
+	tParallelFor
+	(
+		numFrames,
+		[&config, frames, writers, encoded](int begin, int end)
+		{
+			for (int f = begin; f < end; f++)
+			{
+				WebPMemoryWriterInit(&writers[f]);
+				encoded[f] = tWEBP::EncodeFrame(config, *frames[f], writers[f]);
+			}
+		},
+		params.NumThreads
+	);
+
+	// Setup the muxer so we can put more than one image in a file. The writers outlive the assemble call so the mux
+	// does not need its own copy of each bitstream.
 	WebPMux* mux = WebPMuxNew();
 
 	WebPMuxAnimParams animParams;
 	animParams.bgcolor = 0x00000000;
 	animParams.loop_count = 0;
-    WebPMuxSetAnimationParams(mux, &animParams);
+	WebPMuxSetAnimationParams(mux, &animParams);
 
-	bool animated = Frames.GetNumItems() > 1;
-	for (tFrame* frame = Frames.First(); frame; frame = frame->Next())
+	bool animated = numFrames > 1;
+	int copyData = 0;
+	for (int f = 0; f < numFrames; f++)
 	{
-		WebPPicture pic;
-		success = WebPPictureInit(&pic);
-		if (!success)
+		if (!encoded[f])
 			continue;
 
-		// This is inefficient here. I'm reversing the rows so I can use the simple
-		// WebPPictureImportRGBA. But this is a waste of memory and time.
-		tFrame normFrame(*frame);
-		normFrame.ReverseRows();
-
-		// Let's get one frame going first.
-		//tFrame* frame = Frames.Head();
-		pic.width = normFrame.Width;
-		pic.height = normFrame.Height;
-		success = WebPPictureImportRGBA(&pic, (uint8*)normFrame.Pixels, normFrame.Width*sizeof(tPixel4b));
-		if (!success)
-			continue;
-
-		WebPMemoryWriter writer;
-		WebPMemoryWriterInit(&writer);
-		pic.writer = WebPMemoryWrite;
-		pic.custom_ptr = &writer;
-
-		success = WebPEncode(&config, &pic);
-		if (!success)
-			continue;
-
-		// Done with pic.
-		WebPPictureFree(&pic);
-
-		WebPData webpData;		
-		webpData.bytes = writer.mem;
-		webpData.size = writer.size;
-
-		int copyData = 1;
+		WebPData webpData;
+		webpData.bytes = writers[f].mem;
+		webpData.size = writers[f].size;
 		if (animated)
 		{
 			WebPMuxFrameInfo frameInfo;
 			tStd::tMemset(&frameInfo, 0, sizeof(WebPMuxFrameInfo));
 
 			// Frame duration is an integer in milliseconds.
-			frameInfo.duration = (params.OverrideFrameDuration >= 0) ? params.OverrideFrameDuration : int(frame->Duration * 1000.0f);
+			frameInfo.duration = (params.OverrideFrameDuration >= 0) ? params.OverrideFrameDuration : int(frames[f]->Duration * 1000.0f);
 			frameInfo.bitstream = webpData;
 			frameInfo.id = WEBP_CHUNK_ANMF;
 			frameInfo.blend_method = WEBP_MUX_NO_BLEND;
@@ -418,8 +452,6 @@ bool tImageWEBP::Save(const tString& webpFile, const SaveParams& params) const
 			// One frame. Not animated.
 			WebPMuxSetImage(mux, &webpData, copyData);
 		}
-
-		WebPMemoryWriterClear(&writer);
 	}
 
 	// Get data from mux in WebP RIFF format.
@@ -428,10 +460,15 @@ bool tImageWEBP::Save(const tString& webpFile, const SaveParams& params) const
 	WebPMuxAssemble(mux, &assembledData);
 	WebPMuxDelete(mux);
 
+	for (int f = 0; f < numFrames; f++)
+		WebPMemoryWriterClear(&writers[f]);
+	delete[] encoded;
+	delete[] writers;
+	delete[] frames;
+
 	bool ok = tCreateFile(webpFile, (uint8*)assembledData.bytes, assembledData.size);
 	WebPDataClear(&assembledData);
 	return ok;
 }
 
-
 }
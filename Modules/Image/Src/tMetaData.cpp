@@ -14,14 +14,81 @@
 // AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <atomic>
 #include "Image/tMetaData.h"
 #include "System/tPrint.h"
+#include "System/tFile.h"
+#include "System/tThread.h"
 #include "Math/tVector3.h"
 #include "TinyEXIF/TinyEXIF.h"
 using namespace tImage;
 using namespace tMath;
 
 
+// Helpers for finding the EXIF and XMP payloads inside the various image containers without decoding anything.
+namespace tEXIF
+{
+	enum class Container { Unknown, JPG, PNG, WEBP, TIFF };
+	const int ContainerHeadBytes = 12;
+	Container GetContainer(const uint8* head, int numBytes);
+
+	// The streams also know their total size so a whole tiff can be requested in one piece. GetBuffer returns nullptr
+	// if there aren't enough bytes left.
+	class Stream : public TinyEXIF::EXIFStream
+	{
+	public:
+		virtual int GetSize() const = 0;
+	};
+
+	class MemStream : public Stream
+	{
+	public:
+		MemStream(const uint8* data, int numBytes)																		: Data(data), Size(numBytes) { }
+		bool IsValid() const override																					{ return Data && (Size > 0); }
+		const uint8_t* GetBuffer(unsigned len) override																	{ if (len > unsigned(Size-Pos)) return nullptr; const uint8* buf = Data+Pos; Pos += len; return buf; }
+		bool SkipBuffer(unsigned len) override																			{ if (len > unsigned(Size-Pos)) return false; Pos += len; return true; }
+		int GetSize() const override																					{ return Size; }
+
+	private:
+		const uint8* Data;
+		int Size;
+		int Pos = 0;
+	};
+
+	// Only the bytes asked for with GetBuffer are read. Skipped sections are seeked over.
+	class FileStream : public Stream
+	{
+	public:
+		FileStream(const tString& file)																					: File(tSystem::tOpenFile(file.Chr(), "rb")) { Size = File ? tSystem::tGetFileSize(File) : 0; }
+		~FileStream()																									{ if (File) tSystem::tCloseFile(File); delete[] Buffer; }
+		bool IsValid() const override																					{ return File && (Size > 0); }
+		const uint8_t* GetBuffer(unsigned len) override;
+		bool SkipBuffer(unsigned len) override;
+		int GetSize() const override																					{ return Size; }
+
+	private:
+		tFileHandle File;
+		int Size;
+		int Pos					= 0;
+		uint8* Buffer			= nullptr;
+		int BufferSize			= 0;
+	};
+
+	// Payloads may or may not start with "Exif\0\0". TinyEXIF requires it so it is added if missing.
+	int ParseEXIFPayload(TinyEXIF::EXIFInfo&, const uint8* payload, int numBytes);
+	int ParseXMPPayload(TinyEXIF::EXIFInfo&, const uint8* xml, int numBytes);
+
+	// All of these return true if either EXIF or XMP data was successfully parsed.
+	bool Parse(TinyEXIF::EXIFInfo&, Stream&, Container);
+	bool ParsePNG(TinyEXIF::EXIFInfo&, Stream&);
+	bool ParseWEBP(TinyEXIF::EXIFInfo&, Stream&);
+	bool ParseTIFF(TinyEXIF::EXIFInfo&, Stream&);
+
+	uint32 GetBE32(const uint8* b)																						{ return (uint32(b[0]) << 24) | (uint32(b[1]) << 16) | (uint32(b[2]) << 8) | uint32(b[3]); }
+	uint32 GetLE32(const uint8* b)																						{ return (uint32(b[3]) << 24) | (uint32(b[2]) << 16) | (uint32(b[1]) << 8) | uint32(b[0]); }
+}
+
+
 const char* tMetaTagNames[] =
 {
 	// Camera Hardware Tag Names
@@ -204,14 +271,234 @@ const char* tImage::tGetMetaTagDesc(tMetaTag tag)
 }
 
 
-bool tMetaData::Set(const uint8* rawJpgImageData, int numBytes)
+tEXIF::Container tEXIF::GetContainer(const uint8* head, int numBytes)
+{
+	if ((numBytes >= 2) && (head[0] == 0xFF) && (head[1] == 0xD8))
+		return Container::JPG;
+
+	const uint8 pngSig[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+	if ((numBytes >= 8) && (tStd::tMemcmp(head, pngSig, 8) == 0))
+		return Container::PNG;
+
+	if ((numBytes >= 12) && (tStd::tMemcmp(head, "RIFF", 4) == 0) && (tStd::tMemcmp(head+8, "WEBP", 4) == 0))
+		return Container::WEBP;
+
+	if ((numBytes >= 4) && ((tStd::tMemcmp(head, "II*\0", 4) == 0) || (tStd::tMemcmp(head, "MM\0*", 4) == 0)))
+		return Container::TIFF;
+
+	return Container::Unknown;
+}
+
+
+const uint8_t* tEXIF::FileStream::GetBuffer(unsigned len)
+{
+	if (!File || (len > unsigned(Size-Pos)))
+		return nullptr;
+
+	if (int(len) > BufferSize)
+	{
+		delete[] Buffer;
+		BufferSize = tMath::tMax(int(len), 4096);
+		Buffer = new uint8[BufferSize];
+	}
+
+	int numRead = tSystem::tReadFile(File, Buffer, len);
+	Pos += numRead;
+	return (numRead == int(len)) ? Buffer : nullptr;
+}
+
+
+bool tEXIF::FileStream::SkipBuffer(unsigned len)
+{
+	if (!File || (len > unsigned(Size-Pos)))
+		return false;
+
+	if (tSystem::tFileSeek(File, len, tSystem::tSeekOrigin::Current) != 0)
+		return false;
+
+	Pos += len;
+	return true;
+}
+
+
+int tEXIF::ParseEXIFPayload(TinyEXIF::EXIFInfo& info, const uint8* payload, int numBytes)
+{
+	const int prefixSize = 6;
+	if ((numBytes >= prefixSize) && (tStd::tMemcmp(payload, "Exif\0\0", prefixSize) == 0))
+		return info.parseFromEXIFSegment(payload, numBytes);
+
+	uint8* segment = new uint8[numBytes + prefixSize];
+	tStd::tMemcpy(segment, "Exif\0\0", prefixSize);
+	tStd::tMemcpy(segment + prefixSize, payload, numBytes);
+	int result = info.parseFromEXIFSegment(segment, numBytes + prefixSize);
+	delete[] segment;
+	return result;
+}
+
+
+int tEXIF::ParseXMPPayload(TinyEXIF::EXIFInfo& info, const uint8* xml, int numBytes)
+{
+	return info.parseFromXMPSegmentXML((const char*)xml, numBytes);
+}
+
+
+bool tEXIF::Parse(TinyEXIF::EXIFInfo& info, Stream& stream, Container container)
+{
+	info.clear();
+	switch (container)
+	{
+		// TinyEXIF already knows how to walk the jpg segments and stops at the start of the compressed data.
+		case Container::JPG:	return info.parseFrom(stream) == TinyEXIF::PARSE_SUCCESS;
+		case Container::PNG:	return ParsePNG(info, stream);
+		case Container::WEBP:	return ParseWEBP(info, stream);
+		case Container::TIFF:	return ParseTIFF(info, stream);
+	}
+	return false;
+}
+
+
+bool tEXIF::ParsePNG(TinyEXIF::EXIFInfo& info, Stream& stream)
+{
+	if (!stream.SkipBuffer(8))
+		return false;
+
+	// Each chunk is a big-endian length, a 4 character type, the data, and a 4 byte CRC. The image data chunks are
+	// skipped over without being read.
+	bool foundEXIF = false, foundXMP = false;
+	const uint8* chunkHeader;
+	while ((!foundEXIF || !foundXMP) && (chunkHeader = stream.GetBuffer(8)))
+	{
+		uint32 length = GetBE32(chunkHeader);
+		uint32 type = GetBE32(chunkHeader+4);
+		if (type == GetBE32((const uint8*)"IEND"))
+			break;
+
+		if (type == GetBE32((const uint8*)"eXIf"))
+		{
+			const uint8* data = stream.GetBuffer(length);
+			if (!data)
+				break;
+			foundEXIF = foundEXIF || (ParseEXIFPayload(info, data, length) == TinyEXIF::PARSE_SUCCESS);
+		}
+		else if (type == GetBE32((const uint8*)"iTXt"))
+		{
+			// Keyword, compression flag, compression method, language tag, translated keyword, then the text. We only
+			// handle uncompressed XMP which is what all the writers we know of produce.
+			const uint8* data = stream.GetBuffer(length);
+			if (!data)
+				break;
+			const char* xmpKeyword = "XML:com.adobe.xmp";
+			int keywordLen = tStd::tStrlen(xmpKeyword) + 1;
+			if ((int(length) > keywordLen + 2) && (tStd::tMemcmp(data, xmpKeyword, keywordLen) == 0) && (data[keywordLen] == 0))
+			{
+				const uint8* end = data + length;
+				const uint8* text = data + keywordLen + 2;
+				for (int nulls = 0; (nulls < 2) && (text < end); text++)
+					if (*text == 0)
+						nulls++;
+				if (text < end)
+					foundXMP = foundXMP || (ParseXMPPayload(info, text, int(end - text)) == TinyEXIF::PARSE_SUCCESS);
+			}
+		}
+		else if (!stream.SkipBuffer(length))
+		{
+			break;
+		}
+
+		if (!stream.SkipBuffer(4))
+			break;
+	}
+
+	return foundEXIF || foundXMP;
+}
+
+
+bool tEXIF::ParseWEBP(TinyEXIF::EXIFInfo& info, Stream& stream)
+{
+	if (!stream.SkipBuffer(12))
+		return false;
+
+	// RIFF chunks are a 4 character type and a little-endian size. Odd sized chunks are padded by a byte.
+	bool foundEXIF = false, foundXMP = false;
+	const uint8* chunkHeader;
+	while ((!foundEXIF || !foundXMP) && (chunkHeader = stream.GetBuffer(8)))
+	{
+		bool isEXIF = (tStd::tMemcmp(chunkHeader, "EXIF", 4) == 0);
+		bool isXMP = (tStd::tMemcmp(chunkHeader, "XMP ", 4) == 0);
+		uint32 size = GetLE32(chunkHeader+4);
+		uint32 padding = size & 1;
+		if (isEXIF || isXMP)
+		{
+			const uint8* data = stream.GetBuffer(size);
+			if (!data)
+				break;
+			if (isEXIF)
+				foundEXIF = foundEXIF || (ParseEXIFPayload(info, data, size) == TinyEXIF::PARSE_SUCCESS);
+			else
+				foundXMP = foundXMP || (ParseXMPPayload(info, data, size) == TinyEXIF::PARSE_SUCCESS);
+			if (padding && !stream.SkipBuffer(padding))
+				break;
+		}
+		else if (!stream.SkipBuffer(size + padding))
+		{
+			break;
+		}
+	}
+
+	return foundEXIF || foundXMP;
+}
+
+
+bool tEXIF::ParseTIFF(TinyEXIF::EXIFInfo& info, Stream& stream)
+{
+	// A tiff file is itself the EXIF structure. The IFD offsets are relative to the start of the file, so we need a
+	// single contiguous piece starting there. Tags that point past what we read are ignored by TinyEXIF.
+	int numBytes = tMath::tMin(stream.GetSize(), tMetaData::MaxTIFFHeadBytes);
+	const uint8* data = stream.GetBuffer(numBytes);
+	if (!data)
+		return false;
+
+	return ParseEXIFPayload(info, data, numBytes) == TinyEXIF::PARSE_SUCCESS;
+}
+
+
+bool tMetaData::Set(const uint8* imageFileInMemory, int numBytes)
+{
+	Clear();
+	if (!imageFileInMemory || (numBytes <= 0))
+		return false;
+
+	tEXIF::Container container = tEXIF::GetContainer(imageFileInMemory, numBytes);
+	tEXIF::MemStream stream(imageFileInMemory, numBytes);
+	TinyEXIF::EXIFInfo exifInfo;
+	if (!tEXIF::Parse(exifInfo, stream, container))
+		return false;
+
+	return SetTags(exifInfo);
+}
+
+
+bool tMetaData::Set(const tString& imageFile)
 {
 	Clear();
+	uint8 head[tEXIF::ContainerHeadBytes];
+	int headBytes = tEXIF::ContainerHeadBytes;
+	tSystem::tLoadFileHead(imageFile, headBytes, head);
+	tEXIF::Container container = tEXIF::GetContainer(head, headBytes);
+	if (container == tEXIF::Container::Unknown)
+		return false;
+
+	tEXIF::FileStream stream(imageFile);
 	TinyEXIF::EXIFInfo exifInfo;
-	int errorCode = exifInfo.parseFrom(rawJpgImageData, numBytes);
-	if (errorCode)
+	if (!tEXIF::Parse(exifInfo, stream, container))
 		return false;
 
+	return SetTags(exifInfo);
+}
+
+
+bool tMetaData::SetTags(const TinyEXIF::EXIFInfo& exifInfo)
+{
 	SetTags_CamHardware(exifInfo);
 	SetTags_GeoLocation(exifInfo);
 	SetTags_CamSettings(exifInfo);
@@ -221,6 +508,40 @@ bool tMetaData::Set(const uint8* rawJpgImageData, int numBytes)
 }
 
 
+int tImage::tGetMetaData(tMetaData* results, const tList<tStringItem>& imageFiles, int numThreads)
+{
+	int numFiles = imageFiles.GetNumItems();
+	if (!results || (numFiles <= 0))
+		return 0;
+
+	// Indexable array of the filenames.
+	const tStringItem** files = new const tStringItem*[numFiles];
+	int f = 0;
+	for (const tStringItem* file = imageFiles.First(); file; file = file->Next())
+		files[f++] = file;
+
+	// File access times vary a lot so rather than give each thread a fixed range, every worker grabs the next file
+	// index until there are none left.
+	std::atomic<int> nextFile(0);
+	std::atomic<int> numValid(0);
+	int numWorkers = tSystem::tGetNumWorkerThreads(numFiles, numThreads);
+	tSystem::tParallelFor
+	(
+		numWorkers,
+		[&](int, int)
+		{
+			for (int i = nextFile++; i < numFiles; i = nextFile++)
+				if (results[i].Set(*files[i]))
+					numValid++;
+		},
+		numWorkers
+	);
+
+	delete[] files;
+	return numValid;
+}
+
+
 void tMetaData::SetTags_CamHardware(const TinyEXIF::EXIFInfo& exifInfo)
 {
 	// Make. tString can handle nullptr.
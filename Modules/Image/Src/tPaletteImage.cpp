@@ -16,8 +16,8 @@
 
 #include <Foundation/tAssert.h>
 #include <Foundation/tStandard.h>
-#include <Foundation/tBitArray.h>
 #include "Image/tPaletteImage.h"
+#include "Image/tPixelUtil.h"
 namespace tImage
 {
 
@@ -158,20 +158,8 @@ bool tPaletteImage::Set(tPixelFormat fmt, int width, int height, const tPixel3b*
 			return false;
 	}
 
-	// Step 2. Populate PixelData from indices.
-	int bpp = tGetBitsPerPixel(fmt);
-	int numBits = Width*Height*bpp;
-	int bitIndex = 0;
-	tBitArray8 bitArray(PixelData, numBits, true);
-	for (int y = 0; y < Height; y++)
-	{
-		for (int x = 0; x < Width; x++)
-		{
-			bitArray.SetBits(bitIndex, bpp, indices[x + y*Width]);
-			bitIndex += bpp;
-		}
-	}
-	
+	// Step 2. Populate PixelData from indices. There is no padding between rows so the whole image is one run.
+	PackIndices(PixelData, indices, Width*Height, tGetBitsPerPixel(fmt));
 	delete[] indices;
 	return true;
 }
@@ -182,21 +170,12 @@ bool tPaletteImage::Get(tPixel4b* pixels)
 	if (!IsValid() || !pixels)
 		return false;
 
-	int bpp = tGetBitsPerPixel(PixelFormat);
-	int numBits = Width*Height*bpp;
-	int bitIndex = 0;
-	tBitArray8 bitArray(PixelData, numBits, true);
-	for (int y = 0; y < Height; y++)
-	{
-		for (int x = 0; x < Width; x++)
-		{
-			uint8 palIdx = bitArray.GetBits(bitIndex, bpp);
-			tColour3b& colour = Palette[palIdx];
-			pixels[x + y*Width].Set(colour.R, colour.G, colour.B);
-			bitIndex += bpp;
-		}
-	}
+	tPixel4b palette[256];
+	int palSize = GetPaletteSize();
+	for (int c = 0; c < palSize; c++)
+		palette[c].Set(Palette[c].R, Palette[c].G, Palette[c].B);
 
+	ExpandIndices(pixels, PixelData, Width*Height, tGetBitsPerPixel(PixelFormat), palette);
 	return true;
 }
 
@@ -206,21 +185,7 @@ bool tPaletteImage::Get(tPixel3b* pixels)
 	if (!IsValid() || !pixels)
 		return false;
 
-	int bpp = tGetBitsPerPixel(PixelFormat);
-	int numBits = Width*Height*bpp;
-	int bitIndex = 0;
-	tBitArray8 bitArray(PixelData, numBits, true);
-	for (int y = 0; y < Height; y++)
-	{
-		for (int x = 0; x < Width; x++)
-		{
-			uint8 palIdx = bitArray.GetBits(bitIndex, bpp);
-			tColour3b& colour = Palette[palIdx];
-			pixels[x + y*Width].Set(colour.R, colour.G, colour.B);
-			bitIndex += bpp;
-		}
-	}
-
+	ExpandIndices(pixels, PixelData, Width*Height, tGetBitsPerPixel(PixelFormat), Palette);
 	return true;
 }
 
@@ -47,6 +47,15 @@ const char* ASTCENCODER_VERSION_STRING		= VERSION_STRING;
 #include <tinyxml2.h>
 #include <TinyEXIF.h>
 #include "Image/tResample.h"
+#include <System/tThread.h>
+#if defined(ARCHITECTURE_X64) || defined(ARCHITECTURE_X86)
+	#define PICTURE_SSE2
+	#include <emmintrin.h>
+	#if defined(__SSSE3__) || defined(_MSC_VER)
+		#define PICTURE_SSSE3
+		#include <tmmintrin.h>
+	#endif
+#endif
 
 
 using namespace tMath;
@@ -80,6 +89,343 @@ int tImage::Version_TinyEXIF_Minor			= TINYEXIF_MINOR_VERSION;
 int tImage::Version_TinyEXIF_Patch			= TINYEXIF_PATCH_VERSION;
 
 
+namespace tPic
+{
+	// Rotates work on square tiles so both the rows read and the columns written by a tile stay in cache. Rotates and
+	// flips are only spread across threads for large images since starting threads is not free.
+	const int TileSize				= 32;
+	const int MinParallelPixels		= 1024*1024;
+
+	// Rotates source rows [y0, y1) by 90 degrees into dst, which is srcH wide and srcW high.
+	void Rotate90Rows(tPixel4b* dst, const tPixel4b* src, int srcW, int srcH, int y0, int y1, bool antiClockwise);
+
+	// Reverses the order of the pixels in a row in place.
+	void ReverseRow(tPixel4b* row, int width);
+
+	// Exchanges the contents of two rows.
+	void SwapRows(tPixel4b* rowA, tPixel4b* rowB, int width);
+
+	// Calls fn(pixels, numPixels) for spans of whole rows. Large images have their rows split across threads.
+	template<typename Fn> void ParallelSpans(tPixel4b* pixels, int width, int height, Fn);
+
+	// Returns a pixel-sized mask with 0xFF in the bytes of the specified channels.
+	uint32 GetChannelMask(comp_t channels);
+
+	// Swizzle sources for each destination channel. Values 0 to 3 copy that source channel.
+	const int SwizzleZero			= -1;
+	const int SwizzleFull			= -2;
+	int GetSwizzleSource(tComp, int defaultSource);
+
+	// The span kernels. Only the bytes in mask are modified by SetSpan and IntensitySpan. AlphaBlendSpan blends the
+	// masked channels and sets alpha to finalAlpha if it is >= 0.
+	void SetSpan(tPixel4b*, int numPixels, const tPixel4b& colour, uint32 mask);
+	void SwizzleSpan(tPixel4b*, int numPixels, const int sources[4]);
+	void IntensitySpan(tPixel4b*, int numPixels, uint32 mask);
+	void AlphaBlendSpan(tPixel4b*, int numPixels, const tColour4b& blend, uint32 mask, int finalAlpha);
+}
+
+
+void tPic::Rotate90Rows(tPixel4b* dst, const tPixel4b* src, int srcW, int srcH, int y0, int y1, bool antiClockwise)
+{
+	// Source column x becomes destination row x with the rows reversed for anti-clockwise, and destination row
+	// srcW-1-x for clockwise.
+	int dstW = srcH;
+	for (int ty = y0; ty < y1; ty += TileSize)
+	{
+		int tyEnd = tMin(ty + TileSize, y1);
+		for (int tx = 0; tx < srcW; tx += TileSize)
+		{
+			int txEnd = tMin(tx + TileSize, srcW);
+			int y = ty;
+
+			#ifdef PICTURE_SSE2
+			for (; y+4 <= tyEnd; y += 4)
+			{
+				int x = tx;
+				for (; x+4 <= txEnd; x += 4)
+				{
+					// Transpose the 4x4 block so each register holds one source column.
+					__m128i r0 = _mm_loadu_si128((const __m128i*)(src + (y+0)*srcW + x));
+					__m128i r1 = _mm_loadu_si128((const __m128i*)(src + (y+1)*srcW + x));
+					__m128i r2 = _mm_loadu_si128((const __m128i*)(src + (y+2)*srcW + x));
+					__m128i r3 = _mm_loadu_si128((const __m128i*)(src + (y+3)*srcW + x));
+					__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+					__m128i t1 = _mm_unpacklo_epi32(r2, r3);
+					__m128i t2 = _mm_unpackhi_epi32(r0, r1);
+					__m128i t3 = _mm_unpackhi_epi32(r2, r3);
+					__m128i cols[4] =
+					{
+						_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+						_mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3)
+					};
+					for (int c = 0; c < 4; c++)
+					{
+						if (antiClockwise)
+							_mm_storeu_si128((__m128i*)(dst + (x+c)*dstW + srcH-4-y), _mm_shuffle_epi32(cols[c], _MM_SHUFFLE(0, 1, 2, 3)));
+						else
+							_mm_storeu_si128((__m128i*)(dst + (srcW-1-x-c)*dstW + y), cols[c]);
+					}
+				}
+
+				for (; x < txEnd; x++)
+					for (int r = y; r < y+4; r++)
+						dst[ antiClockwise ? x*dstW + srcH-1-r : (srcW-1-x)*dstW + r ] = src[r*srcW + x];
+			}
+			#endif
+
+			for (; y < tyEnd; y++)
+				for (int x = tx; x < txEnd; x++)
+					dst[ antiClockwise ? x*dstW + srcH-1-y : (srcW-1-x)*dstW + y ] = src[y*srcW + x];
+		}
+	}
+}
+
+
+void tPic::ReverseRow(tPixel4b* row, int width)
+{
+	int left = 0;
+	int right = width-1;
+
+	#ifdef PICTURE_SSE2
+	// Swap four pixels from each end at a time, reversing each group.
+	for (; right-left+1 >= 8; left += 4, right -= 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(row + left));
+		__m128i b = _mm_loadu_si128((const __m128i*)(row + right-3));
+		_mm_storeu_si128((__m128i*)(row + left), _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 1, 2, 3)));
+		_mm_storeu_si128((__m128i*)(row + right-3), _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 1, 2, 3)));
+	}
+	#endif
+
+	for (; left < right; left++, right--)
+	{
+		tPixel4b tmp = row[left];
+		row[left] = row[right];
+		row[right] = tmp;
+	}
+}
+
+
+void tPic::SwapRows(tPixel4b* rowA, tPixel4b* rowB, int width)
+{
+	int x = 0;
+
+	#ifdef PICTURE_SSE2
+	for (; x+4 <= width; x += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(rowA + x));
+		__m128i b = _mm_loadu_si128((const __m128i*)(rowB + x));
+		_mm_storeu_si128((__m128i*)(rowA + x), b);
+		_mm_storeu_si128((__m128i*)(rowB + x), a);
+	}
+	#endif
+
+	for (; x < width; x++)
+	{
+		tPixel4b tmp = rowA[x];
+		rowA[x] = rowB[x];
+		rowB[x] = tmp;
+	}
+}
+
+
+template<typename Fn> void tPic::ParallelSpans(tPixel4b* pixels, int width, int height, Fn fn)
+{
+	auto processRows = [&](int begin, int end)
+	{
+		fn(pixels + begin*width, (end-begin)*width);
+	};
+	tParallelFor(height, processRows, (width*height >= MinParallelPixels) ? 0 : 1);
+}
+
+
+uint32 tPic::GetChannelMask(comp_t channels)
+{
+	tPixel4b mask
+	(
+		(channels & tCompBit_R) ? 0xFF : 0x00, (channels & tCompBit_G) ? 0xFF : 0x00,
+		(channels & tCompBit_B) ? 0xFF : 0x00, (channels & tCompBit_A) ? 0xFF : 0x00
+	);
+	return mask.BP;
+}
+
+
+int tPic::GetSwizzleSource(tComp comp, int defaultSource)
+{
+	switch (comp)
+	{
+		case tComp::R:		return 0;
+		case tComp::G:		return 1;
+		case tComp::B:		return 2;
+		case tComp::A:		return 3;
+		case tComp::Zero:	return SwizzleZero;
+		case tComp::Full:	return SwizzleFull;
+		case tComp::Auto:	return defaultSource;
+		default:			break;
+	}
+
+	// Anything else is zero for the colour channels and full for alpha.
+	return (defaultSource == 3) ? SwizzleFull : SwizzleZero;
+}
+
+
+void tPic::SetSpan(tPixel4b* pixels, int numPixels, const tPixel4b& colour, uint32 mask)
+{
+	uint32 setBits = colour.BP & mask;
+	int p = 0;
+
+	#ifdef PICTURE_SSE2
+	__m128i setBits4 = _mm_set1_epi32(int(setBits));
+	__m128i keepMask4 = _mm_set1_epi32(int(~mask));
+	for (; p+4 <= numPixels; p += 4)
+	{
+		__m128i px = _mm_loadu_si128((const __m128i*)(pixels + p));
+		_mm_storeu_si128((__m128i*)(pixels + p), _mm_or_si128(_mm_and_si128(px, keepMask4), setBits4));
+	}
+	#endif
+
+	for (; p < numPixels; p++)
+		pixels[p].BP = (pixels[p].BP & ~mask) | setBits;
+}
+
+
+void tPic::SwizzleSpan(tPixel4b* pixels, int numPixels, const int sources[4])
+{
+	int p = 0;
+
+	#ifdef PICTURE_SSSE3
+	// A zero destination byte comes from a shuffle index with the high bit set. Full bytes are ORed in afterwards.
+	alignas(16) uint8 shuffle[16];
+	alignas(16) uint8 full[16];
+	for (int b = 0; b < 16; b++)
+	{
+		int source = sources[b & 3];
+		shuffle[b] = (source >= 0) ? uint8((b & ~3) + source) : 0x80;
+		full[b] = (source == SwizzleFull) ? 0xFF : 0x00;
+	}
+	__m128i shuffle4 = _mm_load_si128((const __m128i*)shuffle);
+	__m128i full4 = _mm_load_si128((const __m128i*)full);
+	for (; p+4 <= numPixels; p += 4)
+	{
+		__m128i px = _mm_loadu_si128((const __m128i*)(pixels + p));
+		_mm_storeu_si128((__m128i*)(pixels + p), _mm_or_si128(_mm_shuffle_epi8(px, shuffle4), full4));
+	}
+	#endif
+
+	for (; p < numPixels; p++)
+	{
+		tPixel4b src = pixels[p];
+		for (int c = 0; c < 4; c++)
+			pixels[p].E[c] = (sources[c] >= 0) ? src.E[sources[c]] : ((sources[c] == SwizzleFull) ? 0xFF : 0x00);
+	}
+}
+
+
+void tPic::IntensitySpan(tPixel4b* pixels, int numPixels, uint32 mask)
+{
+	int p = 0;
+
+	#ifdef PICTURE_SSE2
+	// The sum of RGB is at most 765 so it fits in the low 16 bits of each pixel lane, and the high 16 bits are zero.
+	// (sum * 0xAAAB) >> 17 is exactly sum/3 for all 16-bit sums.
+	__m128i byteMask4 = _mm_set1_epi32(0xFF);
+	__m128i keepMask4 = _mm_set1_epi32(int(~mask));
+	__m128i setMask4 = _mm_set1_epi32(int(mask));
+	__m128i oneThird = _mm_set1_epi32(0xAAAB);
+	for (; p+4 <= numPixels; p += 4)
+	{
+		__m128i px = _mm_loadu_si128((const __m128i*)(pixels + p));
+		__m128i sum = _mm_add_epi32
+		(
+			_mm_add_epi32(_mm_and_si128(px, byteMask4), _mm_and_si128(_mm_srli_epi32(px, 8), byteMask4)),
+			_mm_and_si128(_mm_srli_epi32(px, 16), byteMask4)
+		);
+		__m128i intensity = _mm_srli_epi32(_mm_mulhi_epu16(sum, oneThird), 1);
+		intensity = _mm_or_si128(intensity, _mm_slli_epi32(intensity, 8));
+		intensity = _mm_or_si128(intensity, _mm_slli_epi32(intensity, 16));
+		_mm_storeu_si128((__m128i*)(pixels + p), _mm_or_si128(_mm_and_si128(px, keepMask4), _mm_and_si128(intensity, setMask4)));
+	}
+	#endif
+
+	for (; p < numPixels; p++)
+	{
+		uint32 intensity = uint32(pixels[p].Intensity());
+		intensity *= 0x01010101;
+		pixels[p].BP = (pixels[p].BP & ~mask) | (intensity & mask);
+	}
+}
+
+
+void tPic::AlphaBlendSpan(tPixel4b* pixels, int numPixels, const tColour4b& blend, uint32 mask, int finalAlpha)
+{
+	// Only RGB are blended. The float maths matches tColour4f exactly so results are identical to converting every
+	// pixel to a tColour4f and back. Unblended channels and alpha survive that round trip unchanged, so they are
+	// simply kept.
+	mask &= tPixel4b(0xFF, 0xFF, 0xFF, 0x00).BP;
+	uint32 alphaMask = tPixel4b(0x00, 0x00, 0x00, 0xFF).BP;
+	uint32 alphaBits = tPixel4b(0x00, 0x00, 0x00, uint8(tMath::tMax(finalAlpha, 0))).BP;
+	int p = 0;
+
+	#ifdef PICTURE_SSE2
+	__m128 blend4 = _mm_div_ps(_mm_set_ps(float(blend.A), float(blend.B), float(blend.G), float(blend.R)), _mm_set1_ps(255.0f));
+	__m128 scale255 = _mm_set1_ps(255.0f);
+	__m128 scale256 = _mm_set1_ps(256.0f);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128i zero = _mm_setzero_si128();
+	__m128i keepMask4 = _mm_set1_epi32(int(~mask));
+	__m128i setMask4 = _mm_set1_epi32(int(mask));
+	__m128i alphaMask4 = _mm_set1_epi32(int(alphaMask));
+	__m128i alphaBits4 = _mm_set1_epi32(int(alphaBits));
+	for (; p+4 <= numPixels; p += 4)
+	{
+		__m128i px = _mm_loadu_si128((const __m128i*)(pixels + p));
+		__m128i lo = _mm_unpacklo_epi8(px, zero);
+		__m128i hi = _mm_unpackhi_epi8(px, zero);
+		__m128i lanes[4] =
+		{
+			_mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+			_mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+		};
+
+		// Each lane is one pixel as RGBA floats.
+		for (int l = 0; l < 4; l++)
+		{
+			__m128 colour = _mm_div_ps(_mm_cvtepi32_ps(lanes[l]), scale255);
+			__m128 alpha = _mm_shuffle_ps(colour, colour, _MM_SHUFFLE(3, 3, 3, 3));
+			__m128 blended = _mm_add_ps(_mm_mul_ps(colour, alpha), _mm_mul_ps(blend4, _mm_sub_ps(one, alpha)));
+			lanes[l] = _mm_cvttps_epi32(_mm_mul_ps(blended, scale256));
+		}
+
+		// Saturating packs clamp to [0, 255] like tColour4b does.
+		__m128i result = _mm_packus_epi16(_mm_packs_epi32(lanes[0], lanes[1]), _mm_packs_epi32(lanes[2], lanes[3]));
+		result = _mm_or_si128(_mm_and_si128(px, keepMask4), _mm_and_si128(result, setMask4));
+		if (finalAlpha >= 0)
+			result = _mm_or_si128(_mm_andnot_si128(alphaMask4, result), alphaBits4);
+		_mm_storeu_si128((__m128i*)(pixels + p), result);
+	}
+	#endif
+
+	tColour4f blendCol(blend);
+	for (; p < numPixels; p++)
+	{
+		tColour4f pixelCol(pixels[p]);
+		float alpha = pixelCol.A;
+		float oneMinusAlpha = 1.0f - alpha;
+		tColour4b blended
+		(
+			pixelCol.R*alpha + blendCol.R*oneMinusAlpha,
+			pixelCol.G*alpha + blendCol.G*oneMinusAlpha,
+			pixelCol.B*alpha + blendCol.B*oneMinusAlpha,
+			0.0f
+		);
+		uint32 result = (pixels[p].BP & ~mask) | (blended.BP & mask);
+		if (finalAlpha >= 0)
+			result = (result & ~alphaMask) | alphaBits;
+		pixels[p].BP = result;
+	}
+}
+
+
 void tPicture::Save(tChunkWriter& chunk) const
 {
 	chunk.Begin(tChunkID::Image_Picture);
@@ -131,6 +477,72 @@ void tPicture::Load(const tChunk& chunk)
 }
 
 
+void tPicture::SetAll(const tColour4b& clearColour, comp_t channels)
+{
+	if (!Pixels)
+		return;
+
+	uint32 mask = tPic::GetChannelMask(channels);
+	tPic::ParallelSpans(Pixels, Width, Height, [&](tPixel4b* pixels, int numPixels) { tPic::SetSpan(pixels, numPixels, clearColour, mask); });
+}
+
+
+void tPicture::Spread(tComp channel)
+{
+	if (!Pixels)
+		return;
+
+	int sources[4] = { 0, 1, 2, 3 };
+	switch (channel)
+	{
+		case tComp::R:	sources[1] = sources[2] = 0;				break;
+		case tComp::G:	sources[0] = sources[2] = 1;				break;
+		case tComp::B:	sources[0] = sources[1] = 2;				break;
+		case tComp::A:	sources[0] = sources[1] = sources[2] = 3;	break;
+		default:		return;
+	}
+	tPic::ParallelSpans(Pixels, Width, Height, [&](tPixel4b* pixels, int numPixels) { tPic::SwizzleSpan(pixels, numPixels, sources); });
+}
+
+
+void tPicture::Swizzle(tComp R, tComp G, tComp B, tComp A)
+{
+	if (!Pixels)
+		return;
+
+	int sources[4] =
+	{
+		tPic::GetSwizzleSource(R, 0), tPic::GetSwizzleSource(G, 1),
+		tPic::GetSwizzleSource(B, 2), tPic::GetSwizzleSource(A, 3)
+	};
+	if ((sources[0] == 0) && (sources[1] == 1) && (sources[2] == 2) && (sources[3] == 3))
+		return;
+
+	tPic::ParallelSpans(Pixels, Width, Height, [&](tPixel4b* pixels, int numPixels) { tPic::SwizzleSpan(pixels, numPixels, sources); });
+}
+
+
+void tPicture::Intensity(comp_t channels)
+{
+	if (!channels || !Pixels)
+		return;
+
+	uint32 mask = tPic::GetChannelMask(channels);
+	tPic::ParallelSpans(Pixels, Width, Height, [&](tPixel4b* pixels, int numPixels) { tPic::IntensitySpan(pixels, numPixels, mask); });
+}
+
+
+void tPicture::AlphaBlendColour(const tColour4b& blend, comp_t channels, int finalAlpha)
+{
+	if (!Pixels)
+		return;
+
+	tMath::tiClamp(finalAlpha, -1, 255);
+	uint32 mask = tPic::GetChannelMask(channels);
+	tPic::ParallelSpans(Pixels, Width, Height, [&](tPixel4b* pixels, int numPixels) { tPic::AlphaBlendSpan(pixels, numPixels, blend, mask, finalAlpha); });
+}
+
+
 void tPicture::Rotate90(bool antiClockwise)
 {
 	tAssert((Width > 0) && (Height > 0) && Pixels);
@@ -138,11 +550,18 @@ void tPicture::Rotate90(bool antiClockwise)
 	int newH = Width;
 	tPixel4b* newPixels = new tPixel4b[newW * newH];
 
-	for (int y = 0; y < Height; y++)
-		for (int x = 0; x < Width; x++)
-			newPixels[ GetIndex(y, x, newW, newH) ] = Pixels[ GetIndex(antiClockwise ? x : Width-1-x, antiClockwise ? Height-1-y : y) ];
+	// Each thread gets whole rows of tiles so no two threads write the same destination pixels.
+	int numTileRows = (Height + tPic::TileSize - 1) / tPic::TileSize;
+	auto rotateTileRows = [&](int begin, int end)
+	{
+		tPic::Rotate90Rows(newPixels, Pixels, Width, Height, begin*tPic::TileSize, tMin(end*tPic::TileSize, Height), antiClockwise);
+	};
+	tParallelFor(numTileRows, rotateTileRows, (GetNumPixels() >= tPic::MinParallelPixels) ? 0 : 1);
 
-	Clear();
+	// Any adjustment session is over since the original pixels no longer match.
+	delete[] Pixels;
+	delete[] OriginalPixels;
+	OriginalPixels = nullptr;
 	Width = newW;
 	Height = newH;
 	Pixels = newPixels;
@@ -271,18 +690,31 @@ void tPicture::RotateCenterResampled
 void tPicture::Flip(bool horizontal)
 {
 	tAssert((Width > 0) && (Height > 0) && Pixels);
-	int newW = Width;
-	int newH = Height;
-	tPixel4b* newPixels = new tPixel4b[newW * newH];
 
-	for (int y = 0; y < Height; y++)
-		for (int x = 0; x < Width; x++)
-			newPixels[ GetIndex(x, y) ] = Pixels[ GetIndex(horizontal ? Width-1-x : x, horizontal ? y : Height-1-y) ];
+	// Flips are done in place. Horizontal reverses every row and vertical swaps rows from the top and bottom.
+	int numThreads = (GetNumPixels() >= tPic::MinParallelPixels) ? 0 : 1;
+	if (horizontal)
+	{
+		auto reverseRows = [&](int begin, int end)
+		{
+			for (int y = begin; y < end; y++)
+				tPic::ReverseRow(Pixels + y*Width, Width);
+		};
+		tParallelFor(Height, reverseRows, numThreads);
+	}
+	else
+	{
+		auto swapRows = [&](int begin, int end)
+		{
+			for (int y = begin; y < end; y++)
+				tPic::SwapRows(Pixels + y*Width, Pixels + (Height-1-y)*Width, Width);
+		};
+		tParallelFor(Height/2, swapRows, numThreads);
+	}
 
-	Clear();
-	Width = newW;
-	Height = newH;
-	Pixels = newPixels;
+	// Any adjustment session is over since the original pixels no longer match.
+	delete[] OriginalPixels;
+	OriginalPixels = nullptr;
 }
 
 
@@ -16,6 +16,8 @@
 #include <Foundation/tStandard.h>
 #include <Foundation/tSmallFloat.h>
 #include <System/tMachine.h>
+#include <System/tFile.h>
+#include <System/tThread.h>
 #include "Image/tPixelUtil.h"
 #include "PVRTDecompress/PVRTDecompress.h"
 #define BCDEC_IMPLEMENTATION
@@ -23,6 +25,14 @@
 #define ETCDEC_IMPLEMENTATION
 #include "etcdec/etcdec.h"
 #include "astcenc.h"
+#if defined(ARCHITECTURE_X64) || defined(ARCHITECTURE_X86)
+	#define PIXELUTIL_SSE2
+	#include <emmintrin.h>
+	#if defined(__SSSE3__) || defined(_MSC_VER)
+		#define PIXELUTIL_SSSE3
+		#include <tmmintrin.h>
+	#endif
+#endif
 
 
 namespace tImage
@@ -1145,7 +1155,7 @@ tImage::DecodeResult tImage::DecodePixelData_ASTC(tPixelFormat fmt, const uint8*
 }
 
 
-tImage::DecodeResult tImage::DecodePixelData_PVR(tPixelFormat fmt, const uint8* src, int srcSize, int w, int h, tColour4b*& decoded4b, tColour4f*& decoded4f)
+tImage::DecodeResult tImage::DecodePixelData_PVR(tPixelFormat fmt, const uint8* src, int srcSize, int w, int h, tColour4b*& decoded4b, tColour4f*& decoded4f, int numThreads)
 {
 	if (decoded4b || decoded4f)
 		return DecodeResult::BuffersNotClear;
@@ -1161,23 +1171,31 @@ tImage::DecodeResult tImage::DecodePixelData_PVR(tPixelFormat fmt, const uint8*
 	switch (fmt)
 	{
 		case tPixelFormat::PVRBPP4:
+		case tPixelFormat::PVRBPP2:
 		{
 			decoded4b = new tColour4b[w*h];
-			uint32_t do2bitMode = 0;
-			uint32_t numSrcBytesDecompressed = pvr::PVRTDecompressPVRTC(src, do2bitMode, w, h, (uint8_t*)decoded4b);
-			if (numSrcBytesDecompressed == 0)
+			uint32_t do2bitMode = (fmt == tPixelFormat::PVRBPP2) ? 1 : 0;
+
+			// Images at or above the minimum PVRTC size are decoded in bands of word rows (4 pixel rows each). The
+			// bands write disjoint pixels straight into decoded4b, so no per-thread buffers or stitching are needed.
+			// Below the minimum size the single call pads internally.
+			int minW = do2bitMode ? 16 : 8;
+			int numWordRows = h / 4;
+			int numBandThreads = tSystem::tGetNumWorkerThreads(numWordRows / PVRMinWordRowsPerThread, numThreads);
+			if ((w >= minW) && (h >= 8) && (numBandThreads > 1))
 			{
-				delete[] decoded4b;
-				decoded4b = nullptr;
-				return DecodeResult::PVRDecodeError;
+				tSystem::tParallelFor
+				(
+					numWordRows,
+					[&](int begin, int end)
+					{
+						pvr::PVRTDecompressPVRTCBand(src, do2bitMode, w, h, (uint8_t*)decoded4b, begin, end-begin);
+					},
+					numBandThreads
+				);
+				break;
 			}
-			break;
-		}
 
-		case tPixelFormat::PVRBPP2:
-		{
-			decoded4b = new tColour4b[w*h];
-			uint32_t do2bitMode = 1;
 			uint32_t numSrcBytesDecompressed = pvr::PVRTDecompressPVRTC(src, do2bitMode, w, h, (uint8_t*)decoded4b);
 			if (numSrcBytesDecompressed == 0)
 			{
@@ -1452,3 +1470,725 @@ uint8* tImage::CreateReversedRowData_BC(const uint8* pixelData, tPixelFormat pix
 
 	return reversedPixelData;
 }
+
+
+void tImage::ConvertBGRAToRGBA(uint8* dst, const uint8* src, int numPixels)
+{
+	int p = 0;
+
+	#ifdef PIXELUTIL_SSE2
+	// Swapping bytes 0 and 2 of every 32-bit lane only needs masks and shifts, so plain SSE2 is enough.
+	const __m128i maskGA = _mm_set1_epi32(0xFF00FF00);
+	const __m128i maskRB = _mm_set1_epi32(0x00FF00FF);
+	for (; p + 4 <= numPixels; p += 4)
+	{
+		__m128i v	= _mm_loadu_si128((const __m128i*)(src + p*4));
+		__m128i ga	= _mm_and_si128(v, maskGA);
+		__m128i rb	= _mm_and_si128(v, maskRB);
+		rb			= _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+		_mm_storeu_si128((__m128i*)(dst + p*4), _mm_or_si128(ga, rb));
+	}
+	#endif
+
+	for (; p < numPixels; p++)
+	{
+		const uint8* s = src + p*4;
+		uint8* d = dst + p*4;
+		d[0] = s[2];
+		d[1] = s[1];
+		d[2] = s[0];
+		d[3] = s[3];
+	}
+}
+
+
+void tImage::ConvertBGRToRGBA(uint8* dst, const uint8* src, int numPixels)
+{
+	int p = 0;
+
+	#ifdef PIXELUTIL_SSSE3
+	// Each iteration reads 16 bytes but only consumes 12 (4 pixels). We stop early enough that the over-read never
+	// goes past the end of the source.
+	const __m128i shuffle	= _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+	const __m128i alpha		= _mm_set1_epi32(0xFF000000);
+	for (; p + 6 <= numPixels; p += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + p*3));
+		v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha);
+		_mm_storeu_si128((__m128i*)(dst + p*4), v);
+	}
+	#endif
+
+	for (; p < numPixels; p++)
+	{
+		const uint8* s = src + p*3;
+		uint8* d = dst + p*4;
+		d[0] = s[2];
+		d[1] = s[1];
+		d[2] = s[0];
+		d[3] = 0xFF;
+	}
+}
+
+
+void tImage::ConvertRGBAToBGR(uint8* dst, const uint8* src, int numPixels)
+{
+	int p = 0;
+
+	#ifdef PIXELUTIL_SSSE3
+	// Each iteration stores 16 bytes but only 12 are valid. The next iteration overwrites the extra 4 and we stop early
+	// enough that the over-write never goes past the end of the destination.
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	for (; p + 6 <= numPixels; p += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + p*4));
+		_mm_storeu_si128((__m128i*)(dst + p*3), _mm_shuffle_epi8(v, shuffle));
+	}
+	#endif
+
+	for (; p < numPixels; p++)
+	{
+		const uint8* s = src + p*4;
+		uint8* d = dst + p*3;
+		d[0] = s[2];
+		d[1] = s[1];
+		d[2] = s[0];
+	}
+}
+
+
+void tImage::ConvertRGBEToFloat(tColour4f* dst, const tColour4b* src, int numPixels)
+{
+	// The scale 2^(e-136) is built directly as float bits and applied as two power-of-two factors, A = 2^(max(e-9,1)-127)
+	// and B = 2^(min(e-10,0)). For e >= 10 B is 1 and A is the whole scale. For small e the scale is below the smallest
+	// normalized float, so the mantissa is scaled down by B first and A takes it the rest of the way. The result is
+	// always representable so neither multiply rounds and the output matches Radiance exactly, including denormals.
+	// An exponent of 0 zeros A.
+	int p = 0;
+
+	#ifdef PIXELUTIL_SSE2
+	const __m128i zero		= _mm_setzero_si128();
+	const __m128i one		= _mm_set1_epi32(1);
+	const __m128i nine		= _mm_set1_epi32(9);
+	const __m128i ten		= _mm_set1_epi32(10);
+	const __m128i bias		= _mm_set1_epi32(127);
+	const __m128 half		= _mm_set1_ps(0.5f);
+	const __m128 alphaOne	= _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+	const __m128 rgbMask	= _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+	for (; p + 4 <= numPixels; p += 4)
+	{
+		__m128i v	= _mm_loadu_si128((const __m128i*)(src + p));
+		__m128i lo	= _mm_unpacklo_epi8(v, zero);
+		__m128i hi	= _mm_unpackhi_epi8(v, zero);
+		__m128i px[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero), _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+		for (int i = 0; i < 4; i++)
+		{
+			// Broadcast the exponent to all lanes. SSE2 has no 32-bit integer min or max, but the values are in
+			// [-10, 246] so the 16-bit versions give the same 32-bit result in both halves of each lane.
+			__m128i e		= _mm_shuffle_epi32(px[i], _MM_SHUFFLE(3, 3, 3, 3));
+			__m128i ea		= _mm_max_epi16(_mm_sub_epi32(e, nine), one);
+			__m128i eb		= _mm_add_epi32(_mm_min_epi16(_mm_sub_epi32(e, ten), zero), bias);
+			__m128 scaleA	= _mm_castsi128_ps(_mm_andnot_si128(_mm_cmpeq_epi32(e, zero), _mm_slli_epi32(ea, 23)));
+			__m128 scaleB	= _mm_castsi128_ps(_mm_slli_epi32(eb, 23));
+			__m128 mant		= _mm_add_ps(_mm_cvtepi32_ps(px[i]), half);
+			__m128 rgb		= _mm_and_ps(_mm_mul_ps(_mm_mul_ps(mant, scaleB), scaleA), rgbMask);
+			_mm_storeu_ps(&dst[p+i].R, _mm_or_ps(rgb, alphaOne));
+		}
+	}
+	#endif
+
+	for (; p < numPixels; p++)
+	{
+		int e = int(src[p].A);
+		uint32 scaleBitsA = (e > 0) ? (uint32(tMath::tMax(e - 9, 1)) << 23) : 0;
+		uint32 scaleBitsB = uint32(tMath::tMin(e - 10, 0) + 127) << 23;
+		float scaleA, scaleB;
+		tStd::tMemcpy(&scaleA, &scaleBitsA, sizeof(float));
+		tStd::tMemcpy(&scaleB, &scaleBitsB, sizeof(float));
+		dst[p].R = ((float(src[p].R) + 0.5f) * scaleB) * scaleA;
+		dst[p].G = ((float(src[p].G) + 0.5f) * scaleB) * scaleA;
+		dst[p].B = ((float(src[p].B) + 0.5f) * scaleB) * scaleA;
+		dst[p].A = 1.0f;
+	}
+}
+
+
+namespace tImage
+{
+	namespace tPackedIndex
+	{
+		#ifdef PIXELUTIL_SSE2
+		// Each of these pulls 16 packed indices into the 16 byte lanes of a register. Only the bytes that hold the 16
+		// indices are read.
+		__m128i Extract16_1Bit(const uint8* src);
+		__m128i Extract16_2Bit(const uint8* src);
+		__m128i Extract16_4Bit(const uint8* src);
+		#endif
+
+		// Expands in batches, unpacking into a small local buffer first when the indices are not already bytes.
+		template<typename PixelType> void ExpandTable(PixelType* dst, const uint8* src, int numIndices, int bitsPerIndex, const PixelType* palette);
+	}
+}
+
+
+#ifdef PIXELUTIL_SSE2
+__m128i tImage::tPackedIndex::Extract16_1Bit(const uint8* src)
+{
+	// Broadcast byte 0 to lanes 0-7 and byte 1 to lanes 8-15, then test a different bit in each lane.
+	__m128i v		= _mm_cvtsi32_si128(int(src[0]) | (int(src[1]) << 8));
+	v				= _mm_unpacklo_epi8(v, v);
+	v				= _mm_unpacklo_epi16(v, v);
+	v				= _mm_unpacklo_epi32(v, v);
+	const __m128i bits = _mm_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	__m128i set		= _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+	return _mm_and_si128(set, _mm_set1_epi8(1));
+}
+
+
+__m128i tImage::tPackedIndex::Extract16_2Bit(const uint8* src)
+{
+	// Broadcast each byte to 4 lanes and test the high and low bit of each index separately.
+	uint32 word;
+	tStd::tMemcpy(&word, src, 4);
+	__m128i v		= _mm_cvtsi32_si128(int(word));
+	v				= _mm_unpacklo_epi8(v, v);
+	v				= _mm_unpacklo_epi16(v, v);
+	const __m128i hiBits = _mm_set1_epi32(0x02082080);
+	const __m128i loBits = _mm_set1_epi32(0x01041040);
+	__m128i hi		= _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(v, hiBits), hiBits), _mm_set1_epi8(2));
+	__m128i lo		= _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(v, loBits), loBits), _mm_set1_epi8(1));
+	return _mm_or_si128(hi, lo);
+}
+
+
+__m128i tImage::tPackedIndex::Extract16_4Bit(const uint8* src)
+{
+	// The high nibble comes first so it goes in the even lanes.
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+	__m128i v		= _mm_loadl_epi64((const __m128i*)src);
+	__m128i hi		= _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+	__m128i lo		= _mm_and_si128(v, nibble);
+	return _mm_unpacklo_epi8(hi, lo);
+}
+#endif
+
+
+template<typename PixelType> void tImage::tPackedIndex::ExpandTable(PixelType* dst, const uint8* src, int numIndices, int bitsPerIndex, const PixelType* palette)
+{
+	const int batchSize = 256;
+	uint8 batch[batchSize];
+	for (int i = 0; i < numIndices; i += batchSize)
+	{
+		int count = tMath::tMin(batchSize, numIndices - i);
+		const uint8* indices = src + i;
+		if (bitsPerIndex != 8)
+		{
+			// i is a multiple of 8 so the batch always starts on a byte boundary.
+			UnpackIndices(batch, src + (i*bitsPerIndex)/8, count, bitsPerIndex);
+			indices = batch;
+		}
+
+		PixelType* d = dst + i;
+		for (int k = 0; k < count; k++)
+			d[k] = palette[indices[k]];
+	}
+}
+
+
+bool tImage::ClipRegion(int& x, int& y, int& w, int& h, int width, int height)
+{
+	int x1 = tMath::tMin(x + w, width);
+	int y1 = tMath::tMin(y + h, height);
+	x = tMath::tMax(x, 0);
+	y = tMath::tMax(y, 0);
+	w = x1 - x;
+	h = y1 - y;
+	return (w > 0) && (h > 0);
+}
+
+
+void tImage::PackIndices(uint8* dst, const uint8* src, int numIndices, int bitsPerIndex)
+{
+	tAssert((bitsPerIndex >= 1) && (bitsPerIndex <= 8));
+	int i = 0;
+
+	// The common depths are done a whole output byte at a time. Anything left over goes through the general path.
+	switch (bitsPerIndex)
+	{
+		case 8:
+			tStd::tMemcpy(dst, src, numIndices);
+			return;
+
+		case 4:
+			for (; i + 2 <= numIndices; i += 2)
+				*dst++ = ((src[i] & 0x0F) << 4) | (src[i+1] & 0x0F);
+			break;
+
+		case 2:
+			for (; i + 4 <= numIndices; i += 4)
+				*dst++ = ((src[i] & 0x03) << 6) | ((src[i+1] & 0x03) << 4) | ((src[i+2] & 0x03) << 2) | (src[i+3] & 0x03);
+			break;
+
+		case 1:
+			for (; i + 8 <= numIndices; i += 8)
+			{
+				const uint8* s = src + i;
+				*dst++ =
+					((s[0] & 1) << 7) | ((s[1] & 1) << 6) | ((s[2] & 1) << 5) | ((s[3] & 1) << 4) |
+					((s[4] & 1) << 3) | ((s[5] & 1) << 2) | ((s[6] & 1) << 1) | (s[7] & 1);
+			}
+			break;
+	}
+
+	// Bits are accumulated and written out a byte at a time. At most 15 bits are ever pending.
+	uint32 mask = (1 << bitsPerIndex) - 1;
+	uint32 accum = 0;
+	int numBits = 0;
+	for (; i < numIndices; i++)
+	{
+		accum = (accum << bitsPerIndex) | (src[i] & mask);
+		numBits += bitsPerIndex;
+		if (numBits >= 8)
+		{
+			numBits -= 8;
+			*dst++ = uint8(accum >> numBits);
+		}
+	}
+	if (numBits > 0)
+		*dst = uint8(accum << (8 - numBits));
+}
+
+
+void tImage::UnpackIndices(uint8* dst, const uint8* src, int numIndices, int bitsPerIndex)
+{
+	tAssert((bitsPerIndex >= 1) && (bitsPerIndex <= 8));
+	int i = 0;
+
+	switch (bitsPerIndex)
+	{
+		case 8:
+			tStd::tMemcpy(dst, src, numIndices);
+			return;
+
+		case 4:
+			#ifdef PIXELUTIL_SSE2
+			for (; i + 16 <= numIndices; i += 16)
+				_mm_storeu_si128((__m128i*)(dst + i), tPackedIndex::Extract16_4Bit(src + i/2));
+			#endif
+			for (; i + 2 <= numIndices; i += 2)
+			{
+				uint8 byte = src[i/2];
+				dst[i]		= byte >> 4;
+				dst[i+1]	= byte & 0x0F;
+			}
+			break;
+
+		case 2:
+			#ifdef PIXELUTIL_SSE2
+			for (; i + 16 <= numIndices; i += 16)
+				_mm_storeu_si128((__m128i*)(dst + i), tPackedIndex::Extract16_2Bit(src + i/4));
+			#endif
+			for (; i + 4 <= numIndices; i += 4)
+			{
+				uint8 byte = src[i/4];
+				dst[i]		= byte >> 6;
+				dst[i+1]	= (byte >> 4) & 0x03;
+				dst[i+2]	= (byte >> 2) & 0x03;
+				dst[i+3]	= byte & 0x03;
+			}
+			break;
+
+		case 1:
+			#ifdef PIXELUTIL_SSE2
+			for (; i + 16 <= numIndices; i += 16)
+				_mm_storeu_si128((__m128i*)(dst + i), tPackedIndex::Extract16_1Bit(src + i/8));
+			#endif
+			for (; i + 8 <= numIndices; i += 8)
+			{
+				uint8 byte = src[i/8];
+				for (int b = 0; b < 8; b++)
+					dst[i+b] = (byte >> (7-b)) & 0x01;
+			}
+			break;
+	}
+
+	// The fast paths above always stop on a byte boundary. Only the bytes holding the remaining indices are read.
+	const uint8* s = src + (i*bitsPerIndex)/8;
+	uint32 mask = (1 << bitsPerIndex) - 1;
+	uint32 accum = 0;
+	int numBits = 0;
+	for (; i < numIndices; i++)
+	{
+		if (numBits < bitsPerIndex)
+		{
+			accum = (accum << 8) | *s++;
+			numBits += 8;
+		}
+		numBits -= bitsPerIndex;
+		dst[i] = uint8((accum >> numBits) & mask);
+	}
+}
+
+
+void tImage::ExpandIndices(tPixel4b* dst, const uint8* src, int numIndices, int bitsPerIndex, const tPixel4b* palette)
+{
+	tAssert((bitsPerIndex >= 1) && (bitsPerIndex <= 8) && palette);
+	int i = 0;
+
+	#ifdef PIXELUTIL_SSSE3
+	if (bitsPerIndex <= 4)
+	{
+		// With at most 16 colours each channel of the palette fits in one register. pshufb then looks up 16 pixels
+		// per channel at once and the channels are interleaved back into RGBA.
+		uint8 channels[4][16];
+		tStd::tMemset(channels, 0, sizeof(channels));
+		int numColours = 1 << bitsPerIndex;
+		for (int c = 0; c < numColours; c++)
+		{
+			channels[0][c] = palette[c].R;
+			channels[1][c] = palette[c].G;
+			channels[2][c] = palette[c].B;
+			channels[3][c] = palette[c].A;
+		}
+		const __m128i tableR = _mm_loadu_si128((const __m128i*)channels[0]);
+		const __m128i tableG = _mm_loadu_si128((const __m128i*)channels[1]);
+		const __m128i tableB = _mm_loadu_si128((const __m128i*)channels[2]);
+		const __m128i tableA = _mm_loadu_si128((const __m128i*)channels[3]);
+
+		// Every 16 indices is exactly 2*bitsPerIndex bytes so each group starts on a byte boundary.
+		for (; i + 16 <= numIndices; i += 16)
+		{
+			const uint8* s = src + (i*bitsPerIndex)/8;
+			__m128i indices;
+			switch (bitsPerIndex)
+			{
+				case 1:		indices = tPackedIndex::Extract16_1Bit(s);		break;
+				case 2:		indices = tPackedIndex::Extract16_2Bit(s);		break;
+				case 4:		indices = tPackedIndex::Extract16_4Bit(s);		break;
+				default:
+				{
+					uint8 unpacked[16];
+					UnpackIndices(unpacked, s, 16, bitsPerIndex);
+					indices = _mm_loadu_si128((const __m128i*)unpacked);
+					break;
+				}
+			}
+
+			__m128i r	= _mm_shuffle_epi8(tableR, indices);
+			__m128i g	= _mm_shuffle_epi8(tableG, indices);
+			__m128i b	= _mm_shuffle_epi8(tableB, indices);
+			__m128i a	= _mm_shuffle_epi8(tableA, indices);
+			__m128i rgLo = _mm_unpacklo_epi8(r, g);
+			__m128i rgHi = _mm_unpackhi_epi8(r, g);
+			__m128i baLo = _mm_unpacklo_epi8(b, a);
+			__m128i baHi = _mm_unpackhi_epi8(b, a);
+			__m128i* d	= (__m128i*)(dst + i);
+			_mm_storeu_si128(d + 0, _mm_unpacklo_epi16(rgLo, baLo));
+			_mm_storeu_si128(d + 1, _mm_unpackhi_epi16(rgLo, baLo));
+			_mm_storeu_si128(d + 2, _mm_unpacklo_epi16(rgHi, baHi));
+			_mm_storeu_si128(d + 3, _mm_unpackhi_epi16(rgHi, baHi));
+		}
+	}
+	#endif
+
+	tPackedIndex::ExpandTable(dst + i, src + (i*bitsPerIndex)/8, numIndices - i, bitsPerIndex, palette);
+}
+
+
+void tImage::ExpandIndices(tPixel3b* dst, const uint8* src, int numIndices, int bitsPerIndex, const tPixel3b* palette)
+{
+	tAssert((bitsPerIndex >= 1) && (bitsPerIndex <= 8) && palette);
+	tPackedIndex::ExpandTable(dst, src, numIndices, bitsPerIndex, palette);
+}
+
+
+namespace tImage
+{
+	namespace tBC6H
+	{
+		// Interpolation weights for 4-bit indices.
+		const int Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// These follow the unsigned decode path exactly. Endpoints are unquantized to 16 bits, interpolated, and then
+		// scaled by 31/64 to give the half-float bit pattern. The largest value is therefore 0x7BFF (65504.0).
+		int Unquantize(int q)																							{ return (q == 0) ? 0 : ((q == 1023) ? 0xFFFF : (((q << 16) + 0x8000) >> 10)); }
+		int Interpolate(int e0, int e1, int index)																		{ return (e0*(64 - Weights[index]) + e1*Weights[index] + 32) >> 6; }
+		int FinishUnquantize(int v)																						{ return (v*31) >> 6; }
+
+		// Returns the 10-bit endpoint that decodes closest to the half-float bit pattern h.
+		int Quantize(float h);
+
+		// Picks the best index for every pixel. Returns the total squared error in half-float bit space.
+		float SelectIndices(int indices[16], const float pixels[16][3], const int q0[3], const int q1[3]);
+		void PutBits(uint8* dst, int& bitPos, uint32 value, int numBits);
+	}
+}
+
+
+int tImage::tBC6H::Quantize(float h)
+{
+	int target = tMath::tClamp(int(h + 0.5f), 0, 0x7BFF);
+	int guess = tMath::tClamp(int(float(target) * (64.0f/31.0f) * (1023.0f/65535.0f) + 0.5f), 0, 1023);
+	int best = guess;
+	int bestErr = 0x7FFFFFFF;
+	for (int q = tMath::tMax(guess-1, 0); q <= tMath::tMin(guess+1, 1023); q++)
+	{
+		int err = tMath::tAbs(FinishUnquantize(Unquantize(q)) - target);
+		if (err < bestErr)
+		{
+			bestErr = err;
+			best = q;
+		}
+	}
+	return best;
+}
+
+
+float tImage::tBC6H::SelectIndices(int indices[16], const float pixels[16][3], const int q0[3], const int q1[3])
+{
+	float palette[16][3];
+	for (int c = 0; c < 3; c++)
+	{
+		int e0 = Unquantize(q0[c]);
+		int e1 = Unquantize(q1[c]);
+		for (int i = 0; i < 16; i++)
+			palette[i][c] = float(FinishUnquantize(Interpolate(e0, e1, i)));
+	}
+
+	float total = 0.0f;
+	for (int p = 0; p < 16; p++)
+	{
+		float bestErr = 1.0e30f;
+		for (int i = 0; i < 16; i++)
+		{
+			float dr = palette[i][0] - pixels[p][0];
+			float dg = palette[i][1] - pixels[p][1];
+			float db = palette[i][2] - pixels[p][2];
+			float err = dr*dr + dg*dg + db*db;
+			if (err < bestErr)
+			{
+				bestErr = err;
+				indices[p] = i;
+			}
+		}
+		total += bestErr;
+	}
+	return total;
+}
+
+
+void tImage::tBC6H::PutBits(uint8* dst, int& bitPos, uint32 value, int numBits)
+{
+	for (int b = 0; b < numBits; b++, bitPos++)
+		if (value & (1 << b))
+			dst[bitPos >> 3] |= uint8(1 << (bitPos & 7));
+}
+
+
+void tImage::EncodeBlock_BC6U(uint8* dst, const tColour4f* src, int effort)
+{
+	// We work with the bit patterns of the half-floats, as the hardware does. The space is close to logarithmic so
+	// squared error in it is a reasonable perceptual measure for HDR data.
+	float pixels[16][3];
+	float lo[3] = { 65535.0f, 65535.0f, 65535.0f };
+	float hi[3] = { 0.0f, 0.0f, 0.0f };
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int p = 0; p < 16; p++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			float v = src[p].E[c];
+			v = (v > 0.0f) ? tMath::tMin(v, 65504.0f) : 0.0f;
+			float h = float(FloatToHalfRaw(v));
+			pixels[p][c] = h;
+			lo[c] = tMath::tMin(lo[c], h);
+			hi[c] = tMath::tMax(hi[c], h);
+			mean[c] += h / 16.0f;
+		}
+	}
+
+	float end0[3] = { lo[0], lo[1], lo[2] };
+	float end1[3] = { hi[0], hi[1], hi[2] };
+	if (effort >= 1)
+	{
+		// The principal axis is found by power iteration on the covariance matrix, starting from the bounding box
+		// diagonal. The endpoints are the extreme projections onto it.
+		float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int p = 0; p < 16; p++)
+		{
+			float r = pixels[p][0] - mean[0];
+			float g = pixels[p][1] - mean[1];
+			float b = pixels[p][2] - mean[2];
+			cov[0] += r*r; cov[1] += r*g; cov[2] += r*b;
+			cov[3] += g*g; cov[4] += g*b; cov[5] += b*b;
+		}
+
+		float axis[3] = { hi[0]-lo[0], hi[1]-lo[1], hi[2]-lo[2] };
+		for (int iter = 0; iter < 8; iter++)
+		{
+			float x = cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2];
+			float y = cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2];
+			float z = cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2];
+			float len = tMath::tMax(tMath::tAbs(x), tMath::tMax(tMath::tAbs(y), tMath::tAbs(z)));
+			if (len <= 0.0f)
+				break;
+			axis[0] = x/len; axis[1] = y/len; axis[2] = z/len;
+		}
+
+		float lenSq = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+		if (lenSq > 0.0f)
+		{
+			float minT = 1.0e30f; float maxT = -1.0e30f;
+			for (int p = 0; p < 16; p++)
+			{
+				float t = ((pixels[p][0]-mean[0])*axis[0] + (pixels[p][1]-mean[1])*axis[1] + (pixels[p][2]-mean[2])*axis[2]) / lenSq;
+				minT = tMath::tMin(minT, t);
+				maxT = tMath::tMax(maxT, t);
+			}
+			for (int c = 0; c < 3; c++)
+			{
+				end0[c] = tMath::tClamp(mean[c] + axis[c]*minT, 0.0f, float(0x7BFF));
+				end1[c] = tMath::tClamp(mean[c] + axis[c]*maxT, 0.0f, float(0x7BFF));
+			}
+		}
+	}
+
+	int q0[3], q1[3];
+	for (int c = 0; c < 3; c++)
+	{
+		q0[c] = tBC6H::Quantize(end0[c]);
+		q1[c] = tBC6H::Quantize(end1[c]);
+	}
+	int indices[16];
+	float error = tBC6H::SelectIndices(indices, pixels, q0, q1);
+
+	// Least-squares refinement. With the indices fixed each channel is an independent 2x2 linear system for the two
+	// endpoints. We only keep the result if it actually lowers the error after quantization.
+	for (int iter = 0; (effort >= 2) && (iter < 2) && (error > 0.0f); iter++)
+	{
+		float a00 = 0.0f; float a01 = 0.0f; float a11 = 0.0f;
+		float b0[3] = { 0.0f, 0.0f, 0.0f };
+		float b1[3] = { 0.0f, 0.0f, 0.0f };
+		for (int p = 0; p < 16; p++)
+		{
+			float t = float(tBC6H::Weights[indices[p]]) / 64.0f;
+			float s = 1.0f - t;
+			a00 += s*s; a01 += s*t; a11 += t*t;
+			for (int c = 0; c < 3; c++)
+			{
+				b0[c] += s*pixels[p][c];
+				b1[c] += t*pixels[p][c];
+			}
+		}
+
+		float det = a00*a11 - a01*a01;
+		if (tMath::tAbs(det) < 1.0e-6f)
+			break;
+
+		int r0[3], r1[3];
+		for (int c = 0; c < 3; c++)
+		{
+			r0[c] = tBC6H::Quantize(tMath::tClamp((b0[c]*a11 - b1[c]*a01) / det, 0.0f, float(0x7BFF)));
+			r1[c] = tBC6H::Quantize(tMath::tClamp((b1[c]*a00 - b0[c]*a01) / det, 0.0f, float(0x7BFF)));
+		}
+		int refined[16];
+		float refinedError = tBC6H::SelectIndices(refined, pixels, r0, r1);
+		if (refinedError >= error)
+			break;
+
+		error = refinedError;
+		for (int c = 0; c < 3; c++) { q0[c] = r0[c]; q1[c] = r1[c]; }
+		for (int p = 0; p < 16; p++) indices[p] = refined[p];
+	}
+
+	// The first index is stored with 3 bits so its top bit must be 0. The weights are symmetric, so swapping the
+	// endpoints and inverting the indices gives the same colours.
+	if (indices[0] & 8)
+	{
+		for (int c = 0; c < 3; c++)
+			tStd::tSwap(q0[c], q1[c]);
+		for (int p = 0; p < 16; p++)
+			indices[p] = 15 - indices[p];
+	}
+
+	tStd::tMemset(dst, 0, 16);
+	int bitPos = 0;
+	tBC6H::PutBits(dst, bitPos, 0x03, 5);				// Mode 11. One region, 10.10 endpoints, 4-bit indices.
+	for (int c = 0; c < 3; c++)
+		tBC6H::PutBits(dst, bitPos, q0[c], 10);
+	for (int c = 0; c < 3; c++)
+		tBC6H::PutBits(dst, bitPos, q1[c], 10);
+	tBC6H::PutBits(dst, bitPos, indices[0], 3);
+	for (int p = 1; p < 16; p++)
+		tBC6H::PutBits(dst, bitPos, indices[p], 4);
+	tAssert(bitPos == 128);
+}
+
+
+tImage::tBlockWriter::tBlockWriter(tFileHandle file, int blockSize) :
+	File(file)
+{
+	tAssert(file && (blockSize > 0));
+	Capacity = blockSize;
+	Buffer = new uint8[Capacity];
+}
+
+
+tImage::tBlockWriter::tBlockWriter(int initialCapacity)
+{
+	Capacity = tMath::tMax(initialCapacity, 256);
+	Buffer = new uint8[Capacity];
+}
+
+
+uint8* tImage::tBlockWriter::Reserve(int numBytes)
+{
+	tAssert(numBytes >= 0);
+	if (Used + numBytes <= Capacity)
+		return Buffer + Used;
+
+	// In file mode we first try to make room by writing out what we have.
+	if (File)
+	{
+		Flush();
+		if (numBytes <= Capacity)
+			return Buffer;
+	}
+
+	// Either in memory mode or the request is bigger than a block. Grow geometrically so appending stays linear.
+	int newCapacity = tMath::tMax(Capacity*2, Used + numBytes);
+	uint8* newBuffer = new uint8[newCapacity];
+	if (Used)
+		tStd::tMemcpy(newBuffer, Buffer, Used);
+	delete[] Buffer;
+	Buffer = newBuffer;
+	Capacity = newCapacity;
+	return Buffer + Used;
+}
+
+
+bool tImage::tBlockWriter::Flush()
+{
+	if (File && Used)
+	{
+		if (tSystem::tWriteFile(File, Buffer, Used) != Used)
+			Error = true;
+		Used = 0;
+	}
+	return !Error;
+}
+
+
+uint8* tImage::tBlockWriter::StealBuffer(int& numBytes)
+{
+	numBytes = 0;
+	if (File || !Used)
+		return nullptr;
+
+	uint8* buffer = Buffer;
+	numBytes = Used;
+	Buffer = nullptr;
+	Capacity = 0;
+	Used = 0;
+	return buffer;
+}
@@ -32,11 +32,20 @@ namespace tImage
 		union { float RatioV; float CubicCoeffC; };
 	};
 
-	tPixel4b KernelFilterNearest			(const tPixel4b* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
-	tPixel4b KernelFilterBox				(const tPixel4b* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
-	tPixel4b KernelFilterBilinear			(const tPixel4b* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
-	tPixel4b KernelFilterBicubic			(const tPixel4b* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
-	tPixel4b KernelFilterLanczos			(const tPixel4b* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
+	// The kernels and the resampler are templated on the pixel type so 8-bit, 16-bit, and float images go through the
+	// same code. Accumulation is always in float. ToPixel rounds and clamps to the range of the integer types and leaves
+	// float pixels unclamped so HDR values survive.
+	template<typename T> bool ResampleT(T* src, int srcW, int srcH, T* dst, int dstW, int dstH, tResampleFilter, tResampleEdgeMode);
+	template<typename T> T KernelFilterNearest	(const T* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
+	template<typename T> T KernelFilterBox		(const T* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
+	template<typename T> T KernelFilterBilinear	(const T* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
+	template<typename T> T KernelFilterBicubic	(const T* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
+	template<typename T> T KernelFilterLanczos	(const T* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
+
+	template<typename T> tVector4 ToVector(const T& p)																	{ return tVector4(float(p.R), float(p.G), float(p.B), float(p.A)); }
+	tPixel4b ToPixel(const tVector4&, const tPixel4b*);
+	tPixel4s ToPixel(const tVector4&, const tPixel4s*);
+	tPixel4f ToPixel(const tVector4&, const tPixel4f*);
 
 	int GetSrcIndex(int idx, int count, tResampleEdgeMode);
 	float ComputeCubicWeight(float x, float b, float c);
@@ -110,6 +119,36 @@ inline int tImage::GetSrcIndex(int idx, int count, tResampleEdgeMode edgeMode)
 }
 
 
+inline tPixel4b tImage::ToPixel(const tVector4& v, const tPixel4b*)
+{
+	return tPixel4b
+	(
+		tClamp(int(tRound(v.x)), 0, 255),
+		tClamp(int(tRound(v.y)), 0, 255),
+		tClamp(int(tRound(v.z)), 0, 255),
+		tClamp(int(tRound(v.w)), 0, 255)
+	);
+}
+
+
+inline tPixel4s tImage::ToPixel(const tVector4& v, const tPixel4s*)
+{
+	return tPixel4s
+	(
+		tClamp(int(tRound(v.x)), 0, 65535),
+		tClamp(int(tRound(v.y)), 0, 65535),
+		tClamp(int(tRound(v.z)), 0, 65535),
+		tClamp(int(tRound(v.w)), 0, 65535)
+	);
+}
+
+
+inline tPixel4f tImage::ToPixel(const tVector4& v, const tPixel4f*)
+{
+	return tPixel4f(v.x, v.y, v.z, v.w);
+}
+
+
 bool tImage::Resample
 (
 	tPixel4b* src, int srcW, int srcH,
@@ -117,6 +156,42 @@ bool tImage::Resample
 	tResampleFilter resampleFilter,
 	tResampleEdgeMode edgeMode
 )
+{
+	return ResampleT(src, srcW, srcH, dst, dstW, dstH, resampleFilter, edgeMode);
+}
+
+
+bool tImage::Resample
+(
+	tPixel4s* src, int srcW, int srcH,
+	tPixel4s* dst, int dstW, int dstH,
+	tResampleFilter resampleFilter,
+	tResampleEdgeMode edgeMode
+)
+{
+	return ResampleT(src, srcW, srcH, dst, dstW, dstH, resampleFilter, edgeMode);
+}
+
+
+bool tImage::Resample
+(
+	tPixel4f* src, int srcW, int srcH,
+	tPixel4f* dst, int dstW, int dstH,
+	tResampleFilter resampleFilter,
+	tResampleEdgeMode edgeMode
+)
+{
+	return ResampleT(src, srcW, srcH, dst, dstW, dstH, resampleFilter, edgeMode);
+}
+
+
+template<typename T> bool tImage::ResampleT
+(
+	T* src, int srcW, int srcH,
+	T* dst, int dstW, int dstH,
+	tResampleFilter resampleFilter,
+	tResampleEdgeMode edgeMode
+)
 {
 	if (!src || !dst || srcW<=0 || srcH<=0 || dstW<=0 || dstH<=0)
 		return false;
@@ -134,67 +209,67 @@ bool tImage::Resample
 
 	// Decide what filer kernel to use. Different kernels may set different values in FilterParams.
 	FilterParams params;
-	typedef tPixel4b (*KernelFilterFn)(const tPixel4b* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
+	typedef T (*KernelFilterFn)(const T* src, int srcW, int srcH, float x, float y, FilterDirection, tResampleEdgeMode, const FilterParams&);
 	KernelFilterFn kernel;
 	switch (resampleFilter)
 	{
 		case tResampleFilter::Nearest:
-			kernel = KernelFilterNearest;
+			kernel = KernelFilterNearest<T>;
 			break;
 
 		case tResampleFilter::Box:
 			params.RatioH = ratioH;
 			params.RatioV = ratioV;
-			kernel = KernelFilterBox;
+			kernel = KernelFilterBox<T>;
 			break;
 
 		case tResampleFilter::Bilinear:
-			kernel = KernelFilterBilinear;
+			kernel = KernelFilterBilinear<T>;
 			break;
 
 		case tResampleFilter::Bicubic_Standard:		// Cardinal.				B=0		C=3/4
 			params.CubicCoeffB = 0.0f;
 			params.CubicCoeffC = 3.0f/4.0f;
-			kernel = KernelFilterBicubic;
+			kernel = KernelFilterBicubic<T>;
 			break;
 
 		case tResampleFilter::Bicubic_CatmullRom:	// Cardinal.				B=0		C=1/2
 			params.CubicCoeffB = 0.0f;
 			params.CubicCoeffC = 1.0f/2.0f;
-			kernel = KernelFilterBicubic;
+			kernel = KernelFilterBicubic<T>;
 			break;
 
 		case tResampleFilter::Bicubic_Mitchell:		// Balanced.				B=1/3	C=1/3
 			params.CubicCoeffB = 1.0f/3.0f;
 			params.CubicCoeffC = 1.0f/3.0f;
-			kernel = KernelFilterBicubic;
+			kernel = KernelFilterBicubic<T>;
 			break;
 
 		case tResampleFilter::Bicubic_Cardinal:		// Pure Cardinal.			B=0		C=1
 			params.CubicCoeffB = 0.0f;
 			params.CubicCoeffC = 1.0f;
-			kernel = KernelFilterBicubic;
+			kernel = KernelFilterBicubic<T>;
 			break;
 
 		case tResampleFilter::Bicubic_BSpline:		// Pure BSpline. Blurry.	B=1		C=0
 			params.CubicCoeffB = 1.0f;
 			params.CubicCoeffC = 0.0f;
-			kernel = KernelFilterBicubic;
+			kernel = KernelFilterBicubic<T>;
 			break;
 
 		case tResampleFilter::Lanczos_Narrow:		// Lanczos. Ringy/Sharp.	A=2
 			params.LanczosA = 2.0f;
-			kernel = KernelFilterLanczos;
+			kernel = KernelFilterLanczos<T>;
 			break;
 
 		case tResampleFilter::Lanczos_Normal:		// Lanczos. Ringy/Sharp.	A=3
 			params.LanczosA = 3.0f;
-			kernel = KernelFilterLanczos;
+			kernel = KernelFilterLanczos<T>;
 			break;
 
 		case tResampleFilter::Lanczos_Wide:			// Lanczos. Ringy/Sharp.	A=4
 			params.LanczosA = 4.0f;
-			kernel = KernelFilterLanczos;
+			kernel = KernelFilterLanczos<T>;
 			break;
 
 		case tResampleFilter::Invalid:
@@ -204,14 +279,14 @@ bool tImage::Resample
 
 	// By convention do horizontal first. Outer loop is for each src row.
 	// hri stands for hozontal-resized-image.
-	tPixel4b* hri = new tPixel4b[dstW*srcH];
+	T* hri = new T[dstW*srcH];
 	for (int r = 0; r < srcH; r++)
 	{
 		// Fill in each dst pixel for the src row,
 		float y = float(r);
 		for (int c = 0; c < dstW; c++)
 		{
-			tPixel4b& dstPixel = hri[dstW*r + c];
+			T& dstPixel = hri[dstW*r + c];
 			float x = float(c) * ratioH;
 			dstPixel = kernel(src, srcW, srcH, x, y, FilterDirection::Horizontal, edgeMode, params);
 		}
@@ -223,7 +298,7 @@ bool tImage::Resample
 		float x = float(c);
 		for (int r = 0; r < dstH; r++)
 		{
-			tPixel4b& dstPixel = dst[dstW*r + c];
+			T& dstPixel = dst[dstW*r + c];
 			float y = float(r) * ratioV;
 			dstPixel = kernel(hri, dstW, srcH, x, y, FilterDirection::Vertical, edgeMode, params);
 		}
@@ -234,9 +309,9 @@ bool tImage::Resample
 }
 
 
-tPixel4b tImage::KernelFilterNearest
+template<typename T> T tImage::KernelFilterNearest
 (
-	const tPixel4b* src, int srcW, int srcH, float x, float y,
+	const T* src, int srcW, int srcH, float x, float y,
 	FilterDirection dir, tResampleEdgeMode edgeMode, const FilterParams& params
 )
 {
@@ -246,9 +321,9 @@ tPixel4b tImage::KernelFilterNearest
 }
 
 
-tPixel4b tImage::KernelFilterBox
+template<typename T> T tImage::KernelFilterBox
 (
-	const tPixel4b* src, int srcW, int srcH, float x, float y,
+	const T* src, int srcW, int srcH, float x, float y,
 	FilterDirection dir, tResampleEdgeMode edgeMode, const FilterParams& params
 )
 {
@@ -268,7 +343,7 @@ tPixel4b tImage::KernelFilterBox
 
 		int srcX = GetSrcIndex(ix ,srcW, edgeMode);
 		int srcY = GetSrcIndex(iy ,srcH, edgeMode);
-		tPixel4b srcPixel = src[srcW*srcY + srcX];
+		const T& srcPixel = src[srcW*srcY + srcX];
 
 		if (ratio >= 1.0f)
 		{
@@ -289,21 +364,15 @@ tPixel4b tImage::KernelFilterBox
 		weightTotal += weight;
 	}
 
-	// Renormalize sampleTotal back to [0, 256).
+	// Renormalize sampleTotal back to the range of the pixel type.
 	sampleTotal /= weightTotal;
-	return tPixel4b
-	(
-		tClamp(int(tRound(sampleTotal.x)), 0, 255),
-		tClamp(int(tRound(sampleTotal.y)), 0, 255),
-		tClamp(int(tRound(sampleTotal.z)), 0, 255),
-		tClamp(int(tRound(sampleTotal.w)), 0, 255)
-	);
+	return ToPixel(sampleTotal, (T*)nullptr);
 }
 
 
-tPixel4b tImage::KernelFilterBilinear
+template<typename T> T tImage::KernelFilterBilinear
 (
-	const tPixel4b* src, int srcW, int srcH, float x, float y,
+	const T* src, int srcW, int srcH, float x, float y,
 	FilterDirection dir, tResampleEdgeMode edgeMode, const FilterParams& params
 )
 {
@@ -315,23 +384,15 @@ tPixel4b tImage::KernelFilterBilinear
 	int srcXb = GetSrcIndex(ix+1, srcW, edgeMode);
 	int srcYb = GetSrcIndex(iy+1, srcH, edgeMode);
 
-	tPixel4b a = src[srcW*srcYa + srcXa];
-	tPixel4b b = (dir == FilterDirection::Horizontal) ?
+	const T& a = src[srcW*srcYa + srcXa];
+	const T& b = (dir == FilterDirection::Horizontal) ?
 		src[srcW*srcYa + srcXb] :
 		src[srcW*srcYb + srcXa];
 
 	float weight = (dir == FilterDirection::Horizontal) ? float(x)-ix : float(y)-iy;
 
-	tVector4 av, bv, rv;
-	a.GetDenorm(av);
-	b.GetDenorm(bv);
-	rv = av*(1.0f-weight) + bv*weight;
-	tiClamp(tiRound(rv.x), 0.0f, 255.0f);
-	tiClamp(tiRound(rv.y), 0.0f, 255.0f);
-	tiClamp(tiRound(rv.z), 0.0f, 255.0f);
-	tiClamp(tiRound(rv.w), 0.0f, 255.0f);
-
-	return tPixel4b(int(rv.x), int(rv.y), int(rv.z), int(rv.w));
+	tVector4 rv = ToVector(a)*(1.0f-weight) + ToVector(b)*weight;
+	return ToPixel(rv, (T*)nullptr);
 }
 
 
@@ -375,9 +436,9 @@ float tImage::ComputeCubicWeight(float x, float b, float c)
 }
 
 
-tPixel4b tImage::KernelFilterBicubic
+template<typename T> T tImage::KernelFilterBicubic
 (
-	const tPixel4b* src, int srcW, int srcH, float x, float y,
+	const T* src, int srcW, int srcH, float x, float y,
 	FilterDirection dir, tResampleEdgeMode edgeMode, const FilterParams& params
 )
 {
@@ -394,7 +455,7 @@ tPixel4b tImage::KernelFilterBicubic
 
 		int srcX = GetSrcIndex(ix, srcW, edgeMode);
 		int srcY = GetSrcIndex(iy, srcH, edgeMode);
-		tPixel4b srcPixel = src[srcW*srcY + srcX];
+		const T& srcPixel = src[srcW*srcY + srcX];
 
 		sampleTotal.x += srcPixel.R * weight;
 		sampleTotal.y += srcPixel.G * weight;
@@ -403,15 +464,9 @@ tPixel4b tImage::KernelFilterBicubic
 		weightTotal += weight;
 	}
 
-	// Renormalize sampleTotal back to [0, 256).
+	// Renormalize sampleTotal back to the range of the pixel type.
 	sampleTotal /= weightTotal;
-	return tPixel4b
-	(
-		tClamp(int(tRound(sampleTotal.x)), 0, 255),
-		tClamp(int(tRound(sampleTotal.y)), 0, 255),
-		tClamp(int(tRound(sampleTotal.z)), 0, 255),
-		tClamp(int(tRound(sampleTotal.w)), 0, 255)
-	);
+	return ToPixel(sampleTotal, (T*)nullptr);
 }
 
 
@@ -422,9 +477,9 @@ inline float tImage::ComputeLanczosWeight(float x, float a)
 }
 
 
-tPixel4b tImage::KernelFilterLanczos
+template<typename T> T tImage::KernelFilterLanczos
 (
-	const tPixel4b* src, int srcW, int srcH, float x, float y,
+	const T* src, int srcW, int srcH, float x, float y,
 	FilterDirection dir, tResampleEdgeMode edgeMode, const FilterParams& params
 )
 {
@@ -442,7 +497,7 @@ tPixel4b tImage::KernelFilterLanczos
 
 		int srcX = GetSrcIndex(ix, srcW, edgeMode);
 		int srcY = GetSrcIndex(iy, srcH, edgeMode);
-		tPixel4b srcPixel = src[srcW*srcY + srcX];
+		const T& srcPixel = src[srcW*srcY + srcX];
 
 		sampleTotal.x += srcPixel.R * weight;
 		sampleTotal.y += srcPixel.G * weight;
@@ -451,13 +506,7 @@ tPixel4b tImage::KernelFilterLanczos
 		weightTotal += weight;
 	}
 
-	// Renormalize totalSamples back to [0, 256).
+	// Renormalize sampleTotal back to the range of the pixel type.
 	sampleTotal /= weightTotal;
-	return tPixel4b
-	(
-		tClamp(int(tRound(sampleTotal.x)), 0, 255),
-		tClamp(int(tRound(sampleTotal.y)), 0, 255),
-		tClamp(int(tRound(sampleTotal.z)), 0, 255),
-		tClamp(int(tRound(sampleTotal.w)), 0, 255)
-	);
+	return ToPixel(sampleTotal, (T*)nullptr);
 }
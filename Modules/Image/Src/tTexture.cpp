@@ -22,9 +22,12 @@
 // AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <System/tThread.h>
 #include <Image/tTexture.h>
+#include <Image/tPixelUtil.h>
 #define RGBCX_IMPLEMENTATION
 #include <BC7Enc/rgbcx.h>
+#include <BC7Enc/bc7enc.h>
 namespace tImage
 {
 
@@ -116,6 +119,40 @@ bool tTexture::Load(const tString& imageFile, bool generateMipMaps, tPixelFormat
 
 
 bool tTexture::Set(tPicture& image, bool generateMipmaps, tPixelFormat pixelFormat, tQuality quality, int forceWidth, int forceHeight)
+{
+	LayerCallback = nullptr;
+	return ProcessImage(image, generateMipmaps, pixelFormat, quality, forceWidth, forceHeight);
+}
+
+
+bool tTexture::Encode(tPicture& image, const tLayerCallback& callback, bool generateMipmaps, tPixelFormat pixelFormat, tQuality quality, int forceWidth, int forceHeight)
+{
+	LayerCallback = &callback;
+	bool success = ProcessImage(image, generateMipmaps, pixelFormat, quality, forceWidth, forceHeight);
+	LayerCallback = nullptr;
+	Clear();
+	return success;
+}
+
+
+bool tTexture::AddLayer(tLayer* layer)
+{
+	if (!LayerCallback)
+	{
+		Layers.Append(layer);
+		return true;
+	}
+
+	bool keepGoing = (*LayerCallback)(*layer, NumCallbackLayers++, NumCallbackMipmaps);
+	delete layer;
+	if (!keepGoing)
+		CallbackStopped = true;
+
+	return keepGoing;
+}
+
+
+bool tTexture::ProcessImage(tPicture& image, bool generateMipmaps, tPixelFormat pixelFormat, tQuality quality, int forceWidth, int forceHeight)
 {
 	Clear();
 
@@ -145,6 +182,14 @@ bool tTexture::Set(tPicture& image, bool generateMipmaps, tPixelFormat pixelForm
 			throw tError("Problem resampling texture '%s' to %dx%d.", tSystem::tGetFileBaseName(image.Filename).Pod(), newWidth, newHeight);
 	}
 
+	// Every conversion halves down to 1x1 when generating mipmaps. Callbacks are told the count up front.
+	NumCallbackLayers = 0;
+	NumCallbackMipmaps = 1;
+	CallbackStopped = false;
+	if (generateMipmaps)
+		for (int dim = tMath::tMax(newWidth, newHeight); dim > 1; dim >>= 1)
+			NumCallbackMipmaps++;
+
 	// This must be set before AutoDeterminePixelFormat is called.
 	Opaque = image.IsOpaque();
 
@@ -167,16 +212,37 @@ bool tTexture::Set(tPicture& image, bool generateMipmaps, tPixelFormat pixelForm
 		case tPixelFormat::BC1DXT1:
 		case tPixelFormat::BC2DXT2DXT3:
 		case tPixelFormat::BC3DXT4DXT5:
+		case tPixelFormat::BC4ATI1U:
+		case tPixelFormat::BC5ATI2U:
+		case tPixelFormat::BC6U:
+		case tPixelFormat::BC7:
 			ProcessImageTo_BCTC(image, pixelFormat, generateMipmaps, quality);
 			break;
 
+		case tPixelFormat::ASTC4X4:
+		case tPixelFormat::ASTC5X4:
+		case tPixelFormat::ASTC5X5:
+		case tPixelFormat::ASTC6X5:
+		case tPixelFormat::ASTC6X6:
+		case tPixelFormat::ASTC8X5:
+		case tPixelFormat::ASTC8X6:
+		case tPixelFormat::ASTC8X8:
+		case tPixelFormat::ASTC10X5:
+		case tPixelFormat::ASTC10X6:
+		case tPixelFormat::ASTC10X8:
+		case tPixelFormat::ASTC10X10:
+		case tPixelFormat::ASTC12X10:
+		case tPixelFormat::ASTC12X12:
+			ProcessImageTo_ASTC(image, pixelFormat, generateMipmaps, quality);
+			break;
+
 		default:
 			throw tError("Conversion of image to pixel format %d failed.", int(pixelFormat));
 	}
 
 	// Since the convert functions may or may not modify the source tPicture image, we guarantee invalidness here.
 	image.Clear();
-	return true;
+	return !CallbackStopped;
 }
 
 
@@ -211,7 +277,8 @@ void tTexture::ProcessImageTo_R8G8B8_Or_R8G8B8A8(tPicture& image, tPixelFormat f
 
 		tLayer* layer = new tLayer(format, width, height, layerData, true);
 		tAssert(numDataBytes == layer->GetDataSize());
-		Layers.Append(layer);
+		if (!AddLayer(layer))
+			break;
 
 		// Was this the last one?
 		if (((width == 1) && (height == 1)) || !generateMipmaps)
@@ -262,7 +329,8 @@ void tTexture::ProcessImageTo_G3B5R5G3(tPicture& image, bool generateMipmaps, tQ
 
 		tLayer* layer = new tLayer(tPixelFormat::G3B5R5G3, width, height, layerData, true);
 		tAssert(numDataBytes == layer->GetDataSize());
-		Layers.Append(layer);
+		if (!AddLayer(layer))
+			break;
 
 		// Was this the last one?
 		if (((width == 1) && (height == 1)) || !generateMipmaps)
@@ -289,12 +357,45 @@ void tTexture::ProcessImageTo_BCTC(tPicture& image, tPixelFormat pixelFormat, bo
 	if (!tMath::tIsPower2(width) || !tMath::tIsPower2(height))
 		throw tError("Texture must be power-of-2 to be compressed to a BC format.");
 
+	// Both encoders have global tables that must be built once before any (possibly concurrent) block encodes.
 	if (!BC7EncInitialized)
 	{
 		rgbcx::init(rgbcx::bc1_approx_mode::cBC1Ideal);
+		bc7enc_compress_block_init();
 		BC7EncInitialized = true;
 	}
 
+	int encoderQualityLevel = DetermineBlockEncodeQualityLevel(quality);
+	int bc6hEffort = DetermineBC6HEncodeEffort(quality);
+	bool allow3colour = true;
+	bool useTransparentTexelsForBlack = false;
+
+	// BC7 presets. Fast skips the partitioned mode entirely, Production turns up the uber level.
+	bc7enc_compress_block_params bc7Params;
+	bc7enc_compress_block_params_init(&bc7Params);
+	switch (quality)
+	{
+		case tQuality::Fast:
+			bc7Params.m_max_partitions_mode = 0;
+			bc7Params.m_try_least_squares = BC7ENC_FALSE;
+			break;
+
+		case tQuality::Development:
+			break;
+
+		case tQuality::Production:
+			bc7Params.m_uber_level = 2;
+			break;
+	}
+
+	// BC6H is encoded from linear values. The 8-bit source is sRGB so we convert with a lookup table.
+	float srgbToLinear[256];
+	if (pixelFormat == tPixelFormat::BC6U)
+		for (int v = 0; v < 256; v++)
+			srgbToLinear[v] = tMath::tSRGBToLinear(float(v)/255.0f);
+
+	int blockSize = ((pixelFormat == tPixelFormat::BC1DXT1) || (pixelFormat == tPixelFormat::BC4ATI1U)) ? 8 : 16;
+
 	// This loop resamples (reduces) the image multiple times for mipmap generation. In general we should start with
 	// the original image every time so that we're not applying interpolations to interpolations (better quality).
 	// However, since we are only using a box-filter (pixel averaging) there is no benefit to having a fresh src
@@ -304,40 +405,99 @@ void tTexture::ProcessImageTo_BCTC(tPicture& image, tPixelFormat pixelFormat, bo
 	while (1)
 	{
 		// Setup the layer data to receive the compressed data.
-		int numBlocks = tMath::tMax(1, width/4) * tMath::tMax(1, height/4);
-		int blockSize = (pixelFormat == tPixelFormat::BC1DXT1) ? 8 : 16;
-		int outputSize = numBlocks * blockSize;
+		int numBlocksW = tMath::tMax(1, width/4);
+		int numBlocksH = tMath::tMax(1, height/4);
+		int outputSize = numBlocksW * numBlocksH * blockSize;
 		uint8* outputData = new uint8[outputSize];
 
-		int encoderQualityLevel = DetermineBlockEncodeQualityLevel(quality);
-		bool allow3colour = true;
-		bool useTransparentTexelsForBlack = false;
+		// The src image stops being downsampled at 4x4 (see below) so it may be bigger than the layer. Texels are
+		// gathered from the top-left of the src and clamped to the layer extents for layers smaller than a block.
+		const tPixel4b* pixels = image.GetPixelPointer();
+		int srcW = image.GetWidth();
+		int clampW = tMath::tMin(width, srcW);
+		int clampH = tMath::tMin(height, image.GetHeight());
 
-		uint8* blockDest = outputData;
-		uint8* pixelSrc = (uint8*)image.GetPixelPointer();
-		for (int block = 0; block < numBlocks; block++)
+		// Block rows are independent so they are encoded concurrently. The encoders only read their global tables.
+		auto encodeRows = [&](int rowBegin, int rowEnd)
 		{
-			switch (pixelFormat)
+			tPixel4b blockPixels[16];
+			tColour4f blockColours[16];
+			for (int by = rowBegin; by < rowEnd; by++)
 			{
-				case tPixelFormat::BC1DXT1:
-					rgbcx::encode_bc1(encoderQualityLevel, blockDest, pixelSrc, allow3colour, useTransparentTexelsForBlack);
-					break;
+				uint8* blockDest = outputData + by*numBlocksW*blockSize;
+				for (int bx = 0; bx < numBlocksW; bx++, blockDest += blockSize)
+				{
+					for (int y = 0; y < 4; y++)
+					{
+						int sy = tMath::tMin(by*4 + y, clampH-1);
+						for (int x = 0; x < 4; x++)
+						{
+							int sx = tMath::tMin(bx*4 + x, clampW-1);
+							blockPixels[y*4 + x] = pixels[sy*srcW + sx];
+						}
+					}
+
+					const uint8* blockSrc = (const uint8*)blockPixels;
+					switch (pixelFormat)
+					{
+						case tPixelFormat::BC1DXT1:
+							rgbcx::encode_bc1(encoderQualityLevel, blockDest, blockSrc, allow3colour, useTransparentTexelsForBlack);
+							break;
+
+						case tPixelFormat::BC3DXT4DXT5:
+							rgbcx::encode_bc3(encoderQualityLevel, blockDest, blockSrc);
+							break;
+
+						case tPixelFormat::BC4ATI1U:
+							rgbcx::encode_bc4(blockDest, blockSrc);
+							break;
+
+						case tPixelFormat::BC5ATI2U:
+							rgbcx::encode_bc5(blockDest, blockSrc);
+							break;
+
+						case tPixelFormat::BC6U:
+							for (int p = 0; p < 16; p++)
+								blockColours[p].Set
+								(
+									srgbToLinear[blockPixels[p].R], srgbToLinear[blockPixels[p].G],
+									srgbToLinear[blockPixels[p].B], 1.0f
+								);
+							EncodeBlock_BC6U(blockDest, blockColours, bc6hEffort);
+							break;
+
+						case tPixelFormat::BC7:
+							bc7enc_compress_block(blockDest, blockSrc, &bc7Params);
+							break;
+
+						default:
+							break;
+					}
+				}
+			}
+		};
 
-				case tPixelFormat::BC3DXT4DXT5:
-					rgbcx::encode_bc3(encoderQualityLevel, blockDest, pixelSrc);
-					break;
+		switch (pixelFormat)
+		{
+			case tPixelFormat::BC1DXT1:
+			case tPixelFormat::BC3DXT4DXT5:
+			case tPixelFormat::BC4ATI1U:
+			case tPixelFormat::BC5ATI2U:
+			case tPixelFormat::BC6U:
+			case tPixelFormat::BC7:
+				tSystem::tParallelFor(numBlocksH, encodeRows);
+				break;
 
-				default:
-					throw tError("Unsupported BC pixel format %d.", int(pixelFormat));
-			}
-			blockDest += blockSize;
-			pixelSrc += sizeof(tPixel4b);
+			default:
+				delete[] outputData;
+				throw tError("Unsupported BC pixel format %d.", int(pixelFormat));
 		}
 
 		// The last true in this call allows the layer constructor to steal the outputData pointer. Avoids extra memcpys.
 		tLayer* layer = new tLayer(pixelFormat, width, height, outputData, true);
 		tAssert(layer->GetDataSize() == outputSize);
-		Layers.Append(layer);
+		if (!AddLayer(layer))
+			break;
 
 		// Was this the last one?
 		if (((width == 1) && (height == 1)) || !generateMipmaps)
@@ -368,6 +528,47 @@ void tTexture::ProcessImageTo_BCTC(tPicture& image, tPixelFormat pixelFormat, bo
 }
 
 
+void tTexture::ProcessImageTo_ASTC(tPicture& image, tPixelFormat pixelFormat, bool generateMipmaps, tQuality quality)
+{
+	int width = image.GetWidth();
+	int height = image.GetHeight();
+	tResampleFilter filter = DetermineFilter(quality);
+
+	// One encoder (and astcenc context) is shared by all the mipmap levels. Contexts are expensive to create compared to
+	// encoding the smaller levels.
+	tASTCEncoder encoder(pixelFormat, DetermineASTCEncodeQuality(quality), tColourProfile::sRGB);
+	if (!encoder.IsValid())
+		throw tError("Unable to create ASTC encoder for pixel format %d.", int(pixelFormat));
+
+	// ASTC blocks may overhang the image edge so, unlike BC, every level can be encoded from a resampled image all the
+	// way down to 1x1.
+	while (1)
+	{
+		int outputSize = 0;
+		uint8* outputData = encoder.Encode(outputSize, image.GetPixelPointer(), width, height);
+		if (!outputData)
+			throw tError("ASTC encode of %dx%d layer failed.", width, height);
+
+		tLayer* layer = new tLayer(pixelFormat, width, height, outputData, true);
+		tAssert(layer->GetDataSize() == outputSize);
+		if (!AddLayer(layer))
+			break;
+
+		// Was this the last one?
+		if (((width == 1) && (height == 1)) || !generateMipmaps)
+			break;
+
+		if (width != 1)
+			width >>= 1;
+
+		if (height != 1)
+			height >>= 1;
+
+		image.Resize(width, height, filter);
+	}
+}
+
+
 int tTexture::ComputeMaxNumberOfMipmaps() const
 {
 	if (!IsValid())
@@ -0,0 +1,370 @@
+// tToneMap.cpp
+//
+// Tone-mapping and transfer-function encoding of linear float colours. The SSE2 exp and log approximations follow the
+// Cephes single-precision expf and logf. Their relative error is around 1e-7, far below 8-bit quantization.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <System/tThread.h>
+#include "Image/tToneMap.h"
+#if defined(ARCHITECTURE_X64) || defined(ARCHITECTURE_X86)
+	#define TONEMAP_SSE2
+	#include <emmintrin.h>
+#endif
+namespace tImage {
+
+
+namespace tToneMapper
+{
+	// Pixels per parallel work item. Small images are processed on the calling thread.
+	const int ChunkSize = 16384;
+
+	float ACESFilmic(float x);
+
+	// The scalar path. This is used for the tails of the SSE2 loops and on other architectures.
+	float MapComponent(float x, const tToneMapParams&);
+
+	void MapSpan(tColour4f* dst, const tColour4f* src, int numPixels, const tToneMapParams&);
+	void MapSpan(tColour4b* dst, const tColour4f* src, int numPixels, const tToneMapParams&);
+
+	#ifdef TONEMAP_SSE2
+	__m128 Exp(__m128 x);
+	__m128 Log(__m128 x);
+
+	// x must be >= 0. Returns 0 where x is 0.
+	__m128 Pow(__m128 x, __m128 p);
+
+	__m128 ApplyOperator(__m128 x, const tToneMapParams&);
+	__m128 LinearToSRGB(__m128 x);
+
+	// Pixels are processed four at a time in SoA form so every lane does useful work. Each stage is applied to the R,
+	// G and B vectors back to back so the three independent dependency chains overlap and hide the latency of the
+	// long polynomials.
+	void MapPixels4(__m128& p0, __m128& p1, __m128& p2, __m128& p3, const tToneMapParams&);
+	#endif
+}
+
+
+const char* tGetToneMapOperatorName(tToneMapOperator op)
+{
+	switch (op)
+	{
+		case tToneMapOperator::None:		return "None";
+		case tToneMapOperator::Exposure:	return "Exposure";
+		case tToneMapOperator::Reinhard:	return "Reinhard";
+		case tToneMapOperator::ACESFilmic:	return "ACESFilmic";
+	}
+	return "Invalid";
+}
+
+
+float tToneMapper::ACESFilmic(float x)
+{
+	// See https://knarkowicz.wordpress.com/2016/01/06/aces-filmic-tone-mapping-curve/
+	float mapped = (x*(2.51f*x + 0.03f)) / (x*(2.43f*x + 0.59f) + 0.14f);
+	return tMath::tSaturate(mapped);
+}
+
+
+float tToneMapper::MapComponent(float x, const tToneMapParams& params)
+{
+	switch (params.Operator)
+	{
+		case tToneMapOperator::Exposure:	x = tMath::tTonemapExposure(x, params.Exposure);		break;
+		case tToneMapOperator::Reinhard:	x = tMath::tTonemapReinhard(x * params.Exposure);		break;
+		case tToneMapOperator::ACESFilmic:	x = ACESFilmic(x * params.Exposure);					break;
+		default:																					break;
+	}
+
+	if (params.SRGBCompression)
+		x = tMath::tLinearToSRGB(x);
+
+	// Negative values would give NaN from the pow.
+	if (params.GammaCompression)
+		x = tMath::tLinearToGamma(tMath::tMax(x, 0.0f), params.Gamma);
+
+	return x;
+}
+
+
+#ifdef TONEMAP_SSE2
+inline __m128 tToneMapper::Exp(__m128 x)
+{
+	// Range reduction to x = n*ln2 + f with |f| <= ln2/2. ln2 is split in two so the reduction stays exact.
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.3f)), _mm_set1_ps(88.3f));
+	__m128i n	= _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)));
+	__m128 fn	= _mm_cvtepi32_ps(n);
+	__m128 f	= _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)));
+	f			= _mm_sub_ps(f, _mm_mul_ps(fn, _mm_set1_ps(-2.12194440e-4f)));
+
+	// The polynomial is evaluated with Estrin's scheme rather than Horner's. It has a much shorter dependency chain,
+	// which matters more than the operation count here.
+	__m128 f2	= _mm_mul_ps(f, f);
+	__m128 f4	= _mm_mul_ps(f2, f2);
+	__m128 y01	= _mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.9875691500E-4f), f), _mm_set1_ps(1.3981999507E-3f));
+	__m128 y23	= _mm_add_ps(_mm_mul_ps(_mm_set1_ps(8.3334519073E-3f), f), _mm_set1_ps(4.1665795894E-2f));
+	__m128 y45	= _mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.6666665459E-1f), f), _mm_set1_ps(5.0000001201E-1f));
+	__m128 y	= _mm_add_ps(_mm_add_ps(_mm_mul_ps(y01, f4), _mm_mul_ps(y23, f2)), y45);
+	y			= _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, f2), f), _mm_set1_ps(1.0f));
+
+	// 2^n built directly in the exponent bits. The clamp above keeps n in the normal range.
+	__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+	return _mm_mul_ps(y, scale);
+}
+
+
+inline __m128 tToneMapper::Log(__m128 x)
+{
+	// Split into mantissa m in [0.5, 1) and exponent e, then shift m to [sqrt(0.5), sqrt(2)) and evaluate log(1+t).
+	__m128i bits	= _mm_castps_si128(x);
+	__m128i expo	= _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126));
+	__m128 m		= _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F000000)));
+	__m128 e		= _mm_cvtepi32_ps(expo);
+
+	__m128 small	= _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+	e				= _mm_sub_ps(e, _mm_and_ps(small, _mm_set1_ps(1.0f)));
+	__m128 t		= _mm_sub_ps(_mm_add_ps(m, _mm_and_ps(small, m)), _mm_set1_ps(1.0f));
+	__m128 z		= _mm_mul_ps(t, t);
+
+	// Estrin's scheme again. z is t^2.
+	__m128 z4	= _mm_mul_ps(z, z);
+	__m128 z8	= _mm_mul_ps(z4, z4);
+	__m128 y12	= _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.1514610310E-1f), t), _mm_set1_ps(1.1676998740E-1f));
+	__m128 y34	= _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.2420140846E-1f), t), _mm_set1_ps(1.4249322787E-1f));
+	__m128 y56	= _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.6668057665E-1f), t), _mm_set1_ps(2.0000714765E-1f));
+	__m128 y78	= _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-2.4999993993E-1f), t), _mm_set1_ps(3.3333331174E-1f));
+	__m128 lo	= _mm_add_ps(_mm_mul_ps(y56, z), y78);
+	__m128 hi	= _mm_add_ps(_mm_mul_ps(y12, z), y34);
+	__m128 y	= _mm_add_ps(_mm_add_ps(_mm_mul_ps(hi, z4), lo), _mm_mul_ps(_mm_set1_ps(7.0376836292E-2f), z8));
+	y			= _mm_mul_ps(_mm_mul_ps(y, t), z);
+
+	y			= _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+	y			= _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+	t			= _mm_add_ps(t, y);
+	return _mm_add_ps(t, _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+}
+
+
+inline __m128 tToneMapper::Pow(__m128 x, __m128 p)
+{
+	__m128 positive = _mm_cmpgt_ps(x, _mm_setzero_ps());
+	__m128 safeX = _mm_max_ps(x, _mm_set1_ps(1.0e-30f));
+	return _mm_and_ps(Exp(_mm_mul_ps(p, Log(safeX))), positive);
+}
+
+
+inline __m128 tToneMapper::ApplyOperator(__m128 x, const tToneMapParams& params)
+{
+	__m128 one = _mm_set1_ps(1.0f);
+	switch (params.Operator)
+	{
+		case tToneMapOperator::Exposure:
+			return _mm_sub_ps(one, Exp(_mm_mul_ps(x, _mm_set1_ps(-params.Exposure))));
+
+		case tToneMapOperator::Reinhard:
+			x = _mm_mul_ps(x, _mm_set1_ps(params.Exposure));
+			return _mm_div_ps(x, _mm_add_ps(x, one));
+
+		case tToneMapOperator::ACESFilmic:
+		{
+			x = _mm_mul_ps(x, _mm_set1_ps(params.Exposure));
+			__m128 num = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+			__m128 den = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+			return _mm_min_ps(_mm_max_ps(_mm_div_ps(num, den), _mm_setzero_ps()), one);
+		}
+
+		default:
+			return x;
+	}
+}
+
+
+inline __m128 tToneMapper::LinearToSRGB(__m128 x)
+{
+	__m128 linear = _mm_mul_ps(x, _mm_set1_ps(12.92f));
+	__m128 curve = _mm_sub_ps(_mm_mul_ps(Pow(x, _mm_set1_ps(1.0f/2.4f)), _mm_set1_ps(1.055f)), _mm_set1_ps(0.055f));
+	__m128 useLinear = _mm_cmple_ps(x, _mm_set1_ps(0.0031308f));
+	x = _mm_or_ps(_mm_and_ps(useLinear, linear), _mm_andnot_ps(useLinear, curve));
+	return _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+
+void tToneMapper::MapPixels4(__m128& p0, __m128& p1, __m128& p2, __m128& p3, const tToneMapParams& params)
+{
+	// After the transpose p0..p3 hold R, G, B and A of the four pixels.
+	_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+	if (params.Operator != tToneMapOperator::None)
+	{
+		p0 = ApplyOperator(p0, params);
+		p1 = ApplyOperator(p1, params);
+		p2 = ApplyOperator(p2, params);
+	}
+
+	if (params.SRGBCompression)
+	{
+		p0 = LinearToSRGB(p0);
+		p1 = LinearToSRGB(p1);
+		p2 = LinearToSRGB(p2);
+	}
+
+	if (params.GammaCompression)
+	{
+		__m128 invGamma = _mm_set1_ps(1.0f/params.Gamma);
+		p0 = Pow(p0, invGamma);
+		p1 = Pow(p1, invGamma);
+		p2 = Pow(p2, invGamma);
+	}
+	_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+}
+#endif
+
+
+void tToneMapper::MapSpan(tColour4f* dst, const tColour4f* src, int numPixels, const tToneMapParams& params)
+{
+	int p = 0;
+
+	#ifdef TONEMAP_SSE2
+	for (; p + 4 <= numPixels; p += 4)
+	{
+		__m128 p0 = _mm_loadu_ps(&src[p+0].R);
+		__m128 p1 = _mm_loadu_ps(&src[p+1].R);
+		__m128 p2 = _mm_loadu_ps(&src[p+2].R);
+		__m128 p3 = _mm_loadu_ps(&src[p+3].R);
+		MapPixels4(p0, p1, p2, p3, params);
+		_mm_storeu_ps(&dst[p+0].R, p0);
+		_mm_storeu_ps(&dst[p+1].R, p1);
+		_mm_storeu_ps(&dst[p+2].R, p2);
+		_mm_storeu_ps(&dst[p+3].R, p3);
+	}
+	#endif
+
+	for (; p < numPixels; p++)
+	{
+		dst[p].R = MapComponent(src[p].R, params);
+		dst[p].G = MapComponent(src[p].G, params);
+		dst[p].B = MapComponent(src[p].B, params);
+		dst[p].A = src[p].A;
+	}
+}
+
+
+void tToneMapper::MapSpan(tColour4b* dst, const tColour4f* src, int numPixels, const tToneMapParams& params)
+{
+	int p = 0;
+
+	#ifdef TONEMAP_SSE2
+	// Quantize like tColour4b::SetR, int(x*256) clamped to [0, 255]. The clamp happens in float first because the
+	// integer conversion of huge values gives INT_MIN, which the saturating packs would turn into 0 instead of 255.
+	const __m128 scale	= _mm_set1_ps(256.0f);
+	const __m128 zero	= _mm_setzero_ps();
+	const __m128 top	= _mm_set1_ps(255.0f);
+	const bool identity	= params.IsIdentity();
+	for (; p + 4 <= numPixels; p += 4)
+	{
+		__m128 v[4] = { _mm_loadu_ps(&src[p+0].R), _mm_loadu_ps(&src[p+1].R), _mm_loadu_ps(&src[p+2].R), _mm_loadu_ps(&src[p+3].R) };
+		if (!identity)
+			MapPixels4(v[0], v[1], v[2], v[3], params);
+
+		__m128i q[4];
+		for (int i = 0; i < 4; i++)
+			q[i] = _mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(v[i], scale), top), zero));
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+		_mm_storeu_si128((__m128i*)(dst + p), packed);
+	}
+	#endif
+
+	for (; p < numPixels; p++)
+	{
+		tColour4f colour(MapComponent(src[p].R, params), MapComponent(src[p].G, params), MapComponent(src[p].B, params), src[p].A);
+		dst[p].Set(colour);
+	}
+}
+
+
+void ToneMap(tColour4f* pixels, int numPixels, const tToneMapParams& params)
+{
+	if (!pixels || (numPixels <= 0) || params.IsIdentity())
+		return;
+
+	int numChunks = (numPixels + tToneMapper::ChunkSize - 1) / tToneMapper::ChunkSize;
+	tSystem::tParallelFor
+	(
+		numChunks,
+		[&](int begin, int end)
+		{
+			int first = begin*tToneMapper::ChunkSize;
+			int count = tMath::tMin(end*tToneMapper::ChunkSize, numPixels) - first;
+			tToneMapper::MapSpan(pixels + first, pixels + first, count, params);
+		},
+		params.NumThreads
+	);
+}
+
+
+void ToneMap(tColour4b* dst, const tColour4f* src, int numPixels, const tToneMapParams& params)
+{
+	if (!dst || !src || (numPixels <= 0))
+		return;
+
+	int numChunks = (numPixels + tToneMapper::ChunkSize - 1) / tToneMapper::ChunkSize;
+	tSystem::tParallelFor
+	(
+		numChunks,
+		[&](int begin, int end)
+		{
+			int first = begin*tToneMapper::ChunkSize;
+			int count = tMath::tMin(end*tToneMapper::ChunkSize, numPixels) - first;
+			tToneMapper::MapSpan(dst + first, src + first, count, params);
+		},
+		params.NumThreads
+	);
+}
+
+
+void EncodeLDR(tColour4b* pixels, int numPixels, const tToneMapParams& params)
+{
+	if (!pixels || (numPixels <= 0) || (!params.SRGBCompression && !params.GammaCompression))
+		return;
+
+	// Built with the same float conversions the loaders used per pixel, so the table is exact.
+	uint8 table[256];
+	for (int v = 0; v < 256; v++)
+	{
+		tColour4f colour(tColour4b(uint8(v), 0, 0, 0));
+		if (params.SRGBCompression)
+			colour.LinearToSRGB(tCompBit_R);
+		if (params.GammaCompression)
+			colour.LinearToGamma(params.Gamma, tCompBit_R);
+		tColour4b quantized;
+		quantized.SetR(colour.R);
+		table[v] = quantized.R;
+	}
+
+	int numChunks = (numPixels + tToneMapper::ChunkSize - 1) / tToneMapper::ChunkSize;
+	tSystem::tParallelFor
+	(
+		numChunks,
+		[&](int begin, int end)
+		{
+			int last = tMath::tMin(end*tToneMapper::ChunkSize, numPixels);
+			for (int p = begin*tToneMapper::ChunkSize; p < last; p++)
+			{
+				pixels[p].R = table[pixels[p].R];
+				pixels[p].G = table[pixels[p].G];
+				pixels[p].B = table[pixels[p].B];
+			}
+		},
+		params.NumThreads
+	);
+}
+
+
+}
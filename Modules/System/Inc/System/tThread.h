@@ -0,0 +1,78 @@
+// tThread.h
+//
+// Simple helpers for spreading work across all cores. tParallelFor splits an index range into contiguous chunks and
+// runs them on std::threads. The calling thread always processes the first chunk itself and the call does not return
+// until every chunk is done. There is no persistent pool, so these are intended for coarse-grained work like decoding
+// stripes or rows of an image, where thread startup cost is small compared to the work.
+//
+// Copyright (c) 2025 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <thread>
+#include <Foundation/tFundamentals.h>
+#include "System/tMachine.h"
+namespace tSystem
+{
+
+
+// Returns how many threads tParallelFor would use for numItems. If maxThreads is <= 0 the number of cores is used as
+// the maximum. The result is always in [1, numItems] for numItems >= 1.
+int tGetNumWorkerThreads(int numItems, int maxThreads = 0);
+
+// Calls fn(begin, end) for contiguous, non-overlapping sub-ranges that together cover [0, numItems). The sub-ranges
+// are run concurrently on up to maxThreads threads (all cores if <= 0). Blocks until all are complete. fn must be safe
+// to call concurrently for different ranges.
+template<typename Fn> void tParallelFor(int numItems, Fn fn, int maxThreads = 0);
+
+
+}
+
+
+// Implementation below this line.
+
+
+inline int tSystem::tGetNumWorkerThreads(int numItems, int maxThreads)
+{
+	if (numItems <= 0)
+		return 0;
+
+	if (maxThreads <= 0)
+		maxThreads = tGetNumCores();
+
+	return tMath::tClamp(maxThreads, 1, numItems);
+}
+
+
+template<typename Fn> inline void tSystem::tParallelFor(int numItems, Fn fn, int maxThreads)
+{
+	int numThreads = tGetNumWorkerThreads(numItems, maxThreads);
+	if (numThreads <= 1)
+	{
+		if (numItems > 0)
+			fn(0, numItems);
+		return;
+	}
+
+	// The first (numItems % numThreads) chunks get one extra item so the chunks differ in size by at most one.
+	int chunkSize = numItems / numThreads;
+	int numLarger = numItems % numThreads;
+	auto chunkBegin = [chunkSize, numLarger](int chunk) { return chunk*chunkSize + tMath::tMin(chunk, numLarger); };
+
+	std::thread* threads = new std::thread[numThreads-1];
+	for (int t = 1; t < numThreads; t++)
+		threads[t-1] = std::thread(fn, chunkBegin(t), chunkBegin(t+1));
+
+	fn(chunkBegin(0), chunkBegin(1));
+	for (int t = 0; t < numThreads-1; t++)
+		threads[t].join();
+
+	delete[] threads;
+}
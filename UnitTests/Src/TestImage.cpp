@@ -33,15 +33,169 @@
 #include <Image/tImageTIFF.h>
 #include <Image/tImagePVR.h>
 #include <Image/tPaletteImage.h>
+#include <Image/tAtlas.h>
+#include <Image/tToneMap.h>
+#include <Image/tEnvMap.h>
+#include <Image/tPictureT.h>
+#include <Image/tConvert.h>
+#include <Image/tPixelUtil.h>
+#include <zlib.h>
+#define KHRONOS_STATIC
+#include <LibKTX/include/ktx.h>
+#include <LibKTX/include/vulkan_core.h>
+#include <Foundation/tBitArray.h>
 #include <System/tFile.h>
+#include <System/tTime.h>
 #include "UnitTests.h"
 using namespace tImage;
 namespace tUnitTest
 {
 
 
+// Builds a png or apng in memory a chunk at a time. Lengths and CRCs are big-endian and the CRC covers the type and
+// data. PutChunk returns false if the chunk does not fit.
+struct PNGChunkWriter
+{
+	PNGChunkWriter(int maxBytes)																						: Data(new uint8[maxBytes]), Size(8), MaxBytes(maxBytes) { const uint8 signature[] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 }; tStd::tMemcpy(Data, signature, 8); }
+	~PNGChunkWriter()																									{ delete[] Data; }
+
+	static void PutU32(uint8* dst, uint32 v)																			{ dst[0] = uint8(v >> 24); dst[1] = uint8(v >> 16); dst[2] = uint8(v >> 8); dst[3] = uint8(v); }
+	bool PutChunk(const char* type, const uint8* data, int numBytes);
+	bool Save(const tString& pngFile) const																				{ return tSystem::tCreateFile(pngFile, Data, Size); }
+
+	uint8* Data;
+	int Size;
+	int MaxBytes;
+};
+
+
+inline bool PNGChunkWriter::PutChunk(const char* type, const uint8* data, int numBytes)
+{
+	if (Size + 12 + numBytes > MaxBytes)
+		return false;
+
+	PutU32(Data+Size, numBytes);
+	tStd::tMemcpy(Data+Size+4, type, 4);
+	if (numBytes)
+		tStd::tMemcpy(Data+Size+8, data, numBytes);
+	PutU32(Data+Size+8+numBytes, crc32(0, Data+Size+4, 4+numBytes));
+	Size += 12 + numBytes;
+	return true;
+}
+
+
+// Writes an 8-bit RGBA Adam7 interlaced png. The pixels are in tacent order with the bottom row first. Every pass row
+// is unfiltered.
+static bool WriteAdam7PNG(const tString& pngFile, const tPixel4b* pixels, int width, int height)
+{
+	const int xStart[7] = { 0, 4, 0, 2, 0, 1, 0 };	const int xDelta[7] = { 8, 8, 4, 4, 2, 2, 1 };
+	const int yStart[7] = { 0, 0, 4, 0, 2, 0, 1 };	const int yDelta[7] = { 8, 8, 8, 4, 4, 2, 2 };
+	int rawBytes = 0;
+	for (int pass = 0; pass < 7; pass++)
+	{
+		int passW = (width - xStart[pass] + xDelta[pass] - 1) / xDelta[pass];
+		int passH = (height - yStart[pass] + yDelta[pass] - 1) / yDelta[pass];
+		if ((passW > 0) && (passH > 0))
+			rawBytes += passH * (1 + passW*4);
+	}
+
+	uint8* raw = new uint8[rawBytes];
+	uint8* dst = raw;
+	for (int pass = 0; pass < 7; pass++)
+	{
+		for (int y = yStart[pass]; (y < height) && (xStart[pass] < width); y += yDelta[pass])
+		{
+			*dst++ = 0;
+			for (int x = xStart[pass]; x < width; x += xDelta[pass])
+			{
+				tStd::tMemcpy(dst, &pixels[(height-1-y)*width + x], 4);
+				dst += 4;
+			}
+		}
+	}
+
+	uLongf zipBytes = compressBound(rawBytes);
+	uint8* zip = new uint8[zipBytes];
+	bool success = (compress2(zip, &zipBytes, raw, rawBytes, 6) == Z_OK);
+	delete[] raw;
+
+	PNGChunkWriter png(int(zipBytes) + 64);
+	uint8 ihdr[13];
+	PNGChunkWriter::PutU32(ihdr, width); PNGChunkWriter::PutU32(ihdr+4, height);
+	ihdr[8] = 8; ihdr[9] = 6; ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 1;
+	success = success && png.PutChunk("IHDR", ihdr, 13) && png.PutChunk("IDAT", zip, int(zipBytes)) && png.PutChunk("IEND", nullptr, 0);
+	delete[] zip;
+	return success && png.Save(pngFile);
+}
+
+
 tTestUnit(ImageLoad)
 {
+	// Progressive loads of a progressive jpg and an Adam7 png must call back at least once, always with a pass before
+	// the last, and must give exactly the pixels of a normal load. The files are written here so no test data is
+	// needed. The odd dimensions leave partial blocks and partial Adam7 passes.
+	const int progW = 203;
+	const int progH = 157;
+	tPixel4b* progPixels = new tPixel4b[progW*progH];
+	for (int y = 0; y < progH; y++)
+		for (int x = 0; x < progW; x++)
+			progPixels[y*progW + x].Set(x, (x*y) & 0xFF, 255 - y, 128 + ((x ^ y) & 0x7F));
+
+	int numPreviews = 0;
+	bool previewsValid = true;
+	auto progressive = [&](tFrame& preview, int pass, int numPasses)
+	{
+		numPreviews++;
+		if (!preview.IsValid() || (preview.Width != progW) || (preview.Height != progH) || (pass < 0) || (pass >= numPasses))
+			previewsValid = false;
+	};
+
+	tImageJPG::SaveParams jpgProgressiveSave;
+	jpgProgressiveSave.Progressive = true;
+	tImageJPG jpgProgressiveSrc(progPixels, progW, progH, false);
+	tRequire(jpgProgressiveSrc.Save("WrittenProgressive.jpg", jpgProgressiveSave));
+	tImageJPG jpgNormal("WrittenProgressive.jpg");
+	tImageJPG::LoadParams jpgProgressiveLoad;
+	jpgProgressiveLoad.Progressive = progressive;
+	tImageJPG jpgPreviewed("WrittenProgressive.jpg", jpgProgressiveLoad);
+	tRequire(jpgNormal.IsValid() && jpgPreviewed.IsValid());
+	tRequire((numPreviews > 0) && previewsValid);
+	tRequire((jpgPreviewed.GetWidth() == progW) && (jpgPreviewed.GetHeight() == progH));
+	tRequire(tStd::tMemcmp(jpgPreviewed.GetPixels(), jpgNormal.GetPixels(), progW*progH*sizeof(tPixel4b)) == 0);
+
+	// Progressive region decodes go through the whole-image coefficient buffer and must match a full decode too.
+	tImageJPG::LoadParams jpgProgressiveRegion;
+	jpgProgressiveRegion.Flags = 0;
+	jpgProgressiveRegion.RegionX = 37;		jpgProgressiveRegion.RegionY = 21;
+	jpgProgressiveRegion.RegionWidth = 100;	jpgProgressiveRegion.RegionHeight = 61;
+	tImageJPG jpgRegionProg("WrittenProgressive.jpg", jpgProgressiveRegion);
+	tRequire(jpgRegionProg.IsValid() && (jpgRegionProg.GetWidth() == 100) && (jpgRegionProg.GetHeight() == 61));
+	bool progRegionMatch = true;
+	for (int y = 0; y < 61; y++)
+		for (int x = 0; x < 100; x++)
+			if (jpgRegionProg.GetPixels()[y*100 + x] != jpgNormal.GetPixels()[(y+21)*progW + x+37])
+				progRegionMatch = false;
+	tRequire(progRegionMatch);
+
+	// A region hanging off the top-right is clipped to the image.
+	jpgProgressiveRegion.RegionX = progW - 30;	jpgProgressiveRegion.RegionY = progH - 20;
+	tImageJPG jpgClippedProg("WrittenProgressive.jpg", jpgProgressiveRegion);
+	tRequire(jpgClippedProg.IsValid() && (jpgClippedProg.GetWidth() == 30) && (jpgClippedProg.GetHeight() == 20));
+	tRequire(jpgClippedProg.GetPixels()[19*30 + 29] == jpgNormal.GetPixels()[progW*progH - 1]);
+
+	numPreviews = 0;
+	tRequire(WriteAdam7PNG("WrittenAdam7.png", progPixels, progW, progH));
+	tImagePNG pngNormal("WrittenAdam7.png");
+	tImagePNG::LoadParams pngProgressiveLoad;
+	pngProgressiveLoad.Progressive = progressive;
+	tImagePNG pngPreviewed("WrittenAdam7.png", pngProgressiveLoad);
+	tRequire(pngNormal.IsValid() && pngPreviewed.IsValid());
+	tRequire((numPreviews > 0) && previewsValid);
+	tRequire((pngPreviewed.GetWidth() == progW) && (pngPreviewed.GetHeight() == progH));
+	tRequire(tStd::tMemcmp(pngNormal.GetPixels8(), progPixels, progW*progH*sizeof(tPixel4b)) == 0);
+	tRequire(tStd::tMemcmp(pngPreviewed.GetPixels8(), pngNormal.GetPixels8(), progW*progH*sizeof(tPixel4b)) == 0);
+	delete[] progPixels;
+
 	if (!tSystem::tDirExists("TestData/Images/"))
 		tSkipUnit(ImageLoad)
 
@@ -73,6 +227,29 @@ tTestUnit(ImageLoad)
 	tImageJPG imgJPG("TestData/Images/WiredDrives.jpg");
 	tRequire(imgJPG.IsValid());
 
+	// A progressive load of a single-scan file never calls back and must give the same final pixels.
+	numPreviews = 0;
+	tImageJPG imgJPGProgressive("TestData/Images/WiredDrives.jpg", jpgProgressiveLoad);
+	tRequire(imgJPGProgressive.IsValid() && (numPreviews == 0));
+	tRequire(imgJPGProgressive.GetWidth() == imgJPG.GetWidth());
+	tRequire(tStd::tMemcmp(imgJPGProgressive.GetPixels(), imgJPG.GetPixels(), imgJPG.GetWidth()*imgJPG.GetHeight()*sizeof(tPixel4b)) == 0);
+
+	// Region decodes must match the same pixels of a full decode. The region origin is lower-left.
+	tImageJPG::LoadParams jpgRegion;
+	jpgRegion.Flags = 0;
+	jpgRegion.RegionX = 37;		jpgRegion.RegionY = 21;
+	jpgRegion.RegionWidth = 100;	jpgRegion.RegionHeight = 61;
+	tImageJPG imgJPGRegion("TestData/Images/WiredDrives.jpg", jpgRegion);
+	jpgRegion.RegionWidth = 0;
+	tImageJPG imgJPGFull("TestData/Images/WiredDrives.jpg", jpgRegion);
+	tRequire(imgJPGRegion.IsValid() && (imgJPGRegion.GetWidth() == 100) && (imgJPGRegion.GetHeight() == 61));
+	bool regionMatch = true;
+	for (int y = 0; y < 61; y++)
+		for (int x = 0; x < 100; x++)
+			if (imgJPGRegion.GetPixels()[y*100 + x] != imgJPGFull.GetPixels()[(y+21)*imgJPGFull.GetWidth() + x+37])
+				regionMatch = false;
+	tRequire(regionMatch);
+
 	tImageKTX imgKTX("TestData/Images/KTX2/BC7_RGBA.ktx2");
 	tRequire(imgKTX.IsValid());
 
@@ -80,6 +257,18 @@ tTestUnit(ImageLoad)
 	tRequire(imgPNG.IsValid());
 	tRequire(imgPNG.GetPixelFormatSrc() == tPixelFormat::R8G8B8A8);
 
+	tImagePNG::LoadParams pngRegion;
+	pngRegion.RegionX = -8;		pngRegion.RegionY = 5;
+	pngRegion.RegionWidth = 40;	pngRegion.RegionHeight = 30;
+	tImagePNG imgPNGRegion("TestData/Images/TacentTestPattern.png", pngRegion);
+	tRequire(imgPNGRegion.IsValid() && (imgPNGRegion.GetWidth() == 32) && (imgPNGRegion.GetHeight() == 30));
+	regionMatch = true;
+	for (int y = 0; y < 30; y++)
+		for (int x = 0; x < 32; x++)
+			if (imgPNGRegion.GetPixels8()[y*32 + x] != imgPNG.GetPixels8()[(y+5)*imgPNG.GetWidth() + x])
+				regionMatch = false;
+	tRequire(regionMatch);
+
 	tImagePVR imgPVR("TestData/Images/PVR_V3/PVRBPP4_UNORM_SRGB_RGBA_T.png");
 	tRequire(!imgPVR.IsValid());
 
@@ -163,6 +352,22 @@ tTestUnit(ImageSave)
 	tRequire(rresult32 == tImageQOI::tFormat::BPP32);
 
 	tImageTGA tgaPattern("TacentTestPattern32.tga");
+
+	// Saving to memory, both compressed and uncompressed, must round-trip exactly.
+	for (int rle = 0; rle < 2; rle++)
+	{
+		tImageTGA::SaveParams tgaSaveParams;
+		tgaSaveParams.Format = tImageTGA::tFormat::BPP32;
+		tgaSaveParams.Compression = rle ? tImageTGA::tCompression::RLE : tImageTGA::tCompression::None;
+		uint8* tgaInMemory = nullptr;
+		int tgaNumBytes = 0;
+		tRequire(tgaPattern.Save(tgaInMemory, tgaNumBytes, tgaSaveParams) == tImageTGA::tFormat::BPP32);
+		tImageTGA tgaFromMemory(tgaInMemory, tgaNumBytes);
+		tRequire(tgaFromMemory.IsValid());
+		tRequire(tStd::tMemcmp(tgaFromMemory.GetPixels(), tgaPattern.GetPixels(), tgaPattern.GetWidth()*tgaPattern.GetHeight()*sizeof(tPixel4b)) == 0);
+		delete[] tgaInMemory;
+	}
+
 	int tgaW = tgaPattern.GetWidth();
 	int tgaH = tgaPattern.GetHeight();
 	tPixel4b* tgaPixels = tgaPattern.StealPixels();
@@ -236,6 +441,51 @@ tTestUnit(ImageSave)
 	tRequire(frames.IsEmpty());
 	tRequire(tSystem::tFileExists("WrittenDesk.webp"));
 
+	// Jpg save options. Banded multi-threaded, optimized Huffman and progressive saves only change the entropy coding,
+	// so they must decode to exactly the same pixels as a plain single-threaded save.
+	tImageJPG jpgSource("WiredDrives.jpg");
+	int jpgW = jpgSource.GetWidth();
+	int jpgH = jpgSource.GetHeight();
+	int jpgNumBytes = jpgW*jpgH*sizeof(tPixel4b);
+	tImageJPG::Subsampling subsamplings[] = { tImageJPG::Subsampling::S444, tImageJPG::Subsampling::S422, tImageJPG::Subsampling::S420, tImageJPG::Subsampling::S440 };
+	for (int s = 0; s < int(tNumElements(subsamplings)); s++)
+	{
+		tImageJPG::SaveParams jpgSaveParams;
+		jpgSaveParams.Subsampling = subsamplings[s];
+		tRequire(jpgSource.Save("WrittenSaveParamsSingle.jpg", jpgSaveParams));
+		tImageJPG jpgSingle("WrittenSaveParamsSingle.jpg");
+		tRequire(jpgSingle.IsValid() && (jpgSingle.GetWidth() == jpgW) && (jpgSingle.GetHeight() == jpgH));
+
+		jpgSaveParams.NumThreads = 5;
+		tRequire(jpgSource.Save("WrittenSaveParamsBanded.jpg", jpgSaveParams));
+		tImageJPG jpgBanded("WrittenSaveParamsBanded.jpg");
+		tRequire(jpgBanded.IsValid() && (jpgBanded.GetWidth() == jpgW) && (jpgBanded.GetHeight() == jpgH));
+		tRequire(tStd::tMemcmp(jpgBanded.GetPixels(), jpgSingle.GetPixels(), jpgNumBytes) == 0);
+
+		jpgSaveParams.NumThreads = 1;
+		jpgSaveParams.OptimizeHuffman = true;
+		tRequire(jpgSource.Save("WrittenSaveParamsOptimized.jpg", jpgSaveParams));
+		tImageJPG jpgOptimized("WrittenSaveParamsOptimized.jpg");
+		tRequire(jpgOptimized.IsValid());
+		tRequire(tStd::tMemcmp(jpgOptimized.GetPixels(), jpgSingle.GetPixels(), jpgNumBytes) == 0);
+
+		jpgSaveParams.OptimizeHuffman = false;
+		jpgSaveParams.Progressive = true;
+		tRequire(jpgSource.Save("WrittenSaveParamsProgressive.jpg", jpgSaveParams));
+		int numPreviews = 0;
+		tImageJPG::LoadParams jpgProgressive;
+		jpgProgressive.Progressive = [&numPreviews](tFrame&, int, int) { numPreviews++; };
+		tImageJPG jpgProgressed("WrittenSaveParamsProgressive.jpg", jpgProgressive);
+		tRequire(jpgProgressed.IsValid() && (numPreviews > 0));
+		tRequire(tStd::tMemcmp(jpgProgressed.GetPixels(), jpgSingle.GetPixels(), jpgNumBytes) == 0);
+
+		jpgSaveParams.Progressive = false;
+		jpgSaveParams.FastDCT = true;
+		tRequire(jpgSource.Save("WrittenSaveParamsFastDCT.jpg", jpgSaveParams));
+		tImageJPG jpgFast("WrittenSaveParamsFastDCT.jpg");
+		tRequire(jpgFast.IsValid() && (jpgFast.GetWidth() == jpgW) && (jpgFast.GetHeight() == jpgH));
+	}
+
 	tSystem::tSetCurrentDir(origDir);
 }
 
@@ -284,6 +534,101 @@ tTestUnit(ImageTexture)
 	tChunkWriter chunkWriterBC3("TestData/Images/Written_UpperBounds_BC3.tac");
 	bc3Tex.Save(chunkWriterBC3);
 	tRequire( tSystem::tFileExists("TestData/Images/Written_UpperBounds_BC3.tac"));
+
+	// Check the BC encoders for every quality preset. The source is resized to a power of 2 up front so the decoded
+	// main layer can be compared against it directly. PSNR is measured only over the encoded channels. Encode
+	// throughput and PSNR are reported by the ImageBC benchmark.
+	tImageJPG bcJpg("TestData/Images/WiredDrives.jpg");
+	tPicture bcSrc(bcJpg.GetWidth(), bcJpg.GetHeight(), bcJpg.StealPixels(), false);
+	bcSrc.Resize(tMath::tClosestPower2(bcSrc.GetWidth()), tMath::tClosestPower2(bcSrc.GetHeight()));
+	int bcW = bcSrc.GetWidth(); int bcH = bcSrc.GetHeight();
+	tPixelFormat bcFormats[] =
+	{
+		tPixelFormat::BC1DXT1, tPixelFormat::BC3DXT4DXT5, tPixelFormat::BC4ATI1U,
+		tPixelFormat::BC5ATI2U, tPixelFormat::BC6U, tPixelFormat::BC7
+	};
+	int bcChannels[] = { 3, 3, 1, 2, 3, 3 };
+	tTexture::tQuality bcQualities[] = { tTexture::tQuality::Fast, tTexture::tQuality::Development, tTexture::tQuality::Production };
+	for (int q = 0; q < 3; q++)
+	{
+		for (int f = 0; f < int(tNumElements(bcFormats)); f++)
+		{
+			tPicture bcPic(bcSrc);
+			tTexture bcTex(bcPic, false, bcFormats[f], bcQualities[q]);
+			tRequire(bcTex.IsValid() && (bcTex.GetPixelFormat() == bcFormats[f]));
+
+			tLayer* layer = bcTex.GetMainLayer();
+			tColour4b* decodedLDR = nullptr;
+			tColour4f* decodedHDR = nullptr;
+			DecodeResult result = DecodePixelData(bcFormats[f], layer->Data, layer->GetDataSize(), bcW, bcH, decodedLDR, decodedHDR);
+			tRequire(result == DecodeResult::Success);
+
+			double sumSqErr = 0.0;
+			tPixel4b* srcPixels = bcSrc.GetPixelPointer();
+			for (int p = 0; p < bcW*bcH; p++)
+			{
+				for (int c = 0; c < bcChannels[f]; c++)
+				{
+					float decoded = decodedLDR ? float(decodedLDR[p].E[c]) : 255.0f*tMath::tLinearToSRGB(decodedHDR[p].E[c]);
+					float err = decoded - float(srcPixels[p].E[c]);
+					sumSqErr += err*err;
+				}
+			}
+			delete[] decodedLDR;
+			delete[] decodedHDR;
+
+			double mse = tMath::tMax(sumSqErr / double(bcW*bcH*bcChannels[f]), 0.0001);
+			double psnr = 10.0 * log10(255.0*255.0 / mse);
+			tRequire(psnr > 25.0);
+		}
+	}
+
+	// Test jpg to ASTC texture with mipmaps. One encoder context is used for all levels. The main layer is compared
+	// against the power-of-2 source. Encode throughput is measured by the ImageASTC benchmark.
+	tTexture::tQuality astcQualities[] = { tTexture::tQuality::Fast, tTexture::tQuality::Development };
+	for (int q = 0; q < 2; q++)
+	{
+		tPicture astcPic(bcSrc);
+		tTexture astcTex(astcPic, true, tPixelFormat::ASTC6X6, astcQualities[q]);
+		tRequire(astcTex.IsValid() && (astcTex.GetPixelFormat() == tPixelFormat::ASTC6X6));
+		tRequire(astcTex.GetNumMipmaps() == astcTex.ComputeMaxNumberOfMipmaps());
+
+		tLayer* layer = astcTex.GetMainLayer();
+		tColour4b* decodedLDR = nullptr;
+		tColour4f* decodedHDR = nullptr;
+		DecodeResult result = DecodePixelData(tPixelFormat::ASTC6X6, layer->Data, layer->GetDataSize(), bcW, bcH, decodedLDR, decodedHDR);
+		tRequire(result == DecodeResult::Success);
+
+		double sumSqErr = 0.0;
+		tPixel4b* srcPixels = bcSrc.GetPixelPointer();
+		for (int p = 0; p < bcW*bcH; p++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				float decoded = decodedLDR ? float(decodedLDR[p].E[c]) : 255.0f*tMath::tLinearToSRGB(decodedHDR[p].E[c]);
+				float err = decoded - float(srcPixels[p].E[c]);
+				sumSqErr += err*err;
+			}
+		}
+		delete[] decodedLDR;
+		delete[] decodedHDR;
+
+		double mse = tMath::tMax(sumSqErr / double(bcW*bcH*3), 0.0001);
+		double psnr = 10.0 * log10(255.0*255.0 / mse);
+		tRequire(psnr > 25.0);
+	}
+
+	// Test saving an .astc file and loading it back.
+	tImageJPG astcSrc("TestData/Images/WiredDrives.jpg");
+	tImageASTC astcDst(astcSrc.StealPixels(), astcSrc.GetWidth(), astcSrc.GetHeight(), true);
+	tImageASTC::SaveParams astcParams;
+	astcParams.Format = tPixelFormat::ASTC8X8;
+	astcParams.Quality = tASTCEncoder::Quality_Fast;
+	tRequire(astcDst.Save("TestData/Images/Written_WiredDrives_ASTC8X8.astc", astcParams));
+	tImageASTC astcLoaded("TestData/Images/Written_WiredDrives_ASTC8X8.astc");
+	tRequire(astcLoaded.IsValid());
+	tRequire((astcLoaded.GetWidth() == astcDst.GetWidth()) && (astcLoaded.GetHeight() == astcDst.GetHeight()));
+	tRequire(astcLoaded.GetPixelFormatSrc() == tPixelFormat::ASTC8X8);
 }
 
 
@@ -623,6 +968,45 @@ tTestUnit(ImagePalette)
 	PalettizeImage(w, h, pixels, tPixelFormat::PAL7BIT, tImage::tQuantize::Method::Wu);
 	PalettizeImage(w, h, pixels, tPixelFormat::PAL8BIT, tImage::tQuantize::Method::Wu);
 
+	//
+	// Packed index kernels. The packing must match tBitArray8 and expanding must match a plain palette lookup. The odd
+	// count exercises both the fast paths and the tails.
+	//
+	const int numIndices = 1001;
+	uint8 indices[numIndices];
+	uint8 packed[numIndices];
+	uint8 unpacked[numIndices];
+	tPixel4b palette[256];
+	for (int c = 0; c < 256; c++)
+		palette[c].Set(c, 255-c, c/2, 255);
+	tPixel4b* expanded = new tPixel4b[numIndices];
+	for (int bpp = 1; bpp <= 8; bpp++)
+	{
+		for (int i = 0; i < numIndices; i++)
+			indices[i] = uint8((i*7 + i/3) & ((1 << bpp) - 1));
+
+		uint8 reference[numIndices];
+		tStd::tMemset(reference, 0, numIndices);
+		tBitArray8 bitArray(reference, numIndices*bpp, true);
+		for (int i = 0; i < numIndices; i++)
+			bitArray.SetBits(i*bpp, bpp, indices[i]);
+
+		int numBytes = (numIndices*bpp + 7) / 8;
+		PackIndices(packed, indices, numIndices, bpp);
+		tRequire(tStd::tMemcmp(packed, reference, numBytes) == 0);
+
+		UnpackIndices(unpacked, packed, numIndices, bpp);
+		tRequire(tStd::tMemcmp(unpacked, indices, numIndices) == 0);
+
+		ExpandIndices(expanded, packed, numIndices, bpp, palette);
+		bool expandMatches = true;
+		for (int i = 0; i < numIndices; i++)
+			if (expanded[i] != palette[indices[i]])
+				expandMatches = false;
+		tRequire(expandMatches);
+	}
+	delete[] expanded;
+
 	tSystem::tSetCurrentDir(origDir);
 }
 
@@ -694,6 +1078,31 @@ tTestUnit(ImageMetaData)
 	metaDataLoaded.Load(reader.Chunk());
 	tRequire(metaDataLoaded == metaData);
 
+	// Reading the metadata straight from the file, without decoding the image, must give the same result.
+	tMetaData metaDataOnly("TestData/Images/EXIF_XMP/HasLatLong.jpg");
+	tRequire(metaDataOnly == metaData);
+
+	// The batch reader must match decoding each jpg individually.
+	tList<tStringItem> metaFiles;
+	tSystem::tFindFiles(metaFiles, "TestData/Images/EXIF_XMP/", "jpg");
+	int numMetaFiles = metaFiles.GetNumItems();
+	tMetaData* batchResults = new tMetaData[numMetaFiles];
+	int numBatchValid = tGetMetaData(batchResults, metaFiles);
+	int numDecodedValid = 0;
+	int fileIndex = 0;
+	bool batchMatches = true;
+	for (tStringItem* file = metaFiles.First(); file; file = file->Next(), fileIndex++)
+	{
+		tImageJPG decoded(*file);
+		if (decoded.MetaData.IsValid())
+			numDecodedValid++;
+		if (!(decoded.MetaData == batchResults[fileIndex]))
+			batchMatches = false;
+	}
+	tRequire(batchMatches);
+	tRequire(numBatchValid == numDecodedValid);
+	delete[] batchResults;
+
 	PrintMetaDataTag(metaData, tMetaTag::Make);
 	PrintMetaDataTag(metaData, tMetaTag::Model);
 	PrintMetaDataTag(metaData, tMetaTag::SerialNumber);
@@ -1290,6 +1699,88 @@ tTestUnit(ImageFilter)
 }
 
 
+// Writes a small APNG by hand so every dispose and blend op is present regardless of what an encoder would choose.
+// Each rect is X, Y, W, H, DisposeOp, BlendOp. Pixels are a function of the frame and position and, for 32-bit, the
+// alpha cycles through fully transparent, partial and opaque values.
+static bool WriteOpsAPNG(const tString& apngFile, int width, int height, int bpp, const int rects[][6], int numFrames)
+{
+	PNGChunkWriter png(1 << 16);
+	auto putU32 = PNGChunkWriter::PutU32;
+	uint8 ihdr[13];
+	putU32(ihdr, width); putU32(ihdr+4, height);
+	ihdr[8] = 8; ihdr[9] = (bpp == 4) ? 6 : 2; ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;
+	uint8 actl[8];
+	putU32(actl, numFrames); putU32(actl+4, 0);
+	bool success = png.PutChunk("IHDR", ihdr, 13) && png.PutChunk("acTL", actl, 8);
+
+	const uint8 alphas[] = { 0, 64, 128, 200, 255 };
+	uint32 sequence = 0;
+	for (int f = 0; (f < numFrames) && success; f++)
+	{
+		const int* rect = rects[f];
+		uint8 fctl[26];
+		putU32(fctl, sequence++);
+		putU32(fctl+4, rect[2]); putU32(fctl+8, rect[3]); putU32(fctl+12, rect[0]); putU32(fctl+16, rect[1]);
+		fctl[20] = 0; fctl[21] = uint8(5+f); fctl[22] = 0; fctl[23] = 100;
+		fctl[24] = uint8(rect[4]); fctl[25] = uint8(rect[5]);
+		success = png.PutChunk("fcTL", fctl, 26);
+
+		// Rows are unfiltered, so each starts with filter type 0.
+		int rawBytes = rect[3] * (1 + rect[2]*bpp);
+		uint8* raw = new uint8[rawBytes];
+		uint8* dst = raw;
+		for (int y = 0; y < rect[3]; y++)
+		{
+			*dst++ = 0;
+			for (int x = 0; x < rect[2]; x++)
+			{
+				int px = rect[0] + x; int py = rect[1] + y;
+				*dst++ = uint8(f*53 + px*29 + py*13);
+				*dst++ = uint8(f*17 + px*7 + py*41);
+				*dst++ = uint8(f*97 + px*py*3);
+				if (bpp == 4)
+					*dst++ = alphas[(f + px + 2*py) % 5];
+			}
+		}
+
+		uLongf zipBytes = compressBound(rawBytes);
+		uint8* zip = new uint8[4 + zipBytes];
+		success = success && (compress2(zip+4, &zipBytes, raw, rawBytes, 9) == Z_OK);
+		if (success && (f == 0))
+		{
+			success = png.PutChunk("IDAT", zip+4, int(zipBytes));
+		}
+		else if (success)
+		{
+			putU32(zip, sequence++);
+			success = png.PutChunk("fdAT", zip, 4 + int(zipBytes));
+		}
+		delete[] zip;
+		delete[] raw;
+	}
+
+	return success && png.PutChunk("IEND", nullptr, 0) && png.Save(apngFile);
+}
+
+
+// Returns true if both frame lists have the same number of frames and every frame has identical dimensions, duration
+// and pixels.
+static bool APNGFramesMatch(const tList<tFrame>& a, const tList<tFrame>& b)
+{
+	if (a.GetNumItems() != b.GetNumItems())
+		return false;
+
+	for (tFrame* fa = a.Head(), *fb = b.Head(); fa && fb; fa = fa->Next(), fb = fb->Next())
+	{
+		if ((fa->Width != fb->Width) || (fa->Height != fb->Height) || (fa->Duration != fb->Duration))
+			return false;
+		if (tStd::tMemcmp(fa->Pixels, fb->Pixels, fa->Width*fa->Height*sizeof(tPixel4b)) != 0)
+			return false;
+	}
+	return true;
+}
+
+
 tTestUnit(ImageMultiFrame)
 {
 	if (!tSystem::tDirExists("TestData/Images/"))
@@ -1342,6 +1833,23 @@ tTestUnit(ImageMultiFrame)
 	webpDst2.Save("TestData/Images/WrittenIcos4DManyFrames.webp");
 	tRequire(tSystem::tFileExists("TestData/Images/WrittenIcos4DManyFrames.webp"));
 
+	// Frames are encoded independently, so a sequential and a parallel save must give the same file.
+	tImageWEBP::SaveParams webpParams;
+	webpParams.Method = 2;
+	int numWebPFrames = webpDst2.GetNumFrames();
+	webpParams.NumThreads = 1;
+	tRequire(webpDst2.Save("TestData/Images/WrittenIcos4DSequential.webp", webpParams));
+	webpParams.NumThreads = 0;
+	tRequire(webpDst2.Save("TestData/Images/WrittenIcos4DParallel.webp", webpParams));
+	int sequentialSize = 0; int parallelSize = 0;
+	uint8* sequentialData = tSystem::tLoadFile("TestData/Images/WrittenIcos4DSequential.webp", nullptr, &sequentialSize);
+	uint8* parallelData = tSystem::tLoadFile("TestData/Images/WrittenIcos4DParallel.webp", nullptr, &parallelSize);
+	tRequire(sequentialData && (sequentialSize == parallelSize) && (tStd::tMemcmp(sequentialData, parallelData, sequentialSize) == 0));
+	delete[] sequentialData;
+	delete[] parallelData;
+	tImageWEBP webpParallel("TestData/Images/WrittenIcos4DParallel.webp");
+	tRequire(webpParallel.IsValid() && (webpParallel.GetNumFrames() == numWebPFrames));
+
 	// tImageGIF supports saving multi-frame gif files.
 	tImageAPNG apngSrc3("TestData/Images/Icos4D.apng");
 	tImageGIF gifDst(apngSrc3.Frames, true);
@@ -1354,6 +1862,30 @@ tTestUnit(ImageMultiFrame)
 	apngDst.Save("TestData/Images/WrittenIcos4DManyFrames.apng");
 	tRequire(tSystem::tFileExists("TestData/Images/WrittenIcos4DManyFrames.apng"));
 
+	// Saving only the changed rectangles is lossless, so every reloaded frame must match the source.
+	tImageAPNG::SaveParams apngParams;
+	apngParams.Format = tImageAPNG::tFormat::BPP32;
+	apngParams.DirtyRects = true;
+	apngDst.Save("TestData/Images/WrittenIcos4DDirtyRects.apng", apngParams);
+	tImageAPNG apngDirty("TestData/Images/WrittenIcos4DDirtyRects.apng");
+	tRequire(apngDirty.GetNumFrames() == apngDst.GetNumFrames());
+	bool apngFramesMatch = true;
+	for (tFrame* a = apngDst.Frames.Head(), *b = apngDirty.Frames.Head(); a && b; a = a->Next(), b = b->Next())
+		apngFramesMatch = apngFramesMatch && (a->Width == b->Width) && (a->Height == b->Height) &&
+			(tStd::tMemcmp(a->Pixels, b->Pixels, a->Width*a->Height*sizeof(tPixel4b)) == 0);
+	tRequire(apngFramesMatch);
+
+	// Third-party files must decode identically with the tacent decoder and with apngdis.
+	tImageAPNG::LoadParams apngDisParams;
+	apngDisParams.Flags = tImageAPNG::LoadFlag_ForceApngDis;
+	const char* thirdPartyAPNGs[] = { "TestData/Images/Flame.apng", "TestData/Images/Icos4D.apng" };
+	for (const char* apngFile : thirdPartyAPNGs)
+	{
+		tImageAPNG direct(apngFile);
+		tImageAPNG disassembled(apngFile, apngDisParams);
+		tRequire(direct.IsValid() && APNGFramesMatch(direct.Frames, disassembled.Frames));
+	}
+
 	// Load a multipage tiff with no page duration info.
 	tPrintf("Test multipage TIFF load.\n");
 	tImageTIFF tiffMultipage("TestData/Images/Tiff_Multipage_ZIP.tif");
@@ -1378,6 +1910,85 @@ tTestUnit(ImageMultiFrame)
 }
 
 
+tTestUnit(ImageAPNG)
+{
+	// The tacent decoder and apngdis must agree exactly. Frame 0 uses dispose previous, which APNG treats as
+	// background for the first frame. The other frames overlap so background, previous and none disposal and source
+	// and over blending all affect later frames. 24-bit files have no alpha so over behaves like source for them.
+	const int rects[][6] =
+	{
+		{ 0, 0, 9, 7,	2, 0 },
+		{ 1, 1, 5, 4,	1, 1 },
+		{ 2, 2, 6, 3,	2, 1 },
+		{ 0, 0, 4, 4,	0, 0 },
+		{ 4, 1, 5, 6,	2, 1 },
+		{ 3, 3, 2, 2,	1, 0 },
+		{ 8, 6, 1, 1,	0, 1 },
+		{ 0, 3, 9, 2,	0, 1 }
+	};
+	const int numFrames = sizeof(rects) / sizeof(rects[0]);
+	tImageAPNG::LoadParams apngDisParams;
+	apngDisParams.Flags = tImageAPNG::LoadFlag_ForceApngDis;
+	for (int bpp = 3; bpp <= 4; bpp++)
+	{
+		tString opsFile;
+		tsPrintf(opsFile, "WrittenAPNG_Ops%d.apng", bpp*8);
+		tRequire(WriteOpsAPNG(opsFile, 9, 7, bpp, rects, numFrames));
+
+		tImageAPNG direct(opsFile);
+		tImageAPNG disassembled(opsFile, apngDisParams);
+		tRequire(direct.IsValid() && (direct.GetNumFrames() == numFrames));
+		tRequire(APNGFramesMatch(direct.Frames, disassembled.Frames));
+		tRequire(direct.GetFrame(0)->Duration == 0.05f);
+		tRequire(direct.GetFrame(0)->IsOpaque() == (bpp == 3));
+	}
+
+	// Files written by apngasm, which picks its own dispose and blend ops per frame. A square moves over a gradient
+	// and, for the 32-bit file, a translucent square moves over a partly transparent background.
+	const int width = 24; const int height = 16; const int numSaveFrames = 10;
+	for (int bpp = 3; bpp <= 4; bpp++)
+	{
+		tList<tFrame> srcFrames;
+		for (int f = 0; f < numSaveFrames; f++)
+		{
+			tFrame* frame = new tFrame;
+			frame->Width = width; frame->Height = height; frame->Duration = 0.04f;
+			frame->Pixels = new tPixel4b[width*height];
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					tPixel4b& p = frame->Pixels[y*width + x];
+					p.Set(x*10, y*15, 90, ((bpp == 4) && (x < 6)) ? 0 : 255);
+					if (p.A == 0)
+						p.Set(0, 0, 0, 0);
+					if ((x >= f*2) && (x < f*2+5) && (y >= 4) && (y < 9))
+						p.Set(250, f*20, 10, (bpp == 4) ? 160 : 255);
+					if ((bpp == 4) && (f & 1) && (x >= 18) && (y >= 12))
+						p.Set(0, 0, 0, 0);
+				}
+			}
+			srcFrames.Append(frame);
+		}
+
+		tString asmFile;
+		tsPrintf(asmFile, "WrittenAPNG_Asm%d.apng", bpp*8);
+		tImageAPNG src(srcFrames, false);
+		tImageAPNG::tFormat format = src.Save(asmFile, (bpp == 4) ? tImageAPNG::tFormat::BPP32 : tImageAPNG::tFormat::BPP24);
+		tRequire(format == ((bpp == 4) ? tImageAPNG::tFormat::BPP32 : tImageAPNG::tFormat::BPP24));
+
+		tImageAPNG direct(asmFile);
+		tImageAPNG disassembled(asmFile, apngDisParams);
+		tRequire(direct.GetNumFrames() == numSaveFrames);
+		tRequire(APNGFramesMatch(direct.Frames, disassembled.Frames));
+		tRequire(APNGFramesMatch(direct.Frames, srcFrames));
+
+		while (tFrame* frame = srcFrames.Remove())
+			delete frame;
+	}
+}
+
+
 tTestUnit(ImageGradient)
 {
 	if (!tSystem::tDirExists("TestData/Images/"))
@@ -1640,6 +2251,1103 @@ void DDSLoadDecodeSave(const tString& ddsfile, uint32 loadFlags = 0, bool saveAl
 }
 
 
+tTestUnit(ImageBMP)
+{
+	if (!tSystem::tDirExists("TestData/Images/"))
+		tSkipUnit(ImageBMP)
+	tString origDir = tSystem::tGetCurrentDir();
+	tSystem::tSetCurrentDir(origDir + "TestData/Images/");
+
+	// A non-multiple-of-4 width so the 24-bit rows are padded. Decode speed is measured by the ImageBMPLoad benchmark.
+	const int width = 1027;
+	const int height = 512;
+	tPixel4b* pixels = new tPixel4b[width*height];
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			pixels[y*width + x].Set(uint8(x), uint8(y), uint8(x ^ y), uint8(x + y));
+	tImageBMP src(pixels, width, height, true);
+
+	for (int bpp = 24; bpp <= 32; bpp += 8)
+	{
+		tString bmpFile;
+		tsPrintf(bmpFile, "WrittenBMP_BPP%d.bmp", bpp);
+		tImageBMP::tFormat format = (bpp == 24) ? tImageBMP::tFormat::BPP24 : tImageBMP::tFormat::BPP32;
+		tRequire(src.Save(bmpFile, format) == format);
+
+		int numBytes = 0;
+		uint8* bmpInMemory = tSystem::tLoadFile(bmpFile, nullptr, &numBytes);
+		tRequire(bmpInMemory && (numBytes > 0));
+
+		// Load from file and from memory must give identical results.
+		tImageBMP fromFile(bmpFile);
+		tImageBMP fromMem;
+		tRequire(fromMem.Load(bmpInMemory, numBytes));
+		tRequire(fromFile.IsValid() && (fromFile.GetWidth() == width) && (fromFile.GetHeight() == height));
+		tRequire(tStd::tMemcmp(fromFile.GetPixels(), fromMem.GetPixels(), width*height*sizeof(tPixel4b)) == 0);
+
+		bool match = true;
+		for (int p = 0; (p < width*height) && match; p++)
+		{
+			tPixel4b expected = src.GetPixels()[p];
+			if (bpp == 24)
+				expected.A = 0xFF;
+			match = (fromMem.GetPixels()[p] == expected);
+		}
+		tRequire(match);
+
+		// A truncated file must fail to load rather than read past the end.
+		tRequire(!fromMem.Load(bmpInMemory, numBytes/2));
+
+		// Saving to memory must produce the same bytes as saving to a file.
+		uint8* savedInMemory = nullptr;
+		int savedNumBytes = 0;
+		tImageBMP::SaveParams bmpSaveParams;
+		bmpSaveParams.Format = format;
+		tRequire(src.Save(savedInMemory, savedNumBytes, bmpSaveParams) == format);
+		tRequire((savedNumBytes == numBytes) && (tStd::tMemcmp(savedInMemory, bmpInMemory, numBytes) == 0));
+		delete[] savedInMemory;
+
+		delete[] bmpInMemory;
+		tSystem::tDeleteFile(bmpFile);
+	}
+
+	tSystem::tSetCurrentDir(origDir);
+}
+
+
+tTestUnit(ImageQOI)
+{
+	if (!tSystem::tDirExists("TestData/Images/"))
+		tSkipUnit(ImageQOI)
+
+	// A synthetic image with smooth gradients, flat areas, and noise so all the QOI ops get exercised. The height is not
+	// a multiple of any of the stripe counts. Encode and decode speed is measured by the ImageQOIStripes benchmark.
+	const int width = 1024;
+	const int height = 514;
+	tPixel4b* pixels = new tPixel4b[width*height];
+	uint32 seed = 0x12345678;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			seed = seed*1664525u + 1013904223u;
+			uint8 noise = ((x >> 6) & 3) == 0 ? uint8(seed >> 24) : 0;
+			pixels[y*width + x].Set(uint8(x >> 4), uint8(y >> 3), uint8((x >> 8) * 16 + noise), (x < width/2) ? 255 : uint8(y));
+		}
+	}
+	tImageQOI src(pixels, width, height, true);
+
+	for (int bpp = 24; bpp <= 32; bpp += 8)
+	{
+		tImageQOI::SaveParams params;
+		params.Format = (bpp == 24) ? tImageQOI::tFormat::BPP24 : tImageQOI::tFormat::BPP32;
+
+		// Stripe counts of 0 and 1 write a standard QOI file. The other counts exercise uneven last stripes.
+		const int stripeCounts[] = { 0, 1, 3, 16, 64 };
+		for (int stripes : stripeCounts)
+		{
+			params.NumStripes = stripes;
+			uint8* qoiInMemory = nullptr;
+			int numBytes = 0;
+			tRequire(src.Save(qoiInMemory, numBytes, params) == params.Format);
+			tRequire(qoiInMemory && (numBytes > 0));
+			tRequire((stripes > 1) == (tStd::tMemcmp(qoiInMemory, "qois", 4) == 0));
+
+			tImageQOI loaded;
+			tRequire(loaded.Load(qoiInMemory, numBytes));
+			tRequire((loaded.GetWidth() == width) && (loaded.GetHeight() == height));
+			bool match = true;
+			for (int p = 0; (p < width*height) && match; p++)
+			{
+				tPixel4b expected = src.GetPixels()[p];
+				if (bpp == 24)
+					expected.A = 0xFF;
+				match = (loaded.GetPixels()[p] == expected);
+			}
+			tRequire(match);
+
+			// The reference decoder tolerates truncated plain files, but a striped file must have all its stripes.
+			if (stripes > 1)
+				tRequire(!loaded.Load(qoiInMemory, numBytes/2));
+			delete[] qoiInMemory;
+		}
+	}
+}
+
+
+tTestUnit(ImageConvert)
+{
+	if (!tSystem::tDirExists("TestData/Images/"))
+		tSkipUnit(ImageConvert)
+
+	tString dir = "TestData/Images/Written_Convert/";
+	tSystem::tCreateDir(dir);
+
+	// Write a set of synthetic source images. Alternate between tga and qoi sources so more than one decoder runs.
+	const int numFiles = 24;
+	const int width = 256;
+	const int height = 128;
+	tList<tConvertJob> jobs;
+	for (int f = 0; f < numFiles; f++)
+	{
+		tPixel4b* pixels = new tPixel4b[width*height];
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++)
+				pixels[y*width + x].Set(uint8(x + f), uint8(y*2), uint8((x ^ y) + f*8), 255);
+
+		tString srcFile, dstFile;
+		const char* dstExt = ((f % 3) == 0) ? "qoi" : (((f % 3) == 1) ? "tga" : "bmp");
+		tsPrintf(dstFile, "%sConverted%02d.%s", dir.Chr(), f, dstExt);
+		if (f & 1)
+		{
+			tsPrintf(srcFile, "%sSource%02d.tga", dir.Chr(), f);
+			tImageTGA tga(pixels, width, height, true);
+			tRequire(tga.Save(srcFile) != tImageTGA::tFormat::Invalid);
+		}
+		else
+		{
+			tsPrintf(srcFile, "%sSource%02d.qoi", dir.Chr(), f);
+			tImageQOI qoi(pixels, width, height, true);
+			tRequire(qoi.Save(srcFile) != tImageQOI::tFormat::Invalid);
+		}
+		jobs.Append(new tConvertJob(srcFile, dstFile));
+	}
+
+	tConvertParams params;
+	params.ResampleWidth = width/2;
+	params.QuantizeColours = 64;
+	params.QueueCapacity = 2;
+	tConvertStats stats;
+	int numConverted = tConvertBatch(jobs, params, &stats);
+	tRequire(numConverted == numFiles);
+	for (tConvertStage stage : { tConvertStage::Read, tConvertStage::Decode, tConvertStage::Write })
+		tRequire((stats.Stages[int(stage)].NumItems == numFiles) && (stats.Stages[int(stage)].NumFailed == 0));
+
+	for (tConvertJob* job = jobs.First(); job; job = job->Next())
+	{
+		if (!job->Success)
+			continue;
+		tPicture picture;
+		switch (tSystem::tGetFileType(job->DstFile))
+		{
+			case tSystem::tFileType::QOI:	{ tImageQOI img(job->DstFile); picture.Set(img); break; }
+			case tSystem::tFileType::TGA:	{ tImageTGA img(job->DstFile); picture.Set(img); break; }
+			case tSystem::tFileType::BMP:	{ tImageBMP img(job->DstFile); picture.Set(img); break; }
+		}
+		tRequire((picture.GetWidth() == width/2) && (picture.GetHeight() == height/2));
+	}
+
+	// A missing source must fail at Read and an unsupported destination at Encode without stalling the pipeline.
+	// Throughput is measured by the ImageConvert benchmark.
+	tList<tConvertJob> badJobs;
+	tConvertJob* missing = badJobs.Append(new tConvertJob(dir + "DoesNotExist.tga", dir + "DoesNotExist.qoi"));
+	tConvertJob* badDst = badJobs.Append(new tConvertJob(dir + "Source01.tga", dir + "BadDestination.xyz"));
+	tConvertStats badStats;
+	tRequire(tConvertBatch(badJobs, params, &badStats) == 0);
+	tRequire(!missing->Success && (missing->FailedStage == tConvertStage::Read));
+	tRequire(!badDst->Success && (badDst->FailedStage == tConvertStage::Encode));
+	tRequire(badStats.Stages[int(tConvertStage::Read)].NumFailed == 1);
+	tRequire(badStats.Stages[int(tConvertStage::Encode)].NumFailed == 1);
+	tRequire(badStats.Stages[int(tConvertStage::Write)].NumItems == 0);
+}
+
+
+tTestUnit(ImageAtlas)
+{
+	// Synthetic sprites with a unique colour per sprite and a 2 pixel transparent border so trimming has something
+	// to remove. No test data is needed.
+	const int numSprites = 300;
+	tPicture* sprites = new tPicture[numSprites];
+	const tPicture** spritePtrs = new const tPicture*[numSprites];
+	for (int s = 0; s < numSprites; s++)
+	{
+		int w = 6 + (s*7) % 29;
+		int h = 6 + (s*13) % 37;
+		sprites[s].Set(w, h, tColour4b::transparent);
+		for (int y = 2; y < h-2; y++)
+			for (int x = 2; x < w-2; x++)
+				sprites[s].SetPixel(x, y, tColour4b(uint8(s), uint8(s >> 8), uint8(x*8), uint8(128 + y)));
+		spritePtrs[s] = &sprites[s];
+	}
+
+	for (int method = 0; method < 2; method++)
+	{
+		for (int options = 0; options < 2; options++)
+		{
+			tAtlas::Params params;
+			params.Method = method ? tAtlas::tMethod::Skyline : tAtlas::tMethod::MaxRects;
+			params.PageWidth = 256;
+			params.PageHeight = 256;
+			params.Padding = options ? 1 : 0;
+			params.Extrude = options ? 2 : 0;
+			params.AllowRotation = options ? true : false;
+			params.Trim = options ? true : false;
+
+			tAtlas atlas;
+			int numPacked = atlas.Build(spritePtrs, numSprites, params);
+			tRequire(numPacked == numSprites);
+			tRequire(atlas.GetNumPages() >= 1);
+			tPrintf
+			(
+				"Atlas %s Options:%d Pages:%d Occupancy:%.3f\n",
+				method ? "Skyline" : "MaxRects", options, atlas.GetNumPages(), atlas.GetOccupancy()
+			);
+
+			// Sprites, including extrusion and padding, must be inside the page and must not overlap.
+			int extrude = params.Extrude;
+			int pad = params.Padding;
+			bool overlap = false;
+			bool outside = false;
+			for (int a = 0; a < numSprites; a++)
+			{
+				const tAtlasEntry& ea = atlas.GetEntry(a);
+				if ((ea.X - extrude < 0) || (ea.Y - extrude < 0) || (ea.X + ea.Width + extrude > params.PageWidth) || (ea.Y + ea.Height + extrude > params.PageHeight))
+					outside = true;
+				for (int b = a+1; b < numSprites; b++)
+				{
+					const tAtlasEntry& eb = atlas.GetEntry(b);
+					if (ea.Page != eb.Page)
+						continue;
+					if
+					(
+						(ea.X - extrude < eb.X + eb.Width + extrude + pad) && (eb.X - extrude < ea.X + ea.Width + extrude + pad) &&
+						(ea.Y - extrude < eb.Y + eb.Height + extrude + pad) && (eb.Y - extrude < ea.Y + ea.Height + extrude + pad)
+					)
+						overlap = true;
+				}
+			}
+			tRequire(!outside);
+			tRequire(!overlap);
+
+			// Every page pixel of every sprite must match the source pixel it came from.
+			bool pixelsMatch = true;
+			for (int s = 0; (s < numSprites) && pixelsMatch; s++)
+			{
+				const tAtlasEntry& entry = atlas.GetEntry(s);
+				if (options)
+					tRequire((entry.TrimX == 2) && (entry.TrimY == 2));
+				tPicture& page = atlas.GetPage(entry.Page);
+				for (int y = 0; y < entry.Height; y++)
+				{
+					for (int x = 0; x < entry.Width; x++)
+					{
+						int sx = entry.Rotated ? (entry.Height-1 - y) : x;
+						int sy = entry.Rotated ? x : y;
+						if (page.GetPixel(entry.X + x, entry.Y + y) != sprites[s].GetPixel(entry.TrimX + sx, entry.TrimY + sy))
+							pixelsMatch = false;
+					}
+				}
+
+				// The extruded pixels repeat the edge.
+				if (extrude && (page.GetPixel(entry.X - extrude, entry.Y) != page.GetPixel(entry.X, entry.Y)))
+					pixelsMatch = false;
+			}
+			tRequire(pixelsMatch);
+		}
+	}
+
+	// A sprite larger than the page is reported as not packed and does not stop the others.
+	tPicture huge;
+	huge.Set(300, 10, tColour4b::white);
+	const tPicture* mixed[2] = { &huge, &sprites[0] };
+	tAtlas::Params params;
+	params.PageWidth = 256;
+	params.PageHeight = 256;
+	tAtlas atlas;
+	tRequire(atlas.Build(mixed, 2, params) == 1);
+	tRequire((atlas.GetEntry(0).Page == -1) && (atlas.GetEntry(1).Page == 0));
+
+	// Allowing rotation lets it fit on a taller page.
+	params.PageHeight = 512;
+	params.AllowRotation = true;
+	tRequire(atlas.Build(mixed, 2, params) == 2);
+	tRequire(atlas.GetEntry(0).Rotated);
+
+	delete[] spritePtrs;
+	delete[] sprites;
+}
+
+
+tTestUnit(ImageToneMap)
+{
+	// Synthetic HDR pixels covering negatives, the [0,1] range, and large values. The lengths are chosen so the SIMD
+	// paths also have a scalar tail. No test data is needed.
+	const int numPixels = 40003;
+	tColour4f* src = new tColour4f[numPixels];
+	for (int p = 0; p < numPixels; p++)
+	{
+		float t = float(p) / float(numPixels-1);
+		src[p].Set(t*16.0f - 0.5f, t*t*64.0f, (1.0f-t)*4.0f, float(p % 256) / 255.0f);
+	}
+
+	tColour4f* mapped = new tColour4f[numPixels];
+	tColour4b* mapped4b = new tColour4b[numPixels];
+	tColour4b* mapped4bSingle = new tColour4b[numPixels];
+	for (int op = 0; op < int(tToneMapOperator::NumOperators); op++)
+	{
+		for (int encode = 0; encode < 3; encode++)
+		{
+			tToneMapParams params;
+			params.Operator = tToneMapOperator(op);
+			params.Exposure = 1.5f;
+			params.SRGBCompression = (encode == 1);
+			params.GammaCompression = (encode == 2);
+			params.Gamma = 2.2f;
+
+			tStd::tMemcpy(mapped, src, numPixels*sizeof(tColour4f));
+			ToneMap(mapped, numPixels, params);
+			ToneMap(mapped4b, src, numPixels, params);
+			params.NumThreads = 1;
+			ToneMap(mapped4bSingle, src, numPixels, params);
+
+			// Compare against the per-component maths in tColour.h.
+			float maxErr = 0.0f;
+			int maxErr4b = 0;
+			bool alphaKept = true;
+			for (int p = 0; p < numPixels; p++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					float x = src[p].E[c];
+					switch (params.Operator)
+					{
+						case tToneMapOperator::Exposure:	x = tMath::tTonemapExposure(x, params.Exposure);	break;
+						case tToneMapOperator::Reinhard:	x = tMath::tTonemapReinhard(x * params.Exposure);	break;
+						case tToneMapOperator::ACESFilmic:
+							x *= params.Exposure;
+							x = tMath::tSaturate((x*(2.51f*x + 0.03f)) / (x*(2.43f*x + 0.59f) + 0.14f));
+							break;
+						default:
+							break;
+					}
+					if (params.SRGBCompression)
+						x = tMath::tLinearToSRGB(x);
+					if (params.GammaCompression)
+						x = tMath::tLinearToGamma(tMath::tMax(x, 0.0f), params.Gamma);
+
+					maxErr = tMath::tMax(maxErr, tMath::tAbs(mapped[p].E[c] - x));
+					tColour4b expected; expected.Set(tColour4f(x, x, x, 1.0f));
+					maxErr4b = tMath::tMax(maxErr4b, tMath::tAbs(int(mapped4b[p].E[c]) - int(expected.R)));
+				}
+				if ((mapped[p].A != src[p].A) || (mapped4b[p].A != uint8(p % 256)))
+					alphaKept = false;
+			}
+			tRequire(maxErr < 1.0e-3f);
+			tRequire(maxErr4b <= 1);
+			tRequire(alphaKept);
+			tRequire(tStd::tMemcmp(mapped4b, mapped4bSingle, numPixels*sizeof(tColour4b)) == 0);
+		}
+	}
+
+	// EncodeLDR must give exactly what converting each pixel through float used to give.
+	tColour4b* ldr = new tColour4b[numPixels];
+	for (int p = 0; p < numPixels; p++)
+		ldr[p].Set(uint8(p % 256), uint8((p*7) % 256), uint8((p*13) % 256), uint8(p % 251));
+	tToneMapParams params;
+	params.SRGBCompression = true;
+	params.GammaCompression = true;
+	tStd::tMemcpy(mapped4b, ldr, numPixels*sizeof(tColour4b));
+	EncodeLDR(mapped4b, numPixels, params);
+	bool ldrMatch = true;
+	for (int p = 0; p < numPixels; p++)
+	{
+		tColour4f colour(ldr[p]);
+		colour.LinearToSRGB(tCompBit_RGB);
+		colour.LinearToGamma(params.Gamma, tCompBit_RGB);
+		tColour4b expected(colour);
+		if (mapped4b[p] != expected)
+			ldrMatch = false;
+	}
+	tRequire(ldrMatch);
+
+	delete[] ldr;
+	delete[] mapped4bSingle;
+	delete[] mapped4b;
+	delete[] mapped;
+	delete[] src;
+}
+
+
+tTestUnit(ImagePictureT)
+{
+	// Geometry ops on a 16-bit picture. Every pixel is unique so any misplaced pixel is caught.
+	const int w = 7;
+	const int h = 5;
+	tPicture4s orig(w, h);
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+			orig.SetPixel(x, y, tPixel4s(x*1000 + 3, y*1000 + 7, x*y + 300, 65535 - x - y*w));
+
+	tPicture4s pic(orig);
+	pic.Rotate90(false);
+	tRequire((pic.GetWidth() == h) && (pic.GetHeight() == w));
+	tRequire(pic.GetPixel(0, 0) == orig.GetPixel(w-1, 0));
+	pic.Rotate90(true);
+	tRequire(tStd::tMemcmp(pic.GetPixels(), orig.GetPixels(), w*h*sizeof(tPixel4s)) == 0);
+
+	pic.Flip(true);
+	tRequire(pic.GetPixel(0, 2) == orig.GetPixel(w-1, 2));
+	pic.Flip(false);
+	tRequire(pic.GetPixel(0, 0) == orig.GetPixel(w-1, h-1));
+	pic.Flip(true);
+	pic.Flip(false);
+	tRequire(tStd::tMemcmp(pic.GetPixels(), orig.GetPixels(), w*h*sizeof(tPixel4s)) == 0);
+
+	tRequire(pic.Crop(3, 8, 2, 1, tPixel4s::white));
+	tRequire((pic.GetWidth() == 3) && (pic.GetHeight() == 8));
+	tRequire(pic.GetPixel(0, 0) == orig.GetPixel(2, 1));
+	tRequire(pic.GetPixel(2, 3) == orig.GetPixel(4, 4));
+	tRequire(pic.GetPixel(1, 7) == tPixel4s::white);
+
+	// The tiled and in-place tPicture rotates and flips must match the straightforward tPictureT versions. The sizes
+	// cover partial SIMD blocks, partial tiles and images big enough to be split across threads.
+	int sizes[][2] = { { 1, 1 }, { 1, 6 }, { 9, 1 }, { 7, 5 }, { 37, 70 }, { 1031, 1029 } };
+	for (int s = 0; s < int(tNumElements(sizes)); s++)
+	{
+		int sw = sizes[s][0];
+		int sh = sizes[s][1];
+		tPicture picture(sw, sh);
+		tPicture4b expected(sw, sh);
+		for (int y = 0; y < sh; y++)
+		{
+			for (int x = 0; x < sw; x++)
+			{
+				tPixel4b c(x & 0xFF, y & 0xFF, x >> 8, y >> 8);
+				picture.SetPixel(x, y, c);
+				expected.SetPixel(x, y, c);
+			}
+		}
+
+		for (int op = 0; op < 4; op++)
+		{
+			switch (op)
+			{
+				case 0:		picture.Rotate90(false);	expected.Rotate90(false);	break;
+				case 1:		picture.Rotate90(true);		expected.Rotate90(true);	break;
+				case 2:		picture.Flip(true);			expected.Flip(true);		break;
+				case 3:		picture.Flip(false);		expected.Flip(false);		break;
+			}
+			tRequire((picture.GetWidth() == expected.GetWidth()) && (picture.GetHeight() == expected.GetHeight()));
+			tRequire(tStd::tMemcmp(picture.GetPixels(), expected.GetPixels(), sw*sh*sizeof(tPixel4b)) == 0);
+		}
+	}
+
+	// The tPicture channel operations run SIMD kernels over row spans and split large images across threads. Check
+	// them against straightforward per-pixel versions. No width is a multiple of 4 so the scalar tails always run,
+	// and the largest size is split across threads.
+	int channelSizes[][2] = { { 1, 1 }, { 3, 7 }, { 37, 11 }, { 1027, 1029 } };
+	comp_t channelMasks[] = { tCompBit_None, tCompBit_R, tCompBit_G | tCompBit_A, tCompBit_R | tCompBit_B | tCompBit_A, tCompBit_RGB, tCompBit_RGBA };
+	tComp swizzles[][4] =
+	{
+		{ tComp::B,		tComp::Full,	tComp::A,		tComp::Zero	},
+		{ tComp::Auto,	tComp::Auto,	tComp::Auto,	tComp::Zero	},
+		{ tComp::A,		tComp::A,		tComp::R,		tComp::G	},
+		{ tComp::Zero,	tComp::Zero,	tComp::Full,	tComp::Auto	},
+		{ tComp::G,		tComp::B,		tComp::R,		tComp::Full	},
+		{ tComp::A11,	tComp::Auto,	tComp::R,		tComp::A11	}
+	};
+	tComp spreads[] = { tComp::R, tComp::G, tComp::B, tComp::A };
+	int finalAlphas[] = { -1, 0, 77, 255 };
+	tColour4b setColour(19, 201, 77, 143);
+	tColour4b blendColour(10, 200, 90, 0);
+	auto swizzleChannel = [](tComp comp, const tPixel4b& src, int channel) -> uint8
+	{
+		switch (comp)
+		{
+			case tComp::R:		return src.R;
+			case tComp::G:		return src.G;
+			case tComp::B:		return src.B;
+			case tComp::A:		return src.A;
+			case tComp::Zero:	return 0;
+			case tComp::Full:	return 255;
+			case tComp::Auto:	return src.E[channel];
+			default:			return (channel == 3) ? 255 : 0;
+		}
+	};
+
+	for (int s = 0; s < int(tNumElements(channelSizes)); s++)
+	{
+		tPicture channels(channelSizes[s][0], channelSizes[s][1]);
+		int numPixels = channels.GetNumPixels();
+		for (int p = 0; p < numPixels; p++)
+			channels.GetPixels()[p].BP = uint32(p*2654435761u) ^ uint32(p >> 3);
+
+		bool setAllMatch = true;
+		bool intensityMatch = true;
+		bool blendMatch = true;
+		for (int m = 0; m < int(tNumElements(channelMasks)); m++)
+		{
+			comp_t mask = channelMasks[m];
+			tPicture setAll(channels);
+			setAll.SetAll(setColour, mask);
+			tPicture intensity(channels);
+			intensity.Intensity(mask);
+			for (int p = 0; p < numPixels; p++)
+			{
+				tPixel4b src = channels.GetPixels()[p];
+				tPixel4b expectedSet = src;
+				tPixel4b expectedIntensity = src;
+				int i = src.Intensity();
+				for (int c = 0; c < 4; c++)
+				{
+					if (mask & (1 << c))
+					{
+						expectedSet.E[c] = setColour.E[c];
+						expectedIntensity.E[c] = i;
+					}
+				}
+				if (setAll.GetPixels()[p] != expectedSet)
+					setAllMatch = false;
+				if (intensity.GetPixels()[p] != expectedIntensity)
+					intensityMatch = false;
+			}
+
+			for (int a = 0; a < int(tNumElements(finalAlphas)); a++)
+			{
+				tPicture blended(channels);
+				blended.AlphaBlendColour(blendColour, mask, finalAlphas[a]);
+				tColour4f blendf(blendColour);
+				for (int p = 0; p < numPixels; p++)
+				{
+					tColour4f srcf(channels.GetPixels()[p]);
+					tColour4f expected(srcf);
+					float oneMinusAlpha = 1.0f - srcf.A;
+					if (mask & tCompBit_R) expected.R = srcf.R*srcf.A + blendf.R*oneMinusAlpha;
+					if (mask & tCompBit_G) expected.G = srcf.G*srcf.A + blendf.G*oneMinusAlpha;
+					if (mask & tCompBit_B) expected.B = srcf.B*srcf.A + blendf.B*oneMinusAlpha;
+					if (finalAlphas[a] >= 0)
+						expected.SetA(finalAlphas[a]);
+					if (blended.GetPixels()[p] != tColour4b(expected))
+						blendMatch = false;
+				}
+			}
+		}
+		tRequire(setAllMatch);
+		tRequire(intensityMatch);
+		tRequire(blendMatch);
+
+		bool swizzleMatch = true;
+		for (int z = 0; z < int(tNumElements(swizzles)); z++)
+		{
+			tComp* comps = swizzles[z];
+			tPicture swizzled(channels);
+			swizzled.Swizzle(comps[0], comps[1], comps[2], comps[3]);
+			for (int p = 0; p < numPixels; p++)
+			{
+				tPixel4b src = channels.GetPixels()[p];
+				tPixel4b expected
+				(
+					swizzleChannel(comps[0], src, 0), swizzleChannel(comps[1], src, 1),
+					swizzleChannel(comps[2], src, 2), swizzleChannel(comps[3], src, 3)
+				);
+				if (swizzled.GetPixels()[p] != expected)
+					swizzleMatch = false;
+			}
+		}
+		tRequire(swizzleMatch);
+
+		bool spreadMatch = true;
+		for (int c = 0; c < int(tNumElements(spreads)); c++)
+		{
+			tPicture spread(channels);
+			spread.Spread(spreads[c]);
+			for (int p = 0; p < numPixels; p++)
+			{
+				tPixel4b src = channels.GetPixels()[p];
+				uint8 v = src.E[int(spreads[c])];
+				if (spread.GetPixels()[p] != tPixel4b(v, v, v, src.A))
+					spreadMatch = false;
+			}
+		}
+		tRequire(spreadMatch);
+	}
+
+	// A 16-bit resample of an 8-bit image scaled by 257 should be within rounding of the 8-bit resample. The 8-bit
+	// path rounds after each of the two passes and the wider kernels amplify that, so allow two 8-bit steps.
+	tPicture4b pic8(w, h);
+	tPicture4s pic16(w, h);
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			tPixel4b c(x*36, y*60, (x*y*11) % 256, 255 - x*y);
+			pic8.SetPixel(x, y, c);
+			pic16.SetPixel(x, y, tPixel4s(c.R*257, c.G*257, c.B*257, c.A*257));
+		}
+	}
+	for (int f = 0; f < int(tResampleFilter::NumFilters); f++)
+	{
+		tPicture4b dst8(pic8);
+		tPicture4s dst16(pic16);
+		tRequire(dst8.Resample(19, 13, tResampleFilter(f)));
+		tRequire(dst16.Resample(19, 13, tResampleFilter(f)));
+
+		// The templated resampler must be identical to tPicture for 8-bit pixels.
+		tPicture legacy(w, h, pic8.GetPixels(), true);
+		legacy.Resample(19, 13, tResampleFilter(f));
+		tRequire(tStd::tMemcmp(legacy.GetPixels(), dst8.GetPixels(), 19*13*sizeof(tPixel4b)) == 0);
+
+		int maxDiff = 0;
+		for (int p = 0; p < 19*13; p++)
+			for (int c = 0; c < 4; c++)
+				maxDiff = tMath::tMax(maxDiff, tMath::tAbs(int(dst8.GetPixels()[p].E[c])*257 - int(dst16.GetPixels()[p].E[c])));
+		tRequire(maxDiff <= 2*257);
+	}
+
+	// Float pictures keep values outside [0, 1].
+	tPicture4f hdr(4, 4, tPixel4f(8.0f, 0.25f, 40.0f, 1.0f));
+	tRequire(hdr.Resample(9, 6, tResampleFilter::Bicubic_CatmullRom));
+	bool preserved = true;
+	for (int p = 0; p < hdr.GetNumPixels(); p++)
+	{
+		const tPixel4f& c = hdr.GetPixels()[p];
+		if ((tMath::tAbs(c.R - 8.0f) > 1.0e-4f) || (tMath::tAbs(c.G - 0.25f) > 1.0e-4f) || (tMath::tAbs(c.B - 40.0f) > 1.0e-3f))
+			preserved = false;
+	}
+	tRequire(preserved);
+
+	// 16-bit pictures saved as png and tiff must load back bit-exact. Both the 4 and 3 channel (opaque) layouts are
+	// written. The rows differ so a vertical flip would be caught.
+	tPicture4s deep(w, h);
+	tPicture4s deepOpaque(w, h);
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			tPixel4s c(x*9001 + y*13 + 1, 65535 - x*y*517, (x*y*4099 + 257) & 0xFFFF, (y*w + x)*1871);
+			deep.SetPixel(x, y, c);
+			deepOpaque.SetPixel(x, y, tPixel4s(c.R, c.G, c.B, 65535));
+		}
+	}
+	tPicture4s* deepPictures[] = { &deep, &deepOpaque };
+	tImagePNG::tFormat pngFormats[] = { tImagePNG::tFormat::BPP64_RGBA_BPC16, tImagePNG::tFormat::BPP48_RGB_BPC16 };
+	for (int d = 0; d < int(tNumElements(deepPictures)); d++)
+	{
+		const tPicture4s& src = *deepPictures[d];
+		tPicture4s copy(src);
+		tImagePNG pngDeep(copy);
+		tRequire(pngDeep.Save("WrittenPictureT16.png") == pngFormats[d]);
+		tImagePNG::LoadParams pngParams;
+		pngParams.Flags = 0;
+		tImagePNG pngLoaded("WrittenPictureT16.png", pngParams);
+		tRequire(pngLoaded.IsValid() && pngLoaded.GetPixels16() && (pngLoaded.GetWidth() == w) && (pngLoaded.GetHeight() == h));
+		tRequire(tStd::tMemcmp(pngLoaded.GetPixels16(), src.GetPixels(), w*h*sizeof(tPixel4s)) == 0);
+
+		tRequire(tImageTIFF::Save("WrittenPictureT16.tif", src));
+		tPicture4s tiffLoaded;
+		tRequire(tImageTIFF::Load("WrittenPictureT16.tif", tiffLoaded));
+		tRequire((tiffLoaded.GetWidth() == w) && (tiffLoaded.GetHeight() == h));
+		tRequire(tStd::tMemcmp(tiffLoaded.GetPixels(), src.GetPixels(), w*h*sizeof(tPixel4s)) == 0);
+	}
+
+	// Float pictures saved as exr must load back exactly. The values are all representable as halves and include
+	// negatives, HDR values and a denormal. The opaque picture is written without alpha and reads back as 1.0.
+	tPicture4f floats(w, h);
+	tPicture4f floatsOpaque(w, h);
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			tPixel4f c(float(x)*0.125f - 0.5f, float(y*w + x)*64.0f, tMath::tPow(2.0f, float(x - y*4)), float(y)*0.25f);
+			floats.SetPixel(x, y, c);
+			floatsOpaque.SetPixel(x, y, tPixel4f(c.R, c.G, c.B, 1.0f));
+		}
+	}
+	floats.Pixel(0, 0).B = tMath::tPow(2.0f, -20.0f);
+	tPicture4f* floatPictures[] = { &floats, &floatsOpaque };
+	for (int f = 0; f < int(tNumElements(floatPictures)); f++)
+	{
+		const tPicture4f& src = *floatPictures[f];
+		tRequire(tImageEXR::Save("WrittenPictureT.exr", src));
+		tPicture4f exrLoaded;
+		tRequire(tImageEXR::Load("WrittenPictureT.exr", exrLoaded));
+		tRequire((exrLoaded.GetWidth() == w) && (exrLoaded.GetHeight() == h));
+		tRequire(tStd::tMemcmp(exrLoaded.GetPixels(), src.GetPixels(), w*h*sizeof(tPixel4f)) == 0);
+	}
+}
+
+
+tTestUnit(ImagePVRTC)
+{
+	// Banded multi-threaded PVRTC decodes must match the single call exactly, including the wrapped word rows at the
+	// top and bottom edges. Any bytes are valid PVRTC. The small size goes through the padded path.
+	int sizes[][2] = { { 512, 256 }, { 256, 512 }, { 64, 128 }, { 4, 4 } };
+	tPixelFormat formats[] = { tPixelFormat::PVRBPP2, tPixelFormat::PVRBPP4 };
+	for (int s = 0; s < int(tNumElements(sizes)); s++)
+	{
+		for (int f = 0; f < int(tNumElements(formats)); f++)
+		{
+			int w = sizes[s][0];
+			int h = sizes[s][1];
+			bool twoBit = (formats[f] == tPixelFormat::PVRBPP2);
+			int dataSize = tMath::tMax(w, twoBit ? 16 : 8) * tMath::tMax(h, 8) / (twoBit ? 4 : 2);
+			uint8* data = new uint8[dataSize];
+			for (int b = 0; b < dataSize; b++)
+				data[b] = uint8((b*2654435761u) >> 13);
+
+			tColour4b* single = nullptr;
+			tColour4b* banded = nullptr;
+			tColour4f* unused = nullptr;
+			tRequire(DecodePixelData_PVR(formats[f], data, dataSize, w, h, single, unused, 1) == DecodeResult::Success);
+			tRequire(DecodePixelData_PVR(formats[f], data, dataSize, w, h, banded, unused, 3) == DecodeResult::Success);
+			tRequire(tStd::tMemcmp(single, banded, w*h*sizeof(tColour4b)) == 0);
+
+			delete[] banded;
+			delete[] single;
+			delete[] data;
+		}
+	}
+}
+
+
+tTestUnit(ImageTextureSave)
+{
+	// Layers are written without any decode so loading a saved file must give back identical layer data. R8G8B8 uses
+	// a legacy dds header. BC3 rows are reversed in the compressed domain. BC7 cannot be reversed so it round-trips in
+	// the order given.
+	tPicture src(64, 32);
+	for (int y = 0; y < src.GetHeight(); y++)
+		for (int x = 0; x < src.GetWidth(); x++)
+			src.SetPixel(x, y, x*4, y*8, (x^y)*4, 128 + x);
+
+	tPixelFormat formats[] = { tPixelFormat::R8G8B8A8, tPixelFormat::R8G8B8, tPixelFormat::BC3DXT4DXT5, tPixelFormat::BC7 };
+	for (int f = 0; f < int(tNumElements(formats)); f++)
+	{
+		tPicture picture(src);
+		tTexture texture(picture, true, formats[f], tTexture::tQuality::Fast);
+		tRequire(texture.IsValid() && (texture.GetNumMipmaps() == 7));
+		tRequire(tImageDDS::Save("WrittenTextureSave.dds", texture));
+		tRequire(tImageKTX::Save("WrittenTextureSave.ktx2", texture));
+
+		// Encode again but stream each level straight to disk. Only one level is alive at a time.
+		tImageDDS::Writer ddsWriter;
+		tImageKTX::Writer ktxWriter;
+		bool opened = false;
+		auto streamLayer = [&](const tLayer& layer, int mipmap, int numMipmaps) -> bool
+		{
+			if (mipmap == 0)
+				opened =
+					ddsWriter.Open("WrittenTextureStream.dds", layer.PixelFormat, layer.Width, layer.Height, numMipmaps) &&
+					ktxWriter.Open("WrittenTextureStream.ktx2", layer.PixelFormat, layer.Width, layer.Height, numMipmaps);
+			return opened && ddsWriter.Write(0, mipmap, layer) && ktxWriter.Write(0, mipmap, layer);
+		};
+		tPicture streamPicture(src);
+		tTexture encoder;
+		tRequire(encoder.Encode(streamPicture, streamLayer, true, formats[f], tTexture::tQuality::Fast));
+		tRequire(!encoder.IsValid());
+		tRequire(ddsWriter.Close() && ktxWriter.Close());
+
+		const char* ddsFiles[] = { "WrittenTextureSave.dds", "WrittenTextureStream.dds" };
+		const char* ktxFiles[] = { "WrittenTextureSave.ktx2", "WrittenTextureStream.ktx2" };
+		for (int file = 0; file < 2; file++)
+		{
+			tImageDDS::LoadParams ddsParams;
+			ddsParams.Flags = tImageDDS::LoadFlag_ReverseRowOrder;
+			tImageDDS dds(ddsFiles[file], ddsParams);
+			tRequire(dds.IsValid() && (dds.GetNumMipmapLevels() == texture.GetNumMipmaps()));
+
+			tImageKTX::LoadParams ktxParams;
+			ktxParams.Flags = tImageKTX::LoadFlag_ReverseRowOrder;
+			tImageKTX ktx(ktxFiles[file], ktxParams);
+			tRequire(ktx.IsValid() && (ktx.GetNumMipmapLevels() == texture.GetNumMipmaps()));
+
+			int mipmap = 0;
+			for (tLayer* layer = texture.GetFirstLayer(); layer; layer = layer->Next(), mipmap++)
+			{
+				tRequire(*dds.GetLayer(mipmap, 0) == *layer);
+				tRequire(*ktx.GetLayer(mipmap, 0) == *layer);
+			}
+		}
+	}
+
+	// Saving a loaded file writes its rows back in the order they were loaded in. The sources are written in file
+	// order, as another tool would. BC7 rows cannot be reversed without a decode, so with or without the flag the
+	// loaded layers stay in file order and a re-save must not reverse them or change the orientation.
+	tPixelFormat reloadFormats[] = { tPixelFormat::R8G8B8A8, tPixelFormat::BC7 };
+	for (int f = 0; f < int(tNumElements(reloadFormats)); f++)
+	{
+		tPicture picture(src);
+		tTexture texture(picture, true, reloadFormats[f], tTexture::tQuality::Fast);
+		tImageDDS::SaveParams ddsSaveParams;
+		ddsSaveParams.ReverseRowOrder = false;
+		tImageDDS::Writer ddsWriter;
+		tImageKTX::Writer ktxWriter;
+		tRequire(ddsWriter.Open("WrittenTextureReload.dds", texture.GetPixelFormat(), texture.GetWidth(), texture.GetHeight(), texture.GetNumMipmaps(), 1, false, ddsSaveParams));
+		tRequire(ktxWriter.Open("WrittenTextureReload.ktx2", texture.GetPixelFormat(), texture.GetWidth(), texture.GetHeight(), texture.GetNumMipmaps(), 1, false, tImageKTX::SaveParams(), false));
+		int mipmap = 0;
+		for (tLayer* layer = texture.GetFirstLayer(); layer; layer = layer->Next(), mipmap++)
+			tRequire(ddsWriter.Write(0, mipmap, *layer) && ktxWriter.Write(0, mipmap, *layer));
+		tRequire(ddsWriter.Close() && ktxWriter.Close());
+
+		for (int reverse = 0; reverse < 2; reverse++)
+		{
+			tImageDDS::LoadParams ddsParams;
+			ddsParams.Flags = reverse ? tImageDDS::LoadFlag_ReverseRowOrder : 0;
+			tImageDDS dds("WrittenTextureReload.dds", ddsParams);
+			tImageKTX::LoadParams ktxParams;
+			ktxParams.Flags = reverse ? tImageKTX::LoadFlag_ReverseRowOrder : 0;
+			tImageKTX ktx("WrittenTextureReload.ktx2", ktxParams);
+			tRequire(dds.IsValid() && ktx.IsValid());
+			tRequire(ktx.RowsReversed() == (reverse && (reloadFormats[f] == tPixelFormat::R8G8B8A8)));
+			tRequire(dds.Save("WrittenTextureResave.dds") && ktx.Save("WrittenTextureResave.ktx2"));
+
+			const char* srcFiles[] = { "WrittenTextureReload.dds", "WrittenTextureReload.ktx2" };
+			const char* dstFiles[] = { "WrittenTextureResave.dds", "WrittenTextureResave.ktx2" };
+			for (int file = 0; file < 2; file++)
+			{
+				int srcSize = 0; int dstSize = 0;
+				uint8* srcData = tSystem::tLoadFile(srcFiles[file], nullptr, &srcSize);
+				uint8* dstData = tSystem::tLoadFile(dstFiles[file], nullptr, &dstSize);
+				tRequire(srcData && (srcSize == dstSize) && (tStd::tMemcmp(srcData, dstData, srcSize) == 0));
+				delete[] srcData;
+				delete[] dstData;
+			}
+		}
+	}
+
+	// Cubemaps write all six faces.
+	tPicture picture(src);
+	tTexture face(picture, true, tPixelFormat::BC3DXT4DXT5, tTexture::tQuality::Fast);
+	const tTexture* faces[tFaceIndex_NumFaces] = { &face, &face, &face, &face, &face, &face };
+	tRequire(tImageDDS::Save("WrittenTextureCubemap.dds", faces));
+	tImageDDS::LoadParams ddsParams;
+	ddsParams.Flags = tImageDDS::LoadFlag_ReverseRowOrder;
+	tImageDDS cubemap("WrittenTextureCubemap.dds", ddsParams);
+	tRequire(cubemap.IsValid() && cubemap.IsCubemap() && (cubemap.GetNumImages() == tFaceIndex_NumFaces));
+	for (int image = 0; image < tFaceIndex_NumFaces; image++)
+		tRequire(*cubemap.GetLayer(0, image) == *face.GetFirstLayer());
+
+	tRequire(tImageKTX::Save("WrittenTextureCubemap.ktx2", faces));
+	tImageKTX::LoadParams ktxParams;
+	ktxParams.Flags = tImageKTX::LoadFlag_ReverseRowOrder;
+	tImageKTX ktxCubemap("WrittenTextureCubemap.ktx2", ktxParams);
+	tRequire(ktxCubemap.IsValid() && ktxCubemap.IsCubemap() && (ktxCubemap.GetNumImages() == tFaceIndex_NumFaces));
+	tRequire(ktxCubemap.GetNumMipmapLevels() == face.GetNumMipmaps());
+	for (int image = 0; image < tFaceIndex_NumFaces; image++)
+	{
+		int mipmap = 0;
+		for (tLayer* layer = face.GetFirstLayer(); layer; layer = layer->Next(), mipmap++)
+			tRequire(*ktxCubemap.GetLayer(mipmap, image) == *layer);
+	}
+}
+
+
+tTestUnit(ImageEnvMap)
+{
+	// Reads the texel at (x, y) of a float layer.
+	auto getTexel = [](const tLayer* layer, int x, int y) -> tColour4f
+	{
+		return ((const tColour4f*)layer->Data)[y*layer->Width + x];
+	};
+
+	// A constant panorama must give constant faces, specular mipmaps and irradiance.
+	tPicture4f constant(64, 32, tColour4f(0.25f, 0.5f, 2.0f, 1.0f));
+	tPicture4f faces[tFaceIndex_NumFaces];
+	tRequire(EquirectToCubemap(faces, constant, 16));
+	tEnvMapParams params;
+	params.PixelFormat = tPixelFormat::R32G32B32A32f;
+	params.NumSpecularSamples = 64;
+	params.IrradianceSize = 4;
+	params.NumIrradianceSamples = 64;
+	tList<tLayer> specular[tFaceIndex_NumFaces];
+	tList<tLayer> irradiance[tFaceIndex_NumFaces];
+	tRequire(PrefilterSpecular(specular, faces, params));
+	tRequire(ComputeIrradiance(irradiance, faces, params));
+	bool allConstant = true;
+	for (int f = 0; f < tFaceIndex_NumFaces; f++)
+	{
+		tRequire(specular[f].GetNumItems() == 5);
+		tRequire(irradiance[f].GetNumItems() == 1);
+		tList<tLayer>* lists[] = { &specular[f], &irradiance[f] };
+		for (int l = 0; l < 2; l++)
+		{
+			for (tLayer* layer = lists[l]->First(); layer; layer = layer->Next())
+			{
+				for (int p = 0; p < layer->Width*layer->Height; p++)
+				{
+					tColour4f c = ((const tColour4f*)layer->Data)[p];
+					if (!tMath::tApproxEqual(c.R, 0.25f, 1e-4f) || !tMath::tApproxEqual(c.G, 0.5f, 1e-4f) || !tMath::tApproxEqual(c.B, 2.0f, 1e-4f))
+						allConstant = false;
+				}
+			}
+		}
+	}
+	tRequire(allConstant);
+
+	// Light only from above the horizon. Irradiance is 1 facing up, 0 facing down, and 1/2 facing the horizon since
+	// half the cosine-weighted hemisphere is lit. An odd irradiance size puts a texel at the centre of each face.
+	tPicture4f sky(128, 64, tColour4f(0.0f, 0.0f, 0.0f, 1.0f));
+	for (int y = sky.GetHeight()/2; y < sky.GetHeight(); y++)
+		for (int x = 0; x < sky.GetWidth(); x++)
+			sky.SetPixel(x, y, tColour4f(1.0f, 1.0f, 1.0f, 1.0f));
+	tRequire(EquirectToCubemap(faces, sky, 32));
+	tRequire(faces[tFaceIndex_PosY].GetPixel(16, 16).G == 1.0f);
+	tRequire(faces[tFaceIndex_NegY].GetPixel(16, 16).G == 0.0f);
+	params.NumSpecularSamples = 256;
+	params.IrradianceSize = 5;
+	params.NumIrradianceSamples = 512;
+	tRequire(PrefilterSpecular(specular, faces, params));
+	tRequire(ComputeIrradiance(irradiance, faces, params));
+	tRequire(tMath::tApproxEqual(getTexel(irradiance[tFaceIndex_PosY].First(), 2, 2).G, 1.0f, 0.02f));
+	tRequire(tMath::tApproxEqual(getTexel(irradiance[tFaceIndex_NegY].First(), 2, 2).G, 0.0f, 0.02f));
+	tRequire(tMath::tApproxEqual(getTexel(irradiance[tFaceIndex_PosX].First(), 2, 2).G, 0.5f, 0.02f));
+
+	// The scene is symmetric about the horizon so facing up and facing down must sum to 1 at every roughness.
+	for (tLayer* up = specular[tFaceIndex_PosY].First(), *down = specular[tFaceIndex_NegY].First(); up && down; up = up->Next(), down = down->Next())
+	{
+		float upG = getTexel(up, up->Width/2, up->Height/2).G;
+		float downG = getTexel(down, down->Width/2, down->Height/2).G;
+		tRequire((upG > 0.9f) && tMath::tApproxEqual(upG + downG, 1.0f, 0.01f));
+	}
+
+	// Half-float layers go straight into a cubemap dds with a full mipmap chain.
+	params.PixelFormat = tPixelFormat::R16G16B16A16f;
+	tRequire(PrefilterSpecular(specular, faces, params));
+	int numMipmaps = specular[0].GetNumItems();
+	tRequire(numMipmaps == 6);
+	tImageDDS::Writer writer;
+	tRequire(writer.Open("WrittenEnvMap.dds", tPixelFormat::R16G16B16A16f, 32, 32, numMipmaps, tFaceIndex_NumFaces, true));
+	for (int f = 0; f < tFaceIndex_NumFaces; f++)
+	{
+		int mipmap = 0;
+		for (tLayer* layer = specular[f].First(); layer; layer = layer->Next(), mipmap++)
+			tRequire(writer.Write(f, mipmap, *layer));
+	}
+	tRequire(writer.Close());
+
+	tImageDDS::LoadParams ddsParams;
+	ddsParams.Flags = tImageDDS::LoadFlag_ReverseRowOrder;
+	tImageDDS dds("WrittenEnvMap.dds", ddsParams);
+	tRequire(dds.IsValid() && dds.IsCubemap() && (dds.GetNumMipmapLevels() == numMipmaps));
+	for (int f = 0; f < tFaceIndex_NumFaces; f++)
+	{
+		int mipmap = 0;
+		for (tLayer* layer = specular[f].First(); layer; layer = layer->Next(), mipmap++)
+			tRequire(*dds.GetLayer(mipmap, f) == *layer);
+	}
+}
+
+
+tTestUnit(ImageHDR)
+{
+	// Synthetic RGBE pixels cover every exponent, including 0 and the small exponents whose results are denormal. The
+	// floats must exactly match the Radiance definition (m + 0.5) * 2^(e - 136), or 0 if e is 0. The scanlines are
+	// written in the run-length format as literal dumps. The odd width leaves a tail for the scalar conversion.
+	const int rgbeWidth = 259;
+	const int rgbeHeight = 3;
+	tPixel4b* rgbe = new tPixel4b[rgbeWidth*rgbeHeight];
+	for (int y = 0; y < rgbeHeight; y++)
+		for (int x = 0; x < rgbeWidth; x++)
+			rgbe[y*rgbeWidth + x].Set(uint8(x*37 + y*101 + 11), uint8(x*11 + y*53 + 200), uint8(255 - x - y*7), uint8(x + y*85));
+
+	tString rgbeHeader;
+	tsPrintf(rgbeHeader, "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", rgbeHeight, rgbeWidth);
+	int rgbeNumBytes = rgbeHeader.Length() + rgbeHeight*(4 + 4*(rgbeWidth + (rgbeWidth+127)/128));
+	uint8* rgbeFile = new uint8[rgbeNumBytes];
+	uint8* rgbeWrite = rgbeFile;
+	tStd::tMemcpy(rgbeWrite, rgbeHeader.Chr(), rgbeHeader.Length());
+	rgbeWrite += rgbeHeader.Length();
+	for (int y = 0; y < rgbeHeight; y++)
+	{
+		*rgbeWrite++ = 2; *rgbeWrite++ = 2; *rgbeWrite++ = uint8(rgbeWidth >> 8); *rgbeWrite++ = uint8(rgbeWidth & 0xFF);
+		for (int c = 0; c < 4; c++)
+		{
+			for (int x = 0; x < rgbeWidth; x += 128)
+			{
+				int count = tMath::tMin(128, rgbeWidth - x);
+				*rgbeWrite++ = uint8(count);
+				for (int i = 0; i < count; i++)
+					*rgbeWrite++ = rgbe[y*rgbeWidth + x + i].E[c];
+			}
+		}
+	}
+	tRequire(rgbeWrite == rgbeFile + rgbeNumBytes);
+
+	uint8* rgbeCopy = new uint8[rgbeNumBytes];
+	for (int numThreads = 1; numThreads >= 0; numThreads--)
+	{
+		tImageHDR::LoadParams params;
+		params.OutputFloat = true;
+		params.NumThreads = numThreads;
+		tStd::tMemcpy(rgbeCopy, rgbeFile, rgbeNumBytes);
+		tImageHDR hdr;
+		tRequire(hdr.Load(rgbeCopy, rgbeNumBytes, params));
+		tRequire((hdr.GetWidth() == rgbeWidth) && (hdr.GetHeight() == rgbeHeight));
+
+		// The first scanline in the file is the top row.
+		bool exact = true;
+		for (int y = 0; y < rgbeHeight; y++)
+		{
+			for (int x = 0; x < rgbeWidth; x++)
+			{
+				const tPixel4b& src = rgbe[y*rgbeWidth + x];
+				const tPixel4f& dst = hdr.GetPixels4f()[(rgbeHeight-1-y)*rgbeWidth + x];
+				for (int c = 0; c < 3; c++)
+				{
+					float expected = src.A ? float(ldexp(double(src.E[c]) + 0.5, int(src.A) - 136)) : 0.0f;
+					exact = exact && (dst.E[c] == expected);
+				}
+				exact = exact && (dst.A == 1.0f);
+			}
+		}
+		tRequire(exact);
+	}
+	delete[] rgbeCopy;
+	delete[] rgbeFile;
+	delete[] rgbe;
+
+	if (!tSystem::tDirExists("TestData/Images/"))
+		tSkipUnit(ImageHDR)
+	tString origDir = tSystem::tGetCurrentDir();
+	tSystem::tSetCurrentDir(origDir + "TestData/Images/");
+
+	int numBytes = 0;
+	uint8* hdrInMemory = tSystem::tLoadFile("mpi_atrium_3.hdr", nullptr, &numBytes);
+	tRequire(hdrInMemory && (numBytes > 0));
+
+	// The loader modifies the header in place so each load gets its own copy.
+	uint8* hdrCopy = new uint8[numBytes];
+	tImageHDR single, multi;
+	for (int outputFloat = 0; outputFloat < 2; outputFloat++)
+	{
+		tImageHDR::LoadParams params;
+		params.OutputFloat = outputFloat ? true : false;
+
+		params.NumThreads = 1;
+		tStd::tMemcpy(hdrCopy, hdrInMemory, numBytes);
+		tRequire(single.Load(hdrCopy, numBytes, params));
+
+		params.NumThreads = 0;
+		tStd::tMemcpy(hdrCopy, hdrInMemory, numBytes);
+		tRequire(multi.Load(hdrCopy, numBytes, params));
+
+		// Decoding scanlines in parallel must not change the result.
+		int numPixels = single.GetWidth()*single.GetHeight();
+		tRequire((multi.GetWidth() == single.GetWidth()) && (multi.GetHeight() == single.GetHeight()));
+		if (outputFloat)
+		{
+			tRequire(single.GetPixelFormat() == tPixelFormat::R32G32B32A32f);
+			tRequire(single.GetPixels4f() && !single.GetPixels() && !single.GetFrame());
+			tRequire(tStd::tMemcmp(single.GetPixels4f(), multi.GetPixels4f(), numPixels*sizeof(tPixel4f)) == 0);
+			tRequire(single.GetPixels4f()[0].A == 1.0f);
+		}
+		else
+		{
+			tRequire(single.GetPixelFormat() == tPixelFormat::R8G8B8A8);
+			tRequire(tStd::tMemcmp(single.GetPixels(), multi.GetPixels(), numPixels*sizeof(tPixel4b)) == 0);
+		}
+	}
+
+	// A truncated file must fail to load.
+	tStd::tMemcpy(hdrCopy, hdrInMemory, numBytes);
+	tRequire(!single.Load(hdrCopy, numBytes/2));
+
+	delete[] hdrCopy;
+	delete[] hdrInMemory;
+	tSystem::tSetCurrentDir(origDir);
+}
+
+
 tTestUnit(ImageDDS)
 {
 	if (!tSystem::tDirExists("TestData/Images/"))
@@ -2075,6 +3783,107 @@ tTestUnit(ImageKTX1)
 
 tTestUnit(ImageKTX2)
 {
+	// Basis Universal payloads are made here with libktx so no test data is needed. A smooth image is encoded as ETC1S
+	// (BasisLZ supercompressed) and as UASTC. Without decoding, loading must transcode to BC7. With decoding it must
+	// transcode straight to R8G8B8A8 and the pixels must be close to a PNG reference written from the same source.
+	const int basisW = 64;
+	const int basisH = 48;
+	tPixel4b* basisSrc = new tPixel4b[basisW*basisH];
+	for (int y = 0; y < basisH; y++)
+		for (int x = 0; x < basisW; x++)
+			basisSrc[y*basisW + x].Set(x*4, y*5, 128 + x - y, 255);
+
+	tImagePNG basisRefSave(basisSrc, basisW, basisH, false);
+	tRequire(basisRefSave.Save("WrittenBasisReference.png") != tImagePNG::tFormat::Invalid);
+	tImagePNG basisRef("WrittenBasisReference.png");
+	tRequire(basisRef.IsValid() && (basisRef.GetWidth() == basisW) && (basisRef.GetHeight() == basisH));
+
+	// KTX rows go top to bottom.
+	tPixel4b* basisRows = new tPixel4b[basisW*basisH];
+	for (int y = 0; y < basisH; y++)
+		tStd::tMemcpy(basisRows + y*basisW, basisSrc + (basisH-1-y)*basisW, basisW*sizeof(tPixel4b));
+
+	for (int uastc = 0; uastc < 2; uastc++)
+	{
+		ktxTextureCreateInfo createInfo;
+		tStd::tMemset(&createInfo, 0, sizeof(createInfo));
+		createInfo.vkFormat			= VK_FORMAT_R8G8B8A8_SRGB;
+		createInfo.baseWidth		= basisW;
+		createInfo.baseHeight		= basisH;
+		createInfo.baseDepth		= 1;
+		createInfo.numDimensions	= 2;
+		createInfo.numLevels		= 1;
+		createInfo.numLayers		= 1;
+		createInfo.numFaces			= 1;
+		createInfo.isArray			= KTX_FALSE;
+		createInfo.generateMipmaps	= KTX_FALSE;
+		ktxTexture2* basisTex = nullptr;
+		tRequire(ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &basisTex) == KTX_SUCCESS);
+		tRequire(ktxTexture_SetImageFromMemory(ktxTexture(basisTex), 0, 0, 0, (const uint8*)basisRows, basisW*basisH*sizeof(tPixel4b)) == KTX_SUCCESS);
+
+		ktxBasisParams basisParams;
+		tStd::tMemset(&basisParams, 0, sizeof(basisParams));
+		basisParams.structSize			= sizeof(basisParams);
+		basisParams.uastc				= uastc ? KTX_TRUE : KTX_FALSE;
+		basisParams.threadCount			= 1;
+		basisParams.compressionLevel	= KTX_ETC1S_DEFAULT_COMPRESSION_LEVEL;
+		basisParams.qualityLevel		= 255;
+		basisParams.uastcFlags			= KTX_PACK_UASTC_LEVEL_DEFAULT;
+		tRequire(ktxTexture2_CompressBasisEx(basisTex, &basisParams) == KTX_SUCCESS);
+
+		uint8* basisFile = nullptr;
+		ktx_size_t basisSize = 0;
+		tRequire(ktxTexture_WriteToMemory(ktxTexture(basisTex), &basisFile, &basisSize) == KTX_SUCCESS);
+		ktxTexture_Destroy(ktxTexture(basisTex));
+		tImageKTX::tSupercompression supercompression = uastc ? tImageKTX::tSupercompression::None : tImageKTX::tSupercompression::BasisLZ;
+
+		tImageKTX::LoadParams params;
+		params.Flags = tImageKTX::LoadFlag_ReverseRowOrder;
+		tImageKTX bc7(basisFile, int(basisSize), params);
+		tRequire(bc7.IsValid() && bc7.WasTranscoded() && (bc7.GetPixelFormatSrc() == tPixelFormat::BC7));
+		tRequire(bc7.GetSupercompression() == supercompression);
+
+		params.Flags = tImageKTX::LoadFlag_Decode | tImageKTX::LoadFlag_ReverseRowOrder;
+		tImageKTX rgba(basisFile, int(basisSize), params);
+		tRequire(rgba.IsValid() && rgba.WasTranscoded() && (rgba.GetPixelFormatSrc() == tPixelFormat::R8G8B8A8));
+		tRequire(rgba.GetSupercompression() == supercompression);
+		tLayer* layer = rgba.GetLayer(0, 0);
+		tRequire(layer && (layer->PixelFormat == tPixelFormat::R8G8B8A8) && (layer->Width == basisW) && (layer->Height == basisH));
+
+		double sumSqErr = 0.0;
+		const tPixel4b* decoded = (const tPixel4b*)layer->Data;
+		const tPixel4b* reference = basisRef.GetPixels8();
+		for (int p = 0; p < basisW*basisH; p++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				double err = double(decoded[p].E[c]) - double(reference[p].E[c]);
+				sumSqErr += err*err;
+			}
+		}
+		double mse = tMath::tMax(sumSqErr / double(basisW*basisH*4), 0.0001);
+		double psnr = 10.0 * log10(255.0*255.0 / mse);
+		tRequire(psnr > (uastc ? 38.0 : 30.0));
+
+		// The ETC1S global data is a 20 byte header and a 20 byte descriptor per image followed by the endpoint,
+		// selector and Huffman table codebooks. Overwriting the codebooks leaves a file libktx reads without complaint
+		// but whose payload cannot be transcoded.
+		if (!uastc)
+		{
+			uint64 sgdOffset = 0; uint64 sgdLength = 0;
+			tStd::tMemcpy(&sgdOffset, basisFile + 64, sizeof(uint64));
+			tStd::tMemcpy(&sgdLength, basisFile + 72, sizeof(uint64));
+			tRequire((sgdLength > 40) && (sgdOffset + sgdLength <= basisSize));
+			tStd::tMemset(basisFile + sgdOffset + 40, 0xFF, int(sgdLength - 40));
+
+			tImageKTX corrupt(basisFile, int(basisSize), params);
+			tRequire(!corrupt.IsValid() && corrupt.IsStateSet(tImageKTX::StateBit::Fatal_TranscodeError));
+		}
+		free(basisFile);
+	}
+	delete[] basisRows;
+	delete[] basisSrc;
+
 	if (!tSystem::tDirExists("TestData/Images/"))
 		tSkipUnit(ImageKTX2)
 	tString origDir = tSystem::tGetCurrentDir();
@@ -2216,6 +4025,37 @@ tTestUnit(ImageKTX2)
 	// E5B9G9R9uf
 	KTXLoadDecodeSave("E5B9G9R9uf_RGB.ktx2",			decode | revrow);
 
+	// The supercompressed BC7 file must decode to the same pixels as the plain one, and the result must not depend on
+	// the number of decode threads.
+	{
+		tImageKTX::LoadParams params;
+		tImageKTX super("BC7_RGBA.ktx2", params);
+		tImageKTX plain("BC7_RGBANoSuper.ktx2", params);
+		params.NumThreads = 1;
+		tImageKTX single("BC7_RGBA.ktx2", params);
+		tRequire(super.IsValid() && plain.IsValid() && single.IsValid());
+		tRequire(super.GetSupercompression() != tImageKTX::tSupercompression::None);
+		tRequire(plain.GetSupercompression() == tImageKTX::tSupercompression::None);
+		tRequire(!super.WasTranscoded());
+		tRequire(super.GetNumMipmapLevels() == single.GetNumMipmapLevels());
+		for (int level = 0; level < super.GetNumMipmapLevels(); level++)
+		{
+			tLayer* superLayer = super.GetLayer(level, 0);
+			tLayer* singleLayer = single.GetLayer(level, 0);
+			tRequire(superLayer->GetDataSize() == singleLayer->GetDataSize());
+			tRequire(tStd::tMemcmp(superLayer->Data, singleLayer->Data, superLayer->GetDataSize()) == 0);
+		}
+		tLayer* superLayer = super.GetLayer(0, 0);
+		tLayer* plainLayer = plain.GetLayer(0, 0);
+		tRequire(superLayer->GetDataSize() == plainLayer->GetDataSize());
+		tRequire(tStd::tMemcmp(superLayer->Data, plainLayer->Data, superLayer->GetDataSize()) == 0);
+
+		// The transcode target is ignored for files that do not hold Basis Universal data.
+		params.TranscodeFormat = tPixelFormat::BC6U;
+		tImageKTX unaffected("BC7_RGBANoSuper.ktx2", params);
+		tRequire(unaffected.IsValid());
+	}
+
 	// Do this all over again, but without decoding and tRequire the pixel-format to be as expected.
 	// This time, since not decoding, it may be impossible to reverse the rows, so we can also expect
 	// to get conditional valids if it couldn't be done (for some of the BC formats).
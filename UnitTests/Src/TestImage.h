@@ -34,8 +34,19 @@ namespace tUnitTest
 	tTestUnit(ImageMipmap);
 	tTestUnit(ImageFilter);
 	tTestUnit(ImageMultiFrame);
+	tTestUnit(ImageAPNG);
 	tTestUnit(ImageGradient);
 	tTestUnit(ImagePNG);
+	tTestUnit(ImageBMP);
+	tTestUnit(ImageQOI);
+	tTestUnit(ImageConvert);
+	tTestUnit(ImageAtlas);
+	tTestUnit(ImageToneMap);
+	tTestUnit(ImagePictureT);
+	tTestUnit(ImagePVRTC);
+	tTestUnit(ImageTextureSave);
+	tTestUnit(ImageEnvMap);
+	tTestUnit(ImageHDR);
 	tTestUnit(ImageDDS);
 	tTestUnit(ImageKTX2);
 	tTestUnit(ImageKTX1);
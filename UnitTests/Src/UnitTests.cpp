@@ -181,8 +181,19 @@ int main(int argc, char** argv)
 	tTest(ImageMipmap);
 	tTest(ImageFilter);
 	tTest(ImageMultiFrame);
+	tTest(ImageAPNG);
 	tTest(ImageGradient);
 	tTest(ImagePNG);
+	tTest(ImageBMP);
+	tTest(ImageQOI);
+	tTest(ImageConvert);
+	tTest(ImageAtlas);
+	tTest(ImageToneMap);
+	tTest(ImagePictureT);
+	tTest(ImagePVRTC);
+	tTest(ImageTextureSave);
+	tTest(ImageEnvMap);
+	tTest(ImageHDR);
 	tTest(ImageDDS);
 	tTest(ImageKTX1);
 	tTest(ImageKTX2);